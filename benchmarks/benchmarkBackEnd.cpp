@@ -0,0 +1,326 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkBackEnd.cpp
+ * @brief  Benchmarks for the VIO backends, on a synthetic scene (same setup
+ * as testVioBackEnd) with a varying number of landmarks and horizon length.
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/PinholeCamera.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/navigation/ImuBias.h>
+
+#include "kimera-vio/backend/RegularVioBackEnd.h"
+#include "kimera-vio/backend/RegularVioBackEndParams.h"
+#include "kimera-vio/backend/VioBackEnd.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/imu-frontend/ImuFrontEnd-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontEnd.h"
+#include "kimera-vio/imu-frontend/ImuFrontEndParams.h"
+#include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO {
+
+namespace {
+
+// Elapsed time between two consecutive keyframes is 1 second.
+static constexpr Timestamp kTimeStep = 1e9;
+// ImuBuffer does not allow t = 0.
+static constexpr Timestamp kTStart = 1e9;
+static constexpr double kBaseline = 0.5;
+// Depth of the landmarks with an even id, the others are 5 meters further.
+static constexpr double kPlaneDepth = 20.0;
+// Number of keyframes processed after the horizon has been filled, so that
+// marginalization is part of what is timed.
+static constexpr int kNrKeyframesAfterHorizon = 5;
+
+}  // namespace
+
+// Stereo camera moving with constant velocity along x in front of a grid of
+// landmarks, 20 to 25 meters away. Measurements are perfect, so that the
+// benchmark times the optimization and not the robust losses.
+class BackEndFixture : public ::benchmark::Fixture {
+ public:
+  void SetUp(const ::benchmark::State& state) override {
+    num_landmarks_ = state.range(0);
+    horizon_ = static_cast<double>(state.range(1));
+    num_keyframes_ = static_cast<int>(horizon_) + kNrKeyframesAfterHorizon + 1;
+
+    imu_params_.gyro_noise_ = 0.00016968;
+    imu_params_.acc_noise_ = 0.002;
+    imu_params_.gyro_walk_ = 1.9393e-05;
+    imu_params_.acc_walk_ = 0.003;
+    imu_params_.n_gravity_ = gtsam::Vector3(0.0, 0.0, -9.81);
+    imu_params_.imu_integration_sigma_ = 1.0;
+    imu_params_.nominal_rate_ = 200.0;
+    imu_params_.imu_preintegration_type_ =
+        ImuPreintegrationType::kPreintegratedImuMeasurements;
+
+    // Image of 800x600 with a 120 deg field of view.
+    static constexpr double kFov = M_PI / 3 * 2;
+    const double fx = 800.0 / 2.0 / std::tan(kFov / 2.0);
+    cam_params_ = gtsam::Cal3_S2(fx, fx, 0.0, 400.0, 300.0);
+
+    createMeasurements();
+  }
+
+  void TearDown(const ::benchmark::State& /*state*/) override {
+    all_measurements_.clear();
+  }
+
+ protected:
+  void createMeasurements() {
+    // Landmarks on a square grid, alternating depth to avoid a degenerate
+    // (planar) scene.
+    const int side = std::ceil(std::sqrt(static_cast<double>(num_landmarks_)));
+    std::vector<gtsam::Point3> points;
+    points.reserve(num_landmarks_);
+    for (int i = 0; i < num_landmarks_; i++) {
+      const double x = 20.0 * (i % side) / side;
+      const double y = 20.0 * (i / side) / side - 10.0;
+      points.push_back(
+          gtsam::Point3(x, y, i % 2 == 0 ? kPlaneDepth : kPlaneDepth + 5.0));
+    }
+
+    const gtsam::Pose3 L_pose_R(gtsam::Rot3::identity(),
+                                gtsam::Point3(kBaseline, 0, 0));
+    TrackerStatusSummary tracker_status_valid;
+    tracker_status_valid.kfTrackingStatus_mono_ = TrackingStatus::VALID;
+    tracker_status_valid.kfTrackingStatus_stereo_ = TrackingStatus::VALID;
+    all_measurements_.clear();
+    poses_.clear();
+    for (int k = 0; k < num_keyframes_; k++) {
+      const gtsam::Pose3 pose_left(
+          gtsam::Rot3::identity(),
+          gtsam::Point3(velocity_ * static_cast<double>(k)));
+      poses_.push_back(pose_left);
+      gtsam::PinholeCamera<gtsam::Cal3_S2> cam_left(pose_left, cam_params_);
+      gtsam::PinholeCamera<gtsam::Cal3_S2> cam_right(
+          pose_left.compose(L_pose_R), cam_params_);
+      SmartStereoMeasurements measurement_frame;
+      measurement_frame.reserve(points.size());
+      for (size_t l_id = 0u; l_id < points.size(); l_id++) {
+        const gtsam::Point2 pt_left = cam_left.project2(points[l_id]);
+        const gtsam::Point2 pt_right = cam_right.project2(points[l_id]);
+        measurement_frame.push_back(std::make_pair(
+            l_id, gtsam::StereoPoint2(pt_left.x(), pt_right.x(), pt_left.y())));
+      }
+      all_measurements_.push_back(std::make_shared<StatusStereoMeasurements>(
+          std::make_pair(tracker_status_valid, measurement_frame)));
+    }
+  }
+
+  // Creates a backend, initializes it and feeds it all keyframes. Only the
+  // calls to spinOnce (hence addVisualInertialStateAndOptimize) are timed.
+  void runBackEnd(
+      ::benchmark::State& state,
+      const VioBackEndParams& backend_params,
+      const std::function<std::unique_ptr<VioBackEnd>(
+          const StereoCalibPtr&, const VioBackEndParams&)>& make_backend) {
+    const StereoCalibPtr stereo_calibration =
+        boost::make_shared<gtsam::Cal3_S2Stereo>(cam_params_.fx(),
+                                                 cam_params_.fy(),
+                                                 cam_params_.skew(),
+                                                 cam_params_.px(),
+                                                 cam_params_.py(),
+                                                 kBaseline);
+    for (auto _ : state) {
+      state.PauseTiming();
+      VIO::utils::ThreadsafeImuBuffer imu_buf(-1);
+      for (int k = 0; k < num_keyframes_; k++) {
+        // Constant speed, no acceleration.
+        Vector6 acc_gyr;
+        acc_gyr.head(3) = -imu_params_.n_gravity_ + imu_bias_.accelerometer();
+        acc_gyr.tail(3) = imu_bias_.gyroscope();
+        imu_buf.addMeasurement(int64_t(k) * kTimeStep + kTStart, acc_gyr);
+      }
+      ImuFrontEnd imu_frontend(imu_params_, imu_bias_);
+      std::unique_ptr<VioBackEnd> backend =
+          make_backend(stereo_calibration, backend_params);
+      backend->registerImuBiasUpdateCallback(
+          std::bind(&ImuFrontEnd::updateBias,
+                    std::ref(imu_frontend),
+                    std::placeholders::_1));
+      backend->initStateAndSetPriors(VioNavStateTimestamped(
+          kTStart, VioNavState(poses_[0], velocity_, imu_bias_)));
+      state.ResumeTiming();
+
+      for (int k = 1; k < num_keyframes_; k++) {
+        state.PauseTiming();
+        const Timestamp timestamp_lkf = (k - 1) * kTimeStep + kTStart;
+        const Timestamp timestamp_k = k * kTimeStep + kTStart;
+        ImuStampS imu_stamps;
+        ImuAccGyrS imu_accgyr;
+        CHECK(imu_buf.getImuDataInterpolatedUpperBorder(
+                  timestamp_lkf, timestamp_k, &imu_stamps, &imu_accgyr) ==
+              VIO::utils::ThreadsafeImuBuffer::QueryResult::kDataAvailable);
+        const auto& pim =
+            imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyr);
+        state.ResumeTiming();
+
+        backend->spinOnce(BackendInput(timestamp_k,
+                                       all_measurements_[k],
+                                       TrackingStatus::VALID,
+                                       pim));
+
+        state.PauseTiming();
+        imu_frontend.resetIntegrationWithCachedBias();
+        state.ResumeTiming();
+      }
+
+      state.PauseTiming();
+      backend.reset();
+      state.ResumeTiming();
+    }
+    // Keyframes per second.
+    state.SetItemsProcessed(state.iterations() * (num_keyframes_ - 1));
+    state.counters["landmarks"] = num_landmarks_;
+    state.counters["horizon"] = horizon_;
+  }
+
+  void setBackEndParams(VioBackEndParams* params) const {
+    CHECK_NOTNULL(params);
+    // We simulate points up to 25m away.
+    params->landmarkDistanceThreshold_ = 30;
+    params->horizon_ = horizon_;
+  }
+
+ protected:
+  int num_landmarks_ = 0;
+  double horizon_ = 0.0;
+  int num_keyframes_ = 0;
+  const gtsam::Vector3 velocity_ = gtsam::Vector3(1.0, 0.0, 0.0);
+  const ImuBias imu_bias_ =
+      ImuBias(gtsam::Vector3(0.1, -0.1, 0.3), gtsam::Vector3(0.1, 0.3, -0.2));
+  ImuParams imu_params_;
+  gtsam::Cal3_S2 cam_params_;
+  std::vector<gtsam::Pose3> poses_;
+  std::vector<StatusStereoMeasurementsPtr> all_measurements_;
+};
+
+/* -------------------------------------------------------------------------- */
+// Args: number of landmarks, horizon [s].
+static void BackEndArguments(::benchmark::internal::Benchmark* b) {
+  for (int num_landmarks : {8, 64, 256}) {
+    for (int horizon : {3, 6, 12}) {
+      b->Args({num_landmarks, horizon});
+    }
+  }
+  b->Unit(::benchmark::kMillisecond);
+}
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(BackEndFixture, addVisualInertialStateAndOptimize)
+(::benchmark::State& state) {
+  VioBackEndParams backend_params;
+  setBackEndParams(&backend_params);
+  runBackEnd(state,
+             backend_params,
+             [this](const StereoCalibPtr& stereo_calibration,
+                const VioBackEndParams& params) {
+               return VIO::make_unique<VioBackEnd>(
+                   gtsam::Pose3(),
+                   stereo_calibration,
+                   params,
+                   imu_params_,
+                   BackendOutputParams(false, 0, false),
+                   false);
+             });
+}
+BENCHMARK_REGISTER_F(BackEndFixture, addVisualInertialStateAndOptimize)
+    ->Apply(BackEndArguments);
+
+/* -------------------------------------------------------------------------- */
+// The regular backend does not receive planes from the mesher yet, hence this
+// seeds its planes with the landmarks that lie on the plane z = kPlaneDepth,
+// so that addRegularityFactors is part of what is timed. The plane is only
+// added to the optimization once it has more than
+// FLAGS_min_num_of_plane_constraints_to_add_factors landmarks in the state.
+class PlanarRegularVioBackEnd : public RegularVioBackEnd {
+ public:
+  PlanarRegularVioBackEnd(const Pose3& B_Pose_leftCam,
+                          const StereoCalibPtr& stereo_calibration,
+                          const VioBackEndParams& backend_params,
+                          const ImuParams& imu_params,
+                          const Plane& plane)
+      : RegularVioBackEnd(B_Pose_leftCam,
+                          stereo_calibration,
+                          backend_params,
+                          imu_params,
+                          BackendOutputParams(false, 0, false),
+                          false),
+        plane_(plane) {}
+  virtual ~PlanarRegularVioBackEnd() = default;
+
+  void addVisualInertialStateAndOptimize(
+      const Timestamp& timestamp_kf_nsec,
+      const StatusStereoMeasurements& status_smart_stereo_measurements_kf,
+      const gtsam::PreintegrationType& pim,
+      boost::optional<gtsam::Pose3> stereo_ransac_body_pose =
+          boost::none) override {
+    // The backend drops the planes that are not in its state after each
+    // optimization, so hand it the plane again until it has been added.
+    if (planes_.empty()) planes_.push_back(plane_);
+    RegularVioBackEnd::addVisualInertialStateAndOptimize(
+        timestamp_kf_nsec,
+        status_smart_stereo_measurements_kf,
+        pim,
+        stereo_ransac_body_pose);
+  }
+
+ private:
+  const Plane plane_;
+};
+
+BENCHMARK_DEFINE_F(BackEndFixture, regularAddVisualInertialStateAndOptimize)
+(::benchmark::State& state) {
+  RegularVioBackEndParams backend_params;
+  setBackEndParams(&backend_params);
+  CHECK(backend_params.backend_modality_ ==
+        RegularBackendModality::STRUCTURELESS_PROJECTION_AND_REGULARITY);
+  // Landmarks with an even id are at depth kPlaneDepth, see
+  // createMeasurements.
+  LandmarkIds plane_lmk_ids;
+  for (int l_id = 0; l_id < num_landmarks_; l_id += 2) {
+    plane_lmk_ids.push_back(l_id);
+  }
+  const Plane plane(gtsam::Symbol('P', 0),
+                    Plane::Normal(0.0, 0.0, 1.0),
+                    kPlaneDepth,
+                    plane_lmk_ids);
+  runBackEnd(state,
+             backend_params,
+             [this, &plane](const StereoCalibPtr& stereo_calibration,
+                            const VioBackEndParams& params) {
+               return std::unique_ptr<VioBackEnd>(
+                   VIO::make_unique<PlanarRegularVioBackEnd>(
+                       gtsam::Pose3(),
+                       stereo_calibration,
+                       params,
+                       imu_params_,
+                       plane));
+             });
+}
+BENCHMARK_REGISTER_F(BackEndFixture, regularAddVisualInertialStateAndOptimize)
+    ->Apply(BackEndArguments);
+
+}  // namespace VIO
@@ -0,0 +1,159 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkFeatureSelector.cpp
+ * @brief  Benchmarks for the anticipation-based feature selection, on a
+ * synthetic scene (same setup as testFeatureSelector) with a varying number
+ * of candidate corners and future keyframes.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include <gtsam/geometry/Cal3DS2.h>
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/backend/VioBackEndParams.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/FeatureSelector.h"
+#include "kimera-vio/frontend/VioFrontEndParams.h"
+
+namespace VIO {
+
+// Camera moving forward (along y) at 1m/s, looking at random points between
+// 2 and 20 meters away. Args: number of candidate corners, number of future
+// keyframes (horizon).
+class FeatureSelectorFixture : public ::benchmark::Fixture {
+ public:
+  void SetUp(const ::benchmark::State& state) override {
+    const size_t num_corners = state.range(0);
+    const size_t num_future_keyframes = state.range(1);
+
+    const gtsam::Cal3_S2 K(300, 300, 0.0, 640 / 2, 480 / 2);
+    // For the left camera to have z forward, we need a -90deg rotation
+    // along x.
+    const gtsam::Pose3 b_P_LCam(gtsam::Rot3::Ypr(0.0, 0.0, -M_PI / 2),
+                                gtsam::Point3());
+    const gtsam::Pose3 b_P_RCam =
+        b_P_LCam.compose(gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(0.1, 0, 0)));
+
+    feature_selection_data_ = FeatureSelectorData();
+    for (size_t k = 0u; k < num_future_keyframes; k++) {
+      feature_selection_data_.posesAtFutureKeyframes.push_back(StampedPose(
+          gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(0, 0.5 * k, 0)), 0.5 * k));
+    }
+    feature_selection_data_.body_P_leftCam = b_P_LCam;
+    feature_selection_data_.body_P_rightCam = b_P_RCam;
+    feature_selection_data_.left_undistRectCameraMatrix = K;
+    feature_selection_data_.right_undistRectCameraMatrix = K;
+    feature_selection_data_.currentNavStateCovariance =
+        0.0001 * gtsam::Matrix::Identity(15, 15);
+    feature_selection_data_.currentNavStateCovariance(4, 4) = 0.1;
+
+    // Undistorted camera with the same intrinsics.
+    cam_param_.calibration_ =
+        gtsam::Cal3DS2(K.fx(), K.fy(), 0.0, K.px(), K.py(), 0.0, 0.0);
+    cam_param_.camera_matrix_ = cv::Mat::eye(3, 3, CV_64F);
+    cam_param_.camera_matrix_.at<double>(0, 0) = K.fx();
+    cam_param_.camera_matrix_.at<double>(1, 1) = K.fy();
+    cam_param_.camera_matrix_.at<double>(0, 2) = K.px();
+    cam_param_.camera_matrix_.at<double>(1, 2) = K.py();
+    cam_param_.distortion_coeff_ = cv::Mat::zeros(1, 5, CV_64F);
+    cam_param_.distortion_model_ = "radtan";
+
+    // Fixed seed, so that all runs see the same scene.
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> u_dist(0.0, 640.0);
+    std::uniform_real_distribution<double> v_dist(0.0, 480.0);
+    std::uniform_real_distribution<double> depth_dist(2.0, 20.0);
+    available_corners_.clear();
+    corner_distances_.clear();
+    for (size_t i = 0u; i < num_corners; i++) {
+      available_corners_.push_back(KeypointCV(u_dist(rng), v_dist(rng)));
+      corner_distances_.push_back(depth_dist(rng));
+    }
+    success_probabilities_.assign(num_corners, 1.0);
+    // Select a fourth of the candidates, as the frontend would with
+    // maxFeaturesPerFrame_ ~ 4 * featureSelectionNrCornersToSelect_.
+    need_n_corners_ = std::max<int>(1, num_corners / 4);
+  }
+
+ protected:
+  void runFeatureSelection(
+      ::benchmark::State& state,
+      const FeatureSelectorParams::FeatureSelectionCriterion& criterion) {
+    VioBackEndParams backend_params;
+    backend_params.smartNoiseSigma_ = 1.0;
+    const FeatureSelector feature_selector(VioFrontEndParams(), backend_params);
+    for (auto _ : state) {
+      KeypointsCV selected;
+      std::vector<size_t> selected_indices;
+      std::vector<double> selected_gains;
+      std::tie(selected, selected_indices, selected_gains) =
+          feature_selector.featureSelectionLinearModel(available_corners_,
+                                                       success_probabilities_,
+                                                       corner_distances_,
+                                                       cam_param_,
+                                                       need_n_corners_,
+                                                       feature_selection_data_,
+                                                       criterion);
+      ::benchmark::DoNotOptimize(selected_indices);
+    }
+    state.SetItemsProcessed(state.iterations() * available_corners_.size());
+    state.counters["corners"] = available_corners_.size();
+    state.counters["horizon"] =
+        feature_selection_data_.posesAtFutureKeyframes.size();
+  }
+
+ protected:
+  FeatureSelectorData feature_selection_data_;
+  CameraParams cam_param_;
+  KeypointsCV available_corners_;
+  std::vector<double> success_probabilities_;
+  std::vector<double> corner_distances_;
+  int need_n_corners_ = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+// Args: number of candidate corners, number of future keyframes.
+static void FeatureSelectorArguments(::benchmark::internal::Benchmark* b) {
+  for (int num_corners : {50, 200, 800}) {
+    for (int num_future_keyframes : {3, 5, 10}) {
+      b->Args({num_corners, num_future_keyframes});
+    }
+  }
+  b->Unit(::benchmark::kMillisecond);
+}
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FeatureSelectorFixture, featureSelectionLinearModelMinEig)
+(::benchmark::State& state) {
+  runFeatureSelection(
+      state, FeatureSelectorParams::FeatureSelectionCriterion::MIN_EIG);
+}
+BENCHMARK_REGISTER_F(FeatureSelectorFixture, featureSelectionLinearModelMinEig)
+    ->Apply(FeatureSelectorArguments);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FeatureSelectorFixture, featureSelectionLinearModelLogDet)
+(::benchmark::State& state) {
+  runFeatureSelection(
+      state, FeatureSelectorParams::FeatureSelectionCriterion::LOGDET);
+}
+BENCHMARK_REGISTER_F(FeatureSelectorFixture, featureSelectionLinearModelLogDet)
+    ->Apply(FeatureSelectorArguments);
+
+}  // namespace VIO
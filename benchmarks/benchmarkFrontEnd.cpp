@@ -0,0 +1,281 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkFrontEnd.cpp
+ * @brief  Micro-benchmarks for the vision frontend kernels, on the stereo
+ * images in tests/data/ForStereoFrame.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/Tracker.h"
+#include "kimera-vio/frontend/VioFrontEndParams.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+// Two consecutive stereo frames, processed as in StereoVisionFrontEnd:
+// features detected and stereo-matched in the reference frame, tracked and
+// stereo-matched in the current frame. Each benchmark copies what the
+// benchmarked function modifies outside of the timed region.
+class FrontEndFixture : public ::benchmark::Fixture {
+ public:
+  void SetUp(const ::benchmark::State& /*state*/) override {
+    const std::string data_path = FLAGS_test_data_path + "/ForStereoFrame/";
+    cam_params_left_.parseYAML(data_path + "sensorLeft.yaml");
+    cam_params_right_.parseYAML(data_path + "sensorRight.yaml");
+
+    ref_stereo_frame_ = createStereoFrame(
+        0u, 1000, data_path + "left_img_0.png", data_path + "right_img_0.png");
+    cur_stereo_frame_ = createStereoFrame(
+        1u, 2000, data_path + "left_img_1.png", data_path + "right_img_1.png");
+    CHECK(ref_stereo_frame_->isRectified());
+    CHECK(cur_stereo_frame_->isRectified());
+
+    // Keep unprocessed copies, to benchmark detection and tracking.
+    raw_ref_stereo_frame_ = VIO::make_unique<StereoFrame>(*ref_stereo_frame_);
+    raw_cur_stereo_frame_ = VIO::make_unique<StereoFrame>(*cur_stereo_frame_);
+
+    cam_mask_ = cv::Mat(ref_stereo_frame_->getLeftFrame().img_.size(),
+                        CV_8UC1,
+                        cv::Scalar(255));
+
+    Tracker tracker(tracker_params_);
+    tracker.camMask_ = cam_mask_;
+    tracker.featureDetection(ref_stereo_frame_->getLeftFrameMutable());
+    ref_stereo_frame_->sparseStereoMatching();
+    tracker.featureTracking(ref_stereo_frame_->getLeftFrameMutable(),
+                            cur_stereo_frame_->getLeftFrameMutable());
+    cur_stereo_frame_->sparseStereoMatching();
+    CHECK_GT(ref_stereo_frame_->getLeftFrame().keypoints_.size(), 0u);
+    CHECK_GT(cur_stereo_frame_->getLeftFrame().keypoints_.size(), 0u);
+  }
+
+  void TearDown(const ::benchmark::State& /*state*/) override {
+    ref_stereo_frame_.reset();
+    cur_stereo_frame_.reset();
+    raw_ref_stereo_frame_.reset();
+    raw_cur_stereo_frame_.reset();
+  }
+
+ protected:
+  std::unique_ptr<StereoFrame> createStereoFrame(
+      const FrameId& id,
+      const Timestamp& timestamp,
+      const std::string& left_image_path,
+      const std::string& right_image_path) const {
+    const bool& equalize =
+        tracker_params_.stereo_matching_params_.equalize_image_;
+    return VIO::make_unique<StereoFrame>(
+        id,
+        timestamp,
+        UtilsOpenCV::ReadAndConvertToGrayScale(left_image_path, equalize),
+        cam_params_left_,
+        UtilsOpenCV::ReadAndConvertToGrayScale(right_image_path, equalize),
+        cam_params_right_,
+        tracker_params_.stereo_matching_params_);
+  }
+
+  // Returns a stereo frame with the given left keypoints but no stereo
+  // matching results, so that sparse stereo matching can't reuse them.
+  std::unique_ptr<StereoFrame> createUnmatchedStereoFrame(
+      const StereoFrame& stereo_frame) const {
+    std::unique_ptr<StereoFrame> unmatched =
+        VIO::make_unique<StereoFrame>(stereo_frame);
+    unmatched->left_keypoints_rectified_.clear();
+    unmatched->right_keypoints_rectified_.clear();
+    unmatched->right_keypoints_status_.clear();
+    unmatched->keypoints_depth_.clear();
+    unmatched->keypoints_3d_.clear();
+    return unmatched;
+  }
+
+ protected:
+  VioFrontEndParams tracker_params_;
+  CameraParams cam_params_left_;
+  CameraParams cam_params_right_;
+  cv::Mat cam_mask_;
+  std::unique_ptr<StereoFrame> ref_stereo_frame_;
+  std::unique_ptr<StereoFrame> cur_stereo_frame_;
+  std::unique_ptr<StereoFrame> raw_ref_stereo_frame_;
+  std::unique_ptr<StereoFrame> raw_cur_stereo_frame_;
+};
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, MyGoodFeaturesToTrackSubPix)
+(::benchmark::State& state) {
+  const cv::Mat& img = raw_ref_stereo_frame_->getLeftFrame().img_;
+  for (auto _ : state) {
+    std::pair<std::vector<cv::Point2f>, std::vector<double>>
+        corners_with_scores;
+    UtilsOpenCV::MyGoodFeaturesToTrackSubPix(
+        img,
+        state.range(0),
+        tracker_params_.quality_level_,
+        tracker_params_.min_distance_,
+        cam_mask_,
+        tracker_params_.block_size_,
+        tracker_params_.use_harris_detector_,
+        tracker_params_.k_,
+        &corners_with_scores);
+    ::benchmark::DoNotOptimize(corners_with_scores);
+    state.counters["corners"] = corners_with_scores.first.size();
+  }
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, MyGoodFeaturesToTrackSubPix)
+    ->Arg(100)
+    ->Arg(300)
+    ->Arg(1000)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, featureDetection)
+(::benchmark::State& state) {
+  Tracker tracker(tracker_params_);
+  tracker.camMask_ = cam_mask_;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame frame(raw_ref_stereo_frame_->getLeftFrame());
+    state.ResumeTiming();
+    tracker.featureDetection(&frame);
+    ::benchmark::DoNotOptimize(frame.keypoints_.data());
+  }
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, featureDetection)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, featureTracking)
+(::benchmark::State& state) {
+  Tracker tracker(tracker_params_);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(ref_stereo_frame_->getLeftFrame());
+    Frame cur_frame(raw_cur_stereo_frame_->getLeftFrame());
+    state.ResumeTiming();
+    tracker.featureTracking(&ref_frame, &cur_frame);
+    ::benchmark::DoNotOptimize(cur_frame.keypoints_.data());
+  }
+  state.counters["keypoints"] =
+      ref_stereo_frame_->getLeftFrame().keypoints_.size();
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, featureTracking)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, sparseStereoMatching)
+(::benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<StereoFrame> stereo_frame =
+        createUnmatchedStereoFrame(*cur_stereo_frame_);
+    state.ResumeTiming();
+    stereo_frame->sparseStereoMatching();
+    ::benchmark::DoNotOptimize(stereo_frame->keypoints_3d_.data());
+  }
+  state.counters["keypoints"] =
+      cur_stereo_frame_->getLeftFrame().keypoints_.size();
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, sparseStereoMatching)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, getRightKeypointsRectified)
+(::benchmark::State& state) {
+  StatusKeypointsCV left_keypoints_rectified;
+  cur_stereo_frame_->undistortRectifyPoints(
+      cur_stereo_frame_->getLeftFrame().keypoints_,
+      cur_stereo_frame_->getLeftFrame().cam_param_,
+      cur_stereo_frame_->getLeftUndistRectCamMat(),
+      &left_keypoints_rectified);
+  // Without cached matches, otherwise the function just copies them.
+  std::unique_ptr<StereoFrame> stereo_frame =
+      createUnmatchedStereoFrame(*cur_stereo_frame_);
+  const double fx = stereo_frame->getLeftUndistRectCamMat().fx();
+  const double baseline = stereo_frame->getBaseline();
+  for (auto _ : state) {
+    StatusKeypointsCV right_keypoints_rectified =
+        stereo_frame->getRightKeypointsRectified(
+            stereo_frame->left_img_rectified_,
+            stereo_frame->right_img_rectified_,
+            left_keypoints_rectified,
+            fx,
+            baseline);
+    ::benchmark::DoNotOptimize(right_keypoints_rectified.data());
+  }
+  state.counters["keypoints"] = left_keypoints_rectified.size();
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, getRightKeypointsRectified)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, geometricOutlierRejectionMono)
+(::benchmark::State& state) {
+  Tracker tracker(tracker_params_);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(ref_stereo_frame_->getLeftFrame());
+    Frame cur_frame(cur_stereo_frame_->getLeftFrame());
+    state.ResumeTiming();
+    std::pair<TrackingStatus, gtsam::Pose3> status_pose =
+        tracker.geometricOutlierRejectionMono(&ref_frame, &cur_frame);
+    ::benchmark::DoNotOptimize(status_pose);
+  }
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, geometricOutlierRejectionMono)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, geometricOutlierRejectionStereo)
+(::benchmark::State& state) {
+  Tracker tracker(tracker_params_);
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame ref_stereo_frame(*ref_stereo_frame_);
+    StereoFrame cur_stereo_frame(*cur_stereo_frame_);
+    state.ResumeTiming();
+    std::pair<TrackingStatus, gtsam::Pose3> status_pose =
+        tracker.geometricOutlierRejectionStereo(ref_stereo_frame,
+                                                cur_stereo_frame);
+    ::benchmark::DoNotOptimize(status_pose);
+  }
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, geometricOutlierRejectionStereo)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(FrontEndFixture, calibratePixel)
+(::benchmark::State& state) {
+  const Frame& frame = cur_stereo_frame_->getLeftFrame();
+  for (auto _ : state) {
+    for (const KeypointCV& keypoint : frame.keypoints_) {
+      Vector3 versor = Frame::calibratePixel(keypoint, frame.cam_param_);
+      ::benchmark::DoNotOptimize(versor);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * frame.keypoints_.size());
+}
+BENCHMARK_REGISTER_F(FrontEndFixture, calibratePixel)
+    ->Unit(::benchmark::kMicrosecond);
+
+}  // namespace VIO
@@ -0,0 +1,32 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkKimeraVIO.cpp
+ * @brief  Entry point for the micro-benchmarks.
+ * Run with --benchmark_out=<file> --benchmark_out_format=json to get
+ * machine-readable results (see scripts/run_benchmarks.bash).
+ * @author Antoni Rosinol
+ */
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_string(test_data_path,
+              "../tests/data",
+              "Path to data for benchmarks (same as for unit tests).");
+
+int main(int argc, char** argv) {
+  // Google Benchmark removes its own flags (--benchmark_*) from argv.
+  ::benchmark::Initialize(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,210 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkLoopClosureDetector.cpp
+ * @brief  Benchmarks for the LoopClosureDetector, on the stereo images and
+ * small vocabulary in tests/data/ForLoopClosureDetector, with a varying
+ * database size and number of ORB features.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/Tracker.h"
+#include "kimera-vio/frontend/VioFrontEndParams.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+DECLARE_string(vocabulary_path);
+
+namespace VIO {
+
+// Same data as testLoopClosureDetector: ref1/cur1 is a pair of images of the
+// same place.
+class LcdFixture : public ::benchmark::Fixture {
+ public:
+  static constexpr int kRandomDisparity = 10;
+
+  void SetUp(const ::benchmark::State& /*state*/) override {
+    lcd_test_data_path_ = FLAGS_test_data_path + "/ForLoopClosureDetector";
+    lcd_params_.parseYAML(lcd_test_data_path_ + "/testLCDParameters.yaml");
+    FLAGS_vocabulary_path = lcd_test_data_path_ + "/small_voc.yml.gz";
+
+    CameraParams cam_params_left, cam_params_right;
+    cam_params_left.parseYAML(lcd_test_data_path_ + "/sensorLeft.yaml");
+    cam_params_right.parseYAML(lcd_test_data_path_ + "/sensorRight.yaml");
+    ref1_stereo_frame_ =
+        createStereoFrame(0u, 1000, "0", cam_params_left, cam_params_right);
+    cur1_stereo_frame_ =
+        createStereoFrame(1u, 2000, "1", cam_params_left, cam_params_right);
+  }
+
+  void TearDown(const ::benchmark::State& /*state*/) override {
+    lcd_detector_.reset();
+    ref1_stereo_frame_.reset();
+    cur1_stereo_frame_.reset();
+  }
+
+ protected:
+  std::unique_ptr<StereoFrame> createStereoFrame(
+      const FrameId& id,
+      const Timestamp& timestamp,
+      const std::string& img_suffix,
+      const CameraParams& cam_params_left,
+      const CameraParams& cam_params_right) const {
+    VioFrontEndParams tp;
+    const bool& equalize = tp.stereo_matching_params_.equalize_image_;
+    return createStereoFrame(
+        id,
+        timestamp,
+        UtilsOpenCV::ReadAndConvertToGrayScale(
+            lcd_test_data_path_ + "/left_img_" + img_suffix + ".png",
+            equalize),
+        UtilsOpenCV::ReadAndConvertToGrayScale(
+            lcd_test_data_path_ + "/right_img_" + img_suffix + ".png",
+            equalize),
+        cam_params_left,
+        cam_params_right);
+  }
+
+  // Stereo frame of random texture, with its own ORB descriptors: fills the
+  // database with distinct entries, like a real trajectory would.
+  std::unique_ptr<StereoFrame> createRandomStereoFrame(
+      const FrameId& id,
+      const Timestamp& timestamp,
+      cv::RNG* rng) const {
+    CHECK_NOTNULL(rng);
+    const Frame& ref_left_frame = ref1_stereo_frame_->getLeftFrame();
+    const Frame& ref_right_frame = ref1_stereo_frame_->getRightFrame();
+    cv::Mat left_img(ref_left_frame.img_.size(), CV_8UC1);
+    rng->fill(left_img, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(left_img, left_img, cv::Size(5, 5), 1.5);
+    // Constant disparity, so that stereo matching finds the keypoints.
+    cv::Mat right_img(left_img.size(), CV_8UC1, cv::Scalar(0));
+    left_img.colRange(kRandomDisparity, left_img.cols)
+        .copyTo(right_img.colRange(0, left_img.cols - kRandomDisparity));
+    return createStereoFrame(id,
+                             timestamp,
+                             left_img,
+                             right_img,
+                             ref_left_frame.cam_param_,
+                             ref_right_frame.cam_param_);
+  }
+
+  std::unique_ptr<StereoFrame> createStereoFrame(
+      const FrameId& id,
+      const Timestamp& timestamp,
+      const cv::Mat& left_img,
+      const cv::Mat& right_img,
+      const CameraParams& cam_params_left,
+      const CameraParams& cam_params_right) const {
+    VioFrontEndParams tp;
+    std::unique_ptr<StereoFrame> stereo_frame =
+        VIO::make_unique<StereoFrame>(id,
+                                      timestamp,
+                                      left_img,
+                                      cam_params_left,
+                                      right_img,
+                                      cam_params_right,
+                                      tp.stereo_matching_params_);
+    Tracker tracker(tp);
+    tracker.featureDetection(stereo_frame->getLeftFrameMutable());
+    stereo_frame->setIsKeyframe(true);
+    stereo_frame->sparseStereoMatching();
+    return stereo_frame;
+  }
+
+  // Must be called after modifying lcd_params_.
+  void createLcd() {
+    lcd_detector_ = VIO::make_unique<LoopClosureDetector>(lcd_params_, false);
+    lcd_detector_->setIntrinsics(*ref1_stereo_frame_);
+  }
+
+ protected:
+  std::string lcd_test_data_path_;
+  LoopClosureDetectorParams lcd_params_;
+  std::unique_ptr<LoopClosureDetector> lcd_detector_;
+  std::unique_ptr<StereoFrame> ref1_stereo_frame_, cur1_stereo_frame_;
+};
+
+/* -------------------------------------------------------------------------- */
+// Arg: number of frames in the database before querying. The database holds
+// ref1 and then frames of random texture, each with distinct descriptors, the
+// query is cur1, so that there is always a single good candidate. The timed
+// call includes ORB extraction, BoW query, temporal and geometric
+// verification and pose recovery.
+// Each iteration adds the query to the database: use a fixed number of
+// iterations so that the database size stays close to the requested one.
+BENCHMARK_DEFINE_F(LcdFixture, detectLoop)(::benchmark::State& state) {
+  createLcd();
+  LoopResult result;
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &result);
+  cv::RNG rng(42);
+  for (int64_t i = 1; i < state.range(0); i++) {
+    std::unique_ptr<StereoFrame> random_stereo_frame =
+        createRandomStereoFrame(2u + i, 3000 + 1000 * i, &rng);
+    lcd_detector_->detectLoop(*random_stereo_frame, &result);
+  }
+
+  size_t nr_loops = 0u;
+  for (auto _ : state) {
+    lcd_detector_->detectLoop(*cur1_stereo_frame_, &result);
+    if (result.isLoop()) nr_loops++;
+  }
+  state.counters["db_size"] = state.range(0);
+  state.counters["loop_ratio"] =
+      static_cast<double>(nr_loops) / state.iterations();
+}
+BENCHMARK_REGISTER_F(LcdFixture, detectLoop)
+    ->Arg(16)
+    ->Arg(128)
+    ->Arg(512)
+    ->Iterations(20)
+    ->Unit(::benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+// Arg: number of ORB features extracted per frame.
+BENCHMARK_DEFINE_F(LcdFixture, geometricVerificationCheck)
+(::benchmark::State& state) {
+  lcd_params_.nfeatures_ = state.range(0);
+  createLcd();
+  const FrameId ref_id = lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  const FrameId cur_id = lcd_detector_->processAndAddFrame(*cur1_stereo_frame_);
+
+  size_t nr_passed = 0u;
+  for (auto _ : state) {
+    gtsam::Pose3 camCur_T_camRef_mono;
+    if (lcd_detector_->geometricVerificationCheck(
+            cur_id, ref_id, &camCur_T_camRef_mono)) {
+      nr_passed++;
+    }
+    ::benchmark::DoNotOptimize(camCur_T_camRef_mono);
+  }
+  state.counters["pass_ratio"] =
+      static_cast<double>(nr_passed) / state.iterations();
+}
+BENCHMARK_REGISTER_F(LcdFixture, geometricVerificationCheck)
+    ->RangeMultiplier(2)
+    ->Range(250, 2000)
+    ->Unit(::benchmark::kMillisecond);
+
+}  // namespace VIO
@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchmarkMesher.cpp
+ * @brief  Benchmarks for the Mesher, on a synthetic scene (a wall and the
+ * floor) with a varying number of landmarks, and on corners extracted from
+ * tests/data/chessboard_small.png.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/mesh/Mesher.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+// Keypoints uniformly sampled in the image, back-projected to a wall 5m in
+// front of the camera (upper half of the image) and to the floor 1.5m below
+// the camera (lower half). The camera has z forward, the world has z up.
+class MesherFixture : public ::benchmark::Fixture {
+ public:
+  void SetUp(const ::benchmark::State& state) override {
+    img_size_ = cv::Size(752, 480);
+    mesher_params_ = MesherParams(gtsam::Pose3(), img_size_);
+    // World (x forward, y left, z up) from camera (x right, y down, z fwd).
+    gtsam::Matrix3 W_R_cam;
+    W_R_cam << 0, 0, 1, -1, 0, 0, 0, -1, 0;
+    W_Pose_cam_ = gtsam::Pose3(gtsam::Rot3(W_R_cam), gtsam::Point3(0, 0, 1.5));
+    createScene(state.range(0));
+  }
+
+  void TearDown(const ::benchmark::State& /*state*/) override {
+    keypoints_.clear();
+    keypoints_status_.clear();
+    keypoints_3d_.clear();
+    landmarks_.clear();
+    points_with_id_.clear();
+  }
+
+ protected:
+  void createScene(const size_t& num_landmarks) {
+    static constexpr double kFocalLength = 458.0;
+    static constexpr double kWallDepth = 5.0;
+    static constexpr double kCameraHeight = 1.5;
+    const double cx = img_size_.width / 2.0;
+    const double cy = img_size_.height / 2.0;
+    // Fixed seed, so that all runs see the same scene.
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> u_dist(0.0f, img_size_.width - 1);
+    std::uniform_real_distribution<float> v_dist(0.0f, img_size_.height - 1);
+    keypoints_.reserve(num_landmarks);
+    keypoints_status_.reserve(num_landmarks);
+    keypoints_3d_.reserve(num_landmarks);
+    landmarks_.reserve(num_landmarks);
+    for (size_t i = 0u; i < num_landmarks; i++) {
+      const KeypointCV px(u_dist(rng), v_dist(rng));
+      // Rays below the horizon hit the floor unless the wall is closer.
+      double depth = kWallDepth;
+      if (px.y > cy + 1.0) {
+        depth =
+            std::min(kWallDepth, kCameraHeight * kFocalLength / (px.y - cy));
+      }
+      const Vector3 p_cam(depth * (px.x - cx) / kFocalLength,
+                          depth * (px.y - cy) / kFocalLength,
+                          depth);
+      keypoints_.push_back(px);
+      keypoints_status_.push_back(KeypointStatus::VALID);
+      keypoints_3d_.push_back(p_cam);
+      landmarks_.push_back(i);
+      points_with_id_[i] = W_Pose_cam_.transformFrom(gtsam::Point3(p_cam));
+    }
+  }
+
+ protected:
+  cv::Size img_size_;
+  MesherParams mesher_params_;
+  gtsam::Pose3 W_Pose_cam_;
+  KeypointsCV keypoints_;
+  std::vector<KeypointStatus> keypoints_status_;
+  std::vector<Vector3> keypoints_3d_;
+  LandmarkIds landmarks_;
+  PointsWithIdMap points_with_id_;
+};
+
+/* -------------------------------------------------------------------------- */
+// Number of landmarks in the scene.
+static void MesherArguments(::benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(4)->Range(64, 4096)->Unit(::benchmark::kMicrosecond);
+}
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(MesherFixture, updateMesh3D)(::benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    // Fresh mesher, otherwise we time the update of an ever-growing mesh.
+    Mesher mesher(mesher_params_);
+    state.ResumeTiming();
+    Mesh2D mesh_2d;
+    mesher.updateMesh3D(points_with_id_,
+                        keypoints_,
+                        keypoints_status_,
+                        keypoints_3d_,
+                        landmarks_,
+                        W_Pose_cam_,
+                        &mesh_2d);
+    ::benchmark::DoNotOptimize(mesh_2d);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_REGISTER_F(MesherFixture, updateMesh3D)->Apply(MesherArguments);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(MesherFixture, createMesh2D)(::benchmark::State& state) {
+  Frame frame(0, 0, CameraParams(), cv::Mat::zeros(img_size_, CV_8UC1));
+  frame.keypoints_ = keypoints_;
+  frame.landmarks_ = landmarks_;
+  std::vector<size_t> selected_indices(keypoints_.size());
+  for (size_t i = 0u; i < selected_indices.size(); i++) {
+    selected_indices[i] = i;
+  }
+  for (auto _ : state) {
+    std::vector<cv::Vec6f> mesh_2d =
+        Mesher::createMesh2D(frame, selected_indices);
+    ::benchmark::DoNotOptimize(mesh_2d);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_REGISTER_F(MesherFixture, createMesh2D)->Apply(MesherArguments);
+
+/* -------------------------------------------------------------------------- */
+// Same as above, on the corners extracted from a real image, as testMesher.
+static void BM_createMesh2DChessboard(::benchmark::State& state) {
+  const cv::Mat img = UtilsOpenCV::ReadAndConvertToGrayScale(
+      FLAGS_test_data_path + "/chessboard_small.png");
+  Frame frame(0, 123, CameraParams(), img);
+  frame.extractCorners();
+  for (size_t i = 0u; i < frame.keypoints_.size(); i++) {
+    frame.landmarks_.push_back(i);
+  }
+  std::vector<size_t> selected_indices(frame.keypoints_.size());
+  for (size_t i = 0u; i < selected_indices.size(); i++) {
+    selected_indices[i] = i;
+  }
+  for (auto _ : state) {
+    std::vector<cv::Vec6f> mesh_2d =
+        Mesher::createMesh2D(frame, selected_indices);
+    ::benchmark::DoNotOptimize(mesh_2d);
+  }
+  state.counters["keypoints"] = frame.keypoints_.size();
+}
+BENCHMARK(BM_createMesh2DChessboard)->Unit(::benchmark::kMicrosecond);
+
+/* -------------------------------------------------------------------------- */
+BENCHMARK_DEFINE_F(MesherFixture, clusterPlanesFromMesh)
+(::benchmark::State& state) {
+  Mesher mesher(mesher_params_);
+  mesher.updateMesh3D(points_with_id_,
+                      keypoints_,
+                      keypoints_status_,
+                      keypoints_3d_,
+                      landmarks_,
+                      W_Pose_cam_);
+  size_t num_planes = 0u;
+  for (auto _ : state) {
+    // Start from no planes every time, otherwise we time the association
+    // with the planes found in previous iterations.
+    std::vector<Plane> planes;
+    mesher.clusterPlanesFromMesh(&planes, points_with_id_);
+    num_planes = planes.size();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["planes"] = num_planes;
+}
+BENCHMARK_REGISTER_F(MesherFixture, clusterPlanesFromMesh)
+    ->Apply(MesherArguments);
+
+}  // namespace VIO
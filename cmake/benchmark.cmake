@@ -0,0 +1,15 @@
+cmake_minimum_required(VERSION 2.8.2)
+
+project(googlebenchmark-download NONE)
+
+include(ExternalProject)
+ExternalProject_Add(googlebenchmark
+    GIT_REPOSITORY https://github.com/google/benchmark.git
+    GIT_TAG v1.5.0
+    SOURCE_DIR "${CMAKE_BINARY_DIR}/external/googlebenchmark-src"
+    BINARY_DIR "${CMAKE_BINARY_DIR}/external/googlebenchmark-build"
+    CONFIGURE_COMMAND ""
+    BUILD_COMMAND ""
+    INSTALL_COMMAND ""
+    TEST_COMMAND ""
+)
@@ -0,0 +1,57 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ConvertOrbVocabulary.cpp
+ * @brief  One-time conversion of an ORB vocabulary in DBoW2 text format (e.g.
+ * ORBvoc.yml) to the binary format, which loads much faster.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+#include "kimera-vio/utils/Timer.h"
+
+DEFINE_string(input_vocabulary_path,
+              "../vocabulary/ORBvoc.yml",
+              "Path to the vocabulary in DBoW2 text format.");
+DEFINE_string(output_vocabulary_path,
+              "../vocabulary/ORBvoc.bin",
+              "Path where to write the binary vocabulary.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  LOG(INFO) << "Loading vocabulary from: " << FLAGS_input_vocabulary_path;
+  auto tic = VIO::utils::Timer::tic();
+  OrbVocabulary vocabulary;
+  vocabulary.load(FLAGS_input_vocabulary_path);
+  CHECK(!vocabulary.empty()) << "Empty vocabulary.";
+  LOG(INFO) << "Loaded vocabulary with " << vocabulary.size()
+            << " visual words in " << VIO::utils::Timer::toc(tic).count()
+            << " ms.";
+
+  CHECK(VIO::BinaryOrbVocabulary::saveBinary(vocabulary,
+                                             FLAGS_output_vocabulary_path))
+      << "Could not write: " << FLAGS_output_vocabulary_path;
+
+  // Sanity check: the binary vocabulary loads back.
+  tic = VIO::utils::Timer::tic();
+  VIO::BinaryOrbVocabulary binary_vocabulary;
+  CHECK(binary_vocabulary.loadBinary(FLAGS_output_vocabulary_path));
+  CHECK_EQ(binary_vocabulary.size(), vocabulary.size());
+  LOG(INFO) << "Wrote binary vocabulary to: " << FLAGS_output_vocabulary_path
+            << ", it loads in " << VIO::utils::Timer::toc(tic).count()
+            << " ms.";
+  return 0;
+}
@@ -80,10 +80,12 @@ class RegularVioBackEnd : public VioBackEnd {
   // RAW parameters given by the user for the regulaVIO backend.
   const RegularVioBackEndParams regular_vio_params_;
 
+ protected:
   // Planes in the scene
   // TODO(Toni): CURRENTLY DISABLED
   // We need to make a shared queue with the MeshSegmenter which will push plane
   // hypothesis while the backend pulls them.
+  // Protected so that derived classes (e.g. benchmarks) can seed planes.
   std::vector<Plane> planes_;
 
  private:
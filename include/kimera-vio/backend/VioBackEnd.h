@@ -317,6 +317,11 @@ class VioBackEnd {
   /* ------------------------------------------------------------------------ */
   bool deleteLmkFromFeatureTracks(const LandmarkId& lmk_id);
 
+  /* ------------------------------------------------------------------------ */
+  // Deletes feature tracks whose last observation is no longer in the
+  // smoother, and old smart factors whose slot is no longer in the graph.
+  void pruneMarginalizedFeatureTracks();
+
   /* ------------------------------------------------------------------------ */
   virtual void deleteLmkFromExtraStructures(const LandmarkId& lmk_id);
 
@@ -504,7 +509,8 @@ class VioBackEnd {
   bool debug_smoother_ = false;
 
   // Data:
-  // TODO grows unbounded currently, but it should be limited to time horizon.
+  // Grows unbounded, unless FLAGS_prune_marginalized_feature_tracks is set,
+  // in which case it is limited to the time horizon of the smoother.
   FeatureTracks feature_tracks_;
 
   /// Counters.
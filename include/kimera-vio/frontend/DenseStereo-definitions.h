@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DenseStereo-definitions.h
+ * @brief  Definitions for the dense stereo module.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/StereoVisionFrontEnd-definitions.h"
+#include "kimera-vio/pipeline/PipelinePayload.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+//! Landmark ids of the dense stereo points start here, so that they never
+//! collide with the ids of the landmarks tracked by the frontend.
+static constexpr LandmarkId kDenseStereoFirstLmkId =
+    std::numeric_limits<LandmarkId>::max() / 2;
+
+struct DenseStereoParams {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DenseStereoParams);
+  DenseStereoParams() = default;
+  ~DenseStereoParams() = default;
+
+ public:
+  //! Scale of the images used for matching, in (0, 1]. The cost of the
+  //! matching is proportional to its square.
+  double scale_ = 0.5;
+  //! Disparity range at the matching resolution, a multiple of 16.
+  int num_disparities_ = 48;
+  //! Size of the matched blocks, odd.
+  int block_size_ = 5;
+  //! At most one point is sampled in each cell of a grid with this side,
+  //! in pixels at the matching resolution.
+  int grid_step_ = 8;
+  //! Only sample pixels on the edges of the left image (semi-dense).
+  bool only_gradients_ = true;
+  //! Maximum number of points per keyframe.
+  int max_nr_points_ = 1500;
+  //! Range of depths of the points [m]: far points are too noisy.
+  double min_depth_ = 0.2;
+  double max_depth_ = 5.0;
+};
+
+struct DenseStereoInput : public PipelinePayload {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DenseStereoInput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(DenseStereoInput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  explicit DenseStereoInput(const FrontendOutput::Ptr& frontend_payload)
+      : PipelinePayload(frontend_payload->timestamp_),
+        frontend_output_(frontend_payload) {}
+  virtual ~DenseStereoInput() = default;
+
+  // Copy the pointer so that we do not need to copy the stereo frame.
+  const FrontendOutput::ConstPtr frontend_output_;
+};
+
+struct DenseStereoOutput : public PipelinePayload {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DenseStereoOutput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(DenseStereoOutput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  explicit DenseStereoOutput(const Timestamp& timestamp)
+      : PipelinePayload(timestamp) {}
+  virtual ~DenseStereoOutput() = default;
+
+ public:
+  //! Pixels of the points in the original (unrectified) left image, like the
+  //! keypoints of the left frame.
+  KeypointsCV keypoints_;
+  //! Points in the rectified left camera frame, like
+  //! StereoFrame::keypoints_3d_.
+  std::vector<Vector3> keypoints_3d_;
+  //! Unique landmark ids of the points, from kDenseStereoFirstLmkId on.
+  LandmarkIds landmarks_;
+};
+
+}  // namespace VIO
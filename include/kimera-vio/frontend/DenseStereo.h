@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DenseStereo.h
+ * @brief  Semi-dense stereo points to densify the mesh.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <gtsam/geometry/Cal3_S2.h>
+
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/DenseStereo-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Matches the rectified stereo images of each keyframe with semi-global
+// block matching, at reduced resolution, and samples at most one point per
+// cell of a regular grid, optionally only on image edges. Both the matching
+// and the number of points are bounded by the parameters, so the cost per
+// keyframe does not depend on the scene.
+class DenseStereo {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DenseStereo);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(DenseStereo);
+
+  explicit DenseStereo(const DenseStereoParams& params);
+  virtual ~DenseStereo() = default;
+
+  DenseStereoOutput::UniquePtr spinOnce(const DenseStereoInput& input);
+
+  // Computes points on a pair of rectified images.
+  // left_cam_rect: calibration of the rectified left camera.
+  // baseline: of the rectified stereo camera [m].
+  // undist_rect_map_x/y: map from rectified to original left pixels (CV_32FC1),
+  // empty if the images were not rectified by us.
+  // keypoints: pixels of the points in the original left image.
+  // keypoints_3d: points in the rectified left camera frame.
+  void computeDensePoints(const cv::Mat& left_img_rectified,
+                          const cv::Mat& right_img_rectified,
+                          const gtsam::Cal3_S2& left_cam_rect,
+                          const double& baseline,
+                          const cv::Mat& undist_rect_map_x,
+                          const cv::Mat& undist_rect_map_y,
+                          KeypointsCV* keypoints,
+                          std::vector<Vector3>* keypoints_3d) const;
+
+ private:
+  // Returns the pixel of each grid cell with a valid disparity closest to the
+  // center of the cell, if any. Only pixels where mask is not zero are
+  // considered, unless mask is empty.
+  void samplePixels(const cv::Mat& disparity,
+                    const cv::Mat& mask,
+                    const int& min_disparity_16,
+                    const int& max_disparity_16,
+                    std::vector<cv::Point>* pixels) const;
+
+ private:
+  const DenseStereoParams params_;
+  cv::Ptr<cv::StereoSGBM> sgbm_;
+  //! Id of the next dense landmark.
+  LandmarkId next_lmk_id_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,64 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DenseStereoModule.h
+ * @brief  Pipeline module for the dense stereo.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/frontend/DenseStereo-definitions.h"
+#include "kimera-vio/frontend/DenseStereo.h"
+#include "kimera-vio/pipeline/PipelineModule.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Computes dense stereo points for each keyframe, in parallel with the
+// backend, so that the mesher can use them together with the backend output.
+class DenseStereoModule
+    : public MIMOPipelineModule<DenseStereoInput, DenseStereoOutput> {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DenseStereoModule);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(DenseStereoModule);
+  using DenseStereoFrontendInput = FrontendOutput::Ptr;
+
+  DenseStereoModule(bool parallel_run, DenseStereo::UniquePtr dense_stereo);
+  virtual ~DenseStereoModule() = default;
+
+  //! Callback to fill the queue: only keyframes are processed.
+  inline void fillFrontendQueue(
+      const DenseStereoFrontendInput& frontend_payload) {
+    if (frontend_payload->is_keyframe_) {
+      frontend_payload_queue_.push(frontend_payload);
+    }
+  }
+
+ protected:
+  InputUniquePtr getInputPacket() override;
+
+  OutputUniquePtr spinOnce(DenseStereoInput::UniquePtr input) override;
+
+ protected:
+  //! Called when general shutdown of PipelineModule is triggered.
+  void shutdownQueues() override;
+
+  //! Checks if the module has work to do (should check input queues are empty)
+  bool hasWork() const override;
+
+ private:
+  //! Input Queues
+  ThreadsafeQueue<DenseStereoFrontendInput> frontend_payload_queue_;
+
+  //! Dense stereo implementation
+  DenseStereo::UniquePtr dense_stereo_;
+};
+
+}  // namespace VIO
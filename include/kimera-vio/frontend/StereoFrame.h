@@ -122,6 +122,14 @@ class StereoFrame {
   // (iii) corresponding 3D point.
   void sparseStereoMatching(const int verbosity = 0);
 
+  /* ------------------------------------------------------------------------ */
+  // Same as above, but for external left keypoints and their versors, and
+  // without modifying the frame: only the rectified images are read.
+  // keypoints_3d is in the rectified left frame, zero for unmatched keypoints.
+  void sparseStereoMatching(const KeypointsCV& left_keypoints,
+                            const BearingVectors& left_versors,
+                            std::vector<Vector3>* keypoints_3d) const;
+
   /* ------------------------------------------------------------------------ */
   void checkStereoFrame() const;
 
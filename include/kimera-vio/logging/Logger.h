@@ -17,11 +17,14 @@
 #include <stdlib.h>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
 #include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/logging/MeshStreamWriter.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/mesh/GlobalMesh.h"
 
 namespace VIO {
 
@@ -122,11 +125,25 @@ class VisualizerLogger {
                const cv::Mat& mesh,
                const double& timestamp,
                bool log_accumulated_mesh = false);
+  // Logs each chunk of the global mesh to its own binary ply file,
+  // overwriting the previous version of the chunk, from the I/O thread of
+  // the mesh stream (see MeshStreamWriter::logBinaryPly).
+  void logMeshChunks(const std::vector<MeshChunk>& chunks);
+  // Logs the mesh in binary from a background thread, see MeshStreamWriter.
+  // Cheap enough to be called at every mesh update.
+  void openMeshStream(const MeshStreamFormat& format);
+  void streamMesh(const cv::Mat& lmks,
+                  const cv::Mat& colors,
+                  const cv::Mat& mesh,
+                  const Timestamp& timestamp);
 
  private:
   // Filenames to be saved in the output folder.
-  OfstreamWrapper output_mesh_;
+  // Only opened by logMesh, so that it does not truncate the file of the
+  // mesh stream.
+  std::unique_ptr<OfstreamWrapper> output_mesh_;
   OfstreamWrapper output_landmarks_;
+  MeshStreamWriter::UniquePtr mesh_stream_writer_;
 };
 
 class PipelineLogger {
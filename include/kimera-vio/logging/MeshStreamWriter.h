@@ -0,0 +1,163 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshStreamWriter.h
+ * @brief  Binary mesh logging on a background thread.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+enum class MeshStreamFormat {
+  //! Binary PLY of the latest mesh, replaced atomically at each write.
+  kBinaryPly,
+  //! Stream of records with only the vertices and faces that changed since
+  //! the previous record.
+  kDelta,
+};
+
+// Triangle mesh in flat arrays, ready to be written.
+struct MeshStreamBuffer {
+  Timestamp timestamp_ = 0;
+  //! x, y, z of each vertex.
+  std::vector<float> vertices_;
+  //! r, g, b of each vertex.
+  std::vector<uint8_t> colors_;
+  //! Vertex indices of each triangle.
+  std::vector<uint32_t> faces_;
+
+  inline size_t getNumberOfVertices() const { return vertices_.size() / 3u; }
+  inline size_t getNumberOfFaces() const { return faces_.size() / 3u; }
+  inline void clear() {
+    vertices_.clear();
+    colors_.clear();
+    faces_.clear();
+  }
+};
+
+// Copies the mesh in the buffer, reusing its memory.
+// vertices: CV_32FC3 with one vertex per row, or CV_32FC1 with 3 columns.
+// colors: CV_8UC3 with one color per row, or CV_8UC1 with 3 columns; white
+//  vertices if empty.
+// polygons: CV_32SC1 list (3, id_a, id_b, id_c, 3, ...), as given by
+//  Mesh::convertPolygonsMeshToMat. Only triangles are supported.
+void fillMeshStreamBuffer(const cv::Mat& vertices,
+                          const cv::Mat& colors,
+                          const cv::Mat& polygons,
+                          const Timestamp& timestamp,
+                          MeshStreamBuffer* mesh);
+
+// Removes the repeated faces of the mesh (same vertices in the same cyclic
+// order), keeping the first one. Both formats write the mesh after this, so
+// that the ply and the delta stream, which holds a set of faces, agree.
+void removeDuplicateFaces(MeshStreamBuffer* mesh);
+
+// Writes meshes to disk on its own thread, so that logging never blocks the
+// caller on disk, and is cheap enough to be always on.
+// Double buffered: logMesh copies the mesh in the back buffer and returns;
+// the I/O thread swaps it with its front buffer and writes it. If a mesh is
+// still pending when a new one is logged, the pending one is replaced (and
+// counted as dropped): only the latest mesh matters.
+// Other meshes (e.g. the chunks of the global mesh) can be written to their
+// own binary PLY files by the same I/O thread, see logBinaryPly.
+class MeshStreamWriter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MeshStreamWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MeshStreamWriter);
+
+  // filename: file of the meshes given to logMesh. If empty, only
+  // logBinaryPly can be used.
+  MeshStreamWriter(const std::string& filename, const MeshStreamFormat& format);
+  // Writes the pending mesh, if any, and stops the I/O thread.
+  ~MeshStreamWriter();
+
+  // See fillMeshStreamBuffer for the supported types.
+  void logMesh(const cv::Mat& vertices,
+               const cv::Mat& colors,
+               const cv::Mat& polygons,
+               const Timestamp& timestamp);
+
+  // Writes the mesh to its own binary PLY file, replaced atomically. Meshes
+  // pending for different files are all written, a mesh pending for the same
+  // file is replaced (and counted as dropped).
+  void logBinaryPly(const std::string& filename, MeshStreamBuffer mesh);
+
+  // Blocks until the pending meshes, if any, have been written.
+  void flush();
+
+  inline size_t getNumberOfDroppedMeshes() const { return nr_dropped_; }
+  inline size_t getNumberOfWrittenMeshes() const { return nr_written_; }
+
+ public:
+  static bool writeBinaryPly(const std::string& filename,
+                             const MeshStreamBuffer& mesh);
+  static bool readBinaryPly(const std::string& filename,
+                            MeshStreamBuffer* mesh);
+  // Returns the mesh after each record of a delta stream.
+  static bool readDeltaStream(const std::string& filename,
+                              std::vector<MeshStreamBuffer>* meshes);
+
+ private:
+  void ioSpin();
+  void writeMesh(const MeshStreamBuffer& mesh);
+  // Appends to the stream the difference between mesh and the last written
+  // mesh, and remembers mesh as the last written one.
+  bool writeDelta(const MeshStreamBuffer& mesh);
+
+ private:
+  const std::string filename_;
+  const MeshStreamFormat format_;
+
+  //! Protects back_buffer_ and the flags below.
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  MeshStreamBuffer back_buffer_;
+  //! Meshes of logBinaryPly, by filename.
+  std::map<std::string, MeshStreamBuffer> back_ply_meshes_;
+  bool has_pending_mesh_ = false;
+  bool is_writing_ = false;
+  bool shutdown_ = false;
+
+  //! Only used by the I/O thread.
+  MeshStreamBuffer front_buffer_;
+  std::map<std::string, MeshStreamBuffer> front_ply_meshes_;
+  std::ofstream delta_stream_;
+  std::vector<char> record_;
+  //! Last written mesh, with faces sorted and starting at their smallest
+  //! vertex index, to compute the next delta.
+  std::vector<float> last_vertices_;
+  std::vector<uint8_t> last_colors_;
+  std::vector<std::array<uint32_t, 3>> last_faces_;
+  //! Faces of the mesh being written, in the same form.
+  std::vector<std::array<uint32_t, 3>> faces_;
+
+  std::atomic<size_t> nr_dropped_;
+  std::atomic<size_t> nr_written_;
+  std::thread io_thread_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryOrbVocabulary.h
+ * @brief  Compact binary format for the ORB vocabulary, loaded with mmap, and
+ * an OrbDatabase that shares its vocabulary instead of copying it.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <DBoW2/DBoW2.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+/** @brief ORB vocabulary that can be saved to and loaded from a binary file.
+ * The descriptors of the nodes are not copied on load: they point to the
+ * memory-mapped file, which is paged in lazily by the OS. Therefore, this
+ * object must outlive any copy of it (use SharedVocabularyOrbDatabase instead
+ * of OrbDatabase, which copies the vocabulary).
+ *
+ * File layout (native endianness):
+ *  - Header (see BinaryOrbVocabulary::Header).
+ *  - One NodeRecord per node, root first.
+ *  - For each word id, the id of its node (uint32).
+ *  - The descriptor of each node, descriptor_bytes each (zeros for the root).
+ */
+class BinaryOrbVocabulary : public OrbVocabulary {
+ public:
+  KIMERA_POINTER_TYPEDEFS(BinaryOrbVocabulary);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(BinaryOrbVocabulary);
+
+  BinaryOrbVocabulary() = default;
+  virtual ~BinaryOrbVocabulary();
+
+  /** @brief Loads a vocabulary saved with saveBinary.
+   * @param[in] filepath Path to the binary vocabulary.
+   * @return False if the file could not be mapped or is not a valid binary
+   * vocabulary.
+   */
+  bool loadBinary(const std::string& filepath);
+
+  /** @brief Saves any ORB vocabulary (e.g. loaded from ORBvoc.yml) in binary.
+   * @param[in] vocabulary The vocabulary to save.
+   * @param[in] filepath Path to the binary file to write.
+   * @return False if the file could not be written.
+   */
+  static bool saveBinary(const OrbVocabulary& vocabulary,
+                         const std::string& filepath);
+
+  /** @brief Checks the magic number at the beginning of a file.
+   * @return True if the file is a binary vocabulary.
+   */
+  static bool isBinaryFile(const std::string& filepath);
+
+ private:
+  void unmap();
+
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    int32_t k;
+    int32_t L;
+    int32_t weighting;
+    int32_t scoring;
+    uint32_t nr_nodes;
+    uint32_t nr_words;
+    uint32_t descriptor_bytes;
+  };
+
+  struct NodeRecord {
+    double weight;
+    uint32_t parent;
+    uint32_t word_id;
+  };
+
+  static constexpr char kMagic[8] = "KVIOVOC";
+  static constexpr uint32_t kVersion = 1u;
+
+  // Memory-mapped file, the descriptors of the nodes point inside it.
+  void* mapped_data_ = nullptr;
+  size_t mapped_size_ = 0u;
+};
+
+/* ------------------------------------------------------------------------ */
+/** @brief OrbDatabase that uses a vocabulary owned elsewhere, instead of
+ * copying it like OrbDatabase does. The vocabulary is shared with whoever
+ * else needs it (e.g. to transform descriptors into BoW vectors).
+ * Warning: do not call setVocabulary on it, since OrbDatabase would delete
+ * the shared vocabulary, create a new SharedVocabularyOrbDatabase instead.
+ */
+class SharedVocabularyOrbDatabase : public OrbDatabase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SharedVocabularyOrbDatabase);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SharedVocabularyOrbDatabase);
+
+  SharedVocabularyOrbDatabase(
+      const std::shared_ptr<const OrbVocabulary>& vocabulary,
+      bool use_di = true,
+      int di_levels = 0);
+
+  /** @brief Copy of any database, that uses the given vocabulary instead of a
+   * copy of the vocabulary of db.
+   * @param[in] vocabulary Same vocabulary as the one of db, or a copy of it.
+   * @param[in] db The database to copy.
+   */
+  SharedVocabularyOrbDatabase(
+      const std::shared_ptr<const OrbVocabulary>& vocabulary,
+      const OrbDatabase& db);
+
+  virtual ~SharedVocabularyOrbDatabase();
+
+  inline const std::shared_ptr<const OrbVocabulary>& getSharedVocabulary()
+      const {
+    return vocabulary_;
+  }
+
+  /** @brief Recovers the BoW vector of each entry from the inverted file, so
+   * that the database can be saved and then rebuilt with add().
+   * @param[out] bow_vecs One BoW vector per entry, indexed by EntryId.
+   */
+  void getBowVectors(std::vector<DBoW2::BowVector>* bow_vecs) const;
+
+ private:
+  std::shared_ptr<const OrbVocabulary> vocabulary_;
+};
+
+/* ------------------------------------------------------------------------ */
+/** @brief Loads an ORB vocabulary, either binary (BinaryOrbVocabulary) or in
+ * the text format of DBoW2 (e.g. ORBvoc.yml).
+ * @param[in] filepath Path to the vocabulary.
+ * @return The vocabulary, ready to be shared.
+ */
+std::shared_ptr<const OrbVocabulary> loadOrbVocabulary(
+    const std::string& filepath);
+
+/** @brief Deep copy of an ORB vocabulary: unlike the copy constructor of
+ * OrbVocabulary, the node descriptors are copied too, so the copy of a
+ * BinaryOrbVocabulary does not point to its mapped file.
+ * @param[in] vocabulary The vocabulary to copy.
+ * @return The copy, ready to be shared.
+ */
+std::shared_ptr<const OrbVocabulary> copyOrbVocabulary(
+    const OrbVocabulary& vocabulary);
+
+}  // namespace VIO
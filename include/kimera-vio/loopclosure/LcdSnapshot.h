@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LcdSnapshot.h
+ * @brief  Binary snapshot files of the loop closure state: a sequential writer
+ * and a reader that memory-maps the whole file.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+// Writes a snapshot field after field, in native byte order.
+// write and writeVector copy bytes: only use them for types that can be
+// copied bytewise (scalars, cv::KeyPoint, fixed-size Eigen types).
+// The snapshot is written to a temporary file that only replaces filepath on
+// commit, so that a snapshot can be saved over the one that was loaded (and
+// is still mapped by a SnapshotReader).
+class SnapshotWriter {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SnapshotWriter);
+
+  explicit SnapshotWriter(const std::string& filepath);
+  // Removes the temporary file if the snapshot was not committed.
+  ~SnapshotWriter();
+
+  inline bool good() const { return output_.good(); }
+
+  /** @brief Closes the temporary file and renames it to filepath.
+   * @return False if the snapshot could not be written or renamed.
+   */
+  bool commit();
+
+  void writeBytes(const void* data, size_t size);
+
+  template <typename T>
+  void write(const T& value) {
+    writeBytes(&value, sizeof(T));
+  }
+
+  template <typename T, typename Alloc>
+  void writeVector(const std::vector<T, Alloc>& values) {
+    write(static_cast<uint64_t>(values.size()));
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  // Rotation matrix (row-major) and translation.
+  void writePose(const gtsam::Pose3& pose);
+
+ private:
+  std::string filepath_;
+  std::string tmp_filepath_;
+  std::ofstream output_;
+  bool committed_;
+};
+
+/* ------------------------------------------------------------------------ */
+// Reads a snapshot written by SnapshotWriter from a read-only memory mapping.
+// All reads are bounds-checked, and fail once the end of the file is reached.
+class SnapshotReader {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SnapshotReader);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SnapshotReader);
+
+  SnapshotReader() = default;
+  ~SnapshotReader();
+
+  /** @brief Maps the file and starts reading at its beginning.
+   * @return False if the file can't be opened or mapped.
+   */
+  bool open(const std::string& filepath);
+
+  /** @brief Advances size bytes.
+   * @return Pointer to the bytes inside the mapping, valid as long as this
+   * reader exists, or nullptr if fewer bytes remain.
+   */
+  const uint8_t* readBytes(size_t size);
+
+  template <typename T>
+  bool read(T* value) {
+    const uint8_t* data = readBytes(sizeof(T));
+    if (!data) return false;
+    std::memcpy(static_cast<void*>(value), data, sizeof(T));
+    return true;
+  }
+
+  template <typename T, typename Alloc>
+  bool readVector(std::vector<T, Alloc>* values) {
+    uint64_t size = 0u;
+    if (!read(&size) || size > remaining() / sizeof(T)) return false;
+    const uint8_t* data = readBytes(size * sizeof(T));
+    values->resize(size);
+    if (size > 0u) {
+      std::memcpy(static_cast<void*>(values->data()), data, size * sizeof(T));
+    }
+    return true;
+  }
+
+  bool readPose(gtsam::Pose3* pose);
+
+  inline size_t remaining() const { return mapped_size_ - offset_; }
+
+ private:
+  void unmap();
+
+ private:
+  void* mapped_data_ = nullptr;
+  size_t mapped_size_ = 0u;
+  size_t offset_ = 0u;
+};
+
+}  // namespace VIO
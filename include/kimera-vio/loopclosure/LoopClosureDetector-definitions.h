@@ -16,15 +16,21 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <glog/logging.h>
+
 #include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Symbol.h>
 #include <gtsam/linear/NoiseModel.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include <gtsam/nonlinear/Values.h>
 
+#include <DBoW2/DBoW2.h>
+
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/utils/Macros.h"
@@ -43,7 +49,8 @@ enum class LCDStatus : int {
   NO_GROUPS,
   FAILED_TEMPORAL_CONSTRAINT,
   FAILED_GEOM_VERIFICATION,
-  FAILED_POSE_RECOVERY
+  FAILED_POSE_RECOVERY,
+  SKIPPED_KEYFRAME
 };
 
 enum class GeomVerifOption : int { NISTER, NONE };
@@ -69,14 +76,59 @@ struct LCDFrame {
         descriptors_mat_(descriptors_mat),
         versors_(versors) {}
 
+  // False if the features of this frame have been released (bounded-memory
+  // mode), in which case it can't be geometrically verified anymore.
+  inline bool hasFeatures() const { return !descriptors_mat_.empty(); }
+
+  // Frees keypoints, descriptors and bearing vectors, but keeps the ids and
+  // timestamp so that the frame can still be referenced by the databases.
+  void releaseFeatures() {
+    std::vector<cv::KeyPoint>().swap(keypoints_);
+    std::vector<gtsam::Vector3>().swap(keypoints_3d_);
+    OrbDescriptorVec().swap(descriptors_vec_);
+    descriptors_mat_.release();
+    BearingVectors().swap(versors_);
+    DBoW2::BowVector().swap(bow_vec_);
+    DBoW2::FeatureVector().swap(feature_vec_);
+  }
+
+  // Approximate memory used by this frame [bytes].
+  size_t getMemoryFootprint() const {
+    size_t bytes = sizeof(LCDFrame);
+    bytes += keypoints_.capacity() * sizeof(cv::KeyPoint);
+    bytes += keypoints_3d_.capacity() * sizeof(gtsam::Vector3);
+    bytes += versors_.capacity() * sizeof(BearingVectors::value_type);
+    bytes += descriptors_mat_.total() * descriptors_mat_.elemSize();
+    bytes += descriptors_vec_.capacity() * sizeof(OrbDescriptor);
+    for (const OrbDescriptor& descriptor : descriptors_vec_) {
+      // Rows of descriptors_mat_ are already counted.
+      if (descriptor.datastart == descriptors_mat_.datastart) continue;
+      bytes += descriptor.total() * descriptor.elemSize();
+    }
+    // Ignores the overhead of the nodes of the maps.
+    bytes += bow_vec_.size() * sizeof(DBoW2::BowVector::value_type);
+    bytes += feature_vec_.size() * sizeof(DBoW2::FeatureVector::value_type);
+    for (const auto& node : feature_vec_) {
+      bytes += node.second.capacity() * sizeof(unsigned int);
+    }
+    return bytes;
+  }
+
   Timestamp timestamp_;
   FrameId id_;
   FrameId id_kf_;
   std::vector<cv::KeyPoint> keypoints_;
   std::vector<gtsam::Vector3> keypoints_3d_;
+  // One descriptor per row of descriptors_mat_, usually row views sharing
+  // its data.
   OrbDescriptorVec descriptors_vec_;
   OrbDescriptor descriptors_mat_;
   BearingVectors versors_;
+  // BoW representation of the descriptors.
+  DBoW2::BowVector bow_vec_;
+  // Indices of the descriptors under each node of the vocabulary tree, only
+  // filled when using BoW-guided matching.
+  DBoW2::FeatureVector feature_vec_;
 };  // struct LCDFrame
 
 struct MatchIsland {
@@ -164,6 +216,10 @@ struct LoopResult {
         status_str = "FAILED_POSE_RECOVERY";
         break;
       }
+      case LCDStatus::SKIPPED_KEYFRAME: {
+        status_str = "SKIPPED_KEYFRAME";
+        break;
+      }
     }
     return status_str;
   }
@@ -239,6 +295,73 @@ struct LcdInput {
   const gtsam::Pose3 W_Pose_Blkf_;
 };
 
+/* ------------------------------------------------------------------------ */
+/** @brief Immutable trajectory of the PGO (the pose of each key, in order),
+ * shared between the LoopClosureDetector and the consumers of its output.
+ * Poses are stored in chunks of kChunkSize poses: appending a pose creates a
+ * new trajectory that copies the last chunk and shares all the others (
+ * copy-on-write), so that publishing the trajectory at every keyframe does
+ * not copy it.
+ */
+class PgoTrajectory {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PgoTrajectory);
+  using Poses =
+      std::vector<gtsam::Pose3, Eigen::aligned_allocator<gtsam::Pose3>>;
+  static constexpr size_t kChunkSize = 256u;
+
+  PgoTrajectory() = default;
+
+  // Copies the poses of keys 0, 1, ..., values.size() - 1.
+  explicit PgoTrajectory(const gtsam::Values& values) {
+    std::shared_ptr<Poses> chunk;
+    for (size_t i = 0u; i < values.size(); i++) {
+      if (i % kChunkSize == 0u) {
+        chunk = std::make_shared<Poses>();
+        chunk->reserve(kChunkSize);
+        chunks_.push_back(chunk);
+      }
+      chunk->push_back(values.at<gtsam::Pose3>(gtsam::Symbol(i)));
+    }
+    size_ = values.size();
+  }
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0u; }
+
+  inline const gtsam::Pose3& at(const size_t& i) const {
+    CHECK_LT(i, size_);
+    return chunks_[i / kChunkSize]->at(i % kChunkSize);
+  }
+
+  inline const gtsam::Pose3& back() const {
+    CHECK(!empty());
+    return at(size_ - 1u);
+  }
+
+  // Returns a new trajectory with one more pose, this one is not modified.
+  PgoTrajectory::ConstPtr append(const gtsam::Pose3& pose) const {
+    std::shared_ptr<PgoTrajectory> trajectory =
+        std::make_shared<PgoTrajectory>(*this);
+    std::shared_ptr<Poses> last_chunk;
+    if (size_ % kChunkSize == 0u) {
+      last_chunk = std::make_shared<Poses>();
+      last_chunk->reserve(kChunkSize);
+      trajectory->chunks_.push_back(last_chunk);
+    } else {
+      last_chunk = std::make_shared<Poses>(*chunks_.back());
+      trajectory->chunks_.back() = last_chunk;
+    }
+    last_chunk->push_back(pose);
+    ++trajectory->size_;
+    return trajectory;
+  }
+
+ private:
+  std::vector<std::shared_ptr<const Poses>> chunks_;
+  size_t size_ = 0u;
+};
+
 struct LcdOutput {
   KIMERA_POINTER_TYPEDEFS(LcdOutput);
   KIMERA_DELETE_COPY_CONSTRUCTORS(LcdOutput);
@@ -262,7 +385,9 @@ struct LcdOutput {
         relative_pose_(relative_pose),
         W_Pose_Map_(W_Pose_Map),
         states_(states),
-        nfg_(nfg) {}
+        nfg_(nfg),
+        trajectory_(nullptr),
+        new_factors_() {}
 
   LcdOutput()
       : is_loop_closure_(false),
@@ -274,7 +399,9 @@ struct LcdOutput {
         relative_pose_(gtsam::Pose3()),
         W_Pose_Map_(gtsam::Pose3()),
         states_(gtsam::Values()),
-        nfg_(gtsam::NonlinearFactorGraph()) {}
+        nfg_(gtsam::NonlinearFactorGraph()),
+        trajectory_(nullptr),
+        new_factors_() {}
 
   // TODO(marcus): inlude stats/score of match
   bool is_loop_closure_;
@@ -285,8 +412,13 @@ struct LcdOutput {
   FrameId id_recent_;
   gtsam::Pose3 relative_pose_;
   gtsam::Pose3 W_Pose_Map_;
+  // Full PGO. With incremental output, only filled on loop closures.
   gtsam::Values states_;
   gtsam::NonlinearFactorGraph nfg_;
+  // Incremental output: trajectory of the PGO (shared, do not copy it), and
+  // factors added to the PGO since the previous output.
+  PgoTrajectory::ConstPtr trajectory_;
+  gtsam::NonlinearFactorGraph new_factors_;
 };
 
 }  // namespace VIO
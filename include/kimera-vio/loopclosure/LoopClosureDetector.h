@@ -16,6 +16,7 @@
 
 #include <limits>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -30,9 +31,11 @@
 
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/loopclosure/LcdSnapshot.h"
 #include "kimera-vio/loopclosure/LcdThirdPartyWrapper.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/loopclosure/ShardedBowDatabase.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 
@@ -51,6 +54,17 @@ class LoopClosureDetector {
   KIMERA_DELETE_COPY_CONSTRUCTORS(LoopClosureDetector);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+ private:
+  // Lcd typedefs
+  using DMatchVec = std::vector<cv::DMatch>;
+  using AdapterMono = opengv::relative_pose::CentralRelativeAdapter;
+  using SacProblemMono =
+      opengv::sac_problems::relative_pose::CentralRelativePoseSacProblem;
+  using AdapterStereo = opengv::point_cloud::PointCloudAdapter;
+  using SacProblemStereo =
+      opengv::sac_problems::point_cloud::PointCloudSacProblem;
+
+ public:
   /* ------------------------------------------------------------------------ */
   /** @brief Constructor: detects loop-closures and updates internal PGO.
    * @param[in] lcd_params Parameters for the instance of LoopClosureDetector.
@@ -70,6 +84,32 @@ class LoopClosureDetector {
    */
   virtual LcdOutput::UniquePtr spinOnce(const LcdInput& input);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Same as spinOnce, but only updates the PGO with the odometry of
+   *  the keyframe: no features are extracted and no loop is searched.
+   * @param[in] input A shared_ptr referencing an input payload.
+   * @return The output payload from the pipeline.
+   */
+  LcdOutput::UniquePtr spinOnceWithoutDetection(const LcdInput& input);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Keyframe gating, see gating_min_translation_ and
+   *  gating_max_queue_size_ in LoopClosureDetectorParams.
+   * @param[in] input The next input payload.
+   * @param[in] nr_queued_keyframes Number of keyframes waiting after it.
+   * @return True if loop detection should run on this keyframe.
+   */
+  bool shouldDetectLoop(const LcdInput& input,
+                        size_t nr_queued_keyframes) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Adds a frame without features to the databases, so that frame
+   *  ids stay aligned with the keys of the PGO and the BoW entries.
+   * @param[in] stereo_frame The keyframe, only its ids are read.
+   * @return The local ID of the frame after it is added to the databases.
+   */
+  FrameId addFrameWithoutFeatures(const StereoFrame& stereo_frame);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Processed a single frame and adds it to relevant internal
    * databases.
@@ -170,18 +210,29 @@ class LoopClosureDetector {
 
   /* ------------------------------------------------------------------------ */
   /** @brief Returns the values of the PGO, which is the full trajectory of the
-   *  PGO.
+   *  PGO, including the keyframes whose odometry is pending.
    * @return The gtsam::Values (poses) of the PGO.
    */
   const gtsam::Values getPGOTrajectory() const;
 
   /* ------------------------------------------------------------------------ */
-  /** @brief Returns the Nonlinear-Factor-Graph from the PGO.
+  /** @brief Returns the Nonlinear-Factor-Graph from the PGO, including the
+   *  odometry factors that are pending.
    * @return The gtsam::NonlinearFactorGraph of the optimized trajectory from
    *  the PGO.
    */
   const gtsam::NonlinearFactorGraph getPGOnfg() const;
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Returns the trajectory of the PGO without copying it. Between
+   *  loop closures, new poses are the previous pose of the PGO composed with
+   *  the odometry.
+   * @return The shared, immutable trajectory of the PGO.
+   */
+  inline PgoTrajectory::ConstPtr getSharedPGOTrajectory() const {
+    return pgo_trajectory_;
+  }
+
   /* ------------------------------------------------------------------------ */
   /** @brief Set the bool set_intrinsics as well as the parameter members
    *  representing the principle point, image dimensions, focal length and
@@ -193,7 +244,8 @@ class LoopClosureDetector {
   void setIntrinsics(const StereoFrame& stereo_frame);
 
   /* ------------------------------------------------------------------------ */
-  /** @brief Set the OrbDatabase internal member.
+  /** @brief Set the OrbDatabase internal member, as a copy of db that shares
+   *  its vocabulary if db is a SharedVocabularyOrbDatabase.
    * @param[in] db An OrbDatabase object.
    */
   void setDatabase(const OrbDatabase& db);
@@ -208,6 +260,30 @@ class LoopClosureDetector {
    */
   void print() const;
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Saves the frame database, the BoW database and the PGO to a
+   *  binary snapshot, to relocalize against this session in a later one.
+   *  The snapshot replaces filepath only once fully written, so it can be
+   *  the snapshot that was loaded.
+   * @param[in] filepath Path to the snapshot to write.
+   * @return False if the snapshot could not be written.
+   */
+  bool saveSnapshot(const std::string& filepath) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Restores the state saved with saveSnapshot. Must be called before
+   *  processing any frame. The snapshot stays memory-mapped: the descriptors
+   *  of the restored frames point inside it.
+   *  Keyframes that come after are numbered after the restored ones, and the
+   *  first one is loosely attached to the end of the restored trajectory,
+   *  until loop closures against the old frames align both sessions.
+   * @param[in] filepath Path to a snapshot written by saveSnapshot, with the
+   *  same vocabulary.
+   * @return False if the snapshot could not be read, in which case the
+   *  LoopClosureDetector must not be used.
+   */
+  bool loadSnapshot(const std::string& filepath);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Clears all keypoints and features from an input StereoFrame and
    *  fills it with ORB features.
@@ -215,6 +291,8 @@ class LoopClosureDetector {
    *  identified by an ORB detector.
    * @param[in/out] A StereoFrame initially filled with front-end features,
    *  which is then replaced with ORB features from the keypoints parameter.
+   *  Note: processAndAddFrame does not need it, it matches the ORB keypoints
+   *  without copying the StereoFrame.
    */
   // TODO(marcus): utils and reorder (or just static)
   void rewriteStereoFrameFeatures(const std::vector<cv::KeyPoint>& keypoints,
@@ -267,11 +345,27 @@ class LoopClosureDetector {
   /* ------------------------------------------------------------------------ */
   /** @brief Adds an odometry factor to the PGO and optimizes the trajectory.
    *  No actual optimization is performed on the RPGO side for odometry.
+   *  Odometry factors are only sent to the PGO in batches of
+   *  pgo_odometry_batch_size_ factors, or before a loop closure factor.
    * @param[in] factor An OdometryFactor representing the backend's guess for
    *  odometry between two consecutive keyframes.
    */
   void addOdometryFactorAndOptimize(const OdometryFactor& factor);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Creates the sharded BoW database on top of the vocabulary of
+   *  db_BoW_, if bow_shard_size_ > 0. It then replaces db_BoW_ for queries.
+   */
+  void initializeShardedDatabase();
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Adds the first keyframe of a session that continues a snapshot.
+   *  The world frames of both sessions are unrelated, so the keyframe starts
+   *  at the last pose of the snapshot with a very loose odometry factor.
+   * @param[in] factor The OdometryFactor of the first keyframe.
+   */
+  void addSessionBridgeFactor(const OdometryFactor& factor);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Adds a loop-closure factor to the PGO and optimizes the trajectory.
    * @param[in] factor A LoopClosureFactor representing the relative pose
@@ -279,6 +373,12 @@ class LoopClosureDetector {
    */
   void addLoopClosureFactorAndOptimize(const LoopClosureFactor& factor);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Updates the PGO with the odometry factors that have not been sent
+   *  to it yet, if any.
+   */
+  void updatePGOWithPendingOdometry();
+
   /* ------------------------------------------------------------------------ */
   /** @brief Initializes the RobustSolver member with no prior, or a neutral
    *  starting pose.
@@ -296,44 +396,152 @@ class LoopClosureDetector {
  private:
   /* ------------------------------------------------------------------------ */
   /** @brief Computes the indices of keypoints that match between two frames.
-   * @param[in] query_id The frame ID of the query frame in the database.
-   * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor, see
+   *  computeKnnMatches.
    * @param[out] i_query A vector of indices that match in the query frame.
    * @param[out] i_match A vector of indices that match in the match frame.
    * @param[in] cut_matches If true, Lowe's Ratio Test will be used to cut
    *  out bad matches before sending output.
    */
-  void computeMatchedIndices(const FrameId& query_id,
-                             const FrameId& match_id,
+  void computeMatchedIndices(const std::vector<DMatchVec>& matches,
                              std::vector<FrameId>* i_query,
                              std::vector<FrameId>* i_match,
                              bool cut_matches = false) const;
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Same as computeKnnMatches, but the matches of the latest pair of
+   *  frames are cached, so that geometric verification and pose recovery
+   *  only match descriptors once.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @return The two best matches of each query descriptor, best first.
+   */
+  const std::vector<DMatchVec>& getKnnMatches(const FrameId& query_id,
+                                              const FrameId& match_id);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Finds the two best matches in the match frame of each descriptor
+   *  of the query frame, either by brute force or guided by the vocabulary.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[out] matches The two best matches of each query descriptor, best
+   *  first.
+   */
+  void computeKnnMatches(const FrameId& query_id,
+                         const FrameId& match_id,
+                         std::vector<DMatchVec>* matches) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Brute-force kNN matching (k = 2) of two sets of descriptors, with
+   *  the HammingMatcher if enabled and possible, else with the OpenCV matcher.
+   * @param[in] query_descriptors Query descriptors, one per row.
+   * @param[in] match_descriptors Match descriptors, one per row.
+   * @param[out] matches The two best matches of each query descriptor.
+   */
+  void bruteForceKnnMatch(const OrbDescriptor& query_descriptors,
+                          const OrbDescriptor& match_descriptors,
+                          std::vector<DMatchVec>* matches) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Matches the descriptors of two frames only between descriptors
+   *  that fall under the same node of the vocabulary tree (see
+   *  LCDFrame::feature_vec_), instead of brute force.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[out] matches The two best matches of each query descriptor that
+   *  shares a node with the match frame. If there is only one candidate, the
+   *  second match has an infinite distance, and the match is only kept if its
+   *  distance is small on its own.
+   */
+  void computeBoWGuidedMatches(const FrameId& query_id,
+                               const FrameId& match_id,
+                               std::vector<DMatchVec>* matches) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Same as geometricVerificationCheck, given the matches between
+   *  the frames. It does not modify the LoopClosureDetector, so it can be
+   *  called concurrently.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor.
+   * @param[out] camCur_T_camRef_mono The pose between the match frame and the
+   *  query frame, in the coordinates of the match frame.
+   * @param[out] debug_info Statistics of the RANSAC.
+   * @return True if the verification check passes, false otherwise.
+   */
+  bool geometricVerificationFromMatches(const FrameId& query_id,
+                                        const FrameId& match_id,
+                                        const std::vector<DMatchVec>& matches,
+                                        gtsam::Pose3* camCur_T_camRef_mono,
+                                        LcdDebugInfo* debug_info) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Same as recoverPose, given the matches between the frames. It
+   *  does not modify the LoopClosureDetector, so it can be called
+   *  concurrently.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor.
+   * @param[in] camCur_T_camRef_mono The relative pose between the match frame
+   *  and the query frame, in the coordinates of the match frame.
+   * @param[out] bodyCur_T_bodyRef_stereo The 3D pose between the match frame
+   *  and the query frame, in the coordinates of the match frame.
+   * @param[out] debug_info Statistics of the RANSAC.
+   * @return True if the pose is recovered successfully, false otherwise.
+   */
+  bool recoverPoseFromMatches(const FrameId& query_id,
+                              const FrameId& match_id,
+                              const std::vector<DMatchVec>& matches,
+                              const gtsam::Pose3& camCur_T_camRef_mono,
+                              gtsam::Pose3* bodyCur_T_bodyRef_stereo,
+                              LcdDebugInfo* debug_info) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Runs geometric verification and pose recovery of the query frame
+   *  against several candidates in parallel. Among the candidates that pass,
+   *  the one with most RANSAC inliers wins.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] candidates Frame IDs of the candidates, best candidate first.
+   * @param[out] result The loop with the winner, or the reason why the first
+   *  candidate failed if none passes.
+   */
+  void verifyCandidates(const FrameId& query_id,
+                        const std::vector<FrameId>& candidates,
+                        LoopResult* result);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Checks geometric verification and determines a pose with
    *  a translation up to a scale factor between two frames, using Nister's
    *  five-point method.
    * @param[in] query_id The frame ID of the query frame in the database.
    * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor.
    * @param[out] camCur_T_camRef_mono The relative pose between the two frames,
    *  with translation up to a scale factor.
+   * @param[out] debug_info Statistics of the RANSAC.
    * @return True if the verification passes, false otherwise.
    */
   bool geometricVerificationNister(const FrameId& query_id,
                                    const FrameId& match_id,
-                                   gtsam::Pose3* camCur_T_camRef_mono);
+                                   const std::vector<DMatchVec>& matches,
+                                   gtsam::Pose3* camCur_T_camRef_mono,
+                                   LcdDebugInfo* debug_info) const;
 
   /* ------------------------------------------------------------------------ */
   /** @brief Checks geometric verification and determines a pose that is
    *  "stereo" - correct in translation scale using Arun's three-point method.
    * @param[in] query_id The frame ID of the query frame in the database.
    * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor.
    * @param[out] bodyCur_T_bodyRef The relative pose between the two frames.
+   * @param[out] debug_info Statistics of the RANSAC.
    * @return True if the verification passes, false otherwise.
    */
   bool recoverPoseArun(const FrameId& query_id,
                        const FrameId& match_id,
-                       gtsam::Pose3* bodyCur_T_bodyRef);
+                       const std::vector<DMatchVec>& matches,
+                       gtsam::Pose3* bodyCur_T_bodyRef,
+                       LcdDebugInfo* debug_info) const;
 
   /* ------------------------------------------------------------------------ */
   /** @brief Checks geometric verification and determines a pose that is
@@ -341,13 +549,67 @@ class LoopClosureDetector {
    *  3D keypoints matched between the frames.
    * @param[in] query_id The frame ID of the query frame in the database.
    * @param[in] match_id The frame ID of the match frame in the database.
+   * @param[in] matches The two best matches of each query descriptor.
    * @param[out] bodyCur_T_bodyRef The relative pose between the two frames.
    * @return True if the verification passes, false otherwise.
    */
   bool recoverPoseGivenRot(const FrameId& query_id,
                            const FrameId& match_id,
+                           const std::vector<DMatchVec>& matches,
                            const gtsam::Pose3& camCur_T_camRef_mono,
-                           gtsam::Pose3* bodyCur_T_bodyRef);
+                           gtsam::Pose3* bodyCur_T_bodyRef) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Detects and describes ORB features independently in each tile of
+   *  a grid over the image, in parallel. Each tile is padded with
+   *  edge_threshold_ pixels of the coarsest pyramid level so that features
+   *  close to the tile boundaries can still be described. At most nfeatures_
+   *  features with the best response are kept.
+   * @param[in] img The image where to extract ORB features.
+   * @param[out] keypoints The ORB keypoints, in image coordinates.
+   * @param[out] descriptors One row per keypoint with its ORB descriptor.
+   */
+  void detectAndComputeOrbInTiles(const cv::Mat& img,
+                                  std::vector<cv::KeyPoint>* keypoints,
+                                  OrbDescriptor* descriptors) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Computes ORB descriptors on the keypoints tracked by the frontend,
+   *  skipping ORB detection. Keypoints too close to the image border to be
+   *  described are discarded.
+   * @param[in] frame The left frame, with the keypoints of the frontend.
+   * @param[out] keypoints The described keypoints, with ORB orientation.
+   * @param[out] descriptors One row per keypoint with its ORB descriptor.
+   */
+  void computeOrbOnFrontendKeypoints(const Frame& frame,
+                                     std::vector<cv::KeyPoint>* keypoints,
+                                     OrbDescriptor* descriptors) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Orientation of a keypoint using the intensity centroid of a
+   *  circular patch around it, as ORB does for the keypoints it detects.
+   * @param[in] img Grayscale image.
+   * @param[in] pt Keypoint, at least half_patch_size pixels from the border.
+   * @param[in] half_patch_size Radius of the circular patch.
+   * @return The orientation in degrees, in [0, 360).
+   */
+  static float computeOrbOrientation(const cv::Mat& img,
+                                     const cv::Point2f& pt,
+                                     const int& half_patch_size);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Bounded-memory mode: releases the features of the frames that are
+   *  older than the recent_frames_with_features_ most recent ones, unless they
+   *  are at least min_dist_between_frames_with_features_ away from the last
+   *  old frame that kept its features. Ids and timestamps are kept, since the
+   *  PGO and the BoW database refer to them.
+   */
+  void releaseOldFrameFeatures();
+
+ private:
+  // Shared implementation of spinOnce and spinOnceWithoutDetection.
+  LcdOutput::UniquePtr processKeyframe(const LcdInput& input,
+                                       bool detect_loop);
 
  private:
   // Parameter members
@@ -357,13 +619,30 @@ class LoopClosureDetector {
 
   // ORB extraction and matching members
   cv::Ptr<cv::ORB> orb_feature_detector_;
+  std::vector<cv::Ptr<cv::ORB>> orb_tile_feature_detectors_;
   cv::Ptr<cv::DescriptorMatcher> orb_feature_matcher_;
 
   // BoW and Loop Detection database and members
   std::unique_ptr<OrbDatabase> db_BoW_;
+  // Only used if bow_shard_size_ > 0, in place of db_BoW_.
+  ShardedBowDatabase::UniquePtr sharded_db_BoW_;
   std::vector<LCDFrame> db_frames_;
   FrameIDTimestampMap timestamp_map_;
 
+  // Matches between the latest pair of frames, see getKnnMatches.
+  bool has_cached_matches_ = {false};
+  FrameId cached_query_id_ = {0u};
+  FrameId cached_match_id_ = {0u};
+  std::vector<DMatchVec> cached_matches_;
+
+  // Bounded-memory members
+  size_t db_frames_memory_bytes_ = {0u};
+  FrameId next_frame_to_release_ = {0u};
+  int last_old_frame_with_features_ = {-1};
+
+  // Last frame on which loop detection ran, for keyframe gating.
+  int last_detection_frame_ = {-1};
+
   // Store latest computed objects for temporal matching and nss scoring
   LcdThirdPartyWrapper::UniquePtr lcd_tp_wrapper_;
   DBoW2::BowVector latest_bowvec_;
@@ -374,23 +653,25 @@ class LoopClosureDetector {
   // Robust PGO members
   std::unique_ptr<KimeraRPGO::RobustSolver> pgo_;
   std::vector<gtsam::Pose3> W_Pose_Blkf_estimates_;
+  // Trajectory of the PGO, and factors added to the PGO since last output.
+  PgoTrajectory::ConstPtr pgo_trajectory_;
+  gtsam::NonlinearFactorGraph new_pgo_factors_;
+  // Odometry factors and values not sent to the PGO yet. Values are
+  // dead-reckoned from the optimized poses.
+  gtsam::NonlinearFactorGraph pending_odom_factors_;
+  gtsam::Values pending_odom_values_;
   gtsam::SharedNoiseModel
       shared_noise_model_;  // TODO(marcus): make accurate
                             // should also come in with input
 
+  // Snapshot of a previous session, kept mapped for the restored descriptors.
+  SnapshotReader::UniquePtr snapshot_reader_;
+  // Number of keyframes restored from the snapshot.
+  FrameId kf_id_offset_ = {0u};
+
   // Logging members
   std::unique_ptr<LoopClosureDetectorLogger> logger_;
   LcdDebugInfo debug_info_;
-
- private:
-  // Lcd typedefs
-  using DMatchVec = std::vector<cv::DMatch>;
-  using AdapterMono = opengv::relative_pose::CentralRelativeAdapter;
-  using SacProblemMono =
-      opengv::sac_problems::relative_pose::CentralRelativePoseSacProblem;
-  using AdapterStereo = opengv::point_cloud::PointCloudAdapter;
-  using SacProblemStereo =
-      opengv::sac_problems::point_cloud::PointCloudSacProblem;
 };  // class LoopClosureDetector
 
 enum class LoopClosureDetectorType {
@@ -482,7 +763,13 @@ class LcdModule : public MIMOPipelineModule<LcdInput, LcdOutput> {
   }
 
   OutputUniquePtr spinOnce(LcdInput::UniquePtr input) override {
-    return lcd_->spinOnce(*input);
+    CHECK(input);
+    // Keyframe gating: skip the ORB/BoW work if the keyframe barely moved or
+    // if keyframes pile up, but keep its odometry in the PGO.
+    if (lcd_->shouldDetectLoop(*input, backend_queue_.size())) {
+      return lcd_->spinOnce(*input);
+    }
+    return lcd_->spinOnceWithoutDetection(*input);
   }
 
   //! Called when general shutdown of PipelineModule is triggered.
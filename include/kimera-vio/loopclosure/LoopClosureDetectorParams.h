@@ -76,7 +76,27 @@ class LoopClosureDetectorParams : public PipelineParams {
       int fast_threshold = 20,
 
       double pgo_rot_threshold = 0.01,
-      double pgo_trans_threshold = 0.1)
+      double pgo_trans_threshold = 0.1,
+
+      // New parameters go last, so that positional callers keep working.
+      bool bounded_memory = false,
+      int recent_frames_with_features = 200,
+      double min_dist_between_frames_with_features = 1.0,
+      bool use_frontend_keypoints = false,
+      int orb_grid_rows = 1,
+      int orb_grid_cols = 1,
+      bool use_bow_guided_matching = false,
+      int bow_matching_levels_up = 4,
+      bool incremental_output = false,
+      int pgo_odometry_batch_size = 1,
+      int nr_candidates_to_verify = 1,
+      int bow_shard_size = 0,
+      double bow_shard_query_radius = 20.0,
+      int bow_global_sweep_period = 10,
+      bool use_hamming_kernel = true,
+      double gating_min_translation = 0.0,
+      double gating_min_rotation = 0.0,
+      int gating_max_queue_size = 0)
       : PipelineParams("Loop Closure Parameters"),
         image_width_(image_width),
         image_height_(image_height),
@@ -93,6 +113,12 @@ class LoopClosureDetectorParams : public PipelineParams {
         max_intragroup_gap_(max_intragroup_gap),
         max_distance_between_groups_(max_distance_between_groups),
         max_distance_between_queries_(max_distance_between_queries),
+        bow_shard_size_(bow_shard_size),
+        bow_shard_query_radius_(bow_shard_query_radius),
+        bow_global_sweep_period_(bow_global_sweep_period),
+        gating_min_translation_(gating_min_translation),
+        gating_min_rotation_(gating_min_rotation),
+        gating_max_queue_size_(gating_max_queue_size),
 
         geom_check_(geom_check),
         min_correspondences_(min_correspondences),
@@ -101,6 +127,7 @@ class LoopClosureDetectorParams : public PipelineParams {
         ransac_threshold_mono_(ransac_threshold_mono),
         ransac_randomize_mono_(ransac_randomize_mono),
         ransac_inlier_threshold_mono_(ransac_inlier_threshold_mono),
+        nr_candidates_to_verify_(nr_candidates_to_verify),
 
         pose_recovery_option_(pose_recovery_option),
         max_ransac_iterations_stereo_(max_ransac_iterations_stereo),
@@ -112,6 +139,9 @@ class LoopClosureDetectorParams : public PipelineParams {
 
         lowe_ratio_(lowe_ratio),
         matcher_type_(matcher_type),
+        use_bow_guided_matching_(use_bow_guided_matching),
+        bow_matching_levels_up_(bow_matching_levels_up),
+        use_hamming_kernel_(use_hamming_kernel),
 
         nfeatures_(nfeatures),
         scale_factor_(scale_factor),
@@ -122,12 +152,20 @@ class LoopClosureDetectorParams : public PipelineParams {
         score_type_(score_type),
         patch_sze_(patch_sze),
         fast_threshold_(fast_threshold),
+        use_frontend_keypoints_(use_frontend_keypoints),
+        orb_grid_rows_(orb_grid_rows),
+        orb_grid_cols_(orb_grid_cols),
 
         pgo_rot_threshold_(pgo_rot_threshold),
-        pgo_trans_threshold_(pgo_trans_threshold) {
-    // Trivial sanity checks:
-    CHECK(alpha_ > 0);
-    CHECK(nfeatures_ >= 100);  // TODO(marcus): add more checks, change this one
+        pgo_trans_threshold_(pgo_trans_threshold),
+        incremental_output_(incremental_output),
+        pgo_odometry_batch_size_(pgo_odometry_batch_size),
+
+        bounded_memory_(bounded_memory),
+        recent_frames_with_features_(recent_frames_with_features),
+        min_dist_between_frames_with_features_(
+            min_dist_between_frames_with_features) {
+    checkParams();
   }
 
  public:
@@ -139,6 +177,9 @@ class LoopClosureDetectorParams : public PipelineParams {
 
   virtual void print() const override;
 
+  // Trivial sanity checks, after construction and after parsing.
+  void checkParams() const;
+
  public:
   /////////////////////////// Camera intrinsic Params //////////////////////////
   int image_width_;
@@ -158,6 +199,20 @@ class LoopClosureDetectorParams : public PipelineParams {
   int max_intragroup_gap_;     // Max separation btwn matches of the same group
   int max_distance_between_groups_;   // Max separation between groups
   int max_distance_between_queries_;  // Max separation between two queries
+  // If > 0, the BoW database is split in shards of this many keyframes, and
+  // only the shards within bow_shard_query_radius_ [m] of the current PGO
+  // pose are queried, except every bow_global_sweep_period_ queries.
+  int bow_shard_size_;
+  double bow_shard_query_radius_;
+  int bow_global_sweep_period_;
+  // Keyframe gating: loop detection is skipped for keyframes that moved less
+  // than gating_min_translation_ [m] and gating_min_rotation_ [rad] from the
+  // last keyframe that was processed (0 disables each threshold), or while
+  // more than gating_max_queue_size_ keyframes wait in the LcdModule (0
+  // disables it). Skipped keyframes are still added to the PGO.
+  double gating_min_translation_;
+  double gating_min_rotation_;
+  int gating_max_queue_size_;
   //////////////////////////////////////////////////////////////////////////////
 
   /////////////////////// Geometrical Verification Params //////////////////////
@@ -168,6 +223,9 @@ class LoopClosureDetectorParams : public PipelineParams {
   double ransac_threshold_mono_;         // Threshold for 5-pt algorithm
   bool ransac_randomize_mono_;           // Randomize seed for ransac
   double ransac_inlier_threshold_mono_;  // Threshold for ransac inliers
+  // Number of candidates (best match of each of the best islands) that are
+  // verified in parallel; the one with most inliers is the loop closure.
+  int nr_candidates_to_verify_;
   //////////////////////////////////////////////////////////////////////////////
 
   /////////////////////////// 3D Pose Recovery Params //////////////////////////
@@ -183,6 +241,14 @@ class LoopClosureDetectorParams : public PipelineParams {
   ///////////////////////// ORB feature matching params ////////////////////////
   double lowe_ratio_;
   int matcher_type_;
+  // Only match descriptors under the same node of the vocabulary tree, which
+  // is bow_matching_levels_up_ levels above the leaves (the visual words),
+  // instead of brute-force matching all descriptors.
+  bool use_bow_guided_matching_;
+  int bow_matching_levels_up_;
+  // Brute-force match 256-bit descriptors (ORB) with the HammingMatcher,
+  // whatever the matcher_type_.
+  bool use_hamming_kernel_;
   //////////////////////////////////////////////////////////////////////////////
 
   ///////////////////////// ORB feature detector params ////////////////////////
@@ -195,11 +261,33 @@ class LoopClosureDetectorParams : public PipelineParams {
   int score_type_;
   int patch_sze_;
   int fast_threshold_;
+  // Describe the keypoints tracked by the frontend instead of detecting ORB.
+  bool use_frontend_keypoints_;
+  // Detect ORB features in parallel in a grid of tiles of the image.
+  int orb_grid_rows_;
+  int orb_grid_cols_;
   //////////////////////////////////////////////////////////////////////////////
 
   ////////////////////////////// PGO solver params /////////////////////////////
   double pgo_rot_threshold_;
   double pgo_trans_threshold_;
+  // Only output the factors added to the PGO and its (shared) trajectory at
+  // every keyframe, and the full PGO graph and values only on loop closures.
+  bool incremental_output_;
+  // Number of odometry factors accumulated before updating the PGO with
+  // them. Loop closures always update the PGO with the pending ones first.
+  int pgo_odometry_batch_size_;
+  //////////////////////////////////////////////////////////////////////////////
+
+  ///////////////////////////// Bounded memory params //////////////////////////
+  // If true, old frames only keep their features (keypoints, descriptors...)
+  // if they are spatially sparse, so that they can still be used as loop
+  // closure candidates.
+  bool bounded_memory_;
+  // Number of most recent frames that always keep their features.
+  int recent_frames_with_features_;
+  // Min distance [m] between old frames that keep their features.
+  double min_dist_between_frames_with_features_;
   //////////////////////////////////////////////////////////////////////////////
 };
 
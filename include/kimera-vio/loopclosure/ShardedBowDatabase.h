@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ShardedBowDatabase.h
+ * @brief  BoW database split in temporal shards that are queried only if
+ * they are close to the current pose estimate.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gtsam/geometry/Point3.h>
+
+#include <DBoW2/DBoW2.h>
+
+#include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+// Drop-in replacement of the OrbDatabase for long trajectories, with the same
+// L1 scores. Entries are added to shards of shard_size consecutive entries.
+// Each shard keeps its own inverted file, and the bounding box of the
+// positions of its entries. A query only visits the shards whose bounding box
+// is within query_radius of the query position, except every
+// global_sweep_period queries, which visit all shards in case the pose
+// estimate drifted too much. Full shards store their posting lists in
+// contiguous arrays.
+class ShardedBowDatabase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ShardedBowDatabase);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ShardedBowDatabase);
+
+  ShardedBowDatabase(const OrbVocabulary* vocabulary,
+                     size_t shard_size,
+                     double query_radius,
+                     size_t global_sweep_period);
+  ~ShardedBowDatabase() = default;
+
+  /** @brief Adds an entry, with id the number of entries added before.
+   * @param[in] bow_vec The BoW vector of the entry.
+   * @param[in] W_position Position of the entry in the world frame, or
+   *  nullptr if unknown: shards with unknown positions are always queried.
+   * @return The id of the new entry.
+   */
+  DBoW2::EntryId add(const DBoW2::BowVector& bow_vec,
+                     const gtsam::Point3* W_position = nullptr);
+
+  /** @brief Same as OrbDatabase::query, restricted to the shards near the
+   *  query position.
+   * @param[in] bow_vec The BoW vector of the query.
+   * @param[out] results Entries sorted by decreasing score.
+   * @param[in] max_results Maximum number of results, all if <= 0.
+   * @param[in] max_id Only entries with an id lower than max_id are returned,
+   *  all if -1.
+   * @param[in] W_position Position of the query in the world frame, or
+   *  nullptr to query all shards.
+   */
+  void query(const DBoW2::BowVector& bow_vec,
+             DBoW2::QueryResults* results,
+             int max_results,
+             int max_id,
+             const gtsam::Point3* W_position = nullptr);
+
+  /** @brief Recomputes the bounding boxes of the shards, e.g. after a loop
+   *  closure moved the trajectory. Entry i has the pose of key i.
+   * @param[in] trajectory The trajectory of the PGO.
+   */
+  void updatePositions(const PgoTrajectory& trajectory);
+
+  /** @brief Recovers the BoW vector of each entry, see
+   *  SharedVocabularyOrbDatabase::getBowVectors.
+   * @param[out] bow_vecs One BoW vector per entry, indexed by EntryId.
+   */
+  void getBowVectors(std::vector<DBoW2::BowVector>* bow_vecs) const;
+
+  void clear();
+
+  inline size_t size() const { return nr_entries_; }
+  inline size_t nrShards() const { return shards_.size(); }
+  inline const OrbVocabulary* getVocabulary() const { return vocabulary_; }
+
+ private:
+  struct Shard {
+    DBoW2::EntryId first_entry = 0u;
+    size_t nr_entries = 0u;
+
+    // Full shards: the postings of words[i] are in
+    // [word_offsets[i], word_offsets[i + 1]) of posting_entries (entry minus
+    // first_entry) and posting_weights.
+    std::vector<DBoW2::WordId> words;
+    std::vector<uint32_t> word_offsets;
+    std::vector<uint32_t> posting_entries;
+    std::vector<double> posting_weights;
+
+    // Shard being filled, moved to the arrays above once full.
+    std::unordered_map<DBoW2::WordId,
+                       std::vector<std::pair<uint32_t, double>>>
+        open_postings;
+
+    // Bounding box of the known positions of the entries.
+    bool has_unknown_positions = false;
+    bool has_bounds = false;
+    gtsam::Point3 min_position;
+    gtsam::Point3 max_position;
+
+    inline bool isSealed() const { return !word_offsets.empty(); }
+    void seal();
+    void addPosition(const gtsam::Point3& W_position);
+    double distanceTo(const gtsam::Point3& W_position) const;
+  };
+
+  // Accumulates the L1 scores of the entries of a shard, as DBoW2 does.
+  void queryShard(const Shard& shard,
+                  const DBoW2::BowVector& bow_vec,
+                  int max_id,
+                  DBoW2::QueryResults* results);
+
+ private:
+  const OrbVocabulary* vocabulary_;
+  const size_t shard_size_;
+  const double query_radius_;
+  const size_t global_sweep_period_;
+
+  std::vector<Shard> shards_;
+  size_t nr_entries_ = 0u;
+  size_t nr_queries_ = 0u;
+
+  // Scratch buffers of queryShard, to avoid allocating at every query.
+  std::vector<double> scores_;
+  std::vector<uint8_t> hits_;
+};
+
+}  // namespace VIO
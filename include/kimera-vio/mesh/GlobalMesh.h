@@ -0,0 +1,202 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GlobalMesh.h
+ * @brief  Persistent mesh of the whole map, split in chunks.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Integer coordinates of a cell of a regular grid: a voxel, or a chunk.
+struct GridIndex {
+  GridIndex() : x(0), y(0), z(0) {}
+  GridIndex(int32_t x, int32_t y, int32_t z) : x(x), y(y), z(z) {}
+  inline bool operator==(const GridIndex& other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+
+  int32_t x;
+  int32_t y;
+  int32_t z;
+};
+
+struct GridIndexHash {
+  inline size_t operator()(const GridIndex& index) const {
+    return static_cast<size_t>(index.x) * 73856093u ^
+           static_cast<size_t>(index.y) * 19349669u ^
+           static_cast<size_t>(index.z) * 83492791u;
+  }
+};
+
+// Part of the global mesh: the triangles whose centroid falls in a cube of
+// the map, with their own vertices. Chunks do not share vertices, so that
+// each of them can be used (visualized, saved...) on its own.
+struct MeshChunk {
+  KIMERA_POINTER_TYPEDEFS(MeshChunk);
+  typedef std::array<uint32_t, 3> Face;
+
+  MeshChunk() = default;
+  explicit MeshChunk(const GridIndex& index) : index_(index) {}
+
+  // Index of the chunk in the grid of chunks.
+  GridIndex index_;
+  // Vertices of the chunk, one per voxel.
+  std::vector<cv::Point3f> vertices_;
+  // Triangles of the chunk, as indices in vertices_.
+  std::vector<Face> faces_;
+};
+
+// Accumulates the meshes of the time horizon into a mesh of the whole map.
+// A triangle is only added once it leaves the time horizon, that is, once one
+// of its landmarks is not in the mesh anymore: until then, the mesher can
+// still move it, or replace it by another triangulation of the same
+// landmarks, which is then added instead. Vertices closer than a voxel are
+// merged (their position is averaged), and triangles are only added once.
+// The mesh is split in chunks, and only the
+// most recently used chunks are kept in memory: the others are written to
+// disk, and read back when the camera comes back to them. Therefore, both the
+// memory and the cost of each update are bounded.
+class GlobalMesh {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GlobalMesh);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GlobalMesh);
+
+  // voxel_size: distance under which vertices are merged [m].
+  // chunk_size: side of the cube covered by a chunk [m].
+  // max_chunks_in_memory: chunks kept in memory before evicting to disk.
+  // chunks_path: folder for evicted chunks. If empty, evicted chunks are
+  // dropped instead.
+  GlobalMesh(const double& voxel_size,
+             const double& chunk_size,
+             const size_t& max_chunks_in_memory,
+             const std::string& chunks_path);
+  // Adds the triangles of the time horizon, and saves the chunks in memory to
+  // disk, if chunks_path is not empty.
+  ~GlobalMesh();
+
+  // Adds the triangles that left the time horizon since the last update to
+  // the global mesh, and returns a copy of the chunks that changed. The mesh
+  // is the one of the time horizon. Evicts the least recently used chunks if
+  // there are too many in memory.
+  void update(const Mesh3D& mesh_3d, std::vector<MeshChunk>* updated_chunks);
+
+  // Writes all chunks in memory to disk.
+  void saveChunks() const;
+
+  inline size_t getNumberOfChunksInMemory() const { return chunks_.size(); }
+  inline size_t getNumberOfChunksOnDisk() const {
+    return chunks_on_disk_.size();
+  }
+
+  // Chunk file format, in little endian: "KMC2", the chunk index (3 x
+  // int32), the number of vertices and faces (2 x uint32), then for each
+  // vertex its position (3 x float32), number of merged vertices (uint32)
+  // and voxel index (3 x int32), and for each face its vertex indices (3 x
+  // uint32).
+  static bool saveChunk(const std::string& filename,
+                        const MeshChunk& chunk,
+                        const std::vector<uint32_t>& vertex_weights,
+                        const std::vector<GridIndex>& vertex_voxels);
+  static bool loadChunk(const std::string& filename,
+                        MeshChunk* chunk,
+                        std::vector<uint32_t>* vertex_weights,
+                        std::vector<GridIndex>* vertex_voxels);
+
+ private:
+  struct FaceHash {
+    inline size_t operator()(const MeshChunk::Face& face) const {
+      return static_cast<size_t>(face[0]) * 73856093u ^
+             static_cast<size_t>(face[1]) * 19349669u ^
+             static_cast<size_t>(face[2]) * 83492791u;
+    }
+  };
+
+  // Vertex positions of a triangle of the time horizon.
+  typedef std::array<cv::Point3f, 3> Triangle;
+  // Triangles of the time horizon, by their sorted landmark ids.
+  typedef std::map<std::array<LandmarkId, 3>, Triangle> HorizonTriangles;
+
+  // A chunk with the structures to merge vertices and faces into it.
+  struct ChunkData {
+    MeshChunk chunk;
+    std::vector<uint32_t> vertex_weights;
+    // Voxel of each vertex, the one of the first point merged into it: the
+    // average of the points can end up across the border of the voxel.
+    std::vector<GridIndex> vertex_voxels;
+    std::unordered_map<GridIndex, uint32_t, GridIndexHash> voxel_to_vertex;
+    // Faces with sorted vertex indices.
+    std::unordered_set<MeshChunk::Face, FaceHash> faces;
+    // Position in the list of least recently used chunks.
+    std::list<GridIndex>::iterator lru_it;
+    // Last update that used this chunk.
+    size_t last_update;
+  };
+  typedef std::unordered_map<GridIndex, ChunkData, GridIndexHash> Chunks;
+
+  GridIndex getGridIndex(const cv::Point3f& point,
+                         const double& cell_size) const;
+
+  // Returns the chunk, reading it from disk or creating it if needed, and
+  // marks it as the most recently used one.
+  ChunkData& getChunk(const GridIndex& chunk_index);
+
+  // Adds the triangle to the chunk of its centroid, unless its vertices
+  // collapse when merged into voxels, or the chunk has it already. Returns
+  // whether the triangle was added, and the chunk it belongs to.
+  bool addTriangle(const Triangle& triangle, GridIndex* chunk_index);
+
+  // Returns the index of the vertex of the chunk in the voxel of the point,
+  // adding or merging the point.
+  uint32_t addVertex(const cv::Point3f& point,
+                     const GridIndex& voxel_index,
+                     ChunkData* chunk_data) const;
+
+  // Removes the least recently used chunks until at most max_chunks_in_memory_
+  // remain, except for the ones used in the current update.
+  void evictChunks();
+
+  // Builds the merging structures of a chunk.
+  void indexChunk(ChunkData* chunk_data) const;
+
+  std::string getChunkFilename(const GridIndex& chunk_index) const;
+
+ private:
+  const double voxel_size_;
+  const double chunk_size_;
+  const size_t max_chunks_in_memory_;
+  const std::string chunks_path_;
+
+  // Chunks in memory, and their indices from most to least recently used.
+  Chunks chunks_;
+  std::list<GridIndex> lru_chunks_;
+  // Chunks evicted to disk.
+  std::unordered_set<GridIndex, GridIndexHash> chunks_on_disk_;
+  // Triangles of the mesh of the last update, not added yet.
+  HorizonTriangles horizon_triangles_;
+  size_t nr_updates_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,171 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalDelaunay2D.h
+ * @brief  2D Delaunay triangulation of keypoints, updated across frames.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Delaunay triangulation of the keypoints of an image, indexed by landmark id.
+// Instead of triangulating all keypoints at every frame (as cv::Subdiv2D
+// does), update() moves the vertices of tracked landmarks, removes the ones
+// that are not tracked anymore and inserts the new ones, and re-flips edges
+// locally around the changes (Lawson flips).
+// Like cv::Subdiv2D, the keypoints are triangulated together with the three
+// vertices of a triangle enclosing the image, and only the triangles between
+// keypoints are returned.
+class IncrementalDelaunay2D {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalDelaunay2D);
+
+  IncrementalDelaunay2D();
+  ~IncrementalDelaunay2D() = default;
+
+  // Updates the triangulation to the given keypoints, one per landmark id,
+  // and returns its triangles in the format of cv::Subdiv2D::getTriangleList.
+  // Keypoints outside of the image, or at the same pixel as another keypoint,
+  // are not triangulated.
+  void update(const cv::Size& img_size,
+              const LandmarkIds& lmk_ids,
+              const std::vector<cv::Point2f>& keypoints,
+              std::vector<cv::Vec6f>* triangulation_2D);
+
+  // Removes all keypoints.
+  void clear();
+
+  // Number of keypoints in the triangulation.
+  inline size_t getNumberOfVertices() const {
+    return lmk_id_to_vertex_map_.size();
+  }
+
+ private:
+  typedef int VertexId;
+  typedef int TriangleId;
+
+  // Triangle with counter-clockwise vertices. n[i] is the triangle across the
+  // edge opposite to v[i], or -1 if there is none. Removed triangles have
+  // v[0] == -1.
+  struct Triangle {
+    VertexId v[3];
+    TriangleId n[3];
+  };
+
+  // Edge from a to b, in counter-clockwise order in triangle t.
+  struct Edge {
+    TriangleId t;
+    VertexId a;
+    VertexId b;
+  };
+
+  // Result of locating a point in the triangulation.
+  enum class Location { INSIDE, ON_EDGE, ON_VERTEX, OUTSIDE };
+
+ private:
+  // Clears the triangulation and creates the enclosing triangle of the image.
+  void reset(const cv::Size& img_size);
+
+  // Clears the triangulation and inserts all keypoints again.
+  void rebuild(const cv::Size& img_size,
+               const std::vector<std::pair<LandmarkId, cv::Point2f>>& points);
+
+  // All the functions below return false if the triangulation is broken
+  // (because of numerical issues), in which case it has to be rebuilt.
+  bool insertVertex(const LandmarkId& lmk_id, const cv::Point2f& point);
+  bool removeVertex(const VertexId& vertex_id);
+  bool moveVertex(const VertexId& vertex_id, const cv::Point2f& point);
+
+  // Flips the queued edges, and the edges around them, until they are all
+  // locally Delaunay.
+  bool legalizeEdges();
+
+  // Flips the edge opposite to vertex i of triangle t.
+  void flipEdge(const TriangleId& t, const int& i);
+
+  // Finds the triangle containing a point. For ON_EDGE, *edge_idx is the
+  // index of the vertex opposite to the edge, and for ON_VERTEX, the index of
+  // the vertex.
+  Location locate(const cv::Point2f& point,
+                  TriangleId* triangle_id,
+                  int* edge_idx) const;
+  Location locateInTriangle(const cv::Point2f& point,
+                            const TriangleId& triangle_id,
+                            int* edge_idx) const;
+
+  // Triangles around a vertex, in counter-clockwise order.
+  bool getVertexStar(const VertexId& vertex_id,
+                     std::vector<TriangleId>* star) const;
+
+  VertexId addVertex(const LandmarkId& lmk_id, const cv::Point2f& point);
+  TriangleId addTriangle();
+  void setTriangle(const TriangleId& t,
+                   const VertexId& v0,
+                   const VertexId& v1,
+                   const VertexId& v2,
+                   const TriangleId& n0,
+                   const TriangleId& n1,
+                   const TriangleId& n2);
+  // Sets the neighbor of t across its edge from a to b.
+  void setNeighbor(const TriangleId& t,
+                   const VertexId& a,
+                   const VertexId& b,
+                   const TriangleId& neighbor);
+  // Index of vertex v in triangle t, -1 if t does not have it.
+  int vertexIndex(const TriangleId& t, const VertexId& v) const;
+  // Queues the three edges of triangle t to be legalized.
+  void queueEdges(const TriangleId& t);
+
+  // Orientation of c with respect to the line from a to b: positive if
+  // counter-clockwise.
+  static double orient(const cv::Point2f& a,
+                       const cv::Point2f& b,
+                       const cv::Point2f& c);
+  // Positive if d is inside the circumcircle of the counter-clockwise
+  // triangle (a, b, c).
+  static double inCircle(const cv::Point2f& a,
+                         const cv::Point2f& b,
+                         const cv::Point2f& c,
+                         const cv::Point2f& d);
+
+ private:
+  // The first three vertices enclose the image.
+  static constexpr VertexId kNrEnclosingVertices = 3;
+
+  cv::Size img_size_;
+
+  // Per-vertex arrays, indexed by VertexId.
+  std::vector<cv::Point2f> vertex_positions_;
+  std::vector<LandmarkId> vertex_lmk_ids_;
+  // One of the triangles of the vertex, -1 for removed vertices.
+  std::vector<TriangleId> vertex_triangles_;
+  std::vector<VertexId> free_vertex_ids_;
+  std::unordered_map<LandmarkId, VertexId> lmk_id_to_vertex_map_;
+
+  std::vector<Triangle> triangles_;
+  std::vector<TriangleId> free_triangle_ids_;
+  // Starting triangle for the next point location.
+  TriangleId last_triangle_;
+
+  // Edges to legalize.
+  std::vector<Edge> edge_queue_;
+};
+
+}  // namespace VIO
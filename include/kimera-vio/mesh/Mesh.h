@@ -14,9 +14,12 @@
 
 #pragma once
 
-#include <map>
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
+#include <glog/logging.h>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/viz/types.hpp>  // Just for color type.
@@ -27,6 +30,11 @@ namespace VIO {
 
 // TODO this class is NOT THREADSAFE...
 // Class defining the concept of a polygonal mesh.
+// Vertices and polygons are stored in contiguous arrays, indexed by VertexId
+// and PolygonId. Each vertex keeps the polygons that use it, for neighbor
+// queries and removals. Removed vertices leave a free slot that is reused by
+// the next new vertex; removed polygons are replaced by the last polygon, so
+// that polygon ids are always in [0, getNumberOfPolygons()).
 template <typename VertexPosition = cv::Point3f>
 class Mesh {
  public:
@@ -34,21 +42,24 @@ class Mesh {
   typedef cv::Vec3b VertexColorRGB;
   // Normal for a vertex
   typedef cv::Point3f VertexNormal;
+  // Vertex id: index of the vertex in the vertex arrays.
+  typedef int VertexId;
+  // Polygon id: index of the polygon in the polygon array.
+  typedef size_t PolygonId;
 
  public:
   // Default constructor.
   Mesh(const size_t& polygon_dimension = 3);
 
-  // Delete copy constructor.
-  // Performs a deep copy (clones) the data members.
+  // Copy constructor.
+  // Performs a deep copy of the data members.
   Mesh(const Mesh& rhs_mesh);
 
   // Copy assignement operator.
-  // Performs a deep copy (clones) the data members.
+  // Performs a deep copy of the data members.
   Mesh& operator=(const Mesh& mesh);
 
   // Use default move constructor.
-  // TODO define explicitly what the move ctor shall look like.
   Mesh(Mesh&& mesh) = default;
 
   // Delete move assignement operator.
@@ -58,11 +69,8 @@ class Mesh {
   ~Mesh() = default;
 
  private:
-  // Vertex id (for internal processing).
-  typedef int VertexId;
   // Maps (for internal processing).
-  typedef std::map<VertexId, LandmarkId> VertexToLmkIdMap;
-  typedef std::map<LandmarkId, VertexId> LmkIdToVertexMap;
+  typedef std::unordered_map<LandmarkId, VertexId> LmkIdToVertexMap;
 
  public:
   template <typename PositionType = cv::Point3f>
@@ -124,15 +132,27 @@ class Mesh {
   // Adds a new polygon into the mesh, updates the internal data structures.
   void addPolygonToMesh(const Polygon& polygon);
 
+  // Removes a polygon in O(1): the last polygon takes its id.
+  void removePolygon(const PolygonId& polygon_id);
+
+  // Removes a vertex and all the polygons that use it. Its id will be reused
+  // by a new vertex.
+  void removeVertex(const VertexId& vertex_id);
+
   // Completely clears the mesh.
   void clearMesh();
 
   /// Getters
   inline size_t getNumberOfPolygons() const {
-    return static_cast<size_t>(polygons_mesh_.rows / (polygon_dimension_ + 1));
+    return polygons_mesh_.size() / polygon_dimension_;
   }
+  // Number of vertex ids in use, including the ids of removed vertices that
+  // have not been reused yet: vertex ids are in [0, getNumberOfUniqueVertices).
   inline size_t getNumberOfUniqueVertices() const {
-    return vertices_mesh_.rows;
+    return vertices_mesh_.size();
+  }
+  inline size_t getNumberOfLiveVertices() const {
+    return vertices_mesh_.size() - free_vertex_ids_.size();
   }
   // TODO needs to be generalized to aleatory polygonal meshes.
   // Currently it only allows polygons of same size.
@@ -147,19 +167,52 @@ class Mesh {
   // to retrieve one polygon at a time.
   bool getPolygon(const size_t& polygon_idx, Polygon* polygon) const;
 
+  // Vertex ids of a polygon, getMeshPolygonDimension() of them.
+  inline const VertexId* getPolygonVertexIds(
+      const PolygonId& polygon_id) const {
+    DCHECK_LT(polygon_id, getNumberOfPolygons());
+    return &polygons_mesh_[polygon_id * polygon_dimension_];
+  }
+
   // Retrieve a vertex or internal vertex_id.
   // (optionally, call with nullptr if you don't want the info) from the mesh
   // given a LandmarkId.
   // Returns true if we could find the vertex with the given landmark id
   // false otherwise.
-  // The internal vertex id used to store the vertex in
-  // a cv::Mat (TODO this is only done to be able to create a color mask of
-  // the mesh, but this should be also done internally by storing a set of
-  // properties for each vertex, instead of using cv::Mat).
+  // The internal vertex id indexes the rows of convertVerticesMeshToMat, e.g.
+  // to create a color mask of the mesh.
   bool getVertex(const LandmarkId& lmk_id,
                  Vertex<VertexPosition>* vertex = nullptr,
                  VertexId* vertex_id = nullptr) const;
 
+  /// Per-vertex accessors, by vertex id.
+  inline bool isVertexAlive(const VertexId& vertex_id) const {
+    return vertex_lmk_ids_.at(vertex_id) != -1;
+  }
+  inline const LandmarkId& getVertexLmkId(const VertexId& vertex_id) const {
+    return vertex_lmk_ids_.at(vertex_id);
+  }
+  inline const VertexPosition& getVertexPosition(
+      const VertexId& vertex_id) const {
+    return vertices_mesh_.at(vertex_id);
+  }
+  inline void setVertexPosition(const VertexId& vertex_id,
+                                const VertexPosition& vertex_position) {
+    DCHECK(isVertexAlive(vertex_id));
+    vertices_mesh_.at(vertex_id) = vertex_position;
+    normals_computed_ = false;
+  }
+
+  // Polygons that use a vertex.
+  inline const std::vector<PolygonId>& getVertexPolygons(
+      const VertexId& vertex_id) const {
+    return vertex_polygons_.at(vertex_id);
+  }
+
+  // Vertices that share a polygon with a vertex (its one-ring), sorted.
+  void getVertexNeighbors(const VertexId& vertex_id,
+                          std::vector<VertexId>* neighbors) const;
+
   // NOT TESTED
   void computePerVertexNormals();
 
@@ -171,58 +224,47 @@ class Mesh {
 
  private:
   /// Functions
-  // Updates internal structures to add a vertex.
-  // Used by addPolygonToMesh, it is not supposed to be used by the end user.
-  void updateMeshDataStructures(
+  // Adds a vertex, or updates its position if the landmark is already in the
+  // mesh. Used by addPolygonToMesh, it is not supposed to be used by the end
+  // user.
+  VertexId updateMeshDataStructures(
       const LandmarkId& lmk_id, const VertexPosition& lmk_position,
-      std::map<VertexId, LandmarkId>* vertex_to_lmk_id_map,
-      std::map<LandmarkId, VertexId>* lmk_id_to_vertex_map,
-      cv::Mat* vertices_mesh, cv::Mat_<VertexNormal>* vertices_mesh_normal,
-      cv::Mat* vertices_mesh_color, cv::Mat* polygon_mesh,
-      const VertexColorRGB& vertex_color = cv::viz::Color::white()) const;
+      const VertexColorRGB& vertex_color = cv::viz::Color::white());
+
+  // Removes polygon_id from the polygons of a vertex.
+  void eraseVertexPolygon(const VertexId& vertex_id,
+                          const PolygonId& polygon_id);
 
   // Sets all vertex normals to 0.
   inline void clearVertexNormals() {
-    vertices_mesh_normal_ = VertexNormal(0.0, 0.0, 0.0);
+    std::fill(vertices_mesh_normal_.begin(), vertices_mesh_normal_.end(),
+              VertexNormal(0.0, 0.0, 0.0));
   }
 
  private:
-  /// TODO change internal structures for the mesh with std::vector<Polygon>.
-
   /// Members
-  /// TODO maybe use bimap.
-  // Vertex to LmkId Map
-  VertexToLmkIdMap vertex_to_lmk_id_map_;
-
   // LmkId to Vertex Map
   LmkIdToVertexMap lmk_id_to_vertex_map_;
 
-  // Vertices 3D.
-  // Set of (non-repeated) 3d points.
-  // Format: n rows (one for each point), with each row being a cv::Point3f.
-  cv::Mat vertices_mesh_;
-
-  // Normal for each vertex
-  // Format: n rows (one for each point), with each row being a CV_32FC3.
-  // where n should be the same number as rows for vertices_mesh_.
-  // One normal per vertex.
-  cv::Mat_<VertexNormal> vertices_mesh_normal_;
+  // Per-vertex arrays, indexed by VertexId.
+  // Landmark id of each vertex, -1 for removed vertices.
+  std::vector<LandmarkId> vertex_lmk_ids_;
+  // Vertices 3D, one per landmark.
+  std::vector<VertexPosition> vertices_mesh_;
+  // Normal for each vertex.
+  std::vector<VertexNormal> vertices_mesh_normal_;
   // If the normals have been computed;
   bool normals_computed_ = false;
-
   // Color for each vertex.
-  // Format: n rows (one for each point), with each row being a CV_8UC3.
-  // where n should be the same number as rows for vertices_mesh_.
-  // One color per vertex. (This is how it is done for OpenCV...
-  cv::Mat vertices_mesh_color_;
-
-  // Connectivity of the mesh.
-  // Set of polygons.
-  // Raw integer list of the form: (n,id1_a,id2_a,...,idn_a,
-  // n,id1_b,id2_b,...,idn_b, ..., n, ... idn_x)
-  // where n is the number of points per polygon, and id is a zero-offset
-  // index into the associated row in vertices_mesh_.
-  cv::Mat polygons_mesh_;
+  std::vector<VertexColorRGB> vertices_mesh_color_;
+  // Polygons that use each vertex.
+  std::vector<std::vector<PolygonId>> vertex_polygons_;
+  // Ids of removed vertices, reused by new vertices.
+  std::vector<VertexId> free_vertex_ids_;
+
+  // Connectivity of the mesh: the vertex ids of polygon i are at
+  // [i * polygon_dimension_, (i + 1) * polygon_dimension_).
+  std::vector<VertexId> polygons_mesh_;
 
   // Number of vertices per polygon.
   const size_t polygon_dimension_;
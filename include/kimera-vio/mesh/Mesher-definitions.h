@@ -23,6 +23,8 @@
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/DenseStereo-definitions.h"
+#include "kimera-vio/mesh/GlobalMesh.h"
 #include "kimera-vio/mesh/Mesh.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/utils/Macros.h"
@@ -83,20 +85,27 @@ struct MesherInput : public PipelinePayload {
   // reference to it via the copied pointers.
   MesherInput(const Timestamp& timestamp,
               const FrontendOutput::Ptr& frontend_payload,
-              const BackendOutput::Ptr& backend_payload)
+              const BackendOutput::Ptr& backend_payload,
+              const DenseStereoOutput::Ptr& dense_stereo_payload = nullptr)
       : PipelinePayload(timestamp),
         frontend_output_(frontend_payload),
-        backend_output_(backend_payload) {
+        backend_output_(backend_payload),
+        dense_stereo_output_(dense_stereo_payload) {
     CHECK(frontend_payload);
     CHECK(backend_payload);
     CHECK_EQ(timestamp, frontend_payload->timestamp_);
     CHECK_EQ(timestamp, backend_payload->timestamp_);
+    if (dense_stereo_payload) {
+      CHECK_EQ(timestamp, dense_stereo_payload->timestamp_);
+    }
   }
   virtual ~MesherInput() = default;
 
   // Copy the pointers so that we do not need to copy the data.
   const FrontendOutput::ConstPtr frontend_output_;
   const BackendOutput::ConstPtr backend_output_;
+  //! Optional, only if the dense stereo module is used.
+  const DenseStereoOutput::ConstPtr dense_stereo_output_;
 };
 
 struct MesherOutput : public PipelinePayload {
@@ -153,6 +162,9 @@ struct MesherOutput : public PipelinePayload {
 
   //! Planes from Regular VIO backend
   std::vector<Plane> planes_;
+
+  //! Chunks of the global mesh that changed, only if FLAGS_global_mesh is set.
+  std::vector<MeshChunk> updated_mesh_chunks_;
 };
 
 }  // namespace VIO
@@ -16,6 +16,7 @@
 
 #include <stdlib.h>
 #include <atomic>
+#include <cstdint>
 #include <limits>  // for numeric_limits<>
 #include <utility>  // for move
 #include <vector>
@@ -23,6 +24,8 @@
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/mesh/GlobalMesh.h"
+#include "kimera-vio/mesh/IncrementalDelaunay2D.h"
 #include "kimera-vio/mesh/Mesh.h"
 #include "kimera-vio/mesh/Mesher-definitions.h"
 #include "kimera-vio/utils/Histogram.h"
@@ -58,6 +61,11 @@ class Mesher {
   // that have a corresponding polygon face in 3D.
   // Iterate over the mesh 2D, and use mesh3D getVertex to get the
   // 3D face from the 2D triangle.
+  //
+  // The last nr_dense_keypoints keypoints only live in this keyframe (e.g.
+  // dense stereo points, with new landmark ids at every keyframe): they are
+  // kept out of the incremental 2D triangulation, and only added to a copy of
+  // it.
   void updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
                     const KeypointsCV& keypoints,
                     const std::vector<KeypointStatus>& keypoints_status,
@@ -65,10 +73,13 @@ class Mesher {
                     const LandmarkIds& landmarks,
                     const gtsam::Pose3& left_camera_pose,
                     Mesh2D* mesh_2d = nullptr,
-                    std::vector<cv::Vec6f>* mesh_2d_for_viz = nullptr);
+                    std::vector<cv::Vec6f>* mesh_2d_for_viz = nullptr,
+                    const size_t& nr_dense_keypoints = 0u);
 
   /* ------------------------------------------------------------------------ */
   // Update mesh, but in a thread-safe way.
+  // If the payload has dense stereo points, they are added to the keypoints
+  // of the keyframe to densify the mesh.
   void updateMesh3D(const MesherInput& mesher_payload,
                     Mesh2D* mesh_2d = nullptr,
                     std::vector<cv::Vec6f>* mesh_2d_for_viz = nullptr);
@@ -97,9 +108,45 @@ class Mesher {
       const Frame& frame,
       const std::vector<size_t>& selected_indices);
 
+  // Provide Mesh 3D in read-only mode.
+  // Not the nicest to send a const &, should maybe use shared_ptr
+  inline const Mesh3D& get3DMesh() const { return mesh_3d_; }
+
+  // Provide the 2D triangulation kept across keyframes in read-only mode.
+  inline const IncrementalDelaunay2D& getDelaunay2D() const {
+    return delaunay_2d_;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Calculate normals of each polygon in the mesh.
+  void calculateNormals(std::vector<cv::Point3f>* normals);
+
+  /* ------------------------------------------------------------------------ */
+  // Clusters normals given an axis, a set of normals and a
+  // tolerance. The result is a vector of indices of the given set of normals
+  // that are in the cluster.
+  void clusterNormalsAroundAxis(const cv::Point3f& axis,
+                                const std::vector<cv::Point3f>& normals,
+                                const double& tolerance,
+                                std::vector<int>* triangle_cluster);
+
+  /* ------------------------------------------------------------------------ */
+  // Clusters normals perpendicular to an axis. Given an axis, a set of normals
+  // and a tolerance. The result is a vector of indices of the given set of
+  // normals that are in the cluster.
+  void clusterNormalsPerpendicularToAxis(
+      const cv::Point3f& axis,
+      const std::vector<cv::Point3f>& normals,
+      const double& tolerance,
+      std::vector<int>* cluster_normals_idx);
+
  private:
   // The 3D mesh.
   Mesh3D mesh_3d_;
+  // The 2D triangulation of the keypoints, kept across keyframes.
+  IncrementalDelaunay2D delaunay_2d_;
+  // The mesh of the whole map, only if FLAGS_global_mesh is set.
+  GlobalMesh::UniquePtr global_mesh_;
   // The histogram of z values for vertices of polygons parallel to ground.
   Histogram z_hist_;
   // The 2d histogram of theta angle (latitude) and distance of polygons
@@ -109,10 +156,6 @@ class Mesher {
   const MesherParams mesher_params_;
 
  private:
-  // Provide Mesh 3D in read-only mode.
-  // Not the nicest to send a const &, should maybe use shared_ptr
-  inline const Mesh3D& get3DMesh() const { return mesh_3d_; }
-
   /* ------------------------------------------------------------------------ */
   // Reduce the 3D mesh to the current VIO lmks only.
   void updatePolygonMeshToTimeHorizon(
@@ -122,6 +165,18 @@ class Mesher {
       double max_triangle_side,
       const bool& reduce_mesh_to_time_horizon = true);
 
+  /* ------------------------------------------------------------------------ */
+  // Same as updatePolygonMeshToTimeHorizon, but modifies the mesh in place:
+  // vertices that left the time horizon are removed with their polygons,
+  // positions are updated by vertex id, and only the polygons of updated
+  // vertices are filtered again.
+  void trimPolygonMeshToTimeHorizon(
+      const PointsWithIdMap& points_with_id_map,
+      const gtsam::Pose3& leftCameraPose,
+      double min_ratio_largest_smallest_side,
+      double max_triangle_side,
+      const bool& reduce_mesh_to_time_horizon);
+
   /* ------------------------------------------------------------------------ */
   // For a triangle defined by the 3d points p1, p2, and p3
   // compute ratio between largest side and smallest side (how elongated it is).
@@ -178,10 +233,6 @@ class Mesher {
       double max_triangle_side,
       Mesh2D* mesh_2d = nullptr);
 
-  /* ------------------------------------------------------------------------ */
-  // Calculate normals of each polygon in the mesh.
-  void calculateNormals(std::vector<cv::Point3f>* normals);
-
   /* ------------------------------------------------------------------------ */
   // Calculate normal of a triangle, and return whether it was possible or not.
   // Calculating the normal of aligned points in 3D is not possible...
@@ -202,25 +253,6 @@ class Mesher {
                           const cv::Point3f& normal,
                           const double& tolerance) const;
 
-  /* ------------------------------------------------------------------------ */
-  // Clusters normals given an axis, a set of normals and a
-  // tolerance. The result is a vector of indices of the given set of normals
-  // that are in the cluster.
-  void clusterNormalsAroundAxis(const cv::Point3f& axis,
-                                const std::vector<cv::Point3f>& normals,
-                                const double& tolerance,
-                                std::vector<int>* triangle_cluster);
-
-  /* ------------------------------------------------------------------------ */
-  // Clusters normals perpendicular to an axis. Given an axis, a set of normals
-  // and a tolerance. The result is a vector of indices of the given set of
-  // normals that are in the cluster.
-  void clusterNormalsPerpendicularToAxis(
-      const cv::Point3f& axis,
-      const std::vector<cv::Point3f>& normals,
-      const double& tolerance,
-      std::vector<int>* cluster_normals_idx);
-
   /* ------------------------------------------------------------------------ */
   // Checks whether all points in polygon are closer than tolerance to the
   // plane.
@@ -238,11 +270,15 @@ class Mesher {
 
   /* ------------------------------------------------------------------------ */
   // Try to reject bad triangles, corresponding to outliers.
-  bool isBadTriangle(const Mesh3D::Polygon& polygon,
-                     const gtsam::Pose3& left_camera_pose,
-                     const double& min_ratio_between_largest_an_smallest_side,
-                     const double& min_elongation_ratio,
-                     const double& max_triangle_side) const;
+  // Sets is_good[i] to 1 if polygons[i] passes all the checks of
+  // TriangleFilter::filterBadTriangles, which are run on all triangles at once.
+  void findGoodTriangles(
+      const std::vector<Mesh3D::Polygon>& polygons,
+      const gtsam::Pose3& left_camera_pose,
+      const double& min_ratio_between_largest_an_smallest_side,
+      const double& min_elongation_ratio,
+      const double& max_triangle_side,
+      std::vector<uint8_t>* is_good) const;
 
   /* ------------------------------------------------------------------------ */
   // Segment planes in the mesh:
@@ -279,19 +315,37 @@ class Mesher {
       const PointsWithIdMap& points_with_id_vio) const;
 
   /* ------------------------------------------------------------------------ */
-  // Updates planes lmk ids field with a polygon vertices ids if this polygon
-  // is part of the plane according to given tolerance.
+  // Appends to the planes lmk ids field the vertices ids of the polygons that
+  // are part of the plane according to given tolerance. The polygons are
+  // processed in parallel.
+  // If z_components and walls are given, it also collects the values for the
+  // histograms used to segment new planes (see segmentNewPlanes), for the
+  // polygons aligned with, or perpendicular to, the vertical.
+  void associatePolygonsToPlanes(
+      std::vector<Plane>* planes,
+      double normal_tolerance,
+      double distance_tolerance,
+      const PointsWithIdMap& points_with_id_vio,
+      cv::Mat* z_components = nullptr,
+      cv::Mat* walls = nullptr,
+      double normal_tolerance_horizontal_surface = 0.0,
+      double normal_tolerance_walls = 0.0) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Finds the planes that a polygon is part of according to given tolerance,
+  // and appends the (plane index, polygon id) pairs to plane_polygon_ids.
   // It can either associate a polygon only once to the first plane it matches,
   // or it can associate to multiple planes, depending on the flag passed.
-  bool updatePlanesLmkIdsFromPolygon(
-      std::vector<Plane>* seed_planes,
+  // Returns whether the polygon is on at least one plane.
+  bool associatePolygonToPlanes(
+      const std::vector<Plane>& planes,
       const Mesh3D::Polygon& polygon,
       const size_t& triangle_id,
       const cv::Point3f& triangle_normal,
       double normal_tolerance,
       double distance_tolerance,
-      const PointsWithIdMap& points_with_id_vio,
-      bool only_associate_a_polygon_to_a_single_plane = false) const;
+      bool only_associate_a_polygon_to_a_single_plane,
+      std::vector<std::pair<size_t, size_t>>* plane_polygon_ids) const;
 
   /* --------------------------------------------------------------------------
    */
@@ -360,6 +414,8 @@ class Mesher {
   void getPolygonsMesh(cv::Mat* polygons_mesh) const;
 
   /* ------------------------------------------------------------------------ */
+  // The VIO and stereo 2D meshes are built with createMesh2dImpl, or updated
+  // from the previous keyframe if an incremental triangulation is given.
   static std::vector<cv::Vec6f> createMesh2dImpl(
       const cv::Size& img_size,
       std::vector<cv::Point2f>* keypoints_to_triangulate);
@@ -370,7 +426,8 @@ class Mesher {
       const std::vector<KeypointStatus>& keypoints_status,
       const KeypointsCV& keypoints,
       const cv::Size& img_size,
-      const PointsWithIdMap& pointsWithIdVIO);
+      const PointsWithIdMap& pointsWithIdVIO,
+      IncrementalDelaunay2D* delaunay_2d = nullptr);
 
   static void createMesh2dStereo(
       std::vector<cv::Vec6f>* triangulation_2D,
@@ -380,7 +437,8 @@ class Mesher {
       const std::vector<Vector3>& keypoints_3d,
       const cv::Size& img_size,
       std::vector<std::pair<LandmarkId, gtsam::Point3>>* lmk_with_id_stereo =
-          nullptr);
+          nullptr,
+      IncrementalDelaunay2D* delaunay_2d = nullptr);
 };
 
 }  // namespace VIO
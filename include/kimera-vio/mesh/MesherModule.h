@@ -27,10 +27,15 @@ class MesherModule : public MIMOPipelineModule<MesherInput, MesherOutput> {
   KIMERA_DELETE_COPY_CONSTRUCTORS(MesherModule);
   using MesherFrontendInput = FrontendOutput::Ptr;
   using MesherBackendInput = BackendOutput::Ptr;
+  using MesherDenseStereoInput = DenseStereoOutput::Ptr;
   // TODO(Toni): using this callback generates copies...
   using MesherOutputCallback = std::function<void(const MesherOutput& output)>;
 
-  MesherModule(bool parallel_run, Mesher::UniquePtr mesher);
+  //! If use_dense_stereo, the mesher also waits for the output of the dense
+  //! stereo module for each keyframe.
+  MesherModule(bool parallel_run,
+               Mesher::UniquePtr mesher,
+               bool use_dense_stereo = false);
   virtual ~MesherModule() = default;
 
   //! Callbacks to fill queues: they should be all lighting fast.
@@ -40,6 +45,10 @@ class MesherModule : public MIMOPipelineModule<MesherInput, MesherOutput> {
   inline void fillBackendQueue(const MesherBackendInput& backend_payload) {
     backend_payload_queue_.push(backend_payload);
   }
+  inline void fillDenseStereoQueue(
+      const MesherDenseStereoInput& dense_stereo_payload) {
+    dense_stereo_payload_queue_.push(dense_stereo_payload);
+  }
 
  protected:
   //! Synchronize input queues. Currently doing it in a crude way:
@@ -62,6 +71,8 @@ class MesherModule : public MIMOPipelineModule<MesherInput, MesherOutput> {
   //! Input Queues
   ThreadsafeQueue<MesherFrontendInput> frontend_payload_queue_;
   ThreadsafeQueue<MesherBackendInput> backend_payload_queue_;
+  ThreadsafeQueue<MesherDenseStereoInput> dense_stereo_payload_queue_;
+  const bool use_dense_stereo_;
 
   //! Mesher implementation
   Mesher::UniquePtr mesher_;
@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TriangleFilter.h
+ * @brief  Batched filters to reject bad triangles of the 2D and 3D meshes.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <gtsam/geometry/Pose3.h>
+
+namespace VIO {
+
+// Triangles in structure-of-arrays layout: the coordinates of the i-th
+// vertex of all triangles are stored contiguously, so that the filters below
+// can process several triangles per SIMD instruction.
+class TrianglesSoA {
+ public:
+  TrianglesSoA() = default;
+  ~TrianglesSoA() = default;
+
+  inline size_t size() const { return x_[0].size(); }
+  inline bool empty() const { return x_[0].empty(); }
+
+  void clear();
+  void reserve(const size_t& nr_triangles);
+  void push_back(const cv::Point3f& p1,
+                 const cv::Point3f& p2,
+                 const cv::Point3f& p3);
+
+  // Coordinates of the vertices, indexed by vertex (0, 1 or 2) and triangle.
+  std::array<std::vector<float>, 3> x_;
+  std::array<std::vector<float>, 3> y_;
+  std::array<std::vector<float>, 3> z_;
+};
+
+class TriangleFilter {
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Try to reject bad triangles, corresponding to outliers. Sets keep[i] to 1
+  // if the i-th triangle passes all checks, 0 otherwise:
+  // - the ratio between its smallest and largest sides is at least
+  //   min_ratio_between_largest_an_smallest_side,
+  // - the ratio between its tangential and radial displacement, as seen by
+  //   the left camera, is at least min_elongation_ratio,
+  // - its largest side is at most max_triangle_side.
+  // A check is disabled if its threshold is not positive, in which case the
+  // threshold is compared against zero.
+  static void filterBadTriangles(
+      const TrianglesSoA& triangles,
+      const gtsam::Pose3& left_camera_pose,
+      const double& min_ratio_between_largest_an_smallest_side,
+      const double& min_elongation_ratio,
+      const double& max_triangle_side,
+      std::vector<uint8_t>* keep);
+
+  /* ------------------------------------------------------------------------ */
+  // Sets keep[i] to 1 if the i-th triangle of the 2d triangulation has at
+  // most max_keypoints_with_gradient pixels with higher gradient than
+  // gradient_bound in img_grads (CV_8UC1), 0 otherwise.
+  // Pixels are counted as in UtilsOpenCV::FindHighIntensityInTriangle, but
+  // with one lookup in the integral image of the thresholded gradients per
+  // row of the triangle. If gradient_bound < 0, the check is disabled.
+  static void filterTrianglesWithGradients(
+      const cv::Mat& img_grads,
+      const std::vector<cv::Vec6f>& triangulation_2D,
+      const float& gradient_bound,
+      const size_t& max_keypoints_with_gradient,
+      std::vector<uint8_t>* keep);
+};
+
+}  // namespace VIO
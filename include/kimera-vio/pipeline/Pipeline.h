@@ -26,6 +26,7 @@
 #include "kimera-vio/backend/VioBackEndModule.h"
 #include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
 #include "kimera-vio/dataprovider/DataProviderModule.h"
+#include "kimera-vio/frontend/DenseStereoModule.h"
 #include "kimera-vio/frontend/FeatureSelector.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/frontend/VisionFrontEndModule.h"
@@ -34,6 +35,7 @@
 #include "kimera-vio/mesh/MesherModule.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
+#include "kimera-vio/visualizer/HeadlessVisualizerModule.h"
 #include "kimera-vio/visualizer/Visualizer3DModule.h"
 
 namespace VIO {
@@ -224,6 +226,9 @@ class Pipeline {
   //! Thread-safe queue for the backend.
   VioBackEndModule::InputQueue backend_input_queue_;
 
+  //! Dense stereo, optional.
+  DenseStereoModule::UniquePtr dense_stereo_module_;
+
   //! Mesher
   MesherModule::UniquePtr mesher_module_;
 
@@ -233,6 +238,9 @@ class Pipeline {
   //! Visualizer
   VisualizerModule::UniquePtr visualizer_module_;
 
+  //! Headless visualizer, instead of the visualizer when there is no display.
+  HeadlessVisualizerModule::UniquePtr headless_visualizer_module_;
+
   // Shutdown switch to stop pipeline, threads, and queues.
   std::atomic_bool shutdown_ = {false};
   std::atomic_bool is_initialized_ = {false};
@@ -244,6 +252,7 @@ class Pipeline {
   //! Threads.
   std::unique_ptr<std::thread> frontend_thread_ = {nullptr};
   std::unique_ptr<std::thread> backend_thread_ = {nullptr};
+  std::unique_ptr<std::thread> dense_stereo_thread_ = {nullptr};
   std::unique_ptr<std::thread> mesher_thread_ = {nullptr};
   std::unique_ptr<std::thread> lcd_thread_ = {nullptr};
   std::unique_ptr<std::thread> visualizer_thread_ = {nullptr};
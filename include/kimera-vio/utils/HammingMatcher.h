@@ -0,0 +1,94 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HammingMatcher.h
+ * @brief  Brute-force kNN matching of 256-bit binary descriptors (e.g. ORB).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d.hpp>
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+// Hamming distance between two 256-bit descriptors: four 64-bit POPCNTs
+// (when compiled with -march=native). For a single pair of descriptors this
+// is faster than AVX2 byte-lookup popcounts, which need a horizontal sum.
+inline int hammingDistance256(const uint8_t* a, const uint8_t* b) {
+  uint64_t a_words[4], b_words[4];
+  std::memcpy(a_words, a, sizeof(a_words));
+  std::memcpy(b_words, b, sizeof(b_words));
+  return __builtin_popcountll(a_words[0] ^ b_words[0]) +
+         __builtin_popcountll(a_words[1] ^ b_words[1]) +
+         __builtin_popcountll(a_words[2] ^ b_words[2]) +
+         __builtin_popcountll(a_words[3] ^ b_words[3]);
+}
+
+/* ------------------------------------------------------------------------ */
+// Same results as cv::BFMatcher(cv::NORM_HAMMING), specialized for 256-bit
+// descriptors. Train descriptors are scanned in tiles that fit in L1 cache,
+// for tiles of query descriptors.
+class HammingMatcher {
+ public:
+  static constexpr int kDescriptorBytes = 32;
+
+  /** @brief Checks that the descriptors are continuous rows of 256 bits.
+   */
+  static bool isSupported(const cv::Mat& descriptors);
+
+  /** @brief Same as cv::DescriptorMatcher::knnMatch with k = 2.
+   * @param[in] query Query descriptors, one per row.
+   * @param[in] train Train descriptors, one per row.
+   * @param[out] matches The two best matches in train of each query
+   *  descriptor, best first. If train has fewer than two descriptors, the
+   *  missing matches have trainIdx -1 and an infinite distance.
+   */
+  static void knnMatch(const cv::Mat& query,
+                       const cv::Mat& train,
+                       std::vector<std::vector<cv::DMatch>>* matches);
+
+  /** @brief Matches that pass Lowe's ratio test, without building the kNN
+   *  matches of the rejected query descriptors.
+   * @param[in] query Query descriptors, one per row.
+   * @param[in] train Train descriptors, one per row.
+   * @param[in] lowe_ratio The best match is kept if its distance is lower
+   *  than lowe_ratio times the distance of the second best.
+   * @param[out] matches The best match of each query descriptor that passes.
+   */
+  static void ratioMatch(const cv::Mat& query,
+                         const cv::Mat& train,
+                         double lowe_ratio,
+                         std::vector<cv::DMatch>* matches);
+
+ private:
+  // Tiles of 256 train descriptors (8 KB) and 64 query descriptors (2 KB).
+  static constexpr int kTrainTile = 256;
+  static constexpr int kQueryTile = 64;
+
+  struct BestTwo {
+    int distance_1 = std::numeric_limits<int>::max();
+    int distance_2 = std::numeric_limits<int>::max();
+    int index_1 = -1;
+    int index_2 = -1;
+  };
+
+  static void findBestTwo(const cv::Mat& query,
+                          const cv::Mat& train,
+                          std::vector<BestTwo>* best);
+};
+
+}  // namespace VIO
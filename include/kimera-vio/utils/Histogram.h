@@ -126,9 +126,14 @@ public:
   };
 
   /* ------------------------------------------------------------------------ */
-  // Calculates histogram.
+  // Calculates histogram. Large inputs without mask are split in blocks of
+  // rows, whose histograms are calculated in parallel and then added.
   void calculateHistogram(const cv::Mat& input, bool log_histogram = false);
 
+  /* ------------------------------------------------------------------------ */
+  // Histogram computed by the last call to calculateHistogram.
+  inline const cv::Mat& getHistogram() const { return histogram_; }
+
   /* ------------------------------------------------------------------------ */
   // If you play with the peak_per attribute value, you can increase/decrease the
   // number of peaks found.
@@ -0,0 +1,38 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MemoryUsage.h
+ * @brief  Query the resident set size (RSS) of the current process.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace VIO {
+namespace utils {
+
+class MemoryUsage {
+ public:
+  // Peak resident set size of the process since it started, in bytes.
+  // Returns 0 if it could not be queried.
+  static size_t GetPeakRssBytes();
+
+  // Current resident set size of the process, in bytes.
+  // Returns 0 if it could not be queried (only available on Linux).
+  static size_t GetCurrentRssBytes();
+
+  static inline double BytesToMegaBytes(const size_t& bytes) {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+  }
+};
+
+}  // namespace utils
+}  // namespace VIO
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <chrono>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <string>
@@ -122,6 +123,48 @@ private:
   std::chrono::time_point<std::chrono::system_clock> time_last_called_;
 };
 
+// Summary of a batch of samples (count, sum, sum of squares, min, max).
+// Used by the thread-local collectors (see ThreadLocalStatistics.h) which
+// aggregate samples locally and only push these summaries to Statistics.
+struct StatsAggregate {
+  inline StatsAggregate() { Reset(); }
+
+  inline void Add(double sample) {
+    ++count_;
+    sum_ += sample;
+    sum_sq_ += sample * sample;
+    if (sample < min_) min_ = sample;
+    if (sample > max_) max_ = sample;
+  }
+  inline void Merge(const StatsAggregate& other) {
+    count_ += other.count_;
+    sum_ += other.sum_;
+    sum_sq_ += other.sum_sq_;
+    if (other.min_ < min_) min_ = other.min_;
+    if (other.max_ > max_) max_ = other.max_;
+  }
+  inline void Reset() {
+    count_ = 0u;
+    sum_ = 0.0;
+    sum_sq_ = 0.0;
+    min_ = std::numeric_limits<double>::max();
+    max_ = std::numeric_limits<double>::lowest();
+  }
+  inline double Mean() const { return count_ > 0u ? sum_ / count_ : 0.0; }
+  inline double Variance() const {
+    if (count_ == 0u) return 0.0;
+    const double mean = Mean();
+    const double variance = sum_sq_ / count_ - mean * mean;
+    return variance > 0.0 ? variance : 0.0;
+  }
+
+  size_t count_;
+  double sum_;
+  double sum_sq_;
+  double min_;
+  double max_;
+};
+
 // A class that has the statistics interface but does nothing. Swapping this in
 // in place of the Statistics class (say with a typedef) eliminates the function
 // calls.
@@ -192,6 +235,15 @@ class Statistics {
   static double GetVarianceDeltaTime(std::string const& tag);
   static double GetVarianceDeltaTime(size_t handle);
 
+  // Aggregated samples pushed by the thread-local collectors.
+  static void MergeAggregate(size_t handle, const StatsAggregate& aggregate);
+  static StatsAggregate GetAggregate(size_t handle);
+  static StatsAggregate GetAggregate(std::string const& tag);
+  // Summary of all the values of a tag: its samples and its aggregates. The
+  // variance of the samples is only known for the last kWindowSize ones.
+  static StatsAggregate GetMergedAggregate(size_t handle);
+  static StatsAggregate GetMergedAggregate(std::string const& tag);
+
   // Writes a csv file, but transposed, each row first element represents the
   // columns headers, and the subsequent values are the data.
   static void WriteAllSamplesToCsvFile(const std::string &path);
@@ -211,15 +263,19 @@ class Statistics {
   ~Statistics();
 
   typedef std::vector<utils::StatisticsMapValue> list_t;
+  typedef std::vector<utils::StatsAggregate> aggregate_list_t;
 
   list_t stats_collectors_;
+  aggregate_list_t aggregates_;
   map_t tag_map_;
   size_t max_tag_length_;
   std::mutex mutex_;
 };
 
-// TODO make this a gflag?
+// Set from CMake (option ENABLE_STATISTICS), defaults to on.
+#ifndef ENABLE_STATISTICS
 #define ENABLE_STATISTICS 1
+#endif
 #if ENABLE_STATISTICS
 typedef StatsCollectorImpl StatsCollector;
 #else
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadLocalStatistics.h
+ * @brief  Low-overhead statistics for tight loops: handles are resolved once,
+ * samples are aggregated per thread and periodically flushed to Statistics.
+ * Compiled away entirely when ENABLE_STATISTICS is 0.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+///
+// Example usage:
+//
+// for (const auto& keypoint : keypoints) {
+//   KIMERA_STATS_SCOPED_TIMER_US("Stereo matching per keypoint [us]");
+//   ...
+//   KIMERA_STATS_INCREMENT("Stereo matching valid matches");
+// }
+//
+// Contrary to utils::StatsCollector, the tag is looked up only once (the
+// first time the macro is hit), and a sample costs a few additions on a
+// thread-local buffer. The buffer is pushed to utils::Statistics every
+// kFlushEveryNSamples samples if more than kFlushPeriodMs elapsed since the
+// last flush, and when the thread exits.
+
+namespace VIO {
+
+namespace utils {
+
+class ThreadLocalStatistics {
+ public:
+  // Check the flush period only every that many samples, to avoid querying
+  // the clock for each sample.
+  static constexpr size_t kFlushEveryNSamples = 256u;
+  static constexpr int kFlushPeriodMs = 1000;
+
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadLocalStatistics);
+
+  // Per-thread instance.
+  static ThreadLocalStatistics& Instance();
+
+  inline void AddSample(size_t handle, double sample) {
+    if (handle >= aggregates_.size()) {
+      aggregates_.resize(handle + 1u);
+    }
+    aggregates_[handle].Add(sample);
+    if (++samples_since_check_ >= kFlushEveryNSamples) {
+      samples_since_check_ = 0u;
+      flushIfPeriodElapsed();
+    }
+  }
+
+  // Push all aggregated samples of the calling thread to Statistics.
+  void flush();
+
+ private:
+  ThreadLocalStatistics();
+  ~ThreadLocalStatistics();
+
+  void flushIfPeriodElapsed();
+
+ private:
+  std::vector<StatsAggregate> aggregates_;
+  size_t samples_since_check_;
+  std::chrono::steady_clock::time_point last_flush_;
+};
+
+// Statistics handle resolved at construction. Declare it as a (function-local
+// or namespace-scope) static to resolve the tag at static-init time.
+class StatsHandle {
+ public:
+  explicit StatsHandle(const std::string& tag)
+      : handle_(Statistics::GetHandle(tag)) {}
+
+  inline void AddSample(double sample) const {
+    ThreadLocalStatistics::Instance().AddSample(handle_, sample);
+  }
+  inline size_t GetHandle() const { return handle_; }
+
+ private:
+  const size_t handle_;
+};
+
+// Adds the elapsed time since construction as a sample when going out of
+// scope. Template on the duration to report.
+template <typename T = std::chrono::microseconds>
+class ScopedStatsTimer {
+ public:
+  explicit ScopedStatsTimer(const StatsHandle& handle)
+      : handle_(handle), tic_(std::chrono::steady_clock::now()) {}
+  ~ScopedStatsTimer() {
+    handle_.AddSample(static_cast<double>(
+        std::chrono::duration_cast<T>(std::chrono::steady_clock::now() - tic_)
+            .count()));
+  }
+
+ private:
+  const StatsHandle& handle_;
+  const std::chrono::steady_clock::time_point tic_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
+
+#define KIMERA_STATS_CONCAT_IMPL(a, b) a##b
+#define KIMERA_STATS_CONCAT(a, b) KIMERA_STATS_CONCAT_IMPL(a, b)
+
+#if ENABLE_STATISTICS
+// Defines a statistics handle at namespace scope (resolved at static-init).
+#define KIMERA_DEFINE_STATS_HANDLE(name, tag) \
+  static const VIO::utils::StatsHandle name(tag)
+#define KIMERA_STATS_SAMPLE(tag, sample)                                  \
+  do {                                                                    \
+    static const VIO::utils::StatsHandle kimera_stats_handle_local(tag); \
+    kimera_stats_handle_local.AddSample(sample);                          \
+  } while (0)
+#define KIMERA_STATS_INCREMENT(tag) KIMERA_STATS_SAMPLE(tag, 1.0)
+#define KIMERA_STATS_SCOPED_TIMER_US(tag)                            \
+  static const VIO::utils::StatsHandle KIMERA_STATS_CONCAT(          \
+      kimera_stats_timer_handle_, __LINE__)(tag);                    \
+  const VIO::utils::ScopedStatsTimer<std::chrono::microseconds>      \
+      KIMERA_STATS_CONCAT(kimera_stats_timer_, __LINE__)(            \
+          KIMERA_STATS_CONCAT(kimera_stats_timer_handle_, __LINE__))
+#define KIMERA_STATS_FLUSH() VIO::utils::ThreadLocalStatistics::Instance().flush()
+#else
+#define KIMERA_DEFINE_STATS_HANDLE(name, tag) \
+  static const VIO::utils::DummyStatsCollector name(tag)
+#define KIMERA_STATS_SAMPLE(tag, sample) \
+  do {                                   \
+  } while (0)
+#define KIMERA_STATS_INCREMENT(tag) \
+  do {                              \
+  } while (0)
+#define KIMERA_STATS_SCOPED_TIMER_US(tag) \
+  do {                                    \
+  } while (0)
+#define KIMERA_STATS_FLUSH() \
+  do {                       \
+  } while (0)
+#endif
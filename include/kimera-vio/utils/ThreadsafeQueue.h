@@ -107,6 +107,14 @@ class ThreadsafeQueueBase {
     return data_queue_.empty();
   }
 
+  /** \brief Number of elements in the queue.
+   * the state of the queue might change right after this query.
+   */
+  size_t size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return data_queue_.size();
+  }
+
  public:
   std::string queue_id_;
 
@@ -0,0 +1,94 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HeadlessVisualizer-definitions.h
+ * @brief  Definitions for the headless visualizer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/logging/MeshStreamWriter.h"
+#include "kimera-vio/mesh/Mesher-definitions.h"
+#include "kimera-vio/pipeline/PipelinePayload.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct HeadlessVisualizerParams {
+ public:
+  KIMERA_POINTER_TYPEDEFS(HeadlessVisualizerParams);
+  HeadlessVisualizerParams() = default;
+  ~HeadlessVisualizerParams() = default;
+
+ public:
+  //! Maximum rate of the payloads [Hz], unlimited if not positive. The
+  //! payloads in between are not even built.
+  double display_rate_hz_ = 10.0;
+  //! Where to send the payloads, see VisualizationStream. Empty to only
+  //! send them to the registered callbacks.
+  std::string output_ = "";
+};
+
+struct HeadlessVisualizerInput : public PipelinePayload {
+ public:
+  KIMERA_POINTER_TYPEDEFS(HeadlessVisualizerInput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(HeadlessVisualizerInput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  HeadlessVisualizerInput(const Timestamp& timestamp,
+                          const MesherOutput::Ptr& mesher_output,
+                          const BackendOutput::Ptr& backend_output)
+      : PipelinePayload(timestamp),
+        mesher_output_(mesher_output),
+        backend_output_(backend_output) {
+    CHECK(mesher_output);
+    CHECK(backend_output);
+    CHECK_EQ(timestamp, mesher_output->timestamp_);
+    CHECK_EQ(timestamp, backend_output->timestamp_);
+  }
+  virtual ~HeadlessVisualizerInput() = default;
+
+  // Copy the pointers so that we do not need to copy the data.
+  const MesherOutput::ConstPtr mesher_output_;
+  const BackendOutput::ConstPtr backend_output_;
+};
+
+// What a remote display needs to draw the state of the pipeline, in flat
+// arrays that are serialized as they are, see VisualizationStream.
+struct VisualizationPayload : public PipelinePayload {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VisualizationPayload);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VisualizationPayload);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  explicit VisualizationPayload(const Timestamp& timestamp)
+      : PipelinePayload(timestamp) {}
+  virtual ~VisualizationPayload() = default;
+
+ public:
+  //! Pose of the last keyframe in the world frame: x, y, z, qw, qx, qy, qz.
+  std::array<double, 7> W_Pose_Blkf_ = {{0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0}};
+  //! Landmarks in the world frame, with their x, y, z in landmarks_ and
+  //! their LandmarkType in landmark_types_.
+  std::vector<LandmarkId> landmark_ids_;
+  std::vector<float> landmarks_;
+  std::vector<uint8_t> landmark_types_;
+  //! 3D mesh in the world frame.
+  MeshStreamBuffer mesh_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,53 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HeadlessVisualizer.h
+ * @brief  Visualizer without display, that streams what to draw.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/HeadlessVisualizer-definitions.h"
+#include "kimera-vio/visualizer/VisualizationStream.h"
+
+namespace VIO {
+
+// Replaces Visualizer3D when there is no display: instead of drawing with
+// cv::viz, which has to run on the main thread, it builds a lightweight
+// payload with the pose, the landmarks and the mesh, and sends it to a
+// VisualizationStream, at most at the display rate.
+class HeadlessVisualizer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(HeadlessVisualizer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(HeadlessVisualizer);
+
+  explicit HeadlessVisualizer(const HeadlessVisualizerParams& params);
+  virtual ~HeadlessVisualizer() = default;
+
+  // Returns nullptr if the last payload was built less than a display
+  // period ago.
+  VisualizationPayload::UniquePtr spinOnce(
+      const HeadlessVisualizerInput& input);
+
+  static VisualizationPayload::UniquePtr buildPayload(
+      const HeadlessVisualizerInput& input);
+
+ private:
+  const HeadlessVisualizerParams params_;
+  const std::chrono::steady_clock::duration display_period_;
+  std::chrono::steady_clock::time_point last_payload_time_;
+  //! Only if params_.output_ is set.
+  VisualizationStream::UniquePtr stream_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HeadlessVisualizerModule.h
+ * @brief  Pipeline module for the headless visualizer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/mesh/Mesher-definitions.h"
+#include "kimera-vio/pipeline/PipelineModule.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/HeadlessVisualizer-definitions.h"
+#include "kimera-vio/visualizer/HeadlessVisualizer.h"
+
+namespace VIO {
+
+// Unlike the VisualizerModule, it does not need the main thread, so it spins
+// in its own thread in parallel mode.
+class HeadlessVisualizerModule
+    : public MIMOPipelineModule<HeadlessVisualizerInput,
+                                VisualizationPayload> {
+ public:
+  KIMERA_POINTER_TYPEDEFS(HeadlessVisualizerModule);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(HeadlessVisualizerModule);
+  using VizBackendInput = BackendOutput::Ptr;
+  using VizMesherInput = MesherOutput::Ptr;
+
+  HeadlessVisualizerModule(bool parallel_run,
+                           HeadlessVisualizer::UniquePtr visualizer);
+  virtual ~HeadlessVisualizerModule() = default;
+
+  //! Callbacks to fill queues: they should be all lighting fast.
+  inline void fillBackendQueue(const VizBackendInput& backend_payload) {
+    backend_queue_.push(backend_payload);
+  }
+  inline void fillMesherQueue(const VizMesherInput& mesher_payload) {
+    mesher_queue_.push(mesher_payload);
+  }
+
+ protected:
+  //! The mesher runs after the backend: pop blocking the mesher payload, and
+  //! sync the backend queue with it.
+  virtual InputUniquePtr getInputPacket() override;
+
+  virtual OutputUniquePtr spinOnce(
+      HeadlessVisualizerInput::UniquePtr input) override;
+
+  //! Called when general shutdown of PipelineModule is triggered.
+  virtual void shutdownQueues() override;
+
+  //! Checks if the module has work to do (should check input queues are empty)
+  virtual bool hasWork() const override;
+
+ private:
+  //! Input Queues
+  ThreadsafeQueue<VizBackendInput> backend_queue_;
+  ThreadsafeQueue<VizMesherInput> mesher_queue_;
+
+  //! Visualizer implementation
+  HeadlessVisualizer::UniquePtr visualizer_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,80 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VisualizationStream.h
+ * @brief  Sends visualization payloads to a file or a local socket.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/HeadlessVisualizer-definitions.h"
+
+namespace VIO {
+
+// Sends visualization payloads to a file, or to a consumer on the same
+// machine listening on a unix socket, without ever blocking the caller.
+// The stream starts with the magic "KVZ1", followed by one record per
+// payload: its length (uint32), then its fields in the order of
+// VisualizationPayload, arrays preceded by their number of elements (uint32),
+// all little endian.
+// If the consumer does not read fast enough, or is not listening, payloads
+// are dropped; the connection is retried at the next payload.
+class VisualizationStream {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VisualizationStream);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VisualizationStream);
+
+  // output: path of a file, or "unix:" followed by the path of the socket.
+  explicit VisualizationStream(const std::string& output);
+  ~VisualizationStream();
+
+  // Returns false if the payload was dropped.
+  bool send(const VisualizationPayload& payload);
+
+  inline size_t getNumberOfDroppedPayloads() const { return nr_dropped_; }
+
+ public:
+  static void serialize(const VisualizationPayload& payload,
+                        std::vector<char>* record);
+  // Returns nullptr if the record is corrupted.
+  static VisualizationPayload::UniquePtr deserialize(
+      const std::vector<char>& record);
+  // Reads the payloads of a stream, e.g. an std::ifstream on a file written
+  // by a VisualizationStream.
+  static bool readPayloads(
+      std::istream* stream,
+      std::vector<VisualizationPayload::UniquePtr>* payloads);
+
+ private:
+  bool connectSocket();
+  // Sends as much of send_buffer_ as the socket takes without blocking.
+  // Returns false if the connection was lost.
+  bool flushSocket();
+  void closeSocket();
+
+ private:
+  const std::string output_;
+  const bool is_socket_;
+  std::ofstream file_;
+  int socket_fd_;
+  std::vector<char> record_;
+  //! Bytes not yet taken by the socket: at most one record.
+  std::vector<char> send_buffer_;
+  size_t send_offset_;
+  size_t nr_dropped_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,240 @@
+#!/usr/bin/env python
+"""
+Summarizes end-to-end runs of the pipeline (see run_pipeline_benchmark.bash)
+and compares them against a stored baseline.
+
+For each run (one output folder per mode, e.g. sequential/ and parallel/) we
+report, from the files written with --log_output=1:
+    - overall time, frames processed and frames per second,
+    - peak resident memory (RSS),
+    - mean time per module (all statistics in [ms]),
+    - absolute trajectory error (ATE) of output_posesVIO.csv against the
+      ground truth, after SE(3) alignment.
+
+Returns a non-zero exit code if any metric regressed by more than the given
+tolerance with respect to the baseline, so that it can be used in CI.
+"""
+
+from __future__ import print_function
+
+import argparse
+import csv
+import os
+import sys
+
+import numpy as np
+import yaml
+
+# Module timing statistic whose number of samples is the number of frames.
+FRONTEND_TIMING_TAG = 'VioFrontEnd [ms]'
+OVERALL_TIMING_TAG = 'Pipeline Overall Timing [ms]'
+PEAK_RSS_TAG = 'Pipeline Peak RSS [MB]'
+# Max time difference between an estimate and its ground truth [ns].
+MAX_TIME_DIFF_NS = 5e6
+
+
+def read_statistics(statistics_path):
+    with open(statistics_path, 'r') as input_file:
+        return yaml.safe_load(input_file) or dict()
+
+
+def read_trajectory(csv_path):
+    """ Reads timestamps [ns] and positions from a csv with a header, whose
+    first four columns are timestamp, x, y, z (Kimera and EuRoC format). """
+    stamps = []
+    positions = []
+    with open(csv_path, 'r') as input_file:
+        reader = csv.reader(input_file)
+        next(reader)
+        for row in reader:
+            if len(row) < 4:
+                continue
+            stamps.append(int(row[0]))
+            positions.append([float(x) for x in row[1:4]])
+    return np.array(stamps, dtype=np.int64), np.array(positions)
+
+
+def associate(est_stamps, gt_stamps):
+    """ Returns pairs of indices (est, gt) with the closest gt timestamp. """
+    idx = np.searchsorted(gt_stamps, est_stamps)
+    idx = np.clip(idx, 1, len(gt_stamps) - 1)
+    left = gt_stamps[idx - 1]
+    right = gt_stamps[idx]
+    idx -= est_stamps - left < right - est_stamps
+    valid = np.abs(gt_stamps[idx] - est_stamps) < MAX_TIME_DIFF_NS
+    return np.nonzero(valid)[0], idx[valid]
+
+
+def align_se3(est, gt):
+    """ Rotation and translation minimizing ||gt - (R * est + t)|| (Umeyama
+    without scale). Points are rows. """
+    est_mean = est.mean(axis=0)
+    gt_mean = gt.mean(axis=0)
+    cov = (gt - gt_mean).T.dot(est - est_mean)
+    U, _, Vt = np.linalg.svd(cov)
+    S = np.eye(3)
+    if np.linalg.det(U) * np.linalg.det(Vt) < 0:
+        S[2, 2] = -1
+    R = U.dot(S).dot(Vt)
+    t = gt_mean - R.dot(est_mean)
+    return R, t
+
+
+def compute_ate(est_path, gt_path):
+    est_stamps, est_positions = read_trajectory(est_path)
+    gt_stamps, gt_positions = read_trajectory(gt_path)
+    if len(est_stamps) < 3 or len(gt_stamps) < 2:
+        return None
+    est_idx, gt_idx = associate(est_stamps, gt_stamps)
+    if len(est_idx) < 3:
+        print('Not enough poses associated with ground truth in: %s' % est_path)
+        return None
+    est = est_positions[est_idx]
+    gt = gt_positions[gt_idx]
+    R, t = align_se3(est, gt)
+    errors = np.linalg.norm(gt - (est.dot(R.T) + t), axis=1)
+    return {'ate_rmse [m]': float(np.sqrt(np.mean(errors ** 2))),
+            'ate_max [m]': float(np.max(errors))}
+
+
+def summarize_run(run_path, gt_path):
+    summary = dict()
+    statistics_path = os.path.join(run_path, 'StatisticsVIO.yaml')
+    if not os.path.exists(statistics_path):
+        print('Missing statistics file: %s' % statistics_path)
+        return summary
+    statistics = read_statistics(statistics_path)
+
+    if OVERALL_TIMING_TAG in statistics:
+        overall_ms = statistics[OVERALL_TIMING_TAG]['mean']
+        summary['overall_time [ms]'] = overall_ms
+        if FRONTEND_TIMING_TAG in statistics and overall_ms > 0:
+            nr_frames = statistics[FRONTEND_TIMING_TAG]['samples']
+            summary['frames'] = nr_frames
+            summary['fps'] = 1000.0 * nr_frames / overall_ms
+    if PEAK_RSS_TAG in statistics:
+        summary['peak_rss [MB]'] = statistics[PEAK_RSS_TAG]['max']
+
+    modules = dict()
+    for tag, values in statistics.items():
+        if tag in (OVERALL_TIMING_TAG,) or not str(tag).endswith('[ms]'):
+            continue
+        modules[str(tag)] = values['mean']
+    summary['module_mean_time [ms]'] = modules
+
+    est_path = os.path.join(run_path, 'output_posesVIO.csv')
+    if gt_path and os.path.exists(est_path):
+        ate = compute_ate(est_path, gt_path)
+        if ate:
+            summary.update(ate)
+    return summary
+
+
+# Metric name -> whether higher is better.
+HIGHER_IS_BETTER = {'fps': True}
+
+
+def compare(results, baseline, time_tolerance, memory_tolerance,
+            accuracy_tolerance):
+    """ Prints the relative change of each metric and returns the list of
+    regressions. """
+    regressions = []
+
+    def check(mode, name, new, old, tolerance):
+        if old is None or new is None or old == 0:
+            return
+        change = (new - old) / abs(old)
+        regressed = -change > tolerance if HIGHER_IS_BETTER.get(name, False) \
+            else change > tolerance
+        print('  %-45s %12.4f -> %12.4f (%+6.1f%%)%s' %
+              (name, old, new, 100.0 * change,
+               '  <-- REGRESSION' if regressed else ''))
+        if regressed:
+            regressions.append('%s: %s' % (mode, name))
+
+    for mode, summary in sorted(results.items()):
+        if mode not in baseline:
+            print('No baseline for mode: %s' % mode)
+            continue
+        base = baseline[mode]
+        print('%s:' % mode)
+        check(mode, 'overall_time [ms]', summary.get('overall_time [ms]'),
+              base.get('overall_time [ms]'), time_tolerance)
+        check(mode, 'fps', summary.get('fps'), base.get('fps'),
+              time_tolerance)
+        check(mode, 'peak_rss [MB]', summary.get('peak_rss [MB]'),
+              base.get('peak_rss [MB]'), memory_tolerance)
+        check(mode, 'ate_rmse [m]', summary.get('ate_rmse [m]'),
+              base.get('ate_rmse [m]'), accuracy_tolerance)
+        new_modules = summary.get('module_mean_time [ms]', dict())
+        old_modules = base.get('module_mean_time [ms]', dict())
+        for tag in sorted(new_modules):
+            check(mode, tag, new_modules[tag], old_modules.get(tag),
+                  time_tolerance)
+    return regressions
+
+
+def parser():
+    main_parser = argparse.ArgumentParser(
+        description='Summarize pipeline runs and compare with a baseline.')
+    main_parser.add_argument(
+        'results_path',
+        help='Folder with one output folder per run mode '
+        '(e.g. sequential/ and parallel/).')
+    main_parser.add_argument('--gt', default='',
+                             help='Ground-truth csv (EuRoC format).')
+    main_parser.add_argument('--baseline', default='',
+                             help='Baseline yaml to compare against.')
+    main_parser.add_argument('--save_baseline', action='store_true',
+                             help='Store the results as the new baseline.')
+    main_parser.add_argument('--time_tolerance', type=float, default=0.10,
+                             help='Max relative increase in time.')
+    main_parser.add_argument('--memory_tolerance', type=float, default=0.10,
+                             help='Max relative increase in peak RSS.')
+    main_parser.add_argument('--accuracy_tolerance', type=float, default=0.05,
+                             help='Max relative increase in ATE.')
+    return main_parser
+
+
+def main():
+    args = parser().parse_args()
+    results = dict()
+    for mode in sorted(os.listdir(args.results_path)):
+        run_path = os.path.join(args.results_path, mode)
+        if os.path.isdir(run_path):
+            summary = summarize_run(run_path, args.gt)
+            if summary:
+                results[mode] = summary
+    if not results:
+        print('No runs found in: %s' % args.results_path)
+        return 1
+
+    results_file = os.path.join(args.results_path, 'pipeline_benchmark.yaml')
+    with open(results_file, 'w') as output_file:
+        yaml.safe_dump(results, output_file, default_flow_style=False)
+    print('Wrote results to: %s' % results_file)
+
+    if not args.baseline:
+        return 0
+    if args.save_baseline:
+        with open(args.baseline, 'w') as output_file:
+            yaml.safe_dump(results, output_file, default_flow_style=False)
+        print('Saved new baseline to: %s' % args.baseline)
+        return 0
+    if not os.path.exists(args.baseline):
+        print('Missing baseline: %s, use --save_baseline to create it.' %
+              args.baseline)
+        return 1
+    with open(args.baseline, 'r') as input_file:
+        baseline = yaml.safe_load(input_file) or dict()
+    regressions = compare(results, baseline, args.time_tolerance,
+                          args.memory_tolerance, args.accuracy_tolerance)
+    if regressions:
+        print('Regressions found:\n  ' + '\n  '.join(regressions))
+        return 1
+    print('No regressions found.')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,49 @@
+#!/bin/bash
+###################################################################
+# Runs the micro-benchmarks and writes the results as json.
+# Build first with: cmake -DBUILD_BENCHMARKS=ON .. && make benchmarkKimeraVIO
+
+# Build path: specify where the benchmark executable is.
+BUILD_PATH="../build"
+
+# Test data path: fixed inputs for the benchmarks.
+TEST_DATA_PATH="../tests/data"
+
+# Output path: where the json results will be written.
+OUTPUT_PATH="../output_logs"
+
+# Regex to select benchmarks, empty to run all of them.
+BENCHMARK_FILTER=""
+###################################################################
+
+# Parse Options.
+while [ -n "$1" ]; do
+    case "$1" in
+    -b) BUILD_PATH=$2
+        shift ;;
+    -o) OUTPUT_PATH=$2
+        shift ;;
+    -f) BENCHMARK_FILTER=$2
+        shift ;;
+    *) echo "Option $1 not recognized" ;;
+    esac
+    shift
+done
+
+# Change directory to parent path, in order to make this script
+# independent of where we call it from.
+parent_path=$( cd "$(dirname "${BASH_SOURCE[0]}")" ; pwd -P )
+cd "$parent_path"
+
+mkdir -p $OUTPUT_PATH
+OUTPUT_FILE="$OUTPUT_PATH/benchmarks_$(date +%Y%m%d_%H%M%S).json"
+
+$BUILD_PATH/benchmarkKimeraVIO \
+  --test_data_path="$TEST_DATA_PATH" \
+  --benchmark_filter="$BENCHMARK_FILTER" \
+  --benchmark_out="$OUTPUT_FILE" \
+  --benchmark_out_format=json \
+  --logtostderr=1 \
+  --v=0
+
+echo "Benchmark results written to: $OUTPUT_FILE"
@@ -0,0 +1,118 @@
+#!/bin/bash
+###################################################################
+# Runs the whole pipeline on a EuRoC dataset in sequential and in parallel
+# mode, and reports per-module time, peak memory, frames per second and
+# trajectory error for each run (see evaluation/pipeline_benchmark_report.py).
+# If a baseline is given, the results are compared against it and the script
+# returns a non-zero exit code if there is any regression.
+#
+# Example:
+#   ./run_pipeline_benchmark.bash -p /path/to/V1_01_easy -baseline V1_01.yaml
+# To store the current results as the new baseline, add -save-baseline.
+
+# Specify path of the EuRoC dataset.
+DATASET_PATH="/path/to/euroc/dataset"
+
+# Baseline yaml to compare against, empty to not compare.
+BASELINE_PATH=""
+
+# Specify: 1 to overwrite the baseline with the results of this run.
+SAVE_BASELINE=0
+
+# Specify: 1 to enable the LoopClosureDetector, 0 to not.
+USE_LCD=0
+
+# Frames of the dataset to run on.
+INITIAL_K=50
+FINAL_K=2000
+###################################################################
+
+###################################################################
+# Other PATHS
+# All paths can be absolute or relative to this file location.
+
+# Build path: specify where the executable for Kimera is.
+BUILD_PATH="../build"
+
+# Params path: specify where the parameters for Kimera are.
+PARAMS_PATH="../params"
+
+# Vocabulary path: specify where the vocabulary for loop closure is.
+VOCABULARY_PATH="../vocabulary"
+
+# Output path: one folder per run mode will be created inside.
+OUTPUT_PATH="../output_logs/pipeline_benchmark"
+###################################################################
+
+# Parse Options.
+while [ -n "$1" ]; do
+    case "$1" in
+    -p) DATASET_PATH=$2
+        shift ;;
+    -b) BUILD_PATH=$2
+        shift ;;
+    -o) OUTPUT_PATH=$2
+        shift ;;
+    -baseline) BASELINE_PATH=$2
+        shift ;;
+    -save-baseline) SAVE_BASELINE=1 ;;
+    -lcd) USE_LCD=1 ;;
+    *) echo "Option $1 not recognized" ;;
+    esac
+    shift
+done
+
+# Change directory to parent path, in order to make this script
+# independent of where we call it from.
+parent_path=$( cd "$(dirname "${BASH_SOURCE[0]}")" ; pwd -P )
+cd "$parent_path"
+
+for MODE in sequential parallel; do
+  PARALLEL_RUN=0
+  if [ $MODE == "parallel" ]; then
+    PARALLEL_RUN=1
+  fi
+  RUN_OUTPUT_PATH="$OUTPUT_PATH/$MODE"
+  mkdir -p $RUN_OUTPUT_PATH
+  echo "Running pipeline in $MODE mode, output in: $RUN_OUTPUT_PATH"
+
+  # Visualization is disabled, so that it does not count towards the timing.
+  $BUILD_PATH/stereoVIOEuroc \
+    --dataset_type=0 \
+    --dataset_path="$DATASET_PATH" \
+    --initial_k="$INITIAL_K" \
+    --final_k="$FINAL_K" \
+    --backend_type=0 \
+    --left_cam_params_path="$PARAMS_PATH/LeftCameraParams.yaml" \
+    --right_cam_params_path="$PARAMS_PATH/RightCameraParams.yaml" \
+    --imu_params_path="$PARAMS_PATH/ImuParams.yaml" \
+    --backend_params_path="$PARAMS_PATH/regularVioParameters.yaml" \
+    --frontend_params_path="$PARAMS_PATH/trackerParameters.yaml" \
+    --use_lcd="$USE_LCD" \
+    --lcd_params_path="$PARAMS_PATH/LCDParameters.yaml" \
+    --vocabulary_path="$VOCABULARY_PATH/ORBvoc.yml" \
+    --flagfile="$PARAMS_PATH/flags/stereoVIOEuroc.flags" \
+    --flagfile="$PARAMS_PATH/flags/Mesher.flags" \
+    --flagfile="$PARAMS_PATH/flags/VioBackEnd.flags" \
+    --flagfile="$PARAMS_PATH/flags/RegularVioBackEnd.flags" \
+    --flagfile="$PARAMS_PATH/flags/Visualizer3D.flags" \
+    --flagfile="$PARAMS_PATH/flags/EthParser.flags" \
+    --visualize=false \
+    --parallel_run="$PARALLEL_RUN" \
+    --logtostderr=1 \
+    --colorlogtostderr=1 \
+    --log_prefix=1 \
+    --v=0 \
+    --log_output=1 \
+    --output_path="$RUN_OUTPUT_PATH" || exit 1
+done
+
+# Summarize and compare against the baseline.
+REPORT_ARGS="--gt $DATASET_PATH/mav0/state_groundtruth_estimate0/data.csv"
+if [ -n "$BASELINE_PATH" ]; then
+  REPORT_ARGS="$REPORT_ARGS --baseline $BASELINE_PATH"
+  if [ $SAVE_BASELINE == 1 ]; then
+    REPORT_ARGS="$REPORT_ARGS --save_baseline"
+  fi
+fi
+python evaluation/pipeline_benchmark_report.py "$OUTPUT_PATH" $REPORT_ARGS
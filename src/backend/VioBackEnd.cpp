@@ -41,6 +41,7 @@
 // Only for gtNavState ...
 #include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
 #include "kimera-vio/imu-frontend/ImuFrontEnd-definitions.h"  // for safeCast
+#include "kimera-vio/utils/MemoryUsage.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
 
@@ -60,6 +61,11 @@ DEFINE_int32(max_number_of_cheirality_exceptions,
 DEFINE_bool(compute_state_covariance,
             false,
             "Flag to compute state covariance from optimization backend");
+DEFINE_bool(prune_marginalized_feature_tracks,
+            false,
+            "Bounded-memory mode: delete the feature tracks (and the "
+            "bookkeeping of their smart factors) of landmarks whose last "
+            "observation has been marginalized out of the smoother.");
 
 namespace VIO {
 
@@ -343,6 +349,18 @@ void VioBackEnd::addVisualInertialStateAndOptimize(const BackendInput& input) {
           : boost::none);  // optional: pose estimate from stereo ransac
   // Bookkeeping
   timestamp_lkf_ = input.timestamp_;
+
+  if (FLAGS_prune_marginalized_feature_tracks) {
+    pruneMarginalizedFeatureTracks();
+  }
+
+  // Memory accounting: these structures grow with the length of the run
+  // unless they are pruned.
+  utils::StatsCollector stats_feature_tracks("VioBackEnd Feature Tracks [#]");
+  utils::StatsCollector stats_old_smart_factors(
+      "VioBackEnd Old Smart Factors [#]");
+  stats_feature_tracks.AddSample(feature_tracks_.size());
+  stats_old_smart_factors.AddSample(old_smart_factors_.size());
 }
 
 /* -------------------------------------------------------------------------- */
@@ -2112,6 +2130,52 @@ void VioBackEnd::findSlotsOfFactorsWithKey(
   }
 }
 
+/* -------------------------------------------------------------------------- */
+// Feature tracks and old smart factors are otherwise only deleted on
+// cheirality exceptions, so they grow unbounded over long runs.
+void VioBackEnd::pruneMarginalizedFeatureTracks() {
+  CHECK(smoother_);
+  const gtsam::FixedLagSmoother::KeyTimestampMap& timestamps =
+      smoother_->timestamps();
+  size_t feature_tracks_bytes = 0u;
+  for (FeatureTracks::iterator feature_track_it = feature_tracks_.begin();
+       feature_track_it != feature_tracks_.end();) {
+    const FeatureTrack& feature_track = feature_track_it->second;
+    // Observations are sorted by keyframe id, hence if the last one has been
+    // marginalized, no factor in the smoother can use this track anymore.
+    CHECK(!feature_track.obs_.empty());
+    const FrameId& last_kf_id = feature_track.obs_.back().first;
+    if (timestamps.find(gtsam::Symbol('x', last_kf_id)) == timestamps.end()) {
+      VLOG(20) << "Pruning feature track for lmk: " << feature_track_it->first;
+      feature_track_it = feature_tracks_.erase(feature_track_it);
+    } else {
+      feature_tracks_bytes += sizeof(FeatureTracks::value_type) +
+                              feature_track.obs_.capacity() *
+                                  sizeof(feature_track.obs_.front());
+      ++feature_track_it;
+    }
+  }
+
+  // Same criterion as in getMapLmkIdsTo3dPointsInTimeHorizon: the slot of
+  // the smart factor no longer exists in the graph of the smoother.
+  const gtsam::NonlinearFactorGraph& graph = smoother_->getFactors();
+  for (SmartFactorMap::iterator old_smart_factor_it =
+           old_smart_factors_.begin();
+       old_smart_factor_it != old_smart_factors_.end();) {
+    const Slot& slot_id = old_smart_factor_it->second.second;
+    if (slot_id != -1 && !graph.exists(slot_id)) {
+      old_smart_factor_it = old_smart_factors_.erase(old_smart_factor_it);
+    } else {
+      ++old_smart_factor_it;
+    }
+  }
+
+  utils::StatsCollector stats_feature_tracks_memory(
+      "VioBackEnd Feature Tracks Memory [MB]");
+  stats_feature_tracks_memory.AddSample(
+      utils::MemoryUsage::BytesToMegaBytes(feature_tracks_bytes));
+}
+
 /* -------------------------------------------------------------------------- */
 // Returns if the key in feature tracks could be removed or not.
 bool VioBackEnd::deleteLmkFromFeatureTracks(const LandmarkId& lmk_id) {
@@ -0,0 +1,239 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DenseStereo.cpp
+ * @brief  Semi-dense stereo points to densify the mesh.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/DenseStereo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+DenseStereo::DenseStereo(const DenseStereoParams& params)
+    : params_(params), sgbm_(nullptr), next_lmk_id_(kDenseStereoFirstLmkId) {
+  CHECK_GT(params_.scale_, 0.0);
+  CHECK_LE(params_.scale_, 1.0);
+  CHECK_GT(params_.num_disparities_, 0);
+  CHECK_EQ(params_.num_disparities_ % 16, 0)
+      << "The disparity range must be a multiple of 16.";
+  CHECK_EQ(params_.block_size_ % 2, 1) << "The block size must be odd.";
+  CHECK_GT(params_.grid_step_, 0);
+  CHECK_GE(params_.max_nr_points_, 0);
+  CHECK_GT(params_.min_depth_, 0.0);
+  CHECK_GT(params_.max_depth_, params_.min_depth_);
+
+  // Parameters for grayscale images, as suggested in the OpenCV docs.
+  const int block_area = params_.block_size_ * params_.block_size_;
+  sgbm_ = cv::StereoSGBM::create(0,
+                                 params_.num_disparities_,
+                                 params_.block_size_,
+                                 8 * block_area,
+                                 32 * block_area,
+                                 1,
+                                 63,
+                                 10,
+                                 100,
+                                 2,
+                                 cv::StereoSGBM::MODE_SGBM_3WAY);
+}
+
+/* -------------------------------------------------------------------------- */
+DenseStereoOutput::UniquePtr DenseStereo::spinOnce(
+    const DenseStereoInput& input) {
+  CHECK(input.frontend_output_);
+  const StereoFrame& stereo_frame = input.frontend_output_->stereo_frame_lkf_;
+  CHECK(stereo_frame.isRectified());
+  const CameraParams& left_cam_param = stereo_frame.getLeftFrame().cam_param_;
+
+  DenseStereoOutput::UniquePtr output =
+      VIO::make_unique<DenseStereoOutput>(input.timestamp_);
+  computeDensePoints(stereo_frame.left_img_rectified_,
+                     stereo_frame.right_img_rectified_,
+                     stereo_frame.getLeftUndistRectCamMat(),
+                     stereo_frame.getBaseline(),
+                     left_cam_param.undistRect_map_x_,
+                     left_cam_param.undistRect_map_y_,
+                     &output->keypoints_,
+                     &output->keypoints_3d_);
+
+  output->landmarks_.resize(output->keypoints_.size());
+  for (LandmarkId& lmk_id : output->landmarks_) {
+    lmk_id = next_lmk_id_++;
+  }
+  VLOG(5) << "Dense stereo points: " << output->keypoints_.size();
+  return output;
+}
+
+/* -------------------------------------------------------------------------- */
+void DenseStereo::computeDensePoints(const cv::Mat& left_img_rectified,
+                                     const cv::Mat& right_img_rectified,
+                                     const gtsam::Cal3_S2& left_cam_rect,
+                                     const double& baseline,
+                                     const cv::Mat& undist_rect_map_x,
+                                     const cv::Mat& undist_rect_map_y,
+                                     KeypointsCV* keypoints,
+                                     std::vector<Vector3>* keypoints_3d) const {
+  CHECK_NOTNULL(keypoints)->clear();
+  CHECK_NOTNULL(keypoints_3d)->clear();
+  CHECK_EQ(left_img_rectified.type(), CV_8UC1);
+  CHECK(left_img_rectified.size() == right_img_rectified.size());
+  CHECK_GT(baseline, 0.0);
+  const bool has_map = !undist_rect_map_x.empty();
+  if (has_map) {
+    CHECK_EQ(undist_rect_map_x.type(), CV_32FC1);
+    CHECK_EQ(undist_rect_map_y.type(), CV_32FC1);
+    CHECK(undist_rect_map_x.size() == left_img_rectified.size());
+    CHECK(undist_rect_map_y.size() == left_img_rectified.size());
+  }
+
+  // Match at reduced resolution.
+  cv::Mat left_img, right_img;
+  if (params_.scale_ < 1.0) {
+    cv::resize(left_img_rectified,
+               left_img,
+               cv::Size(),
+               params_.scale_,
+               params_.scale_,
+               cv::INTER_AREA);
+    cv::resize(right_img_rectified,
+               right_img,
+               cv::Size(),
+               params_.scale_,
+               params_.scale_,
+               cv::INTER_AREA);
+  } else {
+    left_img = left_img_rectified;
+    right_img = right_img_rectified;
+  }
+  // Fixed point disparities, with 4 fractional bits.
+  cv::Mat disparity;
+  sgbm_->compute(left_img, right_img, disparity);
+  CHECK_EQ(disparity.type(), CV_16SC1);
+
+  // Same edges as StereoFrame::computeImgGradients.
+  cv::Mat edges;
+  if (params_.only_gradients_) {
+    edges = UtilsOpenCV::EdgeDetectorCanny(left_img);
+  }
+
+  // Range of disparities for the range of depths, at the matching resolution.
+  const double fx = left_cam_rect.fx();
+  const double fy = left_cam_rect.fy();
+  const double fx_b_scaled = fx * baseline * params_.scale_;
+  const int min_disparity_16 = std::max(
+      1, static_cast<int>(std::ceil(16.0 * fx_b_scaled / params_.max_depth_)));
+  const int max_disparity_16 = static_cast<int>(std::min(
+      static_cast<double>(std::numeric_limits<int16_t>::max()),
+      std::floor(16.0 * fx_b_scaled / params_.min_depth_)));
+
+  std::vector<cv::Point> pixels;
+  samplePixels(disparity, edges, min_disparity_16, max_disparity_16, &pixels);
+
+  // Keep evenly spread pixels if there are too many.
+  const size_t max_nr_points = static_cast<size_t>(params_.max_nr_points_);
+  if (pixels.size() > max_nr_points) {
+    std::vector<cv::Point> kept_pixels(max_nr_points);
+    for (size_t i = 0u; i < max_nr_points; i++) {
+      kept_pixels[i] = pixels[i * pixels.size() / max_nr_points];
+    }
+    pixels.swap(kept_pixels);
+  }
+
+  keypoints->reserve(pixels.size());
+  keypoints_3d->reserve(pixels.size());
+  const double cx = left_cam_rect.px();
+  const double cy = left_cam_rect.py();
+  const cv::Rect2f img_rect(0.0f,
+                            0.0f,
+                            static_cast<float>(left_img_rectified.cols),
+                            static_cast<float>(left_img_rectified.rows));
+  for (const cv::Point& pixel : pixels) {
+    // Disparity and pixel at full resolution.
+    const double disparity_px =
+        disparity.at<int16_t>(pixel) / (16.0 * params_.scale_);
+    const double u = (pixel.x + 0.5) / params_.scale_ - 0.5;
+    const double v = (pixel.y + 0.5) / params_.scale_ - 0.5;
+
+    KeypointCV keypoint(static_cast<float>(u), static_cast<float>(v));
+    if (has_map) {
+      const int row = std::min(static_cast<int>(std::round(v)),
+                               undist_rect_map_x.rows - 1);
+      const int col = std::min(static_cast<int>(std::round(u)),
+                               undist_rect_map_x.cols - 1);
+      keypoint = KeypointCV(undist_rect_map_x.at<float>(row, col),
+                            undist_rect_map_y.at<float>(row, col));
+    }
+    // Rectified pixels might come from outside the original image.
+    if (!img_rect.contains(keypoint)) continue;
+
+    const double depth = fx * baseline / disparity_px;
+    keypoints->push_back(keypoint);
+    keypoints_3d->push_back(
+        Vector3((u - cx) * depth / fx, (v - cy) * depth / fy, depth));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void DenseStereo::samplePixels(const cv::Mat& disparity,
+                               const cv::Mat& mask,
+                               const int& min_disparity_16,
+                               const int& max_disparity_16,
+                               std::vector<cv::Point>* pixels) const {
+  CHECK_NOTNULL(pixels)->clear();
+  CHECK(mask.empty() || mask.size() == disparity.size());
+  const int& step = params_.grid_step_;
+  // SGBM cannot match the left border, where the right image ends.
+  const int first_col = params_.num_disparities_;
+  for (int cell_row = 0; cell_row < disparity.rows; cell_row += step) {
+    const int last_row = std::min(cell_row + step, disparity.rows);
+    for (int cell_col = first_col; cell_col < disparity.cols;
+         cell_col += step) {
+      const int last_col = std::min(cell_col + step, disparity.cols);
+      const int center_row = (cell_row + last_row) / 2;
+      const int center_col = (cell_col + last_col) / 2;
+      cv::Point best_pixel;
+      int best_distance = std::numeric_limits<int>::max();
+      for (int row = cell_row; row < last_row; row++) {
+        const int16_t* disparity_row = disparity.ptr<int16_t>(row);
+        const uint8_t* mask_row = mask.empty() ? nullptr : mask.ptr(row);
+        for (int col = cell_col; col < last_col; col++) {
+          if (mask_row && mask_row[col] == 0u) continue;
+          const int disparity_16 = disparity_row[col];
+          if (disparity_16 < min_disparity_16 ||
+              disparity_16 > max_disparity_16) {
+            continue;
+          }
+          const int distance = (row - center_row) * (row - center_row) +
+                               (col - center_col) * (col - center_col);
+          if (distance < best_distance) {
+            best_distance = distance;
+            best_pixel = cv::Point(col, row);
+          }
+        }
+      }
+      if (best_distance < std::numeric_limits<int>::max()) {
+        pixels->push_back(best_pixel);
+      }
+    }
+  }
+}
+
+}  // namespace VIO
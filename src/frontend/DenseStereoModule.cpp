@@ -0,0 +1,66 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DenseStereoModule.cpp
+ * @brief  Pipeline module for the dense stereo.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/DenseStereoModule.h"
+
+namespace VIO {
+
+DenseStereoModule::DenseStereoModule(bool parallel_run,
+                                     DenseStereo::UniquePtr dense_stereo)
+    : MIMOPipelineModule<DenseStereoInput, DenseStereoOutput>(
+          "DenseStereoModule",
+          parallel_run),
+      frontend_payload_queue_("dense_stereo_frontend"),
+      dense_stereo_(std::move(dense_stereo)) {
+  CHECK(dense_stereo_);
+}
+
+DenseStereoModule::InputUniquePtr DenseStereoModule::getInputPacket() {
+  DenseStereoFrontendInput frontend_payload = nullptr;
+  bool queue_state = false;
+  if (PIO::parallel_run_) {
+    queue_state = frontend_payload_queue_.popBlocking(frontend_payload);
+  } else {
+    queue_state = frontend_payload_queue_.pop(frontend_payload);
+  }
+
+  if (!queue_state) {
+    LOG_IF(WARNING, PIO::parallel_run_)
+        << "Module: " << name_id_ << " - Frontend queue is down";
+    VLOG_IF(1, !PIO::parallel_run_)
+        << "Module: " << name_id_ << " - Frontend queue is empty or down";
+    return nullptr;
+  }
+
+  CHECK(frontend_payload);
+  CHECK(frontend_payload->is_keyframe_);
+  return VIO::make_unique<DenseStereoInput>(frontend_payload);
+}
+
+DenseStereoModule::OutputUniquePtr DenseStereoModule::spinOnce(
+    DenseStereoInput::UniquePtr input) {
+  CHECK(input);
+  return dense_stereo_->spinOnce(*input);
+}
+
+void DenseStereoModule::shutdownQueues() {
+  LOG(INFO) << "Shutting down queues for: " << name_id_;
+  frontend_payload_queue_.shutdown();
+}
+
+bool DenseStereoModule::hasWork() const {
+  return !frontend_payload_queue_.empty();
+}
+
+}  // namespace VIO
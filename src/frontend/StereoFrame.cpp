@@ -19,6 +19,9 @@
 
 #include <opencv2/core/core.hpp>
 
+#include "kimera-vio/mesh/TriangleFilter.h"
+#include "kimera-vio/utils/ThreadLocalStatistics.h"
+
 DEFINE_bool(images_rectified, false, "Input image data already rectified.");
 
 namespace VIO {
@@ -278,6 +281,62 @@ void StereoFrame::sparseStereoMatching(const int verbosity) {
   VLOG(10) << "Finished sanity check stereo frame.";
 }
 
+/* -------------------------------------------------------------------------- */
+void StereoFrame::sparseStereoMatching(
+    const KeypointsCV& left_keypoints,
+    const BearingVectors& left_versors,
+    std::vector<Vector3>* keypoints_3d) const {
+  CHECK_NOTNULL(keypoints_3d);
+  CHECK(is_rectified_);
+  CHECK_EQ(left_keypoints.size(), left_versors.size());
+
+  StatusKeypointsCV left_keypoints_rectified;
+  undistortRectifyPoints(left_keypoints,
+                         left_frame_.cam_param_,
+                         left_undistRectCameraMatrix_,
+                         &left_keypoints_rectified);
+
+  // Same matching as for the frontend keypoints, on the shared (not copied)
+  // rectified images.
+  double fx = left_undistRectCameraMatrix_.fx();
+  StatusKeypointsCV right_keypoints_rectified;
+  switch (sparse_stereo_params_.vision_sensor_type_) {
+    case VisionSensorType::STEREO:
+      right_keypoints_rectified = getRightKeypointsRectified(
+          left_img_rectified_, right_img_rectified_, left_keypoints_rectified,
+          fx, getBaseline());
+      break;
+    case VisionSensorType::RGBD:
+      right_keypoints_rectified = getRightKeypointsRectifiedRGBD(
+          left_img_rectified_, right_img_rectified_, left_keypoints_rectified,
+          fx, getBaseline(), getMapDepthFactor(), getMinDepthFactor());
+      break;
+    default:
+      LOG(FATAL) << "sparseStereoMatching: only works when "
+                    "VisionSensorType::STEREO or RGBD";
+      break;
+  }
+  std::vector<double> keypoints_depth = getDepthFromRectifiedMatches(
+      left_keypoints_rectified, right_keypoints_rectified, fx, getBaseline());
+  CHECK_EQ(keypoints_depth.size(), left_versors.size());
+
+  // As in sparseStereoMatching: expressed in the rectified left frame.
+  gtsam::Rot3 camLrect_R_camL =
+      UtilsOpenCV::cvMatToGtsamRot3(left_frame_.cam_param_.R_rectify_);
+  keypoints_3d->clear();
+  keypoints_3d->reserve(right_keypoints_rectified.size());
+  for (size_t i = 0; i < right_keypoints_rectified.size(); i++) {
+    if (right_keypoints_rectified[i].first == KeypointStatus::VALID) {
+      Vector3 versor = camLrect_R_camL.rotate(left_versors[i]);
+      CHECK_GE(versor(2), 1e-3)
+          << "sparseStereoMatching: found point with nonpositive depth!";
+      keypoints_3d->push_back(versor * keypoints_depth[i] / versor(2));
+    } else {
+      keypoints_3d->push_back(Vector3::Zero());
+    }
+  }
+}
+
 /* -------------------------------------------------------------------------- */
 void StereoFrame::checkStereoFrame() const {
   const size_t nrLeftKeypoints = left_frame_.keypoints_.size();
@@ -531,19 +590,21 @@ void StereoFrame::filterTrianglesWithGradients(
   cv::Mat img_grads;
   computeImgGradients(left_frame_.img_, &img_grads);
 
-  // For each triangle, set to full the triangles that have near-zero gradient.
-  // triangulation2Dobs_.reserve(triangulation2D.size());
-  // TODO far too many loops over triangles.
-  for (const cv::Vec6f& triangle : original_triangulation_2D) {
-    // Find all pixels with a gradient higher than gradBound.
-    std::vector<std::pair<KeypointCV, double>> keypoints_with_high_gradient =
-        UtilsOpenCV::FindHighIntensityInTriangle(img_grads, triangle,
-                                                 gradient_bound);
-
-    // If no high-grad pixels exist,
-    // then this triangle is assumed to be a plane.
-    if (keypoints_with_high_gradient.size() <= max_keypoints_with_gradient) {
-      filtered_triangulation_2D->push_back(triangle);
+  // Count the high-gradient pixels of all triangles at once.
+  std::vector<uint8_t> keep;
+  TriangleFilter::filterTrianglesWithGradients(img_grads,
+                                               original_triangulation_2D,
+                                               gradient_bound,
+                                               max_keypoints_with_gradient,
+                                               &keep);
+
+  // If no high-grad pixels exist,
+  // then this triangle is assumed to be a plane.
+  filtered_triangulation_2D->reserve(filtered_triangulation_2D->size() +
+                                     original_triangulation_2D.size());
+  for (size_t i = 0u; i < original_triangulation_2D.size(); i++) {
+    if (keep[i]) {
+      filtered_triangulation_2D->push_back(original_triangulation_2D[i]);
     }
   }
 }
@@ -946,6 +1007,7 @@ StatusKeypointsCV StereoFrame::getRightKeypointsRectified(
     }
 
     // Do left->right matching
+    KIMERA_STATS_SCOPED_TIMER_US("Stereo matching per keypoint [us]");
     KeypointCV left_rectified_i = left_keypoints_rectified[i].second;
     StatusKeypointCV right_rectified_i_candidate;
     double matchingVal_LR;
@@ -992,6 +1054,11 @@ StatusKeypointsCV StereoFrame::getRightKeypointsRectified(
     //    }
     //  }
     //}
+    KIMERA_STATS_SAMPLE("Stereo matching valid match [0/1]",
+                        right_rectified_i_candidate.first ==
+                                KeypointStatus::VALID
+                            ? 1.0
+                            : 0.0);
     right_keypoints_rectified.push_back(right_rectified_i_candidate);
   }
 
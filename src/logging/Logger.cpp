@@ -17,11 +17,14 @@
 #include <boost/foreach.hpp>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include <gflags/gflags.h>
 
 #include "kimera-vio/frontend/StereoVisionFrontEnd-definitions.h"
+#include "kimera-vio/utils/MemoryUsage.h"
 #include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/ThreadLocalStatistics.h"
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
@@ -261,8 +264,9 @@ void BackendLogger::logBackendFactorsStats(const BackendOutput& output) {
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 VisualizerLogger::VisualizerLogger()
-    : output_mesh_("output_mesh.ply"),
-      output_landmarks_("output_landmarks.txt") {}
+    : output_mesh_(nullptr),
+      output_landmarks_("output_landmarks.txt"),
+      mesh_stream_writer_(nullptr) {}
 
 void VisualizerLogger::logLandmarks(const PointsWithId& lmks) {
   // Absolute vio errors
@@ -299,7 +303,10 @@ void VisualizerLogger::logMesh(const cv::Mat& lmks,
                                const cv::Mat& mesh,
                                const double& timestamp,
                                bool log_accumulated_mesh) {
-  std::ofstream& output_mesh_stream = output_mesh_.ofstream_;
+  if (!output_mesh_) {
+    output_mesh_ = VIO::make_unique<OfstreamWrapper>("output_mesh.ply");
+  }
+  std::ofstream& output_mesh_stream = output_mesh_->ofstream_;
   CHECK(output_mesh_stream) << "Output File Mesh: error writing.";
   // Number of vertices in the mesh.
   int vertex_count = lmks.rows;
@@ -346,6 +353,52 @@ void VisualizerLogger::logMesh(const cv::Mat& lmks,
   output_mesh_stream << std::endl;
 }
 
+void VisualizerLogger::logMeshChunks(const std::vector<MeshChunk>& chunks) {
+  // The chunks go through the mesh stream, or through a stream of their own
+  // if the mesh is not streamed.
+  if (!mesh_stream_writer_) {
+    mesh_stream_writer_ =
+        VIO::make_unique<MeshStreamWriter>("", MeshStreamFormat::kBinaryPly);
+  }
+  for (const MeshChunk& chunk : chunks) {
+    MeshStreamBuffer mesh;
+    mesh.vertices_.reserve(3u * chunk.vertices_.size());
+    for (const cv::Point3f& vertex : chunk.vertices_) {
+      mesh.vertices_.push_back(vertex.x);
+      mesh.vertices_.push_back(vertex.y);
+      mesh.vertices_.push_back(vertex.z);
+    }
+    // The chunks have no colors.
+    mesh.colors_.resize(mesh.vertices_.size(), 255u);
+    mesh.faces_.reserve(3u * chunk.faces_.size());
+    for (const MeshChunk::Face& face : chunk.faces_) {
+      mesh.faces_.insert(mesh.faces_.end(), face.begin(), face.end());
+    }
+    mesh_stream_writer_->logBinaryPly(
+        FLAGS_output_path + "/output_mesh_chunk_" +
+            std::to_string(chunk.index_.x) + "_" +
+            std::to_string(chunk.index_.y) + "_" +
+            std::to_string(chunk.index_.z) + ".ply",
+        std::move(mesh));
+  }
+}
+
+void VisualizerLogger::openMeshStream(const MeshStreamFormat& format) {
+  const std::string filename =
+      FLAGS_output_path + (format == MeshStreamFormat::kBinaryPly
+                               ? "/output_mesh.ply"
+                               : "/output_mesh.delta");
+  mesh_stream_writer_ = VIO::make_unique<MeshStreamWriter>(filename, format);
+}
+
+void VisualizerLogger::streamMesh(const cv::Mat& lmks,
+                                  const cv::Mat& colors,
+                                  const cv::Mat& mesh,
+                                  const Timestamp& timestamp) {
+  CHECK(mesh_stream_writer_) << "Call openMeshStream first.";
+  mesh_stream_writer_->logMesh(lmks, colors, mesh, timestamp);
+}
+
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 FrontendLogger::FrontendLogger()
     : output_frontend_stats_("output_frontend_stats.csv"),
@@ -474,8 +527,21 @@ void PipelineLogger::logPipelineOverallTiming(
   outputFile_timingOverall_ << "vio_overall_time [ms]" << std::endl;
   outputFile_timingOverall_ << duration.count();
 
+  // Overall time and peak memory, to be compared across runs together with
+  // the per-module timing (see scripts/run_pipeline_benchmark.bash).
+  utils::StatsCollector stats_overall_timing("Pipeline Overall Timing [ms]");
+  stats_overall_timing.AddSample(duration.count());
+  utils::StatsCollector stats_peak_rss("Pipeline Peak RSS [MB]");
+  stats_peak_rss.AddSample(utils::MemoryUsage::BytesToMegaBytes(
+      utils::MemoryUsage::GetPeakRssBytes()));
+
+  // Push the samples aggregated by this thread before writing.
+  KIMERA_STATS_FLUSH();
   VIO::utils::Statistics::WriteAllSamplesToCsvFile(
       FLAGS_output_path + '/' + "StatisticsVIO.csv");
+  // The csv only has per-sample statistics, the yaml also has aggregates.
+  VIO::utils::Statistics::WriteToYamlFile(
+      FLAGS_output_path + '/' + "StatisticsVIO.yaml");
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -542,10 +608,16 @@ void LoopClosureDetectorLogger::logOptimizedTraj(const LcdOutput& lcd_output) {
     is_header_written = true;
   }
 
+  // With incremental output, the full PGO is only sent on loop closures.
   const gtsam::Values& traj = lcd_output.states_;
-
-  for (size_t i = 1; i < traj.size(); i++) {
-    const gtsam::Pose3& pose = traj.at<gtsam::Pose3>(i);
+  const bool use_shared_traj = traj.empty() && lcd_output.trajectory_;
+  const size_t traj_size =
+      use_shared_traj ? lcd_output.trajectory_->size() : traj.size();
+
+  for (size_t i = 1; i < traj_size; i++) {
+    const gtsam::Pose3& pose = use_shared_traj
+                                   ? lcd_output.trajectory_->at(i)
+                                   : traj.at<gtsam::Pose3>(i);
     const gtsam::Point3& trans = pose.translation();
     const gtsam::Quaternion& quat = pose.rotation().toQuaternion();
 
@@ -0,0 +1,551 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshStreamWriter.cpp
+ * @brief  Binary mesh logging on a background thread.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/logging/MeshStreamWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+using Face = std::array<uint32_t, 3>;
+
+constexpr char kDeltaMagic[4] = {'K', 'M', 'D', '1'};
+// Sanity bound on the size of a delta record when reading.
+constexpr uint32_t kMaxRecordLength = 1u << 30;
+
+// Values are written as they are in memory: little endian on all the
+// platforms we run on, as declared in the PLY header.
+template <typename T>
+inline void writeBinary(std::ofstream* stream, const T& value) {
+  stream->write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readBinary(std::ifstream* stream, T* value) {
+  stream->read(reinterpret_cast<char*>(value), sizeof(T));
+  return static_cast<bool>(*stream);
+}
+
+template <typename T>
+inline void appendBinary(std::vector<char>* buffer, const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer->insert(buffer->end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+inline bool parseBinary(const std::vector<char>& buffer,
+                        size_t* offset,
+                        T* value) {
+  if (*offset + sizeof(T) > buffer.size()) return false;
+  std::copy(buffer.data() + *offset,
+            buffer.data() + *offset + sizeof(T),
+            reinterpret_cast<char*>(value));
+  *offset += sizeof(T);
+  return true;
+}
+
+// Rotates the face so that it starts at its smallest vertex index, which
+// keeps its orientation.
+inline Face normalizeFace(const uint32_t* vertex_ids) {
+  const size_t first =
+      std::min_element(vertex_ids, vertex_ids + 3) - vertex_ids;
+  return Face{{vertex_ids[first],
+               vertex_ids[(first + 1u) % 3u],
+               vertex_ids[(first + 2u) % 3u]}};
+}
+
+// Writes aside and renames, so that the file always holds a whole mesh.
+bool replaceBinaryPly(const std::string& filename,
+                      const MeshStreamBuffer& mesh) {
+  const std::string tmp_filename = filename + ".tmp";
+  return MeshStreamWriter::writeBinaryPly(tmp_filename, mesh) &&
+         std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+MeshStreamWriter::MeshStreamWriter(const std::string& filename,
+                                   const MeshStreamFormat& format)
+    : filename_(filename),
+      format_(format),
+      nr_dropped_(0u),
+      nr_written_(0u) {
+  if (format_ == MeshStreamFormat::kDelta) {
+    delta_stream_.open(filename_,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    CHECK(delta_stream_.is_open()) << "Cannot open file: " << filename_;
+    delta_stream_.write(kDeltaMagic, sizeof(kDeltaMagic));
+  }
+  io_thread_ = std::thread(&MeshStreamWriter::ioSpin, this);
+}
+
+/* -------------------------------------------------------------------------- */
+MeshStreamWriter::~MeshStreamWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  if (io_thread_.joinable()) io_thread_.join();
+  LOG_IF(WARNING, nr_dropped_ > 0u)
+      << "Mesh logging dropped " << nr_dropped_ << " of "
+      << nr_dropped_ + nr_written_ << " meshes: disk is too slow.";
+}
+
+/* -------------------------------------------------------------------------- */
+void fillMeshStreamBuffer(const cv::Mat& vertices,
+                          const cv::Mat& colors,
+                          const cv::Mat& polygons,
+                          const Timestamp& timestamp,
+                          MeshStreamBuffer* mesh) {
+  CHECK_NOTNULL(mesh);
+  CHECK_EQ(vertices.depth(), CV_32F);
+  CHECK_EQ(vertices.channels() * vertices.cols, 3);
+  if (!colors.empty()) {
+    CHECK_EQ(colors.depth(), CV_8U);
+    CHECK_EQ(colors.channels() * colors.cols, 3);
+    CHECK_EQ(colors.rows, vertices.rows);
+  }
+  if (!polygons.empty()) {
+    CHECK_EQ(polygons.type(), CV_32SC1);
+    CHECK(polygons.isContinuous());
+  }
+  const size_t nr_vertices = static_cast<size_t>(vertices.rows);
+
+  mesh->clear();
+  mesh->timestamp_ = timestamp;
+  mesh->vertices_.reserve(3u * nr_vertices);
+  mesh->colors_.reserve(3u * nr_vertices);
+  for (int i = 0; i < vertices.rows; i++) {
+    const float* vertex = vertices.ptr<float>(i);
+    mesh->vertices_.insert(mesh->vertices_.end(), vertex, vertex + 3);
+  }
+  if (colors.empty()) {
+    mesh->colors_.resize(3u * nr_vertices, 255u);
+  } else {
+    for (int i = 0; i < colors.rows; i++) {
+      const uint8_t* color = colors.ptr<uint8_t>(i);
+      mesh->colors_.insert(mesh->colors_.end(), color, color + 3);
+    }
+  }
+  const size_t nr_values = polygons.total();
+  const int32_t* polygon =
+      polygons.empty() ? nullptr : polygons.ptr<int32_t>();
+  CHECK_EQ(nr_values % 4u, 0u) << "Only triangles are supported.";
+  mesh->faces_.reserve(3u * nr_values / 4u);
+  for (size_t i = 0u; i < nr_values; i += 4u) {
+    CHECK_EQ(polygon[i], 3) << "Only triangles are supported.";
+    for (size_t j = 1u; j <= 3u; j++) {
+      CHECK_GE(polygon[i + j], 0);
+      CHECK_LT(static_cast<size_t>(polygon[i + j]), nr_vertices);
+      mesh->faces_.push_back(static_cast<uint32_t>(polygon[i + j]));
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void removeDuplicateFaces(MeshStreamBuffer* mesh) {
+  CHECK_NOTNULL(mesh);
+  std::set<Face> faces;
+  size_t nr_faces = 0u;
+  for (size_t i = 0u; i < mesh->faces_.size(); i += 3u) {
+    if (!faces.insert(normalizeFace(&mesh->faces_[i])).second) continue;
+    // Kept faces only move towards the front.
+    for (size_t j = 0u; j < 3u; j++) {
+      mesh->faces_[3u * nr_faces + j] = mesh->faces_[i + j];
+    }
+    nr_faces++;
+  }
+  mesh->faces_.resize(3u * nr_faces);
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshStreamWriter::logMesh(const cv::Mat& vertices,
+                               const cv::Mat& colors,
+                               const cv::Mat& polygons,
+                               const Timestamp& timestamp) {
+  CHECK(!filename_.empty()) << "No file to log the mesh to.";
+  {
+    // The copy reuses the memory of the buffers, and the I/O thread only
+    // holds the lock to swap them.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (has_pending_mesh_) nr_dropped_++;
+    fillMeshStreamBuffer(vertices, colors, polygons, timestamp, &back_buffer_);
+    has_pending_mesh_ = true;
+  }
+  cv_.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshStreamWriter::logBinaryPly(const std::string& filename,
+                                    MeshStreamBuffer mesh) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (back_ply_meshes_.count(filename) > 0u) nr_dropped_++;
+    back_ply_meshes_[filename] = std::move(mesh);
+  }
+  cv_.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshStreamWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] {
+    return !has_pending_mesh_ && back_ply_meshes_.empty() && !is_writing_;
+  });
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshStreamWriter::ioSpin() {
+  while (true) {
+    bool has_mesh = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] {
+        return has_pending_mesh_ || !back_ply_meshes_.empty() || shutdown_;
+      });
+      // Pending meshes are written before shutting down.
+      if (!has_pending_mesh_ && back_ply_meshes_.empty()) break;
+      if (has_pending_mesh_) std::swap(front_buffer_, back_buffer_);
+      front_ply_meshes_.swap(back_ply_meshes_);
+      has_mesh = has_pending_mesh_;
+      has_pending_mesh_ = false;
+      is_writing_ = true;
+    }
+    // On this thread, so that the caller does not pay for it.
+    if (has_mesh) {
+      removeDuplicateFaces(&front_buffer_);
+      writeMesh(front_buffer_);
+    }
+    for (auto& ply_mesh : front_ply_meshes_) {
+      removeDuplicateFaces(&ply_mesh.second);
+      if (replaceBinaryPly(ply_mesh.first, ply_mesh.second)) {
+        nr_written_++;
+      } else {
+        LOG(ERROR) << "Could not log the mesh to: " << ply_mesh.first;
+      }
+    }
+    front_ply_meshes_.clear();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_writing_ = false;
+    }
+    cv_.notify_all();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshStreamWriter::writeMesh(const MeshStreamBuffer& mesh) {
+  bool success = false;
+  switch (format_) {
+    case MeshStreamFormat::kBinaryPly: {
+      success = replaceBinaryPly(filename_, mesh);
+      break;
+    }
+    case MeshStreamFormat::kDelta: {
+      success = writeDelta(mesh);
+      break;
+    }
+    default: {
+      LOG(FATAL) << "Unknown mesh stream format.";
+    }
+  }
+  if (success) {
+    nr_written_++;
+  } else {
+    LOG(ERROR) << "Could not log the mesh to: " << filename_;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool MeshStreamWriter::writeDelta(const MeshStreamBuffer& mesh) {
+  const size_t nr_vertices = mesh.getNumberOfVertices();
+  const size_t nr_last_vertices = last_vertices_.size() / 3u;
+  record_.clear();
+  appendBinary(&record_, mesh.timestamp_);
+  appendBinary(&record_, static_cast<uint32_t>(nr_vertices));
+
+  // Vertices that are new or moved or recolored, the count is patched after.
+  const size_t nr_changed_offset = record_.size();
+  appendBinary(&record_, uint32_t(0u));
+  uint32_t nr_changed = 0u;
+  for (size_t i = 0u; i < nr_vertices; i++) {
+    const float* vertex = &mesh.vertices_[3u * i];
+    const uint8_t* color = &mesh.colors_[3u * i];
+    if (i < nr_last_vertices &&
+        std::equal(vertex, vertex + 3, &last_vertices_[3u * i]) &&
+        std::equal(color, color + 3, &last_colors_[3u * i])) {
+      continue;
+    }
+    appendBinary(&record_, static_cast<uint32_t>(i));
+    for (size_t j = 0u; j < 3u; j++) appendBinary(&record_, vertex[j]);
+    for (size_t j = 0u; j < 3u; j++) appendBinary(&record_, color[j]);
+    nr_changed++;
+  }
+  std::copy(reinterpret_cast<const char*>(&nr_changed),
+            reinterpret_cast<const char*>(&nr_changed) + sizeof(nr_changed),
+            record_.begin() + nr_changed_offset);
+
+  faces_.clear();
+  faces_.reserve(mesh.getNumberOfFaces());
+  for (size_t i = 0u; i < mesh.faces_.size(); i += 3u) {
+    faces_.push_back(normalizeFace(&mesh.faces_[i]));
+  }
+  // Faces are unique, see removeDuplicateFaces.
+  std::sort(faces_.begin(), faces_.end());
+
+  std::vector<Face> removed_faces, added_faces;
+  std::set_difference(last_faces_.begin(),
+                      last_faces_.end(),
+                      faces_.begin(),
+                      faces_.end(),
+                      std::back_inserter(removed_faces));
+  std::set_difference(faces_.begin(),
+                      faces_.end(),
+                      last_faces_.begin(),
+                      last_faces_.end(),
+                      std::back_inserter(added_faces));
+  for (const std::vector<Face>* faces : {&removed_faces, &added_faces}) {
+    appendBinary(&record_, static_cast<uint32_t>(faces->size()));
+    for (const Face& face : *faces) {
+      appendBinary(&record_, face[0]);
+      appendBinary(&record_, face[1]);
+      appendBinary(&record_, face[2]);
+    }
+  }
+
+  // Length prefixed, so that readers can skip records and detect a
+  // truncated last record.
+  writeBinary(&delta_stream_, static_cast<uint32_t>(record_.size()));
+  delta_stream_.write(record_.data(), record_.size());
+  delta_stream_.flush();
+
+  last_vertices_ = mesh.vertices_;
+  last_colors_ = mesh.colors_;
+  last_faces_.swap(faces_);
+  return static_cast<bool>(delta_stream_);
+}
+
+/* -------------------------------------------------------------------------- */
+bool MeshStreamWriter::writeBinaryPly(const std::string& filename,
+                                      const MeshStreamBuffer& mesh) {
+  CHECK_EQ(mesh.colors_.size(), mesh.vertices_.size());
+  std::ofstream stream(filename, std::ios::out | std::ios::binary);
+  if (!stream) {
+    LOG(ERROR) << "Could not open mesh file: " << filename;
+    return false;
+  }
+  stream << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment Mesh for SPARK VIO at timestamp " << mesh.timestamp_
+         << "\n"
+         << "element vertex " << mesh.getNumberOfVertices() << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "property uchar red\n"
+         << "property uchar green\n"
+         << "property uchar blue\n"
+         << "element face " << mesh.getNumberOfFaces() << "\n"
+         << "property list uchar int vertex_indices\n"
+         << "end_header\n";
+  // Vertices interleave positions and colors, so they are packed first.
+  std::vector<char> data;
+  data.reserve(mesh.getNumberOfVertices() * (3u * sizeof(float) + 3u) +
+               mesh.getNumberOfFaces() * (1u + 3u * sizeof(int32_t)));
+  for (size_t i = 0u; i < mesh.getNumberOfVertices(); i++) {
+    for (size_t j = 0u; j < 3u; j++) {
+      appendBinary(&data, mesh.vertices_[3u * i + j]);
+    }
+    for (size_t j = 0u; j < 3u; j++) {
+      appendBinary(&data, mesh.colors_[3u * i + j]);
+    }
+  }
+  for (size_t i = 0u; i < mesh.faces_.size(); i += 3u) {
+    appendBinary(&data, uint8_t(3u));
+    for (size_t j = 0u; j < 3u; j++) {
+      appendBinary(&data, static_cast<int32_t>(mesh.faces_[i + j]));
+    }
+  }
+  stream.write(data.data(), data.size());
+  return static_cast<bool>(stream);
+}
+
+/* -------------------------------------------------------------------------- */
+bool MeshStreamWriter::readBinaryPly(const std::string& filename,
+                                     MeshStreamBuffer* mesh) {
+  CHECK_NOTNULL(mesh)->clear();
+  std::ifstream stream(filename, std::ios::in | std::ios::binary);
+  if (!stream) {
+    LOG(ERROR) << "Could not open mesh file: " << filename;
+    return false;
+  }
+  // Only the layout written by writeBinaryPly is supported.
+  size_t nr_vertices = 0u;
+  size_t nr_faces = 0u;
+  bool is_binary = false;
+  std::string line;
+  while (std::getline(stream, line) && line != "end_header") {
+    std::istringstream line_stream(line);
+    std::string keyword, name;
+    line_stream >> keyword >> name;
+    if (keyword == "format") {
+      is_binary = name == "binary_little_endian";
+    } else if (keyword == "comment" && name == "Mesh") {
+      const size_t timestamp_pos = line.rfind(' ');
+      mesh->timestamp_ = std::stoll(line.substr(timestamp_pos + 1u));
+    } else if (keyword == "element" && name == "vertex") {
+      line_stream >> nr_vertices;
+    } else if (keyword == "element" && name == "face") {
+      line_stream >> nr_faces;
+    }
+  }
+  if (!stream || !is_binary) {
+    LOG(ERROR) << "Not a binary ply file: " << filename;
+    return false;
+  }
+  mesh->vertices_.resize(3u * nr_vertices);
+  mesh->colors_.resize(3u * nr_vertices);
+  for (size_t i = 0u; i < nr_vertices; i++) {
+    for (size_t j = 0u; j < 3u; j++) {
+      readBinary(&stream, &mesh->vertices_[3u * i + j]);
+    }
+    for (size_t j = 0u; j < 3u; j++) {
+      readBinary(&stream, &mesh->colors_[3u * i + j]);
+    }
+  }
+  mesh->faces_.resize(3u * nr_faces);
+  for (size_t i = 0u; i < nr_faces; i++) {
+    uint8_t polygon_dimension = 0u;
+    if (!readBinary(&stream, &polygon_dimension) || polygon_dimension != 3u) {
+      LOG(ERROR) << "Not a triangle mesh: " << filename;
+      return false;
+    }
+    for (size_t j = 0u; j < 3u; j++) {
+      int32_t vertex_id = 0;
+      readBinary(&stream, &vertex_id);
+      if (vertex_id < 0 || static_cast<size_t>(vertex_id) >= nr_vertices) {
+        LOG(ERROR) << "Corrupted mesh file: " << filename;
+        return false;
+      }
+      mesh->faces_[3u * i + j] = static_cast<uint32_t>(vertex_id);
+    }
+  }
+  if (!stream) {
+    LOG(ERROR) << "Truncated mesh file: " << filename;
+    return false;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool MeshStreamWriter::readDeltaStream(const std::string& filename,
+                                       std::vector<MeshStreamBuffer>* meshes) {
+  CHECK_NOTNULL(meshes)->clear();
+  std::ifstream stream(filename, std::ios::in | std::ios::binary);
+  if (!stream) {
+    LOG(ERROR) << "Could not open mesh stream: " << filename;
+    return false;
+  }
+  char magic[sizeof(kDeltaMagic)];
+  stream.read(magic, sizeof(magic));
+  if (!stream || !std::equal(magic, magic + sizeof(magic), kDeltaMagic)) {
+    LOG(ERROR) << "Not a mesh stream: " << filename;
+    return false;
+  }
+
+  MeshStreamBuffer mesh;
+  std::set<Face> faces;
+  std::vector<char> record;
+  uint32_t record_length = 0u;
+  while (readBinary(&stream, &record_length)) {
+    if (record_length > kMaxRecordLength) {
+      LOG(ERROR) << "Corrupted mesh stream: " << filename;
+      return false;
+    }
+    record.resize(record_length);
+    stream.read(record.data(), record_length);
+    if (!stream) {
+      // The writer was stopped in the middle of a record.
+      LOG(WARNING) << "Truncated last record in mesh stream: " << filename;
+      break;
+    }
+
+    size_t offset = 0u;
+    uint32_t nr_vertices = 0u;
+    uint32_t nr_changed = 0u;
+    bool success = parseBinary(record, &offset, &mesh.timestamp_) &&
+                   parseBinary(record, &offset, &nr_vertices) &&
+                   parseBinary(record, &offset, &nr_changed);
+    mesh.vertices_.resize(3u * nr_vertices, 0.0f);
+    mesh.colors_.resize(3u * nr_vertices, 255u);
+    for (uint32_t i = 0u; success && i < nr_changed; i++) {
+      uint32_t vertex_id = 0u;
+      success = parseBinary(record, &offset, &vertex_id) &&
+                vertex_id < nr_vertices;
+      for (size_t j = 0u; success && j < 3u; j++) {
+        success = parseBinary(
+            record, &offset, &mesh.vertices_[3u * vertex_id + j]);
+      }
+      for (size_t j = 0u; success && j < 3u; j++) {
+        success =
+            parseBinary(record, &offset, &mesh.colors_[3u * vertex_id + j]);
+      }
+    }
+    for (const bool is_added : {false, true}) {
+      uint32_t nr_faces = 0u;
+      success = success && parseBinary(record, &offset, &nr_faces);
+      for (uint32_t i = 0u; success && i < nr_faces; i++) {
+        Face face;
+        success = parseBinary(record, &offset, &face[0]) &&
+                  parseBinary(record, &offset, &face[1]) &&
+                  parseBinary(record, &offset, &face[2]);
+        if (!success) break;
+        if (is_added) {
+          faces.insert(face);
+        } else {
+          faces.erase(face);
+        }
+      }
+    }
+    if (!success) {
+      LOG(ERROR) << "Corrupted mesh stream: " << filename;
+      return false;
+    }
+
+    // Faces of removed vertices are removed in the same record.
+    mesh.faces_.clear();
+    mesh.faces_.reserve(3u * faces.size());
+    for (const Face& face : faces) {
+      if (face[0] >= nr_vertices || face[1] >= nr_vertices ||
+          face[2] >= nr_vertices) {
+        LOG(ERROR) << "Corrupted mesh stream: " << filename;
+        return false;
+      }
+      mesh.faces_.insert(mesh.faces_.end(), face.begin(), face.end());
+    }
+    meshes->push_back(mesh);
+  }
+  return true;
+}
+
+}  // namespace VIO
@@ -0,0 +1,297 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryOrbVocabulary.cpp
+ * @brief  Compact binary format for the ORB vocabulary, loaded with mmap, and
+ * an OrbDatabase that shares its vocabulary instead of copying it.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+// OrbVocabulary that owns the descriptors of its nodes.
+class DeepCopyOrbVocabulary : public OrbVocabulary {
+ public:
+  explicit DeepCopyOrbVocabulary(const OrbVocabulary& vocabulary)
+      : OrbVocabulary(vocabulary) {
+    for (Node& node : m_nodes) {
+      node.descriptor = node.descriptor.clone();
+    }
+  }
+};
+}  // namespace
+
+constexpr char BinaryOrbVocabulary::kMagic[8];
+constexpr uint32_t BinaryOrbVocabulary::kVersion;
+
+/* ------------------------------------------------------------------------ */
+BinaryOrbVocabulary::~BinaryOrbVocabulary() {
+  // The nodes only hold headers to the mapped memory, no need to clear them.
+  unmap();
+}
+
+/* ------------------------------------------------------------------------ */
+bool BinaryOrbVocabulary::loadBinary(const std::string& filepath) {
+  // Nodes may point to the previous mapping.
+  m_words.clear();
+  m_nodes.clear();
+  unmap();
+
+  const int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open binary vocabulary: " << filepath;
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < sizeof(Header)) {
+    LOG(ERROR) << "Binary vocabulary is too small: " << filepath;
+    close(fd);
+    return false;
+  }
+  mapped_size_ = static_cast<size_t>(file_stat.st_size);
+  mapped_data_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after closing the file.
+  close(fd);
+  if (mapped_data_ == MAP_FAILED) {
+    LOG(ERROR) << "Could not map binary vocabulary: " << filepath;
+    mapped_data_ = nullptr;
+    mapped_size_ = 0u;
+    return false;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(mapped_data_);
+
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    LOG(ERROR) << "Not a binary vocabulary (or wrong version): " << filepath;
+    unmap();
+    return false;
+  }
+  const uint64_t nodes_offset = sizeof(Header);
+  const uint64_t words_offset =
+      nodes_offset + uint64_t(header.nr_nodes) * sizeof(NodeRecord);
+  const uint64_t descriptors_offset =
+      words_offset + uint64_t(header.nr_words) * sizeof(uint32_t);
+  const uint64_t expected_size =
+      descriptors_offset +
+      uint64_t(header.nr_nodes) * uint64_t(header.descriptor_bytes);
+  if (header.nr_nodes == 0u || expected_size > mapped_size_) {
+    LOG(ERROR) << "Binary vocabulary is truncated: " << filepath;
+    unmap();
+    return false;
+  }
+
+  m_k = header.k;
+  m_L = header.L;
+  m_weighting = static_cast<DBoW2::WeightingType>(header.weighting);
+  m_scoring = static_cast<DBoW2::ScoringType>(header.scoring);
+  createScoringObject();
+
+  const NodeRecord* node_records =
+      reinterpret_cast<const NodeRecord*>(data + nodes_offset);
+  uint8_t* descriptors =
+      const_cast<uint8_t*>(data) + static_cast<size_t>(descriptors_offset);
+  m_nodes.resize(header.nr_nodes);
+  for (uint32_t i = 0u; i < header.nr_nodes; i++) {
+    Node& node = m_nodes[i];
+    node.id = i;
+    node.weight = node_records[i].weight;
+    node.parent = node_records[i].parent;
+    node.word_id = node_records[i].word_id;
+    // The root has no parent nor descriptor.
+    if (i == 0u) continue;
+    if (node.parent >= header.nr_nodes) {
+      LOG(ERROR) << "Wrong parent for node " << i << " in: " << filepath;
+      m_nodes.clear();
+      unmap();
+      return false;
+    }
+    m_nodes[node.parent].children.push_back(i);
+    // Read-only view of the mapped file, no copy.
+    uint8_t* descriptor = descriptors + size_t(i) * header.descriptor_bytes;
+    node.descriptor = DBoW2::FORB::TDescriptor(
+        1, header.descriptor_bytes, CV_8U, descriptor);
+  }
+
+  const uint32_t* word_nodes =
+      reinterpret_cast<const uint32_t*>(data + words_offset);
+  m_words.resize(header.nr_words);
+  for (uint32_t word_id = 0u; word_id < header.nr_words; word_id++) {
+    if (word_nodes[word_id] >= header.nr_nodes) {
+      LOG(ERROR) << "Wrong node for word " << word_id << " in: " << filepath;
+      m_words.clear();
+      m_nodes.clear();
+      unmap();
+      return false;
+    }
+    m_words[word_id] = &m_nodes[word_nodes[word_id]];
+  }
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+bool BinaryOrbVocabulary::saveBinary(const OrbVocabulary& vocabulary,
+                                     const std::string& filepath) {
+  // Copy to be able to access the nodes, this is a one-time conversion.
+  BinaryOrbVocabulary voc;
+  static_cast<OrbVocabulary&>(voc) = vocabulary;
+  CHECK(!voc.m_nodes.empty()) << "Cannot save an empty vocabulary.";
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.k = voc.m_k;
+  header.L = voc.m_L;
+  header.weighting = static_cast<int32_t>(voc.m_weighting);
+  header.scoring = static_cast<int32_t>(voc.m_scoring);
+  header.nr_nodes = voc.m_nodes.size();
+  header.nr_words = voc.m_words.size();
+  header.descriptor_bytes = 0u;
+  if (voc.m_nodes.size() > 1u) {
+    // All nodes but the root have a descriptor of the same size.
+    const DBoW2::FORB::TDescriptor& descriptor = voc.m_nodes[1].descriptor;
+    header.descriptor_bytes = descriptor.total() * descriptor.elemSize();
+  }
+
+  std::ofstream output(filepath, std::ios::binary | std::ios::trunc);
+  if (!output.good()) {
+    LOG(ERROR) << "Could not open for writing: " << filepath;
+    return false;
+  }
+  output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  for (const Node& node : voc.m_nodes) {
+    NodeRecord record;
+    record.weight = node.weight;
+    record.parent = node.parent;
+    record.word_id = node.word_id;
+    output.write(reinterpret_cast<const char*>(&record), sizeof(NodeRecord));
+  }
+  for (const Node* word : voc.m_words) {
+    CHECK_NOTNULL(word);
+    const uint32_t node_id = word->id;
+    output.write(reinterpret_cast<const char*>(&node_id), sizeof(uint32_t));
+  }
+  const std::vector<char> zeros(header.descriptor_bytes, 0);
+  for (size_t i = 0u; i < voc.m_nodes.size(); i++) {
+    const DBoW2::FORB::TDescriptor& descriptor = voc.m_nodes[i].descriptor;
+    if (i == 0u) {
+      output.write(zeros.data(), zeros.size());
+      continue;
+    }
+    CHECK(descriptor.isContinuous());
+    CHECK_EQ(descriptor.total() * descriptor.elemSize(),
+             header.descriptor_bytes);
+    output.write(reinterpret_cast<const char*>(descriptor.data),
+                 header.descriptor_bytes);
+  }
+  return output.good();
+}
+
+/* ------------------------------------------------------------------------ */
+bool BinaryOrbVocabulary::isBinaryFile(const std::string& filepath) {
+  std::ifstream input(filepath, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  if (!input.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+/* ------------------------------------------------------------------------ */
+void BinaryOrbVocabulary::unmap() {
+  if (mapped_data_) {
+    munmap(mapped_data_, mapped_size_);
+    mapped_data_ = nullptr;
+    mapped_size_ = 0u;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+SharedVocabularyOrbDatabase::SharedVocabularyOrbDatabase(
+    const std::shared_ptr<const OrbVocabulary>& vocabulary,
+    bool use_di,
+    int di_levels)
+    : OrbDatabase(use_di, di_levels), vocabulary_(vocabulary) {
+  CHECK(vocabulary_);
+  // The database never modifies its vocabulary, only setVocabulary would.
+  m_voc = const_cast<OrbVocabulary*>(vocabulary_.get());
+  clear();
+}
+
+/* ------------------------------------------------------------------------ */
+SharedVocabularyOrbDatabase::SharedVocabularyOrbDatabase(
+    const std::shared_ptr<const OrbVocabulary>& vocabulary,
+    const OrbDatabase& db)
+    : OrbDatabase(db), vocabulary_(vocabulary) {
+  CHECK(vocabulary_);
+  CHECK_EQ(vocabulary_->size(), m_voc->size());
+  // Replace the shallow copy of the vocabulary of db, keeping the entries.
+  delete m_voc;
+  m_voc = const_cast<OrbVocabulary*>(vocabulary_.get());
+}
+
+/* ------------------------------------------------------------------------ */
+SharedVocabularyOrbDatabase::~SharedVocabularyOrbDatabase() {
+  // Owned by vocabulary_, do not let OrbDatabase delete it.
+  m_voc = nullptr;
+}
+
+/* ------------------------------------------------------------------------ */
+void SharedVocabularyOrbDatabase::getBowVectors(
+    std::vector<DBoW2::BowVector>* bow_vecs) const {
+  CHECK_NOTNULL(bow_vecs);
+  bow_vecs->clear();
+  bow_vecs->resize(m_nentries);
+  // Words are visited in increasing order, so they are appended at the end.
+  for (size_t word_id = 0u; word_id < m_ifile.size(); word_id++) {
+    for (const auto& posting : m_ifile[word_id]) {
+      DBoW2::BowVector& bow_vec = bow_vecs->at(posting.entry_id);
+      bow_vec.emplace_hint(bow_vec.end(),
+                           static_cast<DBoW2::WordId>(word_id),
+                           posting.word_weight);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+std::shared_ptr<const OrbVocabulary> loadOrbVocabulary(
+    const std::string& filepath) {
+  if (BinaryOrbVocabulary::isBinaryFile(filepath)) {
+    std::shared_ptr<BinaryOrbVocabulary> vocabulary =
+        std::make_shared<BinaryOrbVocabulary>();
+    CHECK(vocabulary->loadBinary(filepath))
+        << "Could not load binary vocabulary: " << filepath;
+    return vocabulary;
+  }
+  std::shared_ptr<OrbVocabulary> vocabulary = std::make_shared<OrbVocabulary>();
+  vocabulary->load(filepath);
+  return vocabulary;
+}
+
+/* ------------------------------------------------------------------------ */
+std::shared_ptr<const OrbVocabulary> copyOrbVocabulary(
+    const OrbVocabulary& vocabulary) {
+  return std::make_shared<DeepCopyOrbVocabulary>(vocabulary);
+}
+
+}  // namespace VIO
@@ -0,0 +1,151 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LcdSnapshot.cpp
+ * @brief  Binary snapshot files of the loop closure state: a sequential writer
+ * and a reader that memory-maps the whole file.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/LcdSnapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+SnapshotWriter::SnapshotWriter(const std::string& filepath)
+    : filepath_(filepath),
+      tmp_filepath_(filepath + ".tmp"),
+      output_(tmp_filepath_, std::ios::binary | std::ios::trunc),
+      committed_(false) {
+  if (!output_.good()) {
+    LOG(ERROR) << "Could not open snapshot for writing: " << tmp_filepath_;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+SnapshotWriter::~SnapshotWriter() {
+  if (!committed_) {
+    output_.close();
+    std::remove(tmp_filepath_.c_str());
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+bool SnapshotWriter::commit() {
+  CHECK(!committed_);
+  output_.close();
+  if (output_.fail()) {
+    LOG(ERROR) << "Could not write snapshot: " << tmp_filepath_;
+    return false;
+  }
+  // Atomic: readers of the previous snapshot keep their mapping of it.
+  if (std::rename(tmp_filepath_.c_str(), filepath_.c_str()) != 0) {
+    LOG(ERROR) << "Could not rename snapshot " << tmp_filepath_ << " to "
+               << filepath_;
+    return false;
+  }
+  committed_ = true;
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+void SnapshotWriter::writeBytes(const void* data, size_t size) {
+  if (size == 0u) return;
+  output_.write(static_cast<const char*>(data), size);
+}
+
+/* ------------------------------------------------------------------------ */
+void SnapshotWriter::writePose(const gtsam::Pose3& pose) {
+  const gtsam::Matrix3 R = pose.rotation().matrix();
+  const gtsam::Point3& t = pose.translation();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      write(static_cast<double>(R(i, j)));
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    write(static_cast<double>(t(i)));
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+SnapshotReader::~SnapshotReader() { unmap(); }
+
+/* ------------------------------------------------------------------------ */
+bool SnapshotReader::open(const std::string& filepath) {
+  unmap();
+
+  const int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open snapshot: " << filepath;
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    LOG(ERROR) << "Empty snapshot: " << filepath;
+    close(fd);
+    return false;
+  }
+  mapped_size_ = static_cast<size_t>(file_stat.st_size);
+  mapped_data_ = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after closing the file.
+  close(fd);
+  if (mapped_data_ == MAP_FAILED) {
+    LOG(ERROR) << "Could not map snapshot: " << filepath;
+    mapped_data_ = nullptr;
+    mapped_size_ = 0u;
+    return false;
+  }
+  offset_ = 0u;
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+const uint8_t* SnapshotReader::readBytes(size_t size) {
+  if (!mapped_data_ || size > remaining()) return nullptr;
+  const uint8_t* data = static_cast<const uint8_t*>(mapped_data_) + offset_;
+  offset_ += size;
+  return data;
+}
+
+/* ------------------------------------------------------------------------ */
+bool SnapshotReader::readPose(gtsam::Pose3* pose) {
+  CHECK_NOTNULL(pose);
+  double values[12];
+  for (double& value : values) {
+    if (!read(&value)) return false;
+  }
+  gtsam::Matrix3 R;
+  R << values[0], values[1], values[2], values[3], values[4], values[5],
+      values[6], values[7], values[8];
+  *pose = gtsam::Pose3(gtsam::Rot3(R),
+                       gtsam::Point3(values[9], values[10], values[11]));
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+void SnapshotReader::unmap() {
+  if (mapped_data_) {
+    munmap(mapped_data_, mapped_size_);
+    mapped_data_ = nullptr;
+  }
+  mapped_size_ = 0u;
+  offset_ = 0u;
+}
+
+}  // namespace VIO
@@ -15,14 +15,23 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
 #include <opengv/point_cloud/PointCloudAdapter.hpp>
 #include <opengv/relative_pose/CentralRelativeAdapter.hpp>
 #include <opengv/sac/Ransac.hpp>
@@ -32,6 +41,10 @@
 #include <KimeraRPGO/RobustSolver.h>
 
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+#include "kimera-vio/loopclosure/ShardedBowDatabase.h"
+#include "kimera-vio/utils/HammingMatcher.h"
+#include "kimera-vio/utils/MemoryUsage.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
@@ -39,6 +52,14 @@
 DEFINE_string(vocabulary_path,
               "../vocabulary/ORBvoc.yml",
               "Path to BoW vocabulary file for LoopClosureDetector module.");
+DEFINE_string(lcd_load_snapshot_path,
+              "",
+              "Path to a LoopClosureDetector snapshot of a previous session to "
+              "relocalize against. Empty to start from scratch.");
+DEFINE_string(lcd_save_snapshot_path,
+              "",
+              "Path where to save a snapshot of the LoopClosureDetector at "
+              "shutdown. Empty to not save it.");
 
 /** Verbosity settings: (cumulative with every increase in level)
       0: Runtime errors and warnings, spin start and frequency are reported.
@@ -66,6 +87,10 @@ LoopClosureDetector::LoopClosureDetector(
       B_Pose_camLrect_(),
       pgo_(nullptr),
       W_Pose_Blkf_estimates_(),
+      pgo_trajectory_(std::make_shared<PgoTrajectory>()),
+      new_pgo_factors_(),
+      pending_odom_factors_(),
+      pending_odom_values_(),
       logger_(nullptr) {
   // TODO(marcus): This should come in with every input payload, not be
   // constant.
@@ -84,6 +109,25 @@ LoopClosureDetector::LoopClosureDetector(
                                           lcd_params_.patch_sze_,
                                           lcd_params_.fast_threshold_);
 
+  // One ORB detector per tile, so that tiles can be processed in parallel.
+  const int nr_tiles = lcd_params_.orb_grid_rows_ * lcd_params_.orb_grid_cols_;
+  if (nr_tiles > 1) {
+    const int nfeatures_per_tile =
+        (lcd_params_.nfeatures_ + nr_tiles - 1) / nr_tiles;
+    for (int i = 0; i < nr_tiles; i++) {
+      orb_tile_feature_detectors_.push_back(
+          cv::ORB::create(nfeatures_per_tile,
+                          lcd_params_.scale_factor_,
+                          lcd_params_.nlevels_,
+                          lcd_params_.edge_threshold_,
+                          lcd_params_.first_level_,
+                          lcd_params_.WTA_K_,
+                          lcd_params_.score_type_,
+                          lcd_params_.patch_sze_,
+                          lcd_params_.fast_threshold_));
+    }
+  }
+
   // Initialize our feature matching object:
   orb_feature_matcher_ =
       cv::DescriptorMatcher::create(lcd_params_.matcher_type_);
@@ -94,17 +138,20 @@ LoopClosureDetector::LoopClosureDetector(
                         << FLAGS_vocabulary_path;
   f_vocab.close();
 
-  OrbVocabulary vocab;
   LOG(INFO) << "LoopClosureDetector:: Loading vocabulary from "
             << FLAGS_vocabulary_path;
-  vocab.load(FLAGS_vocabulary_path);
-  LOG(INFO) << "Loaded vocabulary with " << vocab.size() << " visual words.";
+  auto tic = utils::Timer::tic();
+  std::shared_ptr<const OrbVocabulary> vocab =
+      loadOrbVocabulary(FLAGS_vocabulary_path);
+  LOG(INFO) << "Loaded vocabulary with " << vocab->size() << " visual words in "
+            << utils::Timer::toc(tic).count() << " ms.";
 
   // Initialize the thirdparty wrapper:
   lcd_tp_wrapper_ = VIO::make_unique<LcdThirdPartyWrapper>(lcd_params_);
 
-  // Initialize db_BoW_:
-  db_BoW_ = VIO::make_unique<OrbDatabase>(vocab);
+  // Initialize db_BoW_, sharing the vocabulary instead of copying it:
+  db_BoW_ = VIO::make_unique<SharedVocabularyOrbDatabase>(vocab);
+  initializeShardedDatabase();
 
   // Initialize pgo_:
   // TODO(marcus): parametrize the verbosity of PGO params
@@ -115,14 +162,74 @@ LoopClosureDetector::LoopClosureDetector(
   pgo_ = VIO::make_unique<KimeraRPGO::RobustSolver>(pgo_params);
 
   if (log_output) logger_ = VIO::make_unique<LoopClosureDetectorLogger>();
+
+  if (!FLAGS_lcd_load_snapshot_path.empty()) {
+    CHECK(loadSnapshot(FLAGS_lcd_load_snapshot_path))
+        << "LoopClosureDetector: could not load snapshot: "
+        << FLAGS_lcd_load_snapshot_path;
+  }
 }
 
 LoopClosureDetector::~LoopClosureDetector() {
   LOG(INFO) << "LoopClosureDetector desctuctor called.";
+  if (!FLAGS_lcd_save_snapshot_path.empty() && !db_frames_.empty()) {
+    if (!saveSnapshot(FLAGS_lcd_save_snapshot_path)) {
+      LOG(ERROR) << "LoopClosureDetector: could not save snapshot: "
+                 << FLAGS_lcd_save_snapshot_path;
+    }
+  }
 }
 
 /* ------------------------------------------------------------------------ */
 LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
+  return processKeyframe(input, true);
+}
+
+/* ------------------------------------------------------------------------ */
+LcdOutput::UniquePtr LoopClosureDetector::spinOnceWithoutDetection(
+    const LcdInput& input) {
+  return processKeyframe(input, false);
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::shouldDetectLoop(const LcdInput& input,
+                                           size_t nr_queued_keyframes) const {
+  if (lcd_params_.gating_max_queue_size_ > 0 &&
+      nr_queued_keyframes >
+          static_cast<size_t>(lcd_params_.gating_max_queue_size_)) {
+    VLOG(2) << "LoopClosureDetector: " << nr_queued_keyframes
+            << " keyframes queued, skipping loop detection.";
+    return false;
+  }
+
+  const bool gate_translation = lcd_params_.gating_min_translation_ > 0.0;
+  const bool gate_rotation = lcd_params_.gating_min_rotation_ > 0.0;
+  if (!gate_translation && !gate_rotation) return true;
+  // Poses of a previous session are in another odometry frame.
+  if (last_detection_frame_ < 0) return true;
+
+  // The estimates are the backend poses, in the same frame as the input.
+  const gtsam::Pose3& W_Pose_Blast =
+      W_Pose_Blkf_estimates_.at(last_detection_frame_);
+  const gtsam::Pose3 Blast_Pose_Bcur =
+      W_Pose_Blast.between(input.W_Pose_Blkf_);
+  if (gate_translation && Blast_Pose_Bcur.translation().norm() >=
+                              lcd_params_.gating_min_translation_) {
+    return true;
+  }
+  if (gate_rotation && Blast_Pose_Bcur.rotation().axisAngle().second >=
+                           lcd_params_.gating_min_rotation_) {
+    return true;
+  }
+  VLOG(2) << "LoopClosureDetector: keyframe too close to keyframe "
+          << last_detection_frame_ << ", skipping loop detection.";
+  return false;
+}
+
+/* ------------------------------------------------------------------------ */
+LcdOutput::UniquePtr LoopClosureDetector::processKeyframe(
+    const LcdInput& input,
+    bool detect_loop) {
   // One time initialization from camera parameters.
   if (!set_intrinsics_) {
     setIntrinsics(input.stereo_frame_);
@@ -130,26 +237,42 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
   CHECK_EQ(set_intrinsics_, true);
   CHECK_GT(input.cur_kf_id_, 0);
 
+  // Keyframes are numbered after the ones restored from a snapshot, if any.
+  const FrameId cur_kf_id = input.cur_kf_id_ + kf_id_offset_;
+
   // Update the PGO with the backend VIO estimate.
   // TODO(marcus): only add factor if it's a set distance away from previous
   // TODO(marcus): OdometryPose vs OdometryFactor
-  timestamp_map_[input.cur_kf_id_ - 1] = input.timestamp_kf_;
+  timestamp_map_[cur_kf_id - 1] = input.timestamp_kf_;
   OdometryFactor odom_factor(
-      input.cur_kf_id_, input.W_Pose_Blkf_, shared_noise_model_);
+      cur_kf_id, input.W_Pose_Blkf_, shared_noise_model_);
 
   // Initialize PGO with first frame if needed.
   if (odom_factor.cur_key_ == 1) {
     initializePGO(odom_factor);
   }
 
-  // TODO(marcus): need a better check than this:
-  CHECK_GT(pgo_->calculateEstimate().size(), 0);
-  addOdometryFactorAndOptimize(odom_factor);
+  // Do not check the values of the PGO, that would copy them all.
+  CHECK(!pgo_trajectory_->empty());
+  if (kf_id_offset_ > 0u && input.cur_kf_id_ == 1) {
+    addSessionBridgeFactor(odom_factor);
+  } else {
+    addOdometryFactorAndOptimize(odom_factor);
+  }
 
   // Process the StereoFrame and check for a loop closure with previous ones.
   LoopResult loop_result;
-  // Try to find a loop and update the PGO with the result if available.
-  if (detectLoop(input.stereo_frame_, &loop_result)) {
+  bool is_loop = false;
+  if (detect_loop) {
+    is_loop = detectLoop(input.stereo_frame_, &loop_result);
+    last_detection_frame_ = loop_result.query_id_;
+  } else {
+    loop_result.query_id_ = addFrameWithoutFeatures(input.stereo_frame_);
+    loop_result.status_ = LCDStatus::SKIPPED_KEYFRAME;
+  }
+
+  // Update the PGO with the loop closure if available.
+  if (is_loop) {
     LoopClosureFactor lc_factor(loop_result.match_id_,
                                 loop_result.query_id_,
                                 loop_result.relative_pose_,
@@ -178,11 +301,13 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
   CHECK_EQ(timestamp_map_.size(), db_frames_.size());
   CHECK_EQ(timestamp_map_.size(), W_Pose_Blkf_estimates_.size());
 
+  if (lcd_params_.bounded_memory_) {
+    releaseOldFrameFeatures();
+  }
+
   // Construct output payload.
   CHECK(pgo_);
   const gtsam::Pose3& w_Pose_map = getWPoseMap();
-  const gtsam::Values& pgo_states = pgo_->calculateEstimate();
-  const gtsam::NonlinearFactorGraph& pgo_nfg = pgo_->getFactorsUnsafe();
 
   LcdOutput::UniquePtr output_payload;
   if (loop_result.isLoop()) {
@@ -195,15 +320,34 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
                                     loop_result.query_id_,
                                     loop_result.relative_pose_,
                                     w_Pose_map,
-                                    pgo_states,
-                                    pgo_nfg);
+                                    pgo_->calculateEstimate(),
+                                    pgo_->getFactorsUnsafe());
   } else {
     output_payload = VIO::make_unique<LcdOutput>();
     output_payload->W_Pose_Map_ = w_Pose_map;
-    output_payload->states_ = pgo_states;
-    output_payload->nfg_ = pgo_nfg;
+    // Copying the whole PGO grows with the length of the trajectory, only
+    // do it if the full PGO is requested at every keyframe.
+    if (!lcd_params_.incremental_output_) {
+      output_payload->states_ = getPGOTrajectory();
+      output_payload->nfg_ = getPGOnfg();
+    }
   }
   CHECK(output_payload) << "Missing LCD output payload.";
+  if (lcd_params_.incremental_output_) {
+    output_payload->trajectory_ = pgo_trajectory_;
+    output_payload->new_factors_ = new_pgo_factors_;
+  }
+  new_pgo_factors_ = gtsam::NonlinearFactorGraph();
+
+  // Memory accounting.
+  utils::StatsCollector stats_frames_memory("LCD Frames Memory [MB]");
+  utils::StatsCollector stats_bow_db_size("LCD BoW Database Size [#]");
+  utils::StatsCollector stats_pgo_size("LCD PGO Size [#]");
+  stats_frames_memory.AddSample(
+      utils::MemoryUsage::BytesToMegaBytes(db_frames_memory_bytes_));
+  stats_bow_db_size.AddSample(sharded_db_BoW_ ? sharded_db_BoW_->size()
+                                              : db_BoW_->size());
+  stats_pgo_size.AddSample(pgo_->size());
 
   if (logger_) {
     debug_info_.timestamp_ = output_payload->timestamp_kf_;
@@ -228,35 +372,106 @@ FrameId LoopClosureDetector::processAndAddFrame(
   OrbDescriptorVec descriptors_vec;
 
   // Extract ORB features and construct descriptors_vec.
-  orb_feature_detector_->detectAndCompute(
-      stereo_frame.getLeftFrame().img_, cv::Mat(), keypoints, descriptors_mat);
-
-  int L = orb_feature_detector_->descriptorSize();
-  descriptors_vec.resize(descriptors_mat.size().height);
+  utils::StatsCollector stats_orb_extraction("LCD ORB Extraction Timing [ms]");
+  auto tic = utils::Timer::tic();
+  if (lcd_params_.use_frontend_keypoints_) {
+    computeOrbOnFrontendKeypoints(
+        stereo_frame.getLeftFrame(), &keypoints, &descriptors_mat);
+  } else if (!orb_tile_feature_detectors_.empty()) {
+    detectAndComputeOrbInTiles(
+        stereo_frame.getLeftFrame().img_, &keypoints, &descriptors_mat);
+  } else {
+    orb_feature_detector_->detectAndCompute(stereo_frame.getLeftFrame().img_,
+                                            cv::Mat(),
+                                            keypoints,
+                                            descriptors_mat);
+  }
+  stats_orb_extraction.AddSample(utils::Timer::toc(tic).count());
 
-  for (size_t i = 0; i < descriptors_vec.size(); i++) {
-    descriptors_vec[i] = cv::Mat(1, L, descriptors_mat.type());  // one row only
-    descriptors_mat.row(i).copyTo(descriptors_vec[i].row(0));
+  // Row views of the contiguous descriptor matrix, no copies.
+  CHECK(descriptors_mat.empty() || descriptors_mat.isContinuous());
+  descriptors_vec.reserve(descriptors_mat.rows);
+  for (int i = 0; i < descriptors_mat.rows; i++) {
+    descriptors_vec.push_back(descriptors_mat.row(i));
   }
 
-  // Fill StereoFrame with ORB keypoints and perform stereo matching.
-  StereoFrame cp_stereo_frame(stereo_frame);
-  rewriteStereoFrameFeatures(keypoints, &cp_stereo_frame);
+  // Stereo-match the ORB keypoints with the frontend's matcher, reading the
+  // rectified images of the frame instead of copying it.
+  utils::StatsCollector stats_stereo_matching(
+      "LCD Stereo Matching Timing [ms]");
+  tic = utils::Timer::tic();
+  const Frame& left_frame = stereo_frame.getLeftFrame();
+  KeypointsCV left_keypoints;
+  BearingVectors versors;
+  left_keypoints.reserve(keypoints.size());
+  versors.reserve(keypoints.size());
+  for (const cv::KeyPoint& keypoint : keypoints) {
+    left_keypoints.push_back(keypoint.pt);
+    versors.push_back(
+        Frame::calibratePixel(keypoint.pt, left_frame.cam_param_));
+  }
+  std::vector<gtsam::Vector3> keypoints_3d;
+  stereo_frame.sparseStereoMatching(left_keypoints, versors, &keypoints_3d);
+  stats_stereo_matching.AddSample(utils::Timer::toc(tic).count());
 
   // Build and store LCDFrame object.
-  db_frames_.push_back(LCDFrame(cp_stereo_frame.getTimestamp(),
+  db_frames_.push_back(LCDFrame(stereo_frame.getTimestamp(),
                                 db_frames_.size(),
-                                cp_stereo_frame.getFrameId(),
+                                stereo_frame.getFrameId(),
                                 keypoints,
-                                cp_stereo_frame.keypoints_3d_,
+                                keypoints_3d,
                                 descriptors_vec,
                                 descriptors_mat,
-                                cp_stereo_frame.getLeftFrame().versors_));
+                                versors));
+
+  // Create BOW representation of descriptors, and keep track of the nodes
+  // of each descriptor if they are used for matching.
+  LCDFrame& lcd_frame = db_frames_.back();
+  DCHECK(db_BoW_);
+  if (lcd_params_.use_bow_guided_matching_) {
+    db_BoW_->getVocabulary()->transform(lcd_frame.descriptors_vec_,
+                                        lcd_frame.bow_vec_,
+                                        lcd_frame.feature_vec_,
+                                        lcd_params_.bow_matching_levels_up_);
+  } else {
+    db_BoW_->getVocabulary()->transform(lcd_frame.descriptors_vec_,
+                                        lcd_frame.bow_vec_);
+  }
+  db_frames_memory_bytes_ += lcd_frame.getMemoryFootprint();
 
   CHECK(!db_frames_.empty());
   return db_frames_.back().id_;
 }
 
+/* ------------------------------------------------------------------------ */
+FrameId LoopClosureDetector::addFrameWithoutFeatures(
+    const StereoFrame& stereo_frame) {
+  db_frames_.push_back(LCDFrame(stereo_frame.getTimestamp(),
+                                db_frames_.size(),
+                                stereo_frame.getFrameId(),
+                                std::vector<cv::KeyPoint>(),
+                                std::vector<gtsam::Vector3>(),
+                                OrbDescriptorVec(),
+                                OrbDescriptor(),
+                                BearingVectors()));
+  const LCDFrame& lcd_frame = db_frames_.back();
+  db_frames_memory_bytes_ += lcd_frame.getMemoryFootprint();
+
+  // An empty BoW vector never matches, but keeps entry ids equal to frame ids.
+  if (sharded_db_BoW_) {
+    const gtsam::Point3* W_position_ptr = nullptr;
+    gtsam::Point3 W_position;
+    if (pgo_trajectory_->size() == lcd_frame.id_ + 1u) {
+      W_position = pgo_trajectory_->back().translation();
+      W_position_ptr = &W_position;
+    }
+    sharded_db_BoW_->add(lcd_frame.bow_vec_, W_position_ptr);
+  } else {
+    db_BoW_->add(lcd_frame.bow_vec_);
+  }
+  return lcd_frame.id_;
+}
+
 /* ------------------------------------------------------------------------ */
 bool LoopClosureDetector::detectLoop(const StereoFrame& stereo_frame,
                                      LoopResult* result) {
@@ -265,24 +480,39 @@ bool LoopClosureDetector::detectLoop(const StereoFrame& stereo_frame,
   FrameId frame_id = processAndAddFrame(stereo_frame);
   result->query_id_ = frame_id;
 
-  // Create BOW representation of descriptors.
-  DBoW2::BowVector bow_vec;
-  DCHECK(db_BoW_);
-  db_BoW_->getVocabulary()->transform(db_frames_[frame_id].descriptors_vec_,
-                                      bow_vec);
+  // BOW representation of descriptors.
+  const DBoW2::BowVector& bow_vec = db_frames_[frame_id].bow_vec_;
 
   int max_possible_match_id = frame_id - lcd_params_.dist_local_;
   if (max_possible_match_id < 0) max_possible_match_id = 0;
 
-  // Query for BoW vector matches in database.
+  // Query for BoW vector matches in database, and add the current BoW vector
+  // to it.
+  utils::StatsCollector stats_bow_query("LCD BoW Query Timing [ms]");
+  auto tic = utils::Timer::tic();
   DBoW2::QueryResults query_result;
-  db_BoW_->query(bow_vec,
-                 query_result,
-                 lcd_params_.max_db_results_,
-                 max_possible_match_id);
-
-  // Add current BoW vector to database.
-  db_BoW_->add(bow_vec);
+  if (sharded_db_BoW_) {
+    // Only query near the current PGO pose, if the frame is in the PGO.
+    gtsam::Point3 W_position;
+    const gtsam::Point3* W_position_ptr = nullptr;
+    if (pgo_trajectory_->size() == frame_id + 1u) {
+      W_position = pgo_trajectory_->back().translation();
+      W_position_ptr = &W_position;
+    }
+    sharded_db_BoW_->query(bow_vec,
+                           &query_result,
+                           lcd_params_.max_db_results_,
+                           max_possible_match_id,
+                           W_position_ptr);
+    sharded_db_BoW_->add(bow_vec, W_position_ptr);
+  } else {
+    db_BoW_->query(bow_vec,
+                   query_result,
+                   lcd_params_.max_db_results_,
+                   max_possible_match_id);
+    db_BoW_->add(bow_vec);
+  }
+  stats_bow_query.AddSample(utils::Timer::toc(tic).count());
 
   if (query_result.empty()) {
     result->status_ = LCDStatus::NO_MATCHES;
@@ -322,6 +552,10 @@ bool LoopClosureDetector::detectLoop(const StereoFrame& stereo_frame,
           // Find the best island grouping using MatchIsland sorting.
           const MatchIsland& best_island =
               *std::max_element(islands.begin(), islands.end());
+          // The best match of the best island is the one verified, so that
+          // geometric verification and pose recovery share the cached
+          // matches.
+          result->match_id_ = best_island.best_id_;
 
           // Run temporal constraint check on this best island.
           bool pass_temporal_constraint =
@@ -329,11 +563,26 @@ bool LoopClosureDetector::detectLoop(const StereoFrame& stereo_frame,
 
           if (!pass_temporal_constraint) {
             result->status_ = LCDStatus::FAILED_TEMPORAL_CONSTRAINT;
+          } else if (lcd_params_.nr_candidates_to_verify_ > 1) {
+            // Verify the best match of each of the best islands at once.
+            std::vector<MatchIsland> sorted_islands = islands;
+            std::sort(sorted_islands.begin(),
+                      sorted_islands.end(),
+                      std::greater<MatchIsland>());
+            const size_t nr_candidates = std::min(
+                sorted_islands.size(),
+                static_cast<size_t>(lcd_params_.nr_candidates_to_verify_));
+            std::vector<FrameId> candidates;
+            candidates.reserve(nr_candidates);
+            for (size_t i = 0u; i < nr_candidates; i++) {
+              candidates.push_back(sorted_islands[i].best_id_);
+            }
+            verifyCandidates(frame_id, candidates, result);
           } else {
             // Perform geometric verification check.
             gtsam::Pose3 camCur_T_camRef_mono;
             bool pass_geometric_verification = geometricVerificationCheck(
-                frame_id, best_island.best_id_, &camCur_T_camRef_mono);
+                frame_id, result->match_id_, &camCur_T_camRef_mono);
 
             if (!pass_geometric_verification) {
               result->status_ = LCDStatus::FAILED_GEOM_VERIFICATION;
@@ -374,10 +623,54 @@ bool LoopClosureDetector::geometricVerificationCheck(
     const FrameId& match_id,
     gtsam::Pose3* camCur_T_camRef_mono) {
   CHECK_NOTNULL(camCur_T_camRef_mono);
+  // In bounded-memory mode, the features of the match might be gone.
+  if (!db_frames_.at(query_id).hasFeatures() ||
+      !db_frames_.at(match_id).hasFeatures()) {
+    VLOG(2) << "LoopClosureDetector: no features left for frame " << match_id
+            << ", skipping geometric verification.";
+    return false;
+  }
+
+  return geometricVerificationFromMatches(query_id,
+                                          match_id,
+                                          getKnnMatches(query_id, match_id),
+                                          camCur_T_camRef_mono,
+                                          &debug_info_);
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::recoverPose(const FrameId& query_id,
+                                      const FrameId& match_id,
+                                      const gtsam::Pose3& camCur_T_camRef_mono,
+                                      gtsam::Pose3* bodyCur_T_bodyRef_stereo) {
+  CHECK_NOTNULL(bodyCur_T_bodyRef_stereo);
+  if (!db_frames_.at(query_id).hasFeatures() ||
+      !db_frames_.at(match_id).hasFeatures()) {
+    VLOG(2) << "LoopClosureDetector: no features left for frame " << match_id
+            << ", skipping pose recovery.";
+    return false;
+  }
+
+  return recoverPoseFromMatches(query_id,
+                                match_id,
+                                getKnnMatches(query_id, match_id),
+                                camCur_T_camRef_mono,
+                                bodyCur_T_bodyRef_stereo,
+                                &debug_info_);
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::geometricVerificationFromMatches(
+    const FrameId& query_id,
+    const FrameId& match_id,
+    const std::vector<DMatchVec>& matches,
+    gtsam::Pose3* camCur_T_camRef_mono,
+    LcdDebugInfo* debug_info) const {
+  CHECK_NOTNULL(camCur_T_camRef_mono);
   switch (lcd_params_.geom_check_) {
     case GeomVerifOption::NISTER: {
       return geometricVerificationNister(
-          query_id, match_id, camCur_T_camRef_mono);
+          query_id, match_id, matches, camCur_T_camRef_mono, debug_info);
     }
     case GeomVerifOption::NONE: {
       return true;
@@ -392,23 +685,28 @@ bool LoopClosureDetector::geometricVerificationCheck(
 }
 
 /* ------------------------------------------------------------------------ */
-bool LoopClosureDetector::recoverPose(const FrameId& query_id,
-                                      const FrameId& match_id,
-                                      const gtsam::Pose3& camCur_T_camRef_mono,
-                                      gtsam::Pose3* bodyCur_T_bodyRef_stereo) {
+bool LoopClosureDetector::recoverPoseFromMatches(
+    const FrameId& query_id,
+    const FrameId& match_id,
+    const std::vector<DMatchVec>& matches,
+    const gtsam::Pose3& camCur_T_camRef_mono,
+    gtsam::Pose3* bodyCur_T_bodyRef_stereo,
+    LcdDebugInfo* debug_info) const {
   CHECK_NOTNULL(bodyCur_T_bodyRef_stereo);
-
   bool passed_pose_recovery = false;
 
   switch (lcd_params_.pose_recovery_option_) {
     case PoseRecoveryOption::RANSAC_ARUN: {
-      passed_pose_recovery =
-          recoverPoseArun(query_id, match_id, bodyCur_T_bodyRef_stereo);
+      passed_pose_recovery = recoverPoseArun(
+          query_id, match_id, matches, bodyCur_T_bodyRef_stereo, debug_info);
       break;
     }
     case PoseRecoveryOption::GIVEN_ROT: {
-      passed_pose_recovery = recoverPoseGivenRot(
-          query_id, match_id, camCur_T_camRef_mono, bodyCur_T_bodyRef_stereo);
+      passed_pose_recovery = recoverPoseGivenRot(query_id,
+                                                 match_id,
+                                                 matches,
+                                                 camCur_T_camRef_mono,
+                                                 bodyCur_T_bodyRef_stereo);
       break;
     }
     default: {
@@ -438,14 +736,283 @@ bool LoopClosureDetector::recoverPose(const FrameId& query_id,
   return passed_pose_recovery;
 }
 
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::verifyCandidates(
+    const FrameId& query_id,
+    const std::vector<FrameId>& candidates,
+    LoopResult* result) {
+  CHECK_NOTNULL(result);
+  CHECK(!candidates.empty());
+  utils::StatsCollector stats_verification(
+      "LCD Candidate Verification Timing [ms]");
+  auto tic = utils::Timer::tic();
+
+  // Each candidate only writes to its own slot, and only reads the rest.
+  const size_t nr_candidates = candidates.size();
+  std::vector<LCDStatus> statuses(nr_candidates,
+                                  LCDStatus::FAILED_GEOM_VERIFICATION);
+  std::vector<gtsam::Pose3> relative_poses(nr_candidates);
+  std::vector<LcdDebugInfo> debug_infos(nr_candidates, debug_info_);
+  cv::parallel_for_(
+      cv::Range(0, nr_candidates), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+          const FrameId& match_id = candidates[i];
+          if (!db_frames_.at(query_id).hasFeatures() ||
+              !db_frames_.at(match_id).hasFeatures()) {
+            continue;
+          }
+          std::vector<DMatchVec> matches;
+          computeKnnMatches(query_id, match_id, &matches);
+
+          gtsam::Pose3 camCur_T_camRef_mono;
+          if (!geometricVerificationFromMatches(query_id,
+                                                match_id,
+                                                matches,
+                                                &camCur_T_camRef_mono,
+                                                &debug_infos[i])) {
+            continue;
+          }
+          if (!recoverPoseFromMatches(query_id,
+                                      match_id,
+                                      matches,
+                                      camCur_T_camRef_mono,
+                                      &relative_poses[i],
+                                      &debug_infos[i])) {
+            statuses[i] = LCDStatus::FAILED_POSE_RECOVERY;
+            continue;
+          }
+          statuses[i] = LCDStatus::LOOP_DETECTED;
+        }
+      });
+
+  // The verified candidate with most RANSAC inliers wins, ties go to the
+  // candidate with the best island.
+  int best_candidate = -1;
+  size_t best_nr_inliers = 0u;
+  for (size_t i = 0u; i < nr_candidates; i++) {
+    if (statuses[i] != LCDStatus::LOOP_DETECTED) continue;
+    size_t nr_inliers = 0u;
+    if (lcd_params_.pose_recovery_option_ == PoseRecoveryOption::RANSAC_ARUN) {
+      nr_inliers = debug_infos[i].stereo_inliers_;
+    } else if (lcd_params_.geom_check_ == GeomVerifOption::NISTER) {
+      nr_inliers = debug_infos[i].mono_inliers_;
+    }
+    if (best_candidate < 0 || nr_inliers > best_nr_inliers) {
+      best_candidate = i;
+      best_nr_inliers = nr_inliers;
+    }
+  }
+  // If none is verified, report the failure of the best island.
+  const size_t winner = best_candidate < 0 ? 0u : best_candidate;
+  result->status_ = statuses[winner];
+  result->match_id_ = candidates[winner];
+  result->relative_pose_ = relative_poses[winner];
+  debug_info_ = debug_infos[winner];
+  stats_verification.AddSample(utils::Timer::toc(tic).count());
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::detectAndComputeOrbInTiles(
+    const cv::Mat& img,
+    std::vector<cv::KeyPoint>* keypoints,
+    OrbDescriptor* descriptors) const {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(descriptors);
+  const int& grid_rows = lcd_params_.orb_grid_rows_;
+  const int& grid_cols = lcd_params_.orb_grid_cols_;
+  CHECK_EQ(orb_tile_feature_detectors_.size(),
+           static_cast<size_t>(grid_rows * grid_cols));
+  const cv::Rect img_rect(0, 0, img.cols, img.rows);
+  // ORB ignores edge_threshold_ pixels along the border of every pyramid
+  // level, which covers scale_factor^level pixels of the image per pixel, so
+  // pad enough for the coarsest level.
+  const int border = static_cast<int>(std::ceil(
+      lcd_params_.edge_threshold_ *
+      std::pow(lcd_params_.scale_factor_, lcd_params_.nlevels_ - 1)));
+
+  std::vector<std::vector<cv::KeyPoint>> tile_keypoints(grid_rows * grid_cols);
+  // Descriptors of each tile, and the row of each kept keypoint in them.
+  std::vector<OrbDescriptor> tile_descriptors(grid_rows * grid_cols);
+  std::vector<std::vector<int>> tile_rows(grid_rows * grid_cols);
+  cv::parallel_for_(
+      cv::Range(0, grid_rows * grid_cols), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+          const int row = i / grid_cols;
+          const int col = i % grid_cols;
+          const cv::Rect tile(cv::Point(col * img.cols / grid_cols,
+                                        row * img.rows / grid_rows),
+                              cv::Point((col + 1) * img.cols / grid_cols,
+                                        (row + 1) * img.rows / grid_rows));
+          const cv::Rect padded_tile =
+              cv::Rect(tile.x - border,
+                       tile.y - border,
+                       tile.width + 2 * border,
+                       tile.height + 2 * border) &
+              img_rect;
+
+          std::vector<cv::KeyPoint> padded_keypoints;
+          orb_tile_feature_detectors_[i]->detectAndCompute(img(padded_tile),
+                                                           cv::Mat(),
+                                                           padded_keypoints,
+                                                           tile_descriptors[i]);
+
+          // Only keep the keypoints inside the tile, the padding belongs to
+          // the neighbouring tiles.
+          for (size_t j = 0u; j < padded_keypoints.size(); j++) {
+            cv::KeyPoint keypoint = padded_keypoints[j];
+            keypoint.pt += cv::Point2f(padded_tile.tl());
+            if (cv::Rect2f(tile).contains(keypoint.pt)) {
+              tile_keypoints[i].push_back(keypoint);
+              tile_rows[i].push_back(static_cast<int>(j));
+            }
+          }
+        }
+      });
+
+  // Merge tiles in order, so that the result is deterministic.
+  size_t nr_tile_keypoints = 0u;
+  for (const std::vector<cv::KeyPoint>& kps : tile_keypoints) {
+    nr_tile_keypoints += kps.size();
+  }
+  std::vector<cv::KeyPoint> all_keypoints;
+  // Tile and descriptor row of each keypoint.
+  std::vector<std::pair<size_t, int>> all_rows;
+  all_keypoints.reserve(nr_tile_keypoints);
+  all_rows.reserve(nr_tile_keypoints);
+  for (size_t i = 0u; i < tile_keypoints.size(); i++) {
+    all_keypoints.insert(all_keypoints.end(),
+                         tile_keypoints[i].begin(),
+                         tile_keypoints[i].end());
+    for (const int& row : tile_rows[i]) {
+      all_rows.push_back(std::make_pair(i, row));
+    }
+  }
+
+  // Keep the nfeatures_ keypoints with best response.
+  std::vector<size_t> indices(all_keypoints.size());
+  std::iota(indices.begin(), indices.end(), 0u);
+  const size_t nr_keypoints =
+      std::min(indices.size(), static_cast<size_t>(lcd_params_.nfeatures_));
+  std::stable_sort(
+      indices.begin(), indices.end(), [&all_keypoints](size_t a, size_t b) {
+        return all_keypoints[a].response > all_keypoints[b].response;
+      });
+  keypoints->clear();
+  keypoints->reserve(nr_keypoints);
+  *descriptors = OrbDescriptor();
+  if (nr_keypoints == 0u) return;
+  const OrbDescriptor& first_descriptors =
+      tile_descriptors[all_rows[indices[0]].first];
+  descriptors->create(static_cast<int>(nr_keypoints),
+                      first_descriptors.cols,
+                      first_descriptors.type());
+  for (size_t i = 0u; i < nr_keypoints; i++) {
+    keypoints->push_back(all_keypoints[indices[i]]);
+    const std::pair<size_t, int>& tile_row = all_rows[indices[i]];
+    tile_descriptors[tile_row.first]
+        .row(tile_row.second)
+        .copyTo(descriptors->row(static_cast<int>(i)));
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::computeOrbOnFrontendKeypoints(
+    const Frame& frame,
+    std::vector<cv::KeyPoint>* keypoints,
+    OrbDescriptor* descriptors) const {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(descriptors);
+  const cv::Mat& img = frame.img_;
+  CHECK_EQ(img.type(), CV_8UC1);
+  CHECK_GE(lcd_params_.edge_threshold_, lcd_params_.patch_sze_ / 2);
+
+  // Same border as the one ORB uses when describing keypoints.
+  const cv::Rect2f inner_rect(lcd_params_.edge_threshold_,
+                              lcd_params_.edge_threshold_,
+                              img.cols - 2 * lcd_params_.edge_threshold_,
+                              img.rows - 2 * lcd_params_.edge_threshold_);
+  keypoints->clear();
+  keypoints->reserve(frame.keypoints_.size());
+  for (const KeypointCV& keypoint : frame.keypoints_) {
+    if (!inner_rect.contains(keypoint)) continue;
+    // ORB does not compute the orientation of keypoints it did not detect.
+    keypoints->push_back(cv::KeyPoint(
+        keypoint,
+        lcd_params_.patch_sze_,
+        computeOrbOrientation(img, keypoint, lcd_params_.patch_sze_ / 2)));
+  }
+
+  orb_feature_detector_->compute(img, *keypoints, *descriptors);
+}
+
+/* ------------------------------------------------------------------------ */
+float LoopClosureDetector::computeOrbOrientation(const cv::Mat& img,
+                                                 const cv::Point2f& pt,
+                                                 const int& half_patch_size) {
+  const int center_u = cvRound(pt.x);
+  const int center_v = cvRound(pt.y);
+  int m_01 = 0, m_10 = 0;
+  for (int v = -half_patch_size; v <= half_patch_size; v++) {
+    const int u_max = cvFloor(
+        std::sqrt(half_patch_size * half_patch_size - v * v + 0.5));
+    const uchar* img_row = img.ptr<uchar>(center_v + v);
+    for (int u = -u_max; u <= u_max; u++) {
+      const int intensity = img_row[center_u + u];
+      m_10 += u * intensity;
+      m_01 += v * intensity;
+    }
+  }
+  return cv::fastAtan2(static_cast<float>(m_01), static_cast<float>(m_10));
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::releaseOldFrameFeatures() {
+  CHECK_GE(lcd_params_.recent_frames_with_features_, 0);
+  CHECK_EQ(db_frames_.size(), W_Pose_Blkf_estimates_.size());
+  const size_t nr_recent_frames = lcd_params_.recent_frames_with_features_;
+  while (db_frames_.size() > next_frame_to_release_ + nr_recent_frames) {
+    LCDFrame& frame = db_frames_.at(next_frame_to_release_);
+    bool is_spatially_sparse = true;
+    if (last_old_frame_with_features_ >= 0) {
+      const gtsam::Point3& W_t_cur =
+          W_Pose_Blkf_estimates_.at(next_frame_to_release_).translation();
+      const gtsam::Point3& W_t_last =
+          W_Pose_Blkf_estimates_.at(last_old_frame_with_features_)
+              .translation();
+      is_spatially_sparse = (W_t_cur - W_t_last).norm() >=
+                            lcd_params_.min_dist_between_frames_with_features_;
+    }
+    if (is_spatially_sparse && frame.hasFeatures()) {
+      // Spatially sparse frame: keep it as a loop closure candidate.
+      last_old_frame_with_features_ = next_frame_to_release_;
+    } else {
+      if (has_cached_matches_ && (cached_query_id_ == frame.id_ ||
+                                  cached_match_id_ == frame.id_)) {
+        has_cached_matches_ = false;
+        std::vector<DMatchVec>().swap(cached_matches_);
+      }
+      db_frames_memory_bytes_ -= frame.getMemoryFootprint();
+      frame.releaseFeatures();
+      db_frames_memory_bytes_ += frame.getMemoryFootprint();
+      VLOG(5) << "LoopClosureDetector: released features of frame "
+              << frame.id_;
+    }
+    ++next_frame_to_release_;
+  }
+}
+
 /* ------------------------------------------------------------------------ */
 const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
   if (W_Pose_Blkf_estimates_.size() > 1) {
     CHECK(pgo_);
     const gtsam::Pose3& w_Pose_Bkf_estim = W_Pose_Blkf_estimates_.back();
-    const gtsam::Pose3& w_Pose_Bkf_optimal =
-        pgo_->calculateEstimate().at<gtsam::Pose3>(
-            W_Pose_Blkf_estimates_.size() - 1);
+    if (lcd_params_.incremental_output_) {
+      // Avoid copying all the values of the PGO.
+      const gtsam::Pose3& w_Pose_Bkf_optimal = pgo_trajectory_->back();
+      return w_Pose_Bkf_optimal.between(w_Pose_Bkf_estim);
+    }
+    const gtsam::Pose3 w_Pose_Bkf_optimal =
+        getPGOTrajectory().at<gtsam::Pose3>(W_Pose_Blkf_estimates_.size() - 1);
 
     return w_Pose_Bkf_optimal.between(w_Pose_Bkf_estim);
   }
@@ -456,13 +1023,17 @@ const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
 /* ------------------------------------------------------------------------ */
 const gtsam::Values LoopClosureDetector::getPGOTrajectory() const {
   CHECK(pgo_);
-  return pgo_->calculateEstimate();
+  gtsam::Values pgo_values = pgo_->calculateEstimate();
+  pgo_values.insert(pending_odom_values_);
+  return pgo_values;
 }
 
 /* ------------------------------------------------------------------------ */
 const gtsam::NonlinearFactorGraph LoopClosureDetector::getPGOnfg() const {
   CHECK(pgo_);
-  return pgo_->getFactorsUnsafe();
+  gtsam::NonlinearFactorGraph pgo_nfg = pgo_->getFactorsUnsafe();
+  pgo_nfg.add(pending_odom_factors_);
+  return pgo_nfg;
 }
 
 /* ------------------------------------------------------------------------ */
@@ -482,12 +1053,36 @@ void LoopClosureDetector::setIntrinsics(const StereoFrame& stereo_frame) {
 
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::setDatabase(const OrbDatabase& db) {
-  db_BoW_ = VIO::make_unique<OrbDatabase>(db);
+  // Copying the OrbDatabase would not copy the node descriptors of a
+  // BinaryOrbVocabulary, which would dangle once its file is unmapped:
+  // share the vocabulary of db if it is shared, or deep-copy it.
+  const SharedVocabularyOrbDatabase* shared_db =
+      dynamic_cast<const SharedVocabularyOrbDatabase*>(&db);
+  db_BoW_ = VIO::make_unique<SharedVocabularyOrbDatabase>(
+      shared_db ? shared_db->getSharedVocabulary()
+                : copyOrbVocabulary(*CHECK_NOTNULL(db.getVocabulary())),
+      db);
+  initializeShardedDatabase();
 }
 
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::setVocabulary(const OrbVocabulary& voc) {
-  db_BoW_->setVocabulary(voc);
+  // OrbDatabase::setVocabulary would delete the shared vocabulary, and it
+  // clears the database anyway.
+  db_BoW_ = VIO::make_unique<SharedVocabularyOrbDatabase>(
+      copyOrbVocabulary(voc));
+  initializeShardedDatabase();
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::initializeShardedDatabase() {
+  if (lcd_params_.bow_shard_size_ <= 0) return;
+  CHECK(db_BoW_);
+  sharded_db_BoW_ = VIO::make_unique<ShardedBowDatabase>(
+      db_BoW_->getVocabulary(),
+      lcd_params_.bow_shard_size_,
+      lcd_params_.bow_shard_query_radius_,
+      lcd_params_.bow_global_sweep_period_);
 }
 
 /* ------------------------------------------------------------------------ */
@@ -495,6 +1090,403 @@ void LoopClosureDetector::print() const {
   // TODO(marcus): implement
 }
 
+/* ------------------------------------------------------------------------ */
+namespace {
+// Bumped whenever the layout of the snapshot changes.
+constexpr char kSnapshotMagic[8] = "KVIOLCD";
+constexpr uint32_t kSnapshotVersion = 2u;
+
+enum class SnapshotFactorType : uint8_t { PRIOR = 0u, BETWEEN = 1u };
+
+// Identifies the vocabulary of the snapshot: its BoW vectors are meaningless
+// with another vocabulary. Hashing the nodes would page in a whole
+// BinaryOrbVocabulary, its shape is enough to tell vocabularies apart.
+struct SnapshotVocabularyInfo {
+  uint64_t nr_words;
+  int32_t branching_factor;
+  int32_t depth_levels;
+  int32_t weighting;
+  int32_t scoring;
+};
+
+SnapshotVocabularyInfo getVocabularyInfo(const OrbVocabulary& vocabulary) {
+  SnapshotVocabularyInfo info;
+  info.nr_words = vocabulary.size();
+  info.branching_factor = vocabulary.getBranchingFactor();
+  info.depth_levels = vocabulary.getDepthLevels();
+  info.weighting = static_cast<int32_t>(vocabulary.getWeightingType());
+  info.scoring = static_cast<int32_t>(vocabulary.getScoringType());
+  return info;
+}
+
+void writeVocabularyInfo(const SnapshotVocabularyInfo& info,
+                         SnapshotWriter* writer) {
+  writer->write(info.nr_words);
+  writer->write(info.branching_factor);
+  writer->write(info.depth_levels);
+  writer->write(info.weighting);
+  writer->write(info.scoring);
+}
+
+bool readVocabularyInfo(SnapshotReader* reader, SnapshotVocabularyInfo* info) {
+  return reader->read(&info->nr_words) &&
+         reader->read(&info->branching_factor) &&
+         reader->read(&info->depth_levels) && reader->read(&info->weighting) &&
+         reader->read(&info->scoring);
+}
+
+bool operator==(const SnapshotVocabularyInfo& lhs,
+                const SnapshotVocabularyInfo& rhs) {
+  return lhs.nr_words == rhs.nr_words &&
+         lhs.branching_factor == rhs.branching_factor &&
+         lhs.depth_levels == rhs.depth_levels &&
+         lhs.weighting == rhs.weighting && lhs.scoring == rhs.scoring;
+}
+
+void writeBowVector(const DBoW2::BowVector& bow_vec, SnapshotWriter* writer) {
+  writer->write(static_cast<uint64_t>(bow_vec.size()));
+  for (const auto& word : bow_vec) {
+    writer->write(static_cast<uint32_t>(word.first));
+    writer->write(static_cast<double>(word.second));
+  }
+}
+
+bool readBowVector(SnapshotReader* reader, DBoW2::BowVector* bow_vec) {
+  uint64_t size = 0u;
+  if (!reader->read(&size)) return false;
+  bow_vec->clear();
+  for (uint64_t i = 0u; i < size; i++) {
+    uint32_t word_id = 0u;
+    double weight = 0.0;
+    if (!reader->read(&word_id) || !reader->read(&weight)) return false;
+    bow_vec->emplace_hint(bow_vec->end(), word_id, weight);
+  }
+  return true;
+}
+
+// Only the factors the LoopClosureDetector creates are supported: pose priors
+// and between factors with Gaussian noise.
+bool writeFactor(const gtsam::NonlinearFactor::shared_ptr& factor,
+                 SnapshotWriter* writer) {
+  SnapshotFactorType type;
+  gtsam::Key key_from = 0u, key_to = 0u;
+  gtsam::Pose3 measurement;
+  gtsam::SharedNoiseModel noise;
+  const auto prior =
+      boost::dynamic_pointer_cast<gtsam::PriorFactor<gtsam::Pose3>>(factor);
+  const auto between =
+      boost::dynamic_pointer_cast<gtsam::BetweenFactor<gtsam::Pose3>>(factor);
+  if (prior) {
+    type = SnapshotFactorType::PRIOR;
+    key_from = key_to = prior->key();
+    measurement = prior->prior();
+    noise = prior->noiseModel();
+  } else if (between) {
+    type = SnapshotFactorType::BETWEEN;
+    key_from = between->key1();
+    key_to = between->key2();
+    measurement = between->measured();
+    noise = between->noiseModel();
+  } else {
+    return false;
+  }
+  const auto gaussian =
+      boost::dynamic_pointer_cast<gtsam::noiseModel::Gaussian>(noise);
+  if (!gaussian) return false;
+
+  writer->write(type);
+  writer->write(static_cast<uint64_t>(key_from));
+  writer->write(static_cast<uint64_t>(key_to));
+  writer->writePose(measurement);
+  const gtsam::Matrix6 sqrt_information = gaussian->R();
+  writer->writeBytes(sqrt_information.data(), sizeof(gtsam::Matrix6));
+  return true;
+}
+
+bool readFactor(SnapshotReader* reader,
+                gtsam::NonlinearFactor::shared_ptr* factor) {
+  SnapshotFactorType type;
+  uint64_t key_from = 0u, key_to = 0u;
+  gtsam::Pose3 measurement;
+  gtsam::Matrix6 sqrt_information;
+  if (!reader->read(&type) || !reader->read(&key_from) ||
+      !reader->read(&key_to) || !reader->readPose(&measurement)) {
+    return false;
+  }
+  const uint8_t* data = reader->readBytes(sizeof(gtsam::Matrix6));
+  if (!data) return false;
+  std::memcpy(sqrt_information.data(), data, sizeof(gtsam::Matrix6));
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Gaussian::SqrtInformation(sqrt_information);
+  switch (type) {
+    case SnapshotFactorType::PRIOR:
+      factor->reset(
+          new gtsam::PriorFactor<gtsam::Pose3>(key_from, measurement, noise));
+      return true;
+    case SnapshotFactorType::BETWEEN:
+      factor->reset(new gtsam::BetweenFactor<gtsam::Pose3>(
+          key_from, key_to, measurement, noise));
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::saveSnapshot(const std::string& filepath) const {
+  const SharedVocabularyOrbDatabase* db =
+      dynamic_cast<const SharedVocabularyOrbDatabase*>(db_BoW_.get());
+  if (!db && !sharded_db_BoW_) {
+    LOG(ERROR) << "LoopClosureDetector: snapshots need the default database.";
+    return false;
+  }
+  auto tic = utils::Timer::tic();
+  SnapshotWriter writer(filepath);
+  if (!writer.good()) return false;
+  writer.writeBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+  writer.write(kSnapshotVersion);
+  writeVocabularyInfo(getVocabularyInfo(*db_BoW_->getVocabulary()), &writer);
+
+  // Frame database.
+  writer.write(static_cast<uint64_t>(db_frames_.size()));
+  for (const LCDFrame& frame : db_frames_) {
+    writer.write(frame.timestamp_);
+    writer.write(static_cast<uint64_t>(frame.id_));
+    writer.write(static_cast<uint64_t>(frame.id_kf_));
+    writer.writeVector(frame.keypoints_);
+    writer.writeVector(frame.keypoints_3d_);
+    writer.writeVector(frame.versors_);
+    // Frames that released their features have no descriptors.
+    const OrbDescriptor& descriptors = frame.descriptors_mat_;
+    CHECK(descriptors.empty() || descriptors.isContinuous());
+    writer.write(static_cast<int32_t>(descriptors.rows));
+    writer.write(static_cast<int32_t>(descriptors.cols));
+    writer.write(static_cast<int32_t>(descriptors.type()));
+    writer.writeBytes(descriptors.data,
+                      descriptors.total() * descriptors.elemSize());
+    writeBowVector(frame.bow_vec_, &writer);
+    writer.write(static_cast<uint64_t>(frame.feature_vec_.size()));
+    for (const auto& node : frame.feature_vec_) {
+      writer.write(static_cast<uint32_t>(node.first));
+      writer.writeVector(node.second);
+    }
+  }
+  writer.write(static_cast<uint64_t>(timestamp_map_.size()));
+  for (const auto& id_timestamp : timestamp_map_) {
+    writer.write(static_cast<uint64_t>(id_timestamp.first));
+    writer.write(id_timestamp.second);
+  }
+  writer.write(static_cast<uint64_t>(next_frame_to_release_));
+  writer.write(static_cast<int64_t>(last_old_frame_with_features_));
+
+  // BoW database, as the BoW vector of each entry.
+  std::vector<DBoW2::BowVector> entries;
+  if (sharded_db_BoW_) {
+    sharded_db_BoW_->getBowVectors(&entries);
+  } else {
+    db->getBowVectors(&entries);
+  }
+  writer.write(static_cast<uint64_t>(entries.size()));
+  for (const DBoW2::BowVector& bow_vec : entries) {
+    writeBowVector(bow_vec, &writer);
+  }
+
+  // PGO, including pending odometry.
+  writer.write(static_cast<uint64_t>(W_Pose_Blkf_estimates_.size()));
+  for (const gtsam::Pose3& W_Pose_Blkf : W_Pose_Blkf_estimates_) {
+    writer.writePose(W_Pose_Blkf);
+  }
+  const gtsam::Values pgo_values = getPGOTrajectory();
+  writer.write(static_cast<uint64_t>(pgo_values.size()));
+  for (const auto& key_value : pgo_values) {
+    writer.write(static_cast<uint64_t>(key_value.key));
+    writer.writePose(key_value.value.cast<gtsam::Pose3>());
+  }
+  const gtsam::NonlinearFactorGraph pgo_nfg = getPGOnfg();
+  uint64_t nr_factors = 0u;
+  for (const auto& factor : pgo_nfg) {
+    if (factor) nr_factors++;
+  }
+  writer.write(nr_factors);
+  for (const auto& factor : pgo_nfg) {
+    if (!factor) continue;
+    if (!writeFactor(factor, &writer)) {
+      LOG(ERROR) << "LoopClosureDetector: unsupported PGO factor in snapshot.";
+      return false;
+    }
+  }
+
+  if (!writer.good() || !writer.commit()) return false;
+  LOG(INFO) << "LoopClosureDetector: saved snapshot with " << db_frames_.size()
+            << " frames to " << filepath << " in "
+            << utils::Timer::toc(tic).count() << " ms.";
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::loadSnapshot(const std::string& filepath) {
+  CHECK(db_frames_.empty() && W_Pose_Blkf_estimates_.empty())
+      << "LoopClosureDetector: load snapshots before processing any frame.";
+  CHECK(db_BoW_);
+  CHECK(pgo_);
+  auto tic = utils::Timer::tic();
+  SnapshotReader::UniquePtr reader = VIO::make_unique<SnapshotReader>();
+  if (!reader->open(filepath)) return false;
+  const uint8_t* magic = reader->readBytes(sizeof(kSnapshotMagic));
+  uint32_t version = 0u;
+  if (!magic ||
+      std::memcmp(magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+      !reader->read(&version) || version != kSnapshotVersion) {
+    LOG(ERROR) << "Not a LoopClosureDetector snapshot (or wrong version): "
+               << filepath;
+    return false;
+  }
+  SnapshotVocabularyInfo vocabulary_info;
+  if (!readVocabularyInfo(reader.get(), &vocabulary_info)) return false;
+  if (!(vocabulary_info == getVocabularyInfo(*db_BoW_->getVocabulary()))) {
+    LOG(ERROR) << "Snapshot was saved with another vocabulary (of "
+               << vocabulary_info.nr_words << " words): " << filepath;
+    return false;
+  }
+
+  // Frame database. Descriptors are not copied, they point to the mapping.
+  uint64_t nr_frames = 0u;
+  if (!reader->read(&nr_frames)) return false;
+  db_frames_.reserve(nr_frames);
+  for (uint64_t i = 0u; i < nr_frames; i++) {
+    LCDFrame frame;
+    uint64_t id = 0u, id_kf = 0u;
+    int32_t rows = 0, cols = 0, type = 0;
+    uint64_t nr_nodes = 0u;
+    if (!reader->read(&frame.timestamp_) || !reader->read(&id) ||
+        !reader->read(&id_kf) || !reader->readVector(&frame.keypoints_) ||
+        !reader->readVector(&frame.keypoints_3d_) ||
+        !reader->readVector(&frame.versors_) || !reader->read(&rows) ||
+        !reader->read(&cols) || !reader->read(&type) || rows < 0 ||
+        cols < 0) {
+      LOG(ERROR) << "Truncated snapshot: " << filepath;
+      return false;
+    }
+    frame.id_ = id;
+    frame.id_kf_ = id_kf;
+    if (rows > 0) {
+      const size_t bytes = size_t(rows) * cols * CV_ELEM_SIZE(type);
+      const uint8_t* data = reader->readBytes(bytes);
+      if (!data) return false;
+      frame.descriptors_mat_ =
+          OrbDescriptor(rows, cols, type, const_cast<uint8_t*>(data));
+      frame.descriptors_vec_.reserve(rows);
+      for (int32_t row = 0; row < rows; row++) {
+        frame.descriptors_vec_.push_back(frame.descriptors_mat_.row(row));
+      }
+    }
+    if (!readBowVector(reader.get(), &frame.bow_vec_) ||
+        !reader->read(&nr_nodes)) {
+      return false;
+    }
+    for (uint64_t j = 0u; j < nr_nodes; j++) {
+      uint32_t node_id = 0u;
+      if (!reader->read(&node_id) ||
+          !reader->readVector(&frame.feature_vec_[node_id])) {
+        return false;
+      }
+    }
+    if (frame.id_ != db_frames_.size()) {
+      LOG(ERROR) << "Frames out of order in snapshot: " << filepath;
+      return false;
+    }
+    db_frames_memory_bytes_ += frame.getMemoryFootprint();
+    db_frames_.push_back(std::move(frame));
+  }
+  uint64_t nr_timestamps = 0u;
+  if (!reader->read(&nr_timestamps)) return false;
+  for (uint64_t i = 0u; i < nr_timestamps; i++) {
+    uint64_t id = 0u;
+    Timestamp timestamp = 0;
+    if (!reader->read(&id) || !reader->read(&timestamp)) return false;
+    timestamp_map_[id] = timestamp;
+  }
+  uint64_t next_frame_to_release = 0u;
+  int64_t last_old_frame_with_features = -1;
+  if (!reader->read(&next_frame_to_release) ||
+      !reader->read(&last_old_frame_with_features)) {
+    return false;
+  }
+  next_frame_to_release_ = next_frame_to_release;
+  last_old_frame_with_features_ = last_old_frame_with_features;
+
+  // BoW database: rebuilding the inverted file is linear in its size.
+  uint64_t nr_entries = 0u;
+  if (!reader->read(&nr_entries)) return false;
+  db_BoW_->clear();
+  if (sharded_db_BoW_) sharded_db_BoW_->clear();
+  DBoW2::BowVector bow_vec;
+  for (uint64_t i = 0u; i < nr_entries; i++) {
+    if (!readBowVector(reader.get(), &bow_vec)) return false;
+    if (sharded_db_BoW_) {
+      sharded_db_BoW_->add(bow_vec);
+    } else {
+      db_BoW_->add(bow_vec);
+    }
+  }
+  if (!db_frames_.empty()) latest_bowvec_ = db_frames_.back().bow_vec_;
+
+  // PGO: odometry and priors first, then the loop closures at once.
+  uint64_t nr_estimates = 0u;
+  if (!reader->read(&nr_estimates)) return false;
+  W_Pose_Blkf_estimates_.resize(nr_estimates);
+  for (gtsam::Pose3& W_Pose_Blkf : W_Pose_Blkf_estimates_) {
+    if (!reader->readPose(&W_Pose_Blkf)) return false;
+  }
+  uint64_t nr_values = 0u;
+  if (!reader->read(&nr_values)) return false;
+  gtsam::Values pgo_values;
+  for (uint64_t i = 0u; i < nr_values; i++) {
+    uint64_t key = 0u;
+    gtsam::Pose3 pose;
+    if (!reader->read(&key) || !reader->readPose(&pose)) return false;
+    pgo_values.insert(key, pose);
+  }
+  uint64_t nr_factors = 0u;
+  if (!reader->read(&nr_factors)) return false;
+  gtsam::NonlinearFactorGraph odometry_nfg, loop_closure_nfg;
+  for (uint64_t i = 0u; i < nr_factors; i++) {
+    gtsam::NonlinearFactor::shared_ptr factor;
+    if (!readFactor(reader.get(), &factor)) {
+      LOG(ERROR) << "Wrong PGO factor in snapshot: " << filepath;
+      return false;
+    }
+    const gtsam::KeyVector& keys = factor->keys();
+    if (keys.size() == 2u && keys[1] != keys[0] + 1u) {
+      loop_closure_nfg.add(factor);
+    } else {
+      odometry_nfg.add(factor);
+    }
+  }
+  if (!pgo_values.empty()) {
+    pgo_->update(odometry_nfg, pgo_values);
+    if (!loop_closure_nfg.empty()) pgo_->update(loop_closure_nfg);
+    pgo_trajectory_ =
+        std::make_shared<PgoTrajectory>(pgo_->calculateEstimate());
+    if (sharded_db_BoW_) sharded_db_BoW_->updatePositions(*pgo_trajectory_);
+  }
+
+  // Frames and PGO keys must match to number the next keyframes.
+  if (W_Pose_Blkf_estimates_.size() != db_frames_.size() ||
+      pgo_trajectory_->size() != db_frames_.size()) {
+    LOG(ERROR) << "Frames and PGO do not match in snapshot: " << filepath;
+    return false;
+  }
+  kf_id_offset_ = db_frames_.size();
+  last_detection_frame_ = -1;
+  snapshot_reader_ = std::move(reader);
+  LOG(INFO) << "LoopClosureDetector: loaded snapshot with "
+            << db_frames_.size() << " frames from " << filepath << " in "
+            << utils::Timer::toc(tic).count() << " ms.";
+  return true;
+}
+
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::rewriteStereoFrameFeatures(
     const std::vector<cv::KeyPoint>& keypoints,
@@ -570,10 +1562,9 @@ cv::Mat LoopClosureDetector::computeAndDrawMatchesBetweenFrames(
   if (cut_matches) lowe_ratio = lcd_params_.lowe_ratio_;
 
   // TODO(marcus): this can use computeMatchedIndices() as well...
-  orb_feature_matcher_->knnMatch(db_frames_[query_id].descriptors_mat_,
-                                 db_frames_[match_id].descriptors_mat_,
-                                 matches,
-                                 2u);
+  bruteForceKnnMatch(db_frames_[query_id].descriptors_mat_,
+                     db_frames_[match_id].descriptors_mat_,
+                     &matches);
 
   for (const std::vector<cv::DMatch>& match : matches) {
     if (match.at(0).distance < lowe_ratio * match.at(1).distance) {
@@ -614,24 +1605,18 @@ void LoopClosureDetector::transformBodyPoseToCameraPose(
 }
 
 /* ------------------------------------------------------------------------ */
-void LoopClosureDetector::computeMatchedIndices(const FrameId& query_id,
-                                                const FrameId& match_id,
-                                                std::vector<FrameId>* i_query,
-                                                std::vector<FrameId>* i_match,
-                                                bool cut_matches) const {
+void LoopClosureDetector::computeMatchedIndices(
+    const std::vector<DMatchVec>& matches,
+    std::vector<FrameId>* i_query,
+    std::vector<FrameId>* i_match,
+    bool cut_matches) const {
   CHECK_NOTNULL(i_query);
   CHECK_NOTNULL(i_match);
 
-  // Get two best matches between frame descriptors.
-  std::vector<DMatchVec> matches;
+  // Keep the best of the two best matches between frame descriptors.
   double lowe_ratio = 1.0;
   if (cut_matches) lowe_ratio = lcd_params_.lowe_ratio_;
 
-  orb_feature_matcher_->knnMatch(db_frames_[query_id].descriptors_mat_,
-                                 db_frames_[match_id].descriptors_mat_,
-                                 matches,
-                                 2u);
-
   // We reserve instead of resize because some of the matches will be pruned.
   const size_t& n_matches = matches.size();
   i_query->reserve(n_matches);
@@ -647,18 +1632,142 @@ void LoopClosureDetector::computeMatchedIndices(const FrameId& query_id,
 }
 
 /* ------------------------------------------------------------------------ */
-// TODO(marcus): both geometrticVerification and recoverPose run the matching
-// alg. this is wasteful. Store the matched indices as latest for use in the
-// compute step
+const std::vector<LoopClosureDetector::DMatchVec>&
+LoopClosureDetector::getKnnMatches(const FrameId& query_id,
+                                   const FrameId& match_id) {
+  if (has_cached_matches_ && cached_query_id_ == query_id &&
+      cached_match_id_ == match_id) {
+    return cached_matches_;
+  }
+
+  computeKnnMatches(query_id, match_id, &cached_matches_);
+  has_cached_matches_ = true;
+  cached_query_id_ = query_id;
+  cached_match_id_ = match_id;
+  return cached_matches_;
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::computeKnnMatches(
+    const FrameId& query_id,
+    const FrameId& match_id,
+    std::vector<DMatchVec>* matches) const {
+  CHECK_NOTNULL(matches);
+  utils::StatsCollector stats_matching("LCD Descriptor Matching Timing [ms]");
+  auto tic = utils::Timer::tic();
+  matches->clear();
+  const LCDFrame& query_frame = db_frames_.at(query_id);
+  const LCDFrame& match_frame = db_frames_.at(match_id);
+  if (lcd_params_.use_bow_guided_matching_ &&
+      !query_frame.feature_vec_.empty() && !match_frame.feature_vec_.empty()) {
+    computeBoWGuidedMatches(query_id, match_id, matches);
+  } else {
+    bruteForceKnnMatch(
+        query_frame.descriptors_mat_, match_frame.descriptors_mat_, matches);
+  }
+  stats_matching.AddSample(utils::Timer::toc(tic).count());
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::bruteForceKnnMatch(
+    const OrbDescriptor& query_descriptors,
+    const OrbDescriptor& match_descriptors,
+    std::vector<DMatchVec>* matches) const {
+  CHECK_NOTNULL(matches);
+  if (lcd_params_.use_hamming_kernel_ &&
+      HammingMatcher::isSupported(query_descriptors) &&
+      HammingMatcher::isSupported(match_descriptors)) {
+    HammingMatcher::knnMatch(query_descriptors, match_descriptors, matches);
+  } else {
+    orb_feature_matcher_->knnMatch(
+        query_descriptors, match_descriptors, *matches, 2u);
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::computeBoWGuidedMatches(
+    const FrameId& query_id,
+    const FrameId& match_id,
+    std::vector<DMatchVec>* matches) const {
+  CHECK_NOTNULL(matches);
+  // Nodes with a single descriptor of the match frame have no second best
+  // distance, hence Lowe's ratio test cannot reject their matches: only keep
+  // them below this Hamming distance (the strict threshold of ORB-SLAM).
+  static constexpr float kMaxSingleCandidateDistance = 50.0f;
+  const LCDFrame& query_frame = db_frames_.at(query_id);
+  const LCDFrame& match_frame = db_frames_.at(match_id);
+  const DBoW2::FeatureVector& query_fv = query_frame.feature_vec_;
+  const DBoW2::FeatureVector& match_fv = match_frame.feature_vec_;
+  matches->clear();
+  matches->reserve(query_frame.descriptors_vec_.size());
+  // All descriptors of a frame have the same size.
+  const bool use_kernel =
+      !query_frame.descriptors_vec_.empty() &&
+      !match_frame.descriptors_vec_.empty() &&
+      HammingMatcher::isSupported(query_frame.descriptors_vec_.front()) &&
+      HammingMatcher::isSupported(match_frame.descriptors_vec_.front());
+
+  // Both feature vectors are sorted by node id: walk them together and only
+  // compare descriptors under the same node.
+  DBoW2::FeatureVector::const_iterator query_it = query_fv.begin();
+  DBoW2::FeatureVector::const_iterator match_it = match_fv.begin();
+  while (query_it != query_fv.end() && match_it != match_fv.end()) {
+    if (query_it->first < match_it->first) {
+      query_it = query_fv.lower_bound(match_it->first);
+      continue;
+    }
+    if (match_it->first < query_it->first) {
+      match_it = match_fv.lower_bound(query_it->first);
+      continue;
+    }
+
+    for (const unsigned int& query_idx : query_it->second) {
+      const OrbDescriptor& query_descriptor =
+          query_frame.descriptors_vec_.at(query_idx);
+      DMatchVec match(2u,
+                      cv::DMatch(query_idx,
+                                 -1,
+                                 std::numeric_limits<float>::infinity()));
+      for (const unsigned int& match_idx : match_it->second) {
+        const OrbDescriptor& match_descriptor =
+            match_frame.descriptors_vec_.at(match_idx);
+        const float distance = static_cast<float>(
+            use_kernel ? hammingDistance256(query_descriptor.ptr<uint8_t>(),
+                                            match_descriptor.ptr<uint8_t>())
+                       : cv::norm(query_descriptor,
+                                  match_descriptor,
+                                  cv::NORM_HAMMING));
+        if (distance < match[0].distance) {
+          match[1] = match[0];
+          match[0] = cv::DMatch(query_idx, match_idx, distance);
+        } else if (distance < match[1].distance) {
+          match[1] = cv::DMatch(query_idx, match_idx, distance);
+        }
+      }
+      if (match[1].trainIdx < 0 &&
+          match[0].distance > kMaxSingleCandidateDistance) {
+        continue;
+      }
+      matches->push_back(match);
+    }
+    ++query_it;
+    ++match_it;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
 bool LoopClosureDetector::geometricVerificationNister(
     const FrameId& query_id,
     const FrameId& match_id,
-    gtsam::Pose3* camCur_T_camRef_mono) {
+    const std::vector<DMatchVec>& matches,
+    gtsam::Pose3* camCur_T_camRef_mono,
+    LcdDebugInfo* debug_info) const {
   CHECK_NOTNULL(camCur_T_camRef_mono);
+  CHECK_NOTNULL(debug_info);
 
   // Find correspondences between keypoints.
   std::vector<FrameId> i_query, i_match;
-  computeMatchedIndices(query_id, match_id, &i_query, &i_match, true);
+  computeMatchedIndices(matches, &i_query, &i_match, true);
 
   BearingVectors query_versors, match_versors;
 
@@ -691,9 +1800,9 @@ bool LoopClosureDetector::geometricVerificationNister(
     VLOG(3) << "ransac 5pt size of input: " << query_versors.size()
             << "\nransac 5pt inliers: " << ransac.inliers_.size()
             << "\nransac 5pt iterations: " << ransac.iterations_;
-    debug_info_.mono_input_size_ = query_versors.size();
-    debug_info_.mono_inliers_ = ransac.inliers_.size();
-    debug_info_.mono_iter_ = ransac.iterations_;
+    debug_info->mono_input_size_ = query_versors.size();
+    debug_info->mono_inliers_ = ransac.inliers_.size();
+    debug_info->mono_iter_ = ransac.iterations_;
 
     if (!ransac_success) {
       VLOG(3) << "LoopClosureDetector Failure: RANSAC 5pt could not solve.";
@@ -717,14 +1826,18 @@ bool LoopClosureDetector::geometricVerificationNister(
 }
 
 /* ------------------------------------------------------------------------ */
-bool LoopClosureDetector::recoverPoseArun(const FrameId& query_id,
-                                          const FrameId& match_id,
-                                          gtsam::Pose3* bodyCur_T_bodyRef) {
+bool LoopClosureDetector::recoverPoseArun(
+    const FrameId& query_id,
+    const FrameId& match_id,
+    const std::vector<DMatchVec>& matches,
+    gtsam::Pose3* bodyCur_T_bodyRef,
+    LcdDebugInfo* debug_info) const {
   CHECK_NOTNULL(bodyCur_T_bodyRef);
+  CHECK_NOTNULL(debug_info);
 
   // Find correspondences between frames.
   std::vector<FrameId> i_query, i_match;
-  computeMatchedIndices(query_id, match_id, &i_query, &i_match, false);
+  computeMatchedIndices(matches, &i_query, &i_match, false);
 
   Points3d f_ref, f_cur;
 
@@ -753,9 +1866,9 @@ bool LoopClosureDetector::recoverPoseArun(const FrameId& query_id,
   VLOG(3) << "ransac 3pt size of input: " << f_ref.size()
           << "\nransac 3pt inliers: " << ransac.inliers_.size()
           << "\nransac 3pt iterations: " << ransac.iterations_;
-  debug_info_.stereo_input_size_ = f_ref.size();
-  debug_info_.stereo_inliers_ = ransac.inliers_.size();
-  debug_info_.stereo_iter_ = ransac.iterations_;
+  debug_info->stereo_input_size_ = f_ref.size();
+  debug_info->stereo_inliers_ = ransac.inliers_.size();
+  debug_info->stereo_iter_ = ransac.iterations_;
 
   if (!ransac_success) {
     VLOG(3) << "LoopClosureDetector Failure: RANSAC 3pt could not solve.";
@@ -784,15 +1897,16 @@ bool LoopClosureDetector::recoverPoseArun(const FrameId& query_id,
 bool LoopClosureDetector::recoverPoseGivenRot(
     const FrameId& query_id,
     const FrameId& match_id,
+    const std::vector<DMatchVec>& matches,
     const gtsam::Pose3& camCur_T_camRef_mono,
-    gtsam::Pose3* bodyCur_T_bodyRef) {
+    gtsam::Pose3* bodyCur_T_bodyRef) const {
   CHECK_NOTNULL(bodyCur_T_bodyRef);
 
   const gtsam::Rot3& R = camCur_T_camRef_mono.rotation();
 
   // Find correspondences between frames.
   std::vector<FrameId> i_query, i_match;
-  computeMatchedIndices(query_id, match_id, &i_query, &i_match, true);
+  computeMatchedIndices(matches, &i_query, &i_match, true);
 
   // Fill point clouds with matched 3D keypoints.
   const size_t& n_matches = i_match.size();
@@ -875,6 +1989,7 @@ void LoopClosureDetector::initializePGO() {
 
   CHECK(pgo_);
   pgo_->update(init_nfg, init_val);
+  pgo_trajectory_ = std::make_shared<PgoTrajectory>()->append(gtsam::Pose3());
 }
 
 /* ------------------------------------------------------------------------ */
@@ -889,6 +2004,9 @@ void LoopClosureDetector::initializePGO(const OdometryFactor& factor) {
 
   CHECK(pgo_);
   pgo_->update(init_nfg, init_val);
+  pgo_trajectory_ =
+      std::make_shared<PgoTrajectory>()->append(factor.W_Pose_Blkf_);
+  new_pgo_factors_.add(init_nfg);
 }
 
 /* ------------------------------------------------------------------------ */
@@ -905,30 +2023,71 @@ void LoopClosureDetector::addOdometryFactorAndOptimize(
   gtsam::Values value;
 
   if (factor.cur_key_ > 1) {
-    value.insert(gtsam::Symbol(factor.cur_key_ - 1), factor.W_Pose_Blkf_);
-
     gtsam::Pose3 B_llkf_Pose_lkf =
         W_Pose_Blkf_estimates_.at(factor.cur_key_ - 2)
             .between(factor.W_Pose_Blkf_);
 
+    // Dead-reckon from the last PGO pose, and not from the VIO estimate, so
+    // that pending odometry stays in the frame of the optimized poses, and
+    // so that the values of the PGO need not be copied at every keyframe.
+    const gtsam::Pose3 W_Pose_Bkf_guess =
+        pgo_trajectory_->empty() ? factor.W_Pose_Blkf_
+                                 : pgo_trajectory_->back() * B_llkf_Pose_lkf;
+    value.insert(gtsam::Symbol(factor.cur_key_ - 1), W_Pose_Bkf_guess);
+
     nfg.add(
         gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(factor.cur_key_ - 2),
                                            gtsam::Symbol(factor.cur_key_ - 1),
                                            B_llkf_Pose_lkf,
                                            factor.noise_));
 
-    CHECK(pgo_);
-    pgo_->update(nfg, value);
+    // Odometry does not change the structure of the PGO, so it is sent to
+    // the PGO in batches.
+    pending_odom_factors_.add(nfg);
+    pending_odom_values_.insert(value);
+    if (pending_odom_factors_.size() >=
+        static_cast<size_t>(lcd_params_.pgo_odometry_batch_size_)) {
+      updatePGOWithPendingOdometry();
+    }
+    new_pgo_factors_.add(nfg);
+    pgo_trajectory_ = pgo_trajectory_->append(W_Pose_Bkf_guess);
   } else {
     LOG(WARNING) << "LoopClosureDetector: Not enough factors for optimization.";
   }
 }
 
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addSessionBridgeFactor(const OdometryFactor& factor) {
+  CHECK(!pgo_trajectory_->empty());
+  W_Pose_Blkf_estimates_.push_back(factor.W_Pose_Blkf_);
+  CHECK_EQ(factor.cur_key_, W_Pose_Blkf_estimates_.size());
+
+  // Uninformative in practice: the loop closures decide where the new session
+  // lies with respect to the old one.
+  static const gtsam::SharedNoiseModel kBridgeNoise =
+      gtsam::noiseModel::Isotropic::Sigma(6, 1e3);
+  const gtsam::Pose3 W_Pose_Bkf_guess = pgo_trajectory_->back();
+  gtsam::NonlinearFactorGraph nfg;
+  nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(factor.cur_key_ - 2),
+                                             gtsam::Symbol(factor.cur_key_ - 1),
+                                             gtsam::Pose3(),
+                                             kBridgeNoise));
+  pending_odom_factors_.add(nfg);
+  pending_odom_values_.insert(gtsam::Symbol(factor.cur_key_ - 1),
+                              W_Pose_Bkf_guess);
+  updatePGOWithPendingOdometry();
+  new_pgo_factors_.add(nfg);
+  pgo_trajectory_ = pgo_trajectory_->append(W_Pose_Bkf_guess);
+}
+
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::addLoopClosureFactorAndOptimize(
     const LoopClosureFactor& factor) {
   gtsam::NonlinearFactorGraph nfg;
 
+  // The loop closure may involve keyframes whose odometry is pending.
+  updatePGOWithPendingOdometry();
+
   nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(factor.ref_key_),
                                              gtsam::Symbol(factor.cur_key_),
                                              factor.ref_Pose_cur_,
@@ -936,6 +2095,25 @@ void LoopClosureDetector::addLoopClosureFactorAndOptimize(
 
   CHECK(pgo_);
   pgo_->update(nfg);
+  new_pgo_factors_.add(nfg);
+
+  // The whole trajectory may have changed.
+  pgo_trajectory_ = std::make_shared<PgoTrajectory>(pgo_->calculateEstimate());
+  if (sharded_db_BoW_) sharded_db_BoW_->updatePositions(*pgo_trajectory_);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::updatePGOWithPendingOdometry() {
+  if (pending_odom_factors_.empty()) return;
+
+  utils::StatsCollector stats_odom_update("PGO Odometry Update Timing [ms]");
+  auto tic = utils::Timer::tic();
+  CHECK(pgo_);
+  pgo_->update(pending_odom_factors_, pending_odom_values_);
+  stats_odom_update.AddSample(utils::Timer::toc(tic).count());
+
+  pending_odom_factors_ = gtsam::NonlinearFactorGraph();
+  pending_odom_values_.clear();
 }
 
 }  // namespace VIO
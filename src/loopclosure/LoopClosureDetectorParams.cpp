@@ -31,6 +31,14 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
                            &max_distance_between_groups_);
   yaml_parser.getYamlParam("max_distance_between_queries",
                            &max_distance_between_queries_);
+  yaml_parser.getYamlParam("bow_shard_size", &bow_shard_size_);
+  yaml_parser.getYamlParam("bow_shard_query_radius", &bow_shard_query_radius_);
+  yaml_parser.getYamlParam("bow_global_sweep_period",
+                           &bow_global_sweep_period_);
+  yaml_parser.getYamlParam("gating_min_translation",
+                           &gating_min_translation_);
+  yaml_parser.getYamlParam("gating_min_rotation", &gating_min_rotation_);
+  yaml_parser.getYamlParam("gating_max_queue_size", &gating_max_queue_size_);
 
   int geom_check_id;
   yaml_parser.getYamlParam("geom_check_id", &geom_check_id);
@@ -54,6 +62,8 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("ransac_randomize_mono", &ransac_randomize_mono_);
   yaml_parser.getYamlParam("ransac_inlier_threshold_mono",
                            &ransac_inlier_threshold_mono_);
+  yaml_parser.getYamlParam("nr_candidates_to_verify",
+                           &nr_candidates_to_verify_);
 
   int pose_recovery_option_id;
   yaml_parser.getYamlParam("pose_recovery_option_id", &pose_recovery_option_id);
@@ -82,6 +92,10 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("use_mono_rot", &use_mono_rot_);
   yaml_parser.getYamlParam("lowe_ratio", &lowe_ratio_);
   yaml_parser.getYamlParam("matcher_type", &matcher_type_);
+  yaml_parser.getYamlParam("use_bow_guided_matching",
+                           &use_bow_guided_matching_);
+  yaml_parser.getYamlParam("bow_matching_levels_up", &bow_matching_levels_up_);
+  yaml_parser.getYamlParam("use_hamming_kernel", &use_hamming_kernel_);
   yaml_parser.getYamlParam("nfeatures", &nfeatures_);
   yaml_parser.getYamlParam("scale_factor", &scale_factor_);
   yaml_parser.getYamlParam("nlevels", &nlevels_);
@@ -102,12 +116,42 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
   }
   yaml_parser.getYamlParam("patch_sze", &patch_sze_);
   yaml_parser.getYamlParam("fast_threshold", &fast_threshold_);
+  yaml_parser.getYamlParam("use_frontend_keypoints", &use_frontend_keypoints_);
+  yaml_parser.getYamlParam("orb_grid_rows", &orb_grid_rows_);
+  yaml_parser.getYamlParam("orb_grid_cols", &orb_grid_cols_);
   yaml_parser.getYamlParam("pgo_rot_threshold", &pgo_rot_threshold_);
   yaml_parser.getYamlParam("pgo_trans_threshold", &pgo_trans_threshold_);
-
+  yaml_parser.getYamlParam("incremental_output", &incremental_output_);
+  yaml_parser.getYamlParam("pgo_odometry_batch_size",
+                           &pgo_odometry_batch_size_);
+  yaml_parser.getYamlParam("bounded_memory", &bounded_memory_);
+  yaml_parser.getYamlParam("recent_frames_with_features",
+                           &recent_frames_with_features_);
+  yaml_parser.getYamlParam("min_dist_between_frames_with_features",
+                           &min_dist_between_frames_with_features_);
+
+  checkParams();
   return true;
 }
 
+void LoopClosureDetectorParams::checkParams() const {
+  CHECK(alpha_ > 0);
+  CHECK(nfeatures_ >= 100);  // TODO(marcus): add more checks, change this one
+  CHECK_GE(recent_frames_with_features_, 0);
+  CHECK_GE(min_dist_between_frames_with_features_, 0.0);
+  CHECK_GE(orb_grid_rows_, 1);
+  CHECK_GE(orb_grid_cols_, 1);
+  CHECK_GE(bow_matching_levels_up_, 0);
+  CHECK_GE(pgo_odometry_batch_size_, 1);
+  CHECK_GE(nr_candidates_to_verify_, 1);
+  CHECK_GE(bow_shard_size_, 0);
+  CHECK_GT(bow_shard_query_radius_, 0.0);
+  CHECK_GE(bow_global_sweep_period_, 1);
+  CHECK_GE(gating_min_translation_, 0.0);
+  CHECK_GE(gating_min_rotation_, 0.0);
+  CHECK_GE(gating_max_queue_size_, 0);
+}
+
 void LoopClosureDetectorParams::print() const {
   // TODO(marcus): print all params
   LOG(INFO)
@@ -130,6 +174,12 @@ void LoopClosureDetectorParams::print() const {
       << '\n'
       << "max_distance_between_queries_: " << max_distance_between_queries_
       << '\n'
+      << "bow_shard_size_: " << bow_shard_size_ << '\n'
+      << "bow_shard_query_radius_: " << bow_shard_query_radius_ << '\n'
+      << "bow_global_sweep_period_: " << bow_global_sweep_period_ << '\n'
+      << "gating_min_translation_: " << gating_min_translation_ << '\n'
+      << "gating_min_rotation_: " << gating_min_rotation_ << '\n'
+      << "gating_max_queue_size_: " << gating_max_queue_size_ << '\n'
 
       << "geom_check_: " << static_cast<unsigned int>(geom_check_) << '\n'
       << "min_correspondences_: " << min_correspondences_ << '\n'
@@ -139,6 +189,7 @@ void LoopClosureDetectorParams::print() const {
       << "ransac_randomize_mono_: " << ransac_randomize_mono_ << '\n'
       << "ransac_inlier_threshold_mono_: " << ransac_inlier_threshold_mono_
       << '\n'
+      << "nr_candidates_to_verify_: " << nr_candidates_to_verify_ << '\n'
 
       << "pose_recovery_option_: "
       << static_cast<unsigned int>(pose_recovery_option_) << '\n'
@@ -153,6 +204,9 @@ void LoopClosureDetectorParams::print() const {
 
       << "lowe_ratio_: " << lowe_ratio_ << '\n'
       << "matcher_type_:" << static_cast<unsigned int>(matcher_type_) << '\n'
+      << "use_bow_guided_matching_: " << use_bow_guided_matching_ << '\n'
+      << "bow_matching_levels_up_: " << bow_matching_levels_up_ << '\n'
+      << "use_hamming_kernel_: " << use_hamming_kernel_ << '\n'
 
       << "nfeatures_: " << nfeatures_ << '\n'
       << "scale_factor_: " << scale_factor_ << '\n'
@@ -163,8 +217,19 @@ void LoopClosureDetectorParams::print() const {
       << "score_type_: " << score_type_ << '\n'
       << "patch_sze_: " << patch_sze_ << '\n'
       << "fast_threshold_: " << fast_threshold_ << '\n'
+      << "use_frontend_keypoints_: " << use_frontend_keypoints_ << '\n'
+      << "orb_grid_rows_: " << orb_grid_rows_ << '\n'
+      << "orb_grid_cols_: " << orb_grid_cols_ << '\n'
 
       << "pgo_rot_threshold_: " << pgo_rot_threshold_ << '\n'
-      << "pgo_trans_threshold_: " << pgo_trans_threshold_;
+      << "pgo_trans_threshold_: " << pgo_trans_threshold_ << '\n'
+      << "incremental_output_: " << incremental_output_ << '\n'
+      << "pgo_odometry_batch_size_: " << pgo_odometry_batch_size_ << '\n'
+
+      << "bounded_memory_: " << bounded_memory_ << '\n'
+      << "recent_frames_with_features_: " << recent_frames_with_features_
+      << '\n'
+      << "min_dist_between_frames_with_features_: "
+      << min_dist_between_frames_with_features_;
 }
 }  // namespace VIO
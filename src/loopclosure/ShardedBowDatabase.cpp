@@ -0,0 +1,238 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ShardedBowDatabase.cpp
+ * @brief  BoW database split in temporal shards that are queried only if
+ * they are close to the current pose estimate.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/ShardedBowDatabase.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+/* ------------------------------------------------------------------------ */
+ShardedBowDatabase::ShardedBowDatabase(const OrbVocabulary* vocabulary,
+                                       size_t shard_size,
+                                       double query_radius,
+                                       size_t global_sweep_period)
+    : vocabulary_(vocabulary),
+      shard_size_(shard_size),
+      query_radius_(query_radius),
+      global_sweep_period_(global_sweep_period) {
+  CHECK_NOTNULL(vocabulary_);
+  CHECK_GT(shard_size_, 0u);
+  CHECK_GT(query_radius_, 0.0);
+  CHECK_GT(global_sweep_period_, 0u);
+  // The inverted files only accumulate L1 scores.
+  CHECK_EQ(vocabulary_->getScoringType(), DBoW2::L1_NORM)
+      << "ShardedBowDatabase only supports L1 scoring.";
+}
+
+/* ------------------------------------------------------------------------ */
+DBoW2::EntryId ShardedBowDatabase::add(const DBoW2::BowVector& bow_vec,
+                                       const gtsam::Point3* W_position) {
+  if (shards_.empty() || shards_.back().nr_entries == shard_size_) {
+    if (!shards_.empty()) shards_.back().seal();
+    shards_.emplace_back();
+    shards_.back().first_entry = nr_entries_;
+  }
+  Shard& shard = shards_.back();
+  const uint32_t entry_offset = shard.nr_entries;
+  for (const auto& word : bow_vec) {
+    shard.open_postings[word.first].emplace_back(entry_offset, word.second);
+  }
+  if (W_position) {
+    shard.addPosition(*W_position);
+  } else {
+    shard.has_unknown_positions = true;
+  }
+  shard.nr_entries++;
+  return nr_entries_++;
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::query(const DBoW2::BowVector& bow_vec,
+                               DBoW2::QueryResults* results,
+                               int max_results,
+                               int max_id,
+                               const gtsam::Point3* W_position) {
+  CHECK_NOTNULL(results);
+  results->clear();
+  const bool global_sweep = !W_position ||
+                            nr_queries_ % global_sweep_period_ == 0u;
+  nr_queries_++;
+
+  for (const Shard& shard : shards_) {
+    if (max_id != -1 && static_cast<int>(shard.first_entry) >= max_id) break;
+    if (!global_sweep && !shard.has_unknown_positions &&
+        shard.distanceTo(*W_position) > query_radius_) {
+      continue;
+    }
+    queryShard(shard, bow_vec, max_id, results);
+  }
+
+  // Same as DBoW2: scores are in [-2 best, 0 worst] until rescaled.
+  std::sort(results->begin(), results->end());
+  if (max_results > 0 && static_cast<int>(results->size()) > max_results) {
+    results->resize(max_results);
+  }
+  for (DBoW2::Result& result : *results) {
+    result.Score = -result.Score / 2.0;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::queryShard(const Shard& shard,
+                                    const DBoW2::BowVector& bow_vec,
+                                    int max_id,
+                                    DBoW2::QueryResults* results) {
+  scores_.assign(shard.nr_entries, 0.0);
+  hits_.assign(shard.nr_entries, 0u);
+  const uint32_t nr_valid_entries =
+      max_id == -1 ? shard.nr_entries
+                   : std::min<int64_t>(shard.nr_entries,
+                                       int64_t(max_id) - shard.first_entry);
+
+  auto accumulate = [&](uint32_t entry_offset, double dvalue, double qvalue) {
+    if (entry_offset >= nr_valid_entries) return;
+    scores_[entry_offset] +=
+        std::fabs(qvalue - dvalue) - std::fabs(qvalue) - std::fabs(dvalue);
+    hits_[entry_offset] = 1u;
+  };
+
+  if (shard.isSealed()) {
+    // Both the query and the words of the shard are sorted.
+    auto word_it = shard.words.begin();
+    for (const auto& word : bow_vec) {
+      word_it = std::lower_bound(word_it, shard.words.end(), word.first);
+      if (word_it == shard.words.end()) break;
+      if (*word_it != word.first) continue;
+      const size_t i = word_it - shard.words.begin();
+      for (uint32_t j = shard.word_offsets[i]; j < shard.word_offsets[i + 1];
+           j++) {
+        accumulate(
+            shard.posting_entries[j], shard.posting_weights[j], word.second);
+      }
+    }
+  } else {
+    for (const auto& word : bow_vec) {
+      const auto postings_it = shard.open_postings.find(word.first);
+      if (postings_it == shard.open_postings.end()) continue;
+      for (const auto& posting : postings_it->second) {
+        accumulate(posting.first, posting.second, word.second);
+      }
+    }
+  }
+
+  for (uint32_t i = 0u; i < shard.nr_entries; i++) {
+    if (hits_[i]) {
+      results->push_back(DBoW2::Result(shard.first_entry + i, scores_[i]));
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::updatePositions(const PgoTrajectory& trajectory) {
+  for (Shard& shard : shards_) {
+    if (shard.first_entry >= trajectory.size()) break;
+    const size_t end_entry = std::min<size_t>(
+        shard.first_entry + shard.nr_entries, trajectory.size());
+    shard.has_bounds = false;
+    shard.has_unknown_positions =
+        end_entry < shard.first_entry + shard.nr_entries;
+    for (size_t entry = shard.first_entry; entry < end_entry; entry++) {
+      shard.addPosition(trajectory.at(entry).translation());
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::getBowVectors(
+    std::vector<DBoW2::BowVector>* bow_vecs) const {
+  CHECK_NOTNULL(bow_vecs);
+  bow_vecs->clear();
+  bow_vecs->resize(nr_entries_);
+  for (const Shard& shard : shards_) {
+    for (size_t i = 0u; i < shard.words.size(); i++) {
+      for (uint32_t j = shard.word_offsets[i]; j < shard.word_offsets[i + 1];
+           j++) {
+        (*bow_vecs)[shard.first_entry + shard.posting_entries[j]]
+            [shard.words[i]] = shard.posting_weights[j];
+      }
+    }
+    for (const auto& word : shard.open_postings) {
+      for (const auto& posting : word.second) {
+        (*bow_vecs)[shard.first_entry + posting.first][word.first] =
+            posting.second;
+      }
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::clear() {
+  shards_.clear();
+  nr_entries_ = 0u;
+  nr_queries_ = 0u;
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::Shard::seal() {
+  CHECK(!isSealed());
+  words.reserve(open_postings.size());
+  size_t nr_postings = 0u;
+  for (const auto& word : open_postings) {
+    words.push_back(word.first);
+    nr_postings += word.second.size();
+  }
+  std::sort(words.begin(), words.end());
+
+  word_offsets.reserve(words.size() + 1u);
+  posting_entries.reserve(nr_postings);
+  posting_weights.reserve(nr_postings);
+  word_offsets.push_back(0u);
+  for (const DBoW2::WordId& word_id : words) {
+    for (const auto& posting : open_postings.at(word_id)) {
+      posting_entries.push_back(posting.first);
+      posting_weights.push_back(posting.second);
+    }
+    word_offsets.push_back(posting_entries.size());
+  }
+  open_postings.clear();
+}
+
+/* ------------------------------------------------------------------------ */
+void ShardedBowDatabase::Shard::addPosition(const gtsam::Point3& W_position) {
+  if (!has_bounds) {
+    min_position = W_position;
+    max_position = W_position;
+    has_bounds = true;
+    return;
+  }
+  min_position = min_position.cwiseMin(W_position);
+  max_position = max_position.cwiseMax(W_position);
+}
+
+/* ------------------------------------------------------------------------ */
+double ShardedBowDatabase::Shard::distanceTo(
+    const gtsam::Point3& W_position) const {
+  if (!has_bounds) return 0.0;
+  // Distance to the bounding box, zero inside.
+  const gtsam::Point3 below = (min_position - W_position).cwiseMax(0.0);
+  const gtsam::Point3 above = (W_position - max_position).cwiseMax(0.0);
+  return (below + above).norm();
+}
+
+}  // namespace VIO
@@ -0,0 +1,384 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GlobalMesh.cpp
+ * @brief  Persistent mesh of the whole map, split in chunks.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/GlobalMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+constexpr char kChunkMagic[4] = {'K', 'M', 'C', '2'};
+
+template <typename T>
+inline void writeBinary(std::ofstream* stream, const T& value) {
+  stream->write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readBinary(std::ifstream* stream, T* value) {
+  stream->read(reinterpret_cast<char*>(value), sizeof(T));
+  return static_cast<bool>(*stream);
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+GlobalMesh::GlobalMesh(const double& voxel_size,
+                       const double& chunk_size,
+                       const size_t& max_chunks_in_memory,
+                       const std::string& chunks_path)
+    : voxel_size_(voxel_size),
+      chunk_size_(chunk_size),
+      max_chunks_in_memory_(max_chunks_in_memory),
+      chunks_path_(chunks_path),
+      chunks_(),
+      lru_chunks_(),
+      chunks_on_disk_(),
+      horizon_triangles_(),
+      nr_updates_(0u) {
+  CHECK_GT(voxel_size_, 0.0);
+  CHECK_GE(chunk_size_, voxel_size_);
+  CHECK_GT(max_chunks_in_memory_, 0u);
+  LOG_IF(WARNING, chunks_path_.empty())
+      << "No path for the chunks of the global mesh: evicted chunks will be "
+         "dropped.";
+}
+
+/* -------------------------------------------------------------------------- */
+GlobalMesh::~GlobalMesh() {
+  if (!chunks_path_.empty()) {
+    // The triangles of the time horizon won't change anymore.
+    GridIndex chunk_index;
+    for (const auto& triangle : horizon_triangles_) {
+      addTriangle(triangle.second, &chunk_index);
+    }
+    LOG(INFO) << "Saving " << chunks_.size() << " chunks of the global mesh.";
+    saveChunks();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void GlobalMesh::update(const Mesh3D& mesh_3d,
+                        std::vector<MeshChunk>* updated_chunks) {
+  CHECK_NOTNULL(updated_chunks);
+  updated_chunks->clear();
+  nr_updates_++;
+
+  // Triangles of the time horizon, and the landmarks in them.
+  HorizonTriangles horizon_triangles;
+  std::unordered_set<LandmarkId> horizon_lmk_ids;
+  Mesh3D::Polygon polygon;
+  for (size_t i = 0u; i < mesh_3d.getNumberOfPolygons(); i++) {
+    CHECK(mesh_3d.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
+    CHECK_EQ(polygon.size(), 3u) << "Expecting 3 vertices in triangle";
+    std::array<LandmarkId, 3> lmk_ids = {polygon[0].getLmkId(),
+                                         polygon[1].getLmkId(),
+                                         polygon[2].getLmkId()};
+    horizon_lmk_ids.insert(lmk_ids.begin(), lmk_ids.end());
+    std::sort(lmk_ids.begin(), lmk_ids.end());
+    horizon_triangles[lmk_ids] = {polygon[0].getVertexPosition(),
+                                  polygon[1].getVertexPosition(),
+                                  polygon[2].getVertexPosition()};
+  }
+
+  // Add the triangles of the last update that left the time horizon, with
+  // their last positions. The ones whose landmarks are all still in the time
+  // horizon have been replaced by a new triangulation: drop them.
+  std::unordered_set<GridIndex, GridIndexHash> changed_chunks;
+  for (const auto& triangle : horizon_triangles_) {
+    const std::array<LandmarkId, 3>& lmk_ids = triangle.first;
+    if (horizon_triangles.count(lmk_ids) > 0u) continue;
+    if (horizon_lmk_ids.count(lmk_ids[0]) > 0u &&
+        horizon_lmk_ids.count(lmk_ids[1]) > 0u &&
+        horizon_lmk_ids.count(lmk_ids[2]) > 0u) {
+      continue;
+    }
+    GridIndex chunk_index;
+    if (addTriangle(triangle.second, &chunk_index)) {
+      changed_chunks.insert(chunk_index);
+    }
+  }
+  horizon_triangles_.swap(horizon_triangles);
+
+  updated_chunks->reserve(changed_chunks.size());
+  for (const GridIndex& chunk_index : changed_chunks) {
+    updated_chunks->push_back(chunks_.at(chunk_index).chunk);
+  }
+
+  evictChunks();
+}
+
+/* -------------------------------------------------------------------------- */
+void GlobalMesh::saveChunks() const {
+  if (chunks_path_.empty()) return;
+  for (const auto& chunk : chunks_) {
+    const ChunkData& chunk_data = chunk.second;
+    LOG_IF(ERROR,
+           !saveChunk(getChunkFilename(chunk.first),
+                      chunk_data.chunk,
+                      chunk_data.vertex_weights,
+                      chunk_data.vertex_voxels))
+        << "Could not save chunk of the global mesh.";
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool GlobalMesh::saveChunk(const std::string& filename,
+                           const MeshChunk& chunk,
+                           const std::vector<uint32_t>& vertex_weights,
+                           const std::vector<GridIndex>& vertex_voxels) {
+  CHECK_EQ(chunk.vertices_.size(), vertex_weights.size());
+  CHECK_EQ(chunk.vertices_.size(), vertex_voxels.size());
+  std::ofstream stream(filename, std::ios::out | std::ios::binary);
+  if (!stream) {
+    LOG(ERROR) << "Could not open chunk file: " << filename;
+    return false;
+  }
+  stream.write(kChunkMagic, sizeof(kChunkMagic));
+  writeBinary(&stream, chunk.index_.x);
+  writeBinary(&stream, chunk.index_.y);
+  writeBinary(&stream, chunk.index_.z);
+  writeBinary(&stream, static_cast<uint32_t>(chunk.vertices_.size()));
+  writeBinary(&stream, static_cast<uint32_t>(chunk.faces_.size()));
+  for (size_t i = 0u; i < chunk.vertices_.size(); i++) {
+    writeBinary(&stream, chunk.vertices_[i].x);
+    writeBinary(&stream, chunk.vertices_[i].y);
+    writeBinary(&stream, chunk.vertices_[i].z);
+    writeBinary(&stream, vertex_weights[i]);
+    writeBinary(&stream, vertex_voxels[i].x);
+    writeBinary(&stream, vertex_voxels[i].y);
+    writeBinary(&stream, vertex_voxels[i].z);
+  }
+  for (const MeshChunk::Face& face : chunk.faces_) {
+    writeBinary(&stream, face[0]);
+    writeBinary(&stream, face[1]);
+    writeBinary(&stream, face[2]);
+  }
+  return static_cast<bool>(stream);
+}
+
+/* -------------------------------------------------------------------------- */
+bool GlobalMesh::loadChunk(const std::string& filename,
+                           MeshChunk* chunk,
+                           std::vector<uint32_t>* vertex_weights,
+                           std::vector<GridIndex>* vertex_voxels) {
+  CHECK_NOTNULL(chunk);
+  CHECK_NOTNULL(vertex_weights);
+  CHECK_NOTNULL(vertex_voxels);
+  std::ifstream stream(filename, std::ios::in | std::ios::binary);
+  if (!stream) {
+    LOG(ERROR) << "Could not open chunk file: " << filename;
+    return false;
+  }
+  char magic[sizeof(kChunkMagic)];
+  stream.read(magic, sizeof(magic));
+  if (!stream || !std::equal(magic, magic + sizeof(magic), kChunkMagic)) {
+    LOG(ERROR) << "Not a chunk file: " << filename;
+    return false;
+  }
+  uint32_t nr_vertices = 0u;
+  uint32_t nr_faces = 0u;
+  if (!readBinary(&stream, &chunk->index_.x) ||
+      !readBinary(&stream, &chunk->index_.y) ||
+      !readBinary(&stream, &chunk->index_.z) ||
+      !readBinary(&stream, &nr_vertices) || !readBinary(&stream, &nr_faces)) {
+    LOG(ERROR) << "Truncated chunk file: " << filename;
+    return false;
+  }
+  chunk->vertices_.resize(nr_vertices);
+  vertex_weights->resize(nr_vertices);
+  vertex_voxels->resize(nr_vertices);
+  for (uint32_t i = 0u; i < nr_vertices; i++) {
+    cv::Point3f& vertex = chunk->vertices_[i];
+    GridIndex& voxel = (*vertex_voxels)[i];
+    if (!readBinary(&stream, &vertex.x) || !readBinary(&stream, &vertex.y) ||
+        !readBinary(&stream, &vertex.z) ||
+        !readBinary(&stream, &(*vertex_weights)[i]) ||
+        !readBinary(&stream, &voxel.x) || !readBinary(&stream, &voxel.y) ||
+        !readBinary(&stream, &voxel.z)) {
+      LOG(ERROR) << "Truncated chunk file: " << filename;
+      return false;
+    }
+  }
+  chunk->faces_.resize(nr_faces);
+  for (MeshChunk::Face& face : chunk->faces_) {
+    if (!readBinary(&stream, &face[0]) || !readBinary(&stream, &face[1]) ||
+        !readBinary(&stream, &face[2])) {
+      LOG(ERROR) << "Truncated chunk file: " << filename;
+      return false;
+    }
+    if (face[0] >= nr_vertices || face[1] >= nr_vertices ||
+        face[2] >= nr_vertices) {
+      LOG(ERROR) << "Corrupted chunk file: " << filename;
+      return false;
+    }
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+GridIndex GlobalMesh::getGridIndex(const cv::Point3f& point,
+                                   const double& cell_size) const {
+  return GridIndex(static_cast<int32_t>(std::floor(point.x / cell_size)),
+                   static_cast<int32_t>(std::floor(point.y / cell_size)),
+                   static_cast<int32_t>(std::floor(point.z / cell_size)));
+}
+
+/* -------------------------------------------------------------------------- */
+GlobalMesh::ChunkData& GlobalMesh::getChunk(const GridIndex& chunk_index) {
+  Chunks::iterator it = chunks_.find(chunk_index);
+  if (it != chunks_.end()) {
+    // Mark as most recently used.
+    lru_chunks_.splice(
+        lru_chunks_.begin(), lru_chunks_, it->second.lru_it);
+  } else {
+    it = chunks_.emplace(chunk_index, ChunkData()).first;
+    ChunkData& chunk_data = it->second;
+    chunk_data.chunk.index_ = chunk_index;
+    const auto& disk_it = chunks_on_disk_.find(chunk_index);
+    if (disk_it != chunks_on_disk_.end()) {
+      // The camera is back to an evicted chunk.
+      if (!loadChunk(getChunkFilename(chunk_index),
+                     &chunk_data.chunk,
+                     &chunk_data.vertex_weights,
+                     &chunk_data.vertex_voxels)) {
+        LOG(ERROR) << "Could not load chunk of the global mesh, starting it "
+                      "from scratch.";
+        chunk_data.chunk = MeshChunk(chunk_index);
+        chunk_data.vertex_weights.clear();
+        chunk_data.vertex_voxels.clear();
+      }
+      chunks_on_disk_.erase(disk_it);
+      indexChunk(&chunk_data);
+    }
+    lru_chunks_.push_front(chunk_index);
+    chunk_data.lru_it = lru_chunks_.begin();
+  }
+  it->second.last_update = nr_updates_;
+  return it->second;
+}
+
+/* -------------------------------------------------------------------------- */
+bool GlobalMesh::addTriangle(const Triangle& triangle,
+                             GridIndex* chunk_index) {
+  CHECK_NOTNULL(chunk_index);
+  // The triangle goes to the chunk of its centroid.
+  *chunk_index = getGridIndex(
+      (triangle[0] + triangle[1] + triangle[2]) * (1.0f / 3.0f), chunk_size_);
+
+  // Skip triangles that collapse when merging their vertices, before adding
+  // any vertex, so that chunks have no vertices without faces.
+  const std::array<GridIndex, 3> voxels = {
+      getGridIndex(triangle[0], voxel_size_),
+      getGridIndex(triangle[1], voxel_size_),
+      getGridIndex(triangle[2], voxel_size_)};
+  if (voxels[0] == voxels[1] || voxels[1] == voxels[2] ||
+      voxels[2] == voxels[0]) {
+    return false;
+  }
+
+  ChunkData& chunk_data = getChunk(*chunk_index);
+  const MeshChunk::Face face = {addVertex(triangle[0], voxels[0], &chunk_data),
+                                addVertex(triangle[1], voxels[1], &chunk_data),
+                                addVertex(triangle[2], voxels[2], &chunk_data)};
+  MeshChunk::Face sorted_face = face;
+  std::sort(sorted_face.begin(), sorted_face.end());
+  if (!chunk_data.faces.insert(sorted_face).second) return false;
+  chunk_data.chunk.faces_.push_back(face);
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+uint32_t GlobalMesh::addVertex(const cv::Point3f& point,
+                               const GridIndex& voxel_index,
+                               ChunkData* chunk_data) const {
+  CHECK_NOTNULL(chunk_data);
+  const auto& it = chunk_data->voxel_to_vertex.find(voxel_index);
+  if (it == chunk_data->voxel_to_vertex.end()) {
+    const uint32_t vertex_idx =
+        static_cast<uint32_t>(chunk_data->chunk.vertices_.size());
+    chunk_data->chunk.vertices_.push_back(point);
+    chunk_data->vertex_weights.push_back(1u);
+    chunk_data->vertex_voxels.push_back(voxel_index);
+    chunk_data->voxel_to_vertex.emplace(voxel_index, vertex_idx);
+    return vertex_idx;
+  }
+
+  // Merge the point into the vertex of its voxel: running average. The vertex
+  // stays keyed by its voxel, even if the average crosses its border.
+  const uint32_t& vertex_idx = it->second;
+  cv::Point3f& vertex = chunk_data->chunk.vertices_[vertex_idx];
+  uint32_t& weight = chunk_data->vertex_weights[vertex_idx];
+  weight++;
+  vertex += (point - vertex) * (1.0f / static_cast<float>(weight));
+  return vertex_idx;
+}
+
+/* -------------------------------------------------------------------------- */
+void GlobalMesh::evictChunks() {
+  while (chunks_.size() > max_chunks_in_memory_) {
+    const GridIndex chunk_index = lru_chunks_.back();
+    Chunks::iterator it = chunks_.find(chunk_index);
+    CHECK(it != chunks_.end());
+    if (it->second.last_update == nr_updates_) {
+      LOG_FIRST_N(WARNING, 1)
+          << "The mesh of a single update spans more than "
+          << max_chunks_in_memory_ << " chunks of the global mesh.";
+      break;
+    }
+    if (!chunks_path_.empty()) {
+      if (saveChunk(getChunkFilename(chunk_index),
+                    it->second.chunk,
+                    it->second.vertex_weights,
+                    it->second.vertex_voxels)) {
+        chunks_on_disk_.insert(chunk_index);
+      } else {
+        LOG(ERROR) << "Could not save chunk of the global mesh, dropping it.";
+      }
+    }
+    chunks_.erase(it);
+    lru_chunks_.pop_back();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void GlobalMesh::indexChunk(ChunkData* chunk_data) const {
+  CHECK_NOTNULL(chunk_data);
+  chunk_data->voxel_to_vertex.clear();
+  chunk_data->faces.clear();
+  const MeshChunk& chunk = chunk_data->chunk;
+  CHECK_EQ(chunk_data->vertex_voxels.size(), chunk.vertices_.size());
+  for (size_t i = 0u; i < chunk_data->vertex_voxels.size(); i++) {
+    chunk_data->voxel_to_vertex.emplace(chunk_data->vertex_voxels[i],
+                                        static_cast<uint32_t>(i));
+  }
+  for (const MeshChunk::Face& face : chunk.faces_) {
+    MeshChunk::Face sorted_face = face;
+    std::sort(sorted_face.begin(), sorted_face.end());
+    chunk_data->faces.insert(sorted_face);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+std::string GlobalMesh::getChunkFilename(const GridIndex& chunk_index) const {
+  return chunks_path_ + "/chunk_" + std::to_string(chunk_index.x) + "_" +
+         std::to_string(chunk_index.y) + "_" + std::to_string(chunk_index.z) +
+         ".bin";
+}
+
+}  // namespace VIO
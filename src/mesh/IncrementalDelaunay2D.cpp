@@ -0,0 +1,605 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalDelaunay2D.cpp
+ * @brief  2D Delaunay triangulation of keypoints, updated across frames.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/IncrementalDelaunay2D.h"
+
+#include <algorithm>
+#include <array>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+constexpr IncrementalDelaunay2D::VertexId
+    IncrementalDelaunay2D::kNrEnclosingVertices;
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay2D::IncrementalDelaunay2D()
+    : img_size_(),
+      vertex_positions_(),
+      vertex_lmk_ids_(),
+      vertex_triangles_(),
+      free_vertex_ids_(),
+      lmk_id_to_vertex_map_(),
+      triangles_(),
+      free_triangle_ids_(),
+      last_triangle_(-1),
+      edge_queue_() {}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::update(
+    const cv::Size& img_size,
+    const LandmarkIds& lmk_ids,
+    const std::vector<cv::Point2f>& keypoints,
+    std::vector<cv::Vec6f>* triangulation_2D) {
+  CHECK_NOTNULL(triangulation_2D);
+  CHECK_EQ(lmk_ids.size(), keypoints.size());
+
+  // Only keypoints inside the image, one per landmark.
+  const cv::Rect2f rect(0, 0, img_size.width, img_size.height);
+  std::vector<std::pair<LandmarkId, cv::Point2f>> points;
+  std::unordered_map<LandmarkId, size_t> lmk_id_to_point;
+  points.reserve(keypoints.size());
+  for (size_t i = 0u; i < keypoints.size(); i++) {
+    if (!rect.contains(keypoints[i])) {
+      VLOG(1) << "IncrementalDelaunay2D - keypoint out of image frame.";
+      continue;
+    }
+    if (lmk_ids[i] == -1) continue;
+    if (lmk_id_to_point.emplace(lmk_ids[i], points.size()).second) {
+      points.push_back(std::make_pair(lmk_ids[i], keypoints[i]));
+    }
+  }
+
+  if (triangles_.empty() || img_size != img_size_) {
+    rebuild(img_size, points);
+  } else {
+    bool success = true;
+    // Remove the keypoints that are not tracked anymore.
+    for (VertexId v = kNrEnclosingVertices;
+         success && v < static_cast<VertexId>(vertex_positions_.size());
+         v++) {
+      if (vertex_triangles_[v] != -1 &&
+          lmk_id_to_point.find(vertex_lmk_ids_[v]) == lmk_id_to_point.end()) {
+        success = removeVertex(v);
+      }
+    }
+    // Move the tracked keypoints, and insert the new ones.
+    std::vector<size_t> duplicated_points;
+    for (size_t i = 0u; success && i < points.size(); i++) {
+      const auto it = lmk_id_to_vertex_map_.find(points[i].first);
+      if (it == lmk_id_to_vertex_map_.end()) {
+        success = insertVertex(points[i].first, points[i].second);
+      } else {
+        // Copy the vertex id, moving the vertex may erase it from the map.
+        const VertexId vertex_id = it->second;
+        success = moveVertex(vertex_id, points[i].second);
+      }
+      if (lmk_id_to_vertex_map_.find(points[i].first) ==
+          lmk_id_to_vertex_map_.end()) {
+        duplicated_points.push_back(i);
+      }
+    }
+    // The keypoint at the same pixel might have moved afterwards.
+    for (size_t k = 0u; success && k < duplicated_points.size(); k++) {
+      const size_t& i = duplicated_points[k];
+      success = insertVertex(points[i].first, points[i].second);
+    }
+    if (!success) {
+      LOG(WARNING) << "Incremental Delaunay triangulation failed, "
+                      "rebuilding it from scratch.";
+      rebuild(img_size, points);
+    }
+  }
+
+  // Retrieve the triangles between keypoints.
+  triangulation_2D->clear();
+  for (const Triangle& triangle : triangles_) {
+    if (triangle.v[0] < kNrEnclosingVertices ||
+        triangle.v[1] < kNrEnclosingVertices ||
+        triangle.v[2] < kNrEnclosingVertices) {
+      // Removed triangle, or triangle of the enclosing vertices.
+      continue;
+    }
+    const cv::Point2f& p0 = vertex_positions_[triangle.v[0]];
+    const cv::Point2f& p1 = vertex_positions_[triangle.v[1]];
+    const cv::Point2f& p2 = vertex_positions_[triangle.v[2]];
+    triangulation_2D->push_back(
+        cv::Vec6f(p0.x, p0.y, p1.x, p1.y, p2.x, p2.y));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::clear() {
+  img_size_ = cv::Size();
+  vertex_positions_.clear();
+  vertex_lmk_ids_.clear();
+  vertex_triangles_.clear();
+  free_vertex_ids_.clear();
+  lmk_id_to_vertex_map_.clear();
+  triangles_.clear();
+  free_triangle_ids_.clear();
+  last_triangle_ = -1;
+  edge_queue_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::reset(const cv::Size& img_size) {
+  clear();
+  img_size_ = img_size;
+  // Triangle enclosing the image with a large margin, so that it does not
+  // change the triangulation of the keypoints much.
+  const float size =
+      10.0f * static_cast<float>(std::max(1, std::max(img_size.width,
+                                                      img_size.height)));
+  const float cx = 0.5f * img_size.width;
+  const float cy = 0.5f * img_size.height;
+  addVertex(-1, cv::Point2f(cx - size, cy - size));
+  addVertex(-1, cv::Point2f(cx + size, cy - size));
+  addVertex(-1, cv::Point2f(cx, cy + size));
+  setTriangle(addTriangle(), 0, 1, 2, -1, -1, -1);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::rebuild(
+    const cv::Size& img_size,
+    const std::vector<std::pair<LandmarkId, cv::Point2f>>& points) {
+  reset(img_size);
+  for (const std::pair<LandmarkId, cv::Point2f>& point : points) {
+    if (!insertVertex(point.first, point.second)) {
+      LOG(ERROR) << "Could not triangulate the keypoints.";
+      reset(img_size);
+      return;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay2D::insertVertex(const LandmarkId& lmk_id,
+                                         const cv::Point2f& point) {
+  TriangleId t;
+  int i;
+  const Location location = locate(point, &t, &i);
+  if (location == Location::OUTSIDE) return false;
+  // Same pixel as another keypoint, do not triangulate it.
+  if (location == Location::ON_VERTEX) return true;
+
+  if (location == Location::INSIDE) {
+    // Split the triangle (a, b, c) in three.
+    const Triangle old_t = triangles_[t];
+    const VertexId& a = old_t.v[0];
+    const VertexId& b = old_t.v[1];
+    const VertexId& c = old_t.v[2];
+    const VertexId v = addVertex(lmk_id, point);
+    const TriangleId t_ab = t;
+    const TriangleId t_bc = addTriangle();
+    const TriangleId t_ca = addTriangle();
+    setTriangle(t_ab, a, b, v, t_bc, t_ca, old_t.n[2]);
+    setTriangle(t_bc, b, c, v, t_ca, t_ab, old_t.n[0]);
+    setTriangle(t_ca, c, a, v, t_ab, t_bc, old_t.n[1]);
+    setNeighbor(old_t.n[2], b, a, t_ab);
+    setNeighbor(old_t.n[0], c, b, t_bc);
+    setNeighbor(old_t.n[1], a, c, t_ca);
+    edge_queue_.push_back({t_ab, a, b});
+    edge_queue_.push_back({t_bc, b, c});
+    edge_queue_.push_back({t_ca, c, a});
+  } else {
+    // Split the edge (q, r) of triangles (p, q, r) and (s, r, q), and the two
+    // triangles with it.
+    const Triangle old_t = triangles_[t];
+    const TriangleId u = old_t.n[i];
+    if (u == -1) return false;
+    const Triangle old_u = triangles_[u];
+    const VertexId& p = old_t.v[i];
+    const VertexId& q = old_t.v[(i + 1) % 3];
+    const VertexId& r = old_t.v[(i + 2) % 3];
+    const int j = 3 - vertexIndex(u, q) - vertexIndex(u, r);
+    const VertexId& s = old_u.v[j];
+    const VertexId v = addVertex(lmk_id, point);
+    const TriangleId t_pq = t;
+    const TriangleId t_qs = u;
+    const TriangleId t_sr = addTriangle();
+    const TriangleId t_rp = addTriangle();
+    setTriangle(t_pq, p, q, v, t_qs, t_rp, old_t.n[(i + 2) % 3]);
+    setTriangle(t_qs, q, s, v, t_sr, t_pq, old_u.n[(j + 1) % 3]);
+    setTriangle(t_sr, s, r, v, t_rp, t_qs, old_u.n[(j + 2) % 3]);
+    setTriangle(t_rp, r, p, v, t_pq, t_sr, old_t.n[(i + 1) % 3]);
+    setNeighbor(old_t.n[(i + 2) % 3], q, p, t_pq);
+    setNeighbor(old_u.n[(j + 1) % 3], s, q, t_qs);
+    setNeighbor(old_u.n[(j + 2) % 3], r, s, t_sr);
+    setNeighbor(old_t.n[(i + 1) % 3], p, r, t_rp);
+    edge_queue_.push_back({t_pq, p, q});
+    edge_queue_.push_back({t_qs, q, s});
+    edge_queue_.push_back({t_sr, s, r});
+    edge_queue_.push_back({t_rp, r, p});
+  }
+  return legalizeEdges();
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay2D::removeVertex(const VertexId& vertex_id) {
+  CHECK_GE(vertex_id, kNrEnclosingVertices);
+  std::vector<TriangleId> star;
+  if (!getVertexStar(vertex_id, &star)) return false;
+
+  // The polygon around the vertex, and the triangles outside of its edges.
+  const size_t n = star.size();
+  std::vector<VertexId> ring(n);
+  std::vector<TriangleId> outer(n);
+  for (size_t i = 0u; i < n; i++) {
+    const int k = vertexIndex(star[i], vertex_id);
+    ring[i] = triangles_[star[i]].v[(k + 1) % 3];
+    outer[i] = triangles_[star[i]].n[k];
+  }
+
+  // Triangulate the polygon by clipping ears, preferring the ears whose
+  // circumcircle does not contain any other vertex of the polygon: for a
+  // polygon around a removed vertex, these are Delaunay.
+  std::vector<std::array<VertexId, 3>> new_triangles;
+  std::vector<VertexId> polygon = ring;
+  while (polygon.size() > 3u) {
+    const size_t m = polygon.size();
+    int best_ear = -1;
+    for (size_t i = 0u; i < m; i++) {
+      const cv::Point2f& a = vertex_positions_[polygon[(i + m - 1) % m]];
+      const cv::Point2f& b = vertex_positions_[polygon[i]];
+      const cv::Point2f& c = vertex_positions_[polygon[(i + 1) % m]];
+      if (orient(a, b, c) <= 0.0) continue;
+      bool is_ear = true;
+      bool is_delaunay = true;
+      for (size_t k = 2u; is_ear && k < m - 1u; k++) {
+        const cv::Point2f& d = vertex_positions_[polygon[(i + k) % m]];
+        is_ear = orient(a, b, d) < 0.0 || orient(b, c, d) < 0.0 ||
+                 orient(c, a, d) < 0.0;
+        is_delaunay = is_delaunay && inCircle(a, b, c, d) <= 0.0;
+      }
+      if (!is_ear) continue;
+      if (best_ear == -1 || is_delaunay) best_ear = static_cast<int>(i);
+      if (is_delaunay) break;
+    }
+    if (best_ear == -1) return false;
+    new_triangles.push_back({polygon[(best_ear + m - 1) % m],
+                             polygon[best_ear],
+                             polygon[(best_ear + 1) % m]});
+    polygon.erase(polygon.begin() + best_ear);
+  }
+  if (orient(vertex_positions_[polygon[0]],
+             vertex_positions_[polygon[1]],
+             vertex_positions_[polygon[2]]) <= 0.0) {
+    return false;
+  }
+  new_triangles.push_back({polygon[0], polygon[1], polygon[2]});
+
+  // Replace the triangles around the vertex by the new ones.
+  std::vector<TriangleId> new_triangle_ids(new_triangles.size());
+  for (size_t i = 0u; i < new_triangles.size(); i++) {
+    new_triangle_ids[i] = addTriangle();
+    setTriangle(new_triangle_ids[i],
+                new_triangles[i][0],
+                new_triangles[i][1],
+                new_triangles[i][2],
+                -1, -1, -1);
+  }
+  for (size_t i = 0u; i < new_triangles.size(); i++) {
+    const TriangleId& t = new_triangle_ids[i];
+    for (int e = 0; e < 3; e++) {
+      const VertexId& a = new_triangles[i][(e + 1) % 3];
+      const VertexId& b = new_triangles[i][(e + 2) % 3];
+      const size_t ring_idx =
+          std::find(ring.begin(), ring.end(), a) - ring.begin();
+      if (ring[(ring_idx + 1) % n] == b) {
+        // Edge of the polygon.
+        triangles_[t].n[e] = outer[ring_idx];
+        setNeighbor(outer[ring_idx], b, a, t);
+        continue;
+      }
+      for (size_t k = 0u; k < new_triangles.size(); k++) {
+        if (vertexIndex(new_triangle_ids[k], a) != -1 &&
+            vertexIndex(new_triangle_ids[k], b) != -1 && k != i) {
+          triangles_[t].n[e] = new_triangle_ids[k];
+          break;
+        }
+      }
+    }
+  }
+  for (const TriangleId& t : star) {
+    triangles_[t].v[0] = -1;
+    free_triangle_ids_.push_back(t);
+  }
+  lmk_id_to_vertex_map_.erase(vertex_lmk_ids_[vertex_id]);
+  vertex_lmk_ids_[vertex_id] = -1;
+  vertex_triangles_[vertex_id] = -1;
+  free_vertex_ids_.push_back(vertex_id);
+
+  for (const TriangleId& t : new_triangle_ids) queueEdges(t);
+  return legalizeEdges();
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay2D::moveVertex(const VertexId& vertex_id,
+                                       const cv::Point2f& point) {
+  if (vertex_positions_[vertex_id] == point) return true;
+  std::vector<TriangleId> star;
+  if (!getVertexStar(vertex_id, &star)) return false;
+
+  // The vertex can be moved in place if it stays inside the polygon around it
+  // (all its triangles keep their orientation); otherwise remove it and
+  // insert it again.
+  for (const TriangleId& t : star) {
+    const int k = vertexIndex(t, vertex_id);
+    if (orient(point,
+               vertex_positions_[triangles_[t].v[(k + 1) % 3]],
+               vertex_positions_[triangles_[t].v[(k + 2) % 3]]) <= 0.0) {
+      const LandmarkId lmk_id = vertex_lmk_ids_[vertex_id];
+      return removeVertex(vertex_id) && insertVertex(lmk_id, point);
+    }
+  }
+  vertex_positions_[vertex_id] = point;
+  for (const TriangleId& t : star) queueEdges(t);
+  return legalizeEdges();
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay2D::legalizeEdges() {
+  // Lawson flips always terminate, this only guards against numerical issues.
+  const size_t max_nr_flips = 10u * triangles_.size() + 100u;
+  size_t nr_flips = 0u;
+  while (!edge_queue_.empty()) {
+    const Edge edge = edge_queue_.back();
+    edge_queue_.pop_back();
+    // The edge might have been flipped since it was queued.
+    const int i = vertexIndex(edge.t, edge.a);
+    if (i == -1 || triangles_[edge.t].v[(i + 1) % 3] != edge.b) continue;
+    const int k = (i + 2) % 3;
+    const TriangleId& u = triangles_[edge.t].n[k];
+    if (u == -1) continue;
+
+    const cv::Point2f& p = vertex_positions_[triangles_[edge.t].v[k]];
+    const cv::Point2f& a = vertex_positions_[edge.a];
+    const cv::Point2f& b = vertex_positions_[edge.b];
+    const int j = 3 - vertexIndex(u, edge.a) - vertexIndex(u, edge.b);
+    const cv::Point2f& s = vertex_positions_[triangles_[u].v[j]];
+    if (inCircle(p, a, b, s) <= 0.0) continue;
+    // Only flip if both new triangles are valid.
+    if (orient(p, a, s) <= 0.0 || orient(s, b, p) <= 0.0) continue;
+
+    if (++nr_flips > max_nr_flips) {
+      edge_queue_.clear();
+      return false;
+    }
+    flipEdge(edge.t, k);
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::flipEdge(const TriangleId& t, const int& i) {
+  // (p, q, r) and (s, r, q) become (p, q, s) and (s, r, p).
+  const Triangle old_t = triangles_[t];
+  const TriangleId u = old_t.n[i];
+  const Triangle old_u = triangles_[u];
+  const VertexId& p = old_t.v[i];
+  const VertexId& q = old_t.v[(i + 1) % 3];
+  const VertexId& r = old_t.v[(i + 2) % 3];
+  const int j = 3 - vertexIndex(u, q) - vertexIndex(u, r);
+  const VertexId& s = old_u.v[j];
+  setTriangle(t, p, q, s, old_u.n[(j + 1) % 3], u, old_t.n[(i + 2) % 3]);
+  setTriangle(u, s, r, p, old_t.n[(i + 1) % 3], t, old_u.n[(j + 2) % 3]);
+  setNeighbor(old_u.n[(j + 1) % 3], s, q, t);
+  setNeighbor(old_t.n[(i + 1) % 3], p, r, u);
+  edge_queue_.push_back({t, q, s});
+  edge_queue_.push_back({t, p, q});
+  edge_queue_.push_back({u, s, r});
+  edge_queue_.push_back({u, r, p});
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay2D::Location IncrementalDelaunay2D::locate(
+    const cv::Point2f& point,
+    TriangleId* triangle_id,
+    int* edge_idx) const {
+  CHECK_NOTNULL(triangle_id);
+  CHECK_NOTNULL(edge_idx);
+  // Walk towards the point from the last triangle.
+  TriangleId t = last_triangle_;
+  for (size_t step = 0u; t != -1 && step < triangles_.size(); step++) {
+    const Triangle& triangle = triangles_[t];
+    TriangleId next = t;
+    for (int k = 0; k < 3; k++) {
+      // Start from a different edge at each step, to avoid walking in
+      // circles.
+      const int i = (k + step) % 3;
+      if (orient(vertex_positions_[triangle.v[(i + 1) % 3]],
+                 vertex_positions_[triangle.v[(i + 2) % 3]],
+                 point) < 0.0) {
+        next = triangle.n[i];
+        break;
+      }
+    }
+    if (next == t) {
+      *triangle_id = t;
+      return locateInTriangle(point, t, edge_idx);
+    }
+    t = next;
+  }
+
+  // The walk did not converge, check all triangles.
+  for (t = 0; t < static_cast<TriangleId>(triangles_.size()); t++) {
+    if (triangles_[t].v[0] == -1) continue;
+    const Location location = locateInTriangle(point, t, edge_idx);
+    if (location != Location::OUTSIDE) {
+      *triangle_id = t;
+      return location;
+    }
+  }
+  return Location::OUTSIDE;
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay2D::Location IncrementalDelaunay2D::locateInTriangle(
+    const cv::Point2f& point,
+    const TriangleId& triangle_id,
+    int* edge_idx) const {
+  const Triangle& triangle = triangles_[triangle_id];
+  for (int i = 0; i < 3; i++) {
+    if (vertex_positions_[triangle.v[i]] == point) {
+      *edge_idx = i;
+      return Location::ON_VERTEX;
+    }
+  }
+  Location location = Location::INSIDE;
+  for (int i = 0; i < 3; i++) {
+    const double orientation =
+        orient(vertex_positions_[triangle.v[(i + 1) % 3]],
+               vertex_positions_[triangle.v[(i + 2) % 3]],
+               point);
+    if (orientation < 0.0) return Location::OUTSIDE;
+    if (orientation == 0.0) {
+      *edge_idx = i;
+      location = Location::ON_EDGE;
+    }
+  }
+  return location;
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay2D::getVertexStar(
+    const VertexId& vertex_id,
+    std::vector<TriangleId>* star) const {
+  CHECK_NOTNULL(star);
+  star->clear();
+  const TriangleId& first = vertex_triangles_[vertex_id];
+  TriangleId t = first;
+  do {
+    const int k = vertexIndex(t, vertex_id);
+    if (k == -1 || star->size() > triangles_.size()) return false;
+    star->push_back(t);
+    // Next triangle, across the edge from the vertex to the previous one.
+    t = triangles_[t].n[(k + 1) % 3];
+  } while (t != first && t != -1);
+  return t == first;
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay2D::VertexId IncrementalDelaunay2D::addVertex(
+    const LandmarkId& lmk_id,
+    const cv::Point2f& point) {
+  VertexId vertex_id;
+  if (free_vertex_ids_.empty()) {
+    vertex_id = static_cast<VertexId>(vertex_positions_.size());
+    vertex_positions_.push_back(point);
+    vertex_lmk_ids_.push_back(lmk_id);
+    vertex_triangles_.push_back(-1);
+  } else {
+    vertex_id = free_vertex_ids_.back();
+    free_vertex_ids_.pop_back();
+    vertex_positions_[vertex_id] = point;
+    vertex_lmk_ids_[vertex_id] = lmk_id;
+  }
+  if (lmk_id != -1) lmk_id_to_vertex_map_[lmk_id] = vertex_id;
+  return vertex_id;
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay2D::TriangleId IncrementalDelaunay2D::addTriangle() {
+  if (!free_triangle_ids_.empty()) {
+    const TriangleId t = free_triangle_ids_.back();
+    free_triangle_ids_.pop_back();
+    return t;
+  }
+  triangles_.push_back({{-1, -1, -1}, {-1, -1, -1}});
+  return static_cast<TriangleId>(triangles_.size()) - 1;
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::setTriangle(const TriangleId& t,
+                                        const VertexId& v0,
+                                        const VertexId& v1,
+                                        const VertexId& v2,
+                                        const TriangleId& n0,
+                                        const TriangleId& n1,
+                                        const TriangleId& n2) {
+  Triangle& triangle = triangles_[t];
+  triangle.v[0] = v0;
+  triangle.v[1] = v1;
+  triangle.v[2] = v2;
+  triangle.n[0] = n0;
+  triangle.n[1] = n1;
+  triangle.n[2] = n2;
+  vertex_triangles_[v0] = t;
+  vertex_triangles_[v1] = t;
+  vertex_triangles_[v2] = t;
+  last_triangle_ = t;
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::setNeighbor(const TriangleId& t,
+                                        const VertexId& a,
+                                        const VertexId& b,
+                                        const TriangleId& neighbor) {
+  if (t == -1) return;
+  Triangle& triangle = triangles_[t];
+  for (int i = 0; i < 3; i++) {
+    if (triangle.v[(i + 1) % 3] == a && triangle.v[(i + 2) % 3] == b) {
+      triangle.n[i] = neighbor;
+      return;
+    }
+  }
+  LOG(FATAL) << "Triangle " << t << " has no edge from vertex " << a
+             << " to vertex " << b << ".";
+}
+
+/* -------------------------------------------------------------------------- */
+int IncrementalDelaunay2D::vertexIndex(const TriangleId& t,
+                                       const VertexId& v) const {
+  const Triangle& triangle = triangles_[t];
+  for (int i = 0; i < 3; i++) {
+    if (triangle.v[i] == v) return i;
+  }
+  return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay2D::queueEdges(const TriangleId& t) {
+  const Triangle& triangle = triangles_[t];
+  for (int i = 0; i < 3; i++) {
+    edge_queue_.push_back({t, triangle.v[i], triangle.v[(i + 1) % 3]});
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalDelaunay2D::orient(const cv::Point2f& a,
+                                     const cv::Point2f& b,
+                                     const cv::Point2f& c) {
+  return (static_cast<double>(b.x) - a.x) * (static_cast<double>(c.y) - a.y) -
+         (static_cast<double>(b.y) - a.y) * (static_cast<double>(c.x) - a.x);
+}
+
+/* -------------------------------------------------------------------------- */
+double IncrementalDelaunay2D::inCircle(const cv::Point2f& a,
+                                       const cv::Point2f& b,
+                                       const cv::Point2f& c,
+                                       const cv::Point2f& d) {
+  const double adx = static_cast<double>(a.x) - d.x;
+  const double ady = static_cast<double>(a.y) - d.y;
+  const double bdx = static_cast<double>(b.x) - d.x;
+  const double bdy = static_cast<double>(b.y) - d.y;
+  const double cdx = static_cast<double>(c.x) - d.x;
+  const double cdy = static_cast<double>(c.y) - d.y;
+  return (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) +
+         (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy) +
+         (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+}
+
+}  // namespace VIO
@@ -14,6 +14,9 @@
 
 #include "kimera-vio/mesh/Mesh.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <glog/logging.h>
 
 #include <opencv2/core/core.hpp>
@@ -25,13 +28,15 @@ namespace VIO {
  */
 template <typename VertexPositionType>
 Mesh<VertexPositionType>::Mesh(const size_t& polygon_dimension)
-    : vertex_to_lmk_id_map_(),
-      lmk_id_to_vertex_map_(),
-      vertices_mesh_(0, 1, CV_32FC3),
-      vertices_mesh_normal_(0, 1),
+    : lmk_id_to_vertex_map_(),
+      vertex_lmk_ids_(),
+      vertices_mesh_(),
+      vertices_mesh_normal_(),
       normals_computed_(false),
-      vertices_mesh_color_(0, 1, CV_8UC3),
-      polygons_mesh_(0, 1, CV_32SC1),
+      vertices_mesh_color_(),
+      vertex_polygons_(),
+      free_vertex_ids_(),
+      polygons_mesh_(),
       polygon_dimension_(polygon_dimension) {
   CHECK_GE(polygon_dimension, 3) << "A polygon must have more than 2"
                                     " vertices";
@@ -40,16 +45,17 @@ Mesh<VertexPositionType>::Mesh(const size_t& polygon_dimension)
 /* -------------------------------------------------------------------------- */
 template <typename VertexPositionType>
 Mesh<VertexPositionType>::Mesh(const Mesh<VertexPositionType>& rhs_mesh)
-    : vertex_to_lmk_id_map_(rhs_mesh.vertex_to_lmk_id_map_),
-      lmk_id_to_vertex_map_(rhs_mesh.lmk_id_to_vertex_map_),
-      vertices_mesh_(rhs_mesh.vertices_mesh_.clone()),  // CLONING!
-      vertices_mesh_normal_(
-          rhs_mesh.vertices_mesh_normal_.clone()),  // CLONING!
-      normals_computed_(false),
-      vertices_mesh_color_(rhs_mesh.vertices_mesh_color_.clone()),  // CLONING!
-      polygons_mesh_(rhs_mesh.polygons_mesh_.clone()),              // CLONING!
+    : lmk_id_to_vertex_map_(rhs_mesh.lmk_id_to_vertex_map_),
+      vertex_lmk_ids_(rhs_mesh.vertex_lmk_ids_),
+      vertices_mesh_(rhs_mesh.vertices_mesh_),
+      vertices_mesh_normal_(rhs_mesh.vertices_mesh_normal_),
+      normals_computed_(rhs_mesh.normals_computed_),
+      vertices_mesh_color_(rhs_mesh.vertices_mesh_color_),
+      vertex_polygons_(rhs_mesh.vertex_polygons_),
+      free_vertex_ids_(rhs_mesh.free_vertex_ids_),
+      polygons_mesh_(rhs_mesh.polygons_mesh_),
       polygon_dimension_(rhs_mesh.polygon_dimension_) {
-  VLOG(2) << "You are calling the copy ctor for a mesh... Cloning data.";
+  VLOG(2) << "You are calling the copy ctor for a mesh... Copying data.";
 }
 
 /* -------------------------------------------------------------------------- */
@@ -63,12 +69,14 @@ Mesh<VertexPositionType>& Mesh<VertexPositionType>::operator=(
       << " for the polygons!";
   // Deep copy internal data.
   lmk_id_to_vertex_map_ = rhs_mesh.lmk_id_to_vertex_map_;
-  vertex_to_lmk_id_map_ = rhs_mesh.vertex_to_lmk_id_map_;
-  vertices_mesh_ = rhs_mesh.vertices_mesh_.clone();
-  vertices_mesh_normal_ = rhs_mesh.vertices_mesh_normal_.clone();
+  vertex_lmk_ids_ = rhs_mesh.vertex_lmk_ids_;
+  vertices_mesh_ = rhs_mesh.vertices_mesh_;
+  vertices_mesh_normal_ = rhs_mesh.vertices_mesh_normal_;
   normals_computed_ = rhs_mesh.normals_computed_;
-  vertices_mesh_color_ = rhs_mesh.vertices_mesh_color_.clone();
-  polygons_mesh_ = rhs_mesh.polygons_mesh_.clone();
+  vertices_mesh_color_ = rhs_mesh.vertices_mesh_color_;
+  vertex_polygons_ = rhs_mesh.vertex_polygons_;
+  free_vertex_ids_ = rhs_mesh.free_vertex_ids_;
+  polygons_mesh_ = rhs_mesh.polygons_mesh_;
   return *this;
 }
 
@@ -87,73 +95,118 @@ void Mesh<VertexPositionType>::addPolygonToMesh(const Polygon& polygon) {
       << "Mesh expected polygon dimension: " << polygon_dimension_ << ".\n";
   // Reset flag to know if normals are valid or not.
   normals_computed_ = false;
-  // Specify number of point ids per face in the mesh.
-  polygons_mesh_.push_back(static_cast<int>(polygon_dimension_));
+  const PolygonId polygon_id = getNumberOfPolygons();
   // Loop over each vertex in the given polygon.
   for (const VertexType& vertex : polygon) {
     // Add or update vertex in the mesh, and encode its connectivity in the
     // mesh.
-    updateMeshDataStructures(vertex.getLmkId(), vertex.getVertexPosition(),
-                             &vertex_to_lmk_id_map_, &lmk_id_to_vertex_map_,
-                             &vertices_mesh_, &vertices_mesh_normal_,
-                             &vertices_mesh_color_, &polygons_mesh_);
+    const VertexId vertex_id = updateMeshDataStructures(
+        vertex.getLmkId(), vertex.getVertexPosition());
+    polygons_mesh_.push_back(vertex_id);
+    vertex_polygons_[vertex_id].push_back(polygon_id);
   }
 }
 
 /* -------------------------------------------------------------------------- */
 // Updates mesh data structures incrementally, by adding new landmark
 // if there was no previous id, or updating it if it was already present.
-// Provides the id of the row where the new/updated vertex is in the
-// vertices_mesh data structure.
+// Returns the id of the new/updated vertex.
 template <typename VertexPositionType>
-void Mesh<VertexPositionType>::updateMeshDataStructures(
+typename Mesh<VertexPositionType>::VertexId
+Mesh<VertexPositionType>::updateMeshDataStructures(
     const LandmarkId& lmk_id, const VertexPositionType& lmk_position,
-    std::map<VertexId, LandmarkId>* vertex_to_lmk_id_map,
-    std::map<LandmarkId, VertexId>* lmk_id_to_vertex_map,
-    cv::Mat* vertices_mesh, cv::Mat_<VertexNormal>* vertices_mesh_normal,
-    cv::Mat* vertices_mesh_color, cv::Mat* polygon_mesh,
-    const VertexColorRGB& vertex_color) const {
-  CHECK_NOTNULL(vertex_to_lmk_id_map);
-  CHECK_NOTNULL(lmk_id_to_vertex_map);
-  CHECK_NOTNULL(vertices_mesh);
-  CHECK_NOTNULL(vertices_mesh_normal);
-  CHECK_NOTNULL(vertices_mesh_color);
-  CHECK_NOTNULL(polygon_mesh);
+    const VertexColorRGB& vertex_color) {
   DCHECK(!normals_computed_) << "Normals should be invalidated before...";
+  CHECK_NE(lmk_id, -1) << "Mesh vertices need a valid landmark id.";
 
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map->end();
-  const auto& vertex_it = lmk_id_to_vertex_map->find(lmk_id);
-
-  int row_id_vertex;
   // Check whether this landmark is already in the set of vertices of the
   // mesh.
-  if (vertex_it == lmk_id_to_vertex_map_end) {
-    // New landmark, create a new entrance in the set of vertices.
-    // Store 3D points in map_points_3d.
-    vertices_mesh->push_back(lmk_position);
-    vertices_mesh_normal->push_back(VertexNormal());
-    vertices_mesh_color->push_back(vertex_color);
-    row_id_vertex = vertices_mesh->rows - 1;
-    // Book-keeping.
-    // Store the row in the vertices structure of this new landmark id.
-    (*lmk_id_to_vertex_map)[lmk_id] = row_id_vertex;
-    (*vertex_to_lmk_id_map)[row_id_vertex] = lmk_id;
-  } else {
+  const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
+  if (vertex_it != lmk_id_to_vertex_map_.end()) {
     // Update old landmark with new position.
     // But don't update the color information... Or should we?
-    vertices_mesh->at<VertexPositionType>(vertex_it->second) = lmk_position;
-    row_id_vertex = vertex_it->second;
+    vertices_mesh_[vertex_it->second] = lmk_position;
+    return vertex_it->second;
+  }
+
+  // New landmark, reuse the id of a removed vertex if any.
+  VertexId vertex_id;
+  if (!free_vertex_ids_.empty()) {
+    vertex_id = free_vertex_ids_.back();
+    free_vertex_ids_.pop_back();
+    DCHECK(vertex_polygons_[vertex_id].empty());
+    vertex_lmk_ids_[vertex_id] = lmk_id;
+    vertices_mesh_[vertex_id] = lmk_position;
+    vertices_mesh_normal_[vertex_id] = VertexNormal();
+    vertices_mesh_color_[vertex_id] = vertex_color;
+  } else {
+    vertex_id = static_cast<VertexId>(vertices_mesh_.size());
+    vertex_lmk_ids_.push_back(lmk_id);
+    vertices_mesh_.push_back(lmk_position);
+    vertices_mesh_normal_.push_back(VertexNormal());
+    vertices_mesh_color_.push_back(vertex_color);
+    vertex_polygons_.emplace_back();
+  }
+  lmk_id_to_vertex_map_[lmk_id] = vertex_id;
+  return vertex_id;
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::eraseVertexPolygon(const VertexId& vertex_id,
+                                                  const PolygonId& polygon_id) {
+  std::vector<PolygonId>& polygons = vertex_polygons_[vertex_id];
+  const auto& it = std::find(polygons.begin(), polygons.end(), polygon_id);
+  DCHECK(it != polygons.end());
+  // Order does not matter.
+  *it = polygons.back();
+  polygons.pop_back();
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::removePolygon(const PolygonId& polygon_id) {
+  const size_t nr_polygons = getNumberOfPolygons();
+  CHECK_LT(polygon_id, nr_polygons);
+  normals_computed_ = false;
+  const size_t begin = polygon_id * polygon_dimension_;
+  for (size_t j = 0u; j < polygon_dimension_; j++) {
+    eraseVertexPolygon(polygons_mesh_[begin + j], polygon_id);
+  }
+
+  // Move the last polygon in the freed slot.
+  const PolygonId last_polygon_id = nr_polygons - 1u;
+  if (polygon_id != last_polygon_id) {
+    const size_t last_begin = last_polygon_id * polygon_dimension_;
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      const VertexId& vertex_id = polygons_mesh_[last_begin + j];
+      std::vector<PolygonId>& polygons = vertex_polygons_[vertex_id];
+      std::replace(polygons.begin(), polygons.end(), last_polygon_id,
+                   polygon_id);
+      polygons_mesh_[begin + j] = vertex_id;
+    }
+  }
+  polygons_mesh_.resize(last_polygon_id * polygon_dimension_);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::removeVertex(const VertexId& vertex_id) {
+  CHECK(isVertexAlive(vertex_id));
+  // Removing a polygon may move the last one, so always take the last
+  // polygon of the vertex.
+  std::vector<PolygonId>& polygons = vertex_polygons_[vertex_id];
+  while (!polygons.empty()) {
+    removePolygon(polygons.back());
   }
-  // Store corresponding ids (row index) to the 3d point in map_points_3d.
-  // This structure encodes the connectivity of the mesh:
-  polygon_mesh->push_back(row_id_vertex);
+  lmk_id_to_vertex_map_.erase(vertex_lmk_ids_[vertex_id]);
+  vertex_lmk_ids_[vertex_id] = -1;
+  free_vertex_ids_.push_back(vertex_id);
 }
 
 /* -------------------------------------------------------------------------- */
 // Get a polygon in the mesh.
 // Returns false if there is no polygon.
-// TODO(Toni) this is constructing polygons on the fly, but we should instead
-// store polygons, not cv::Mats
 template <typename VertexPositionType>
 bool Mesh<VertexPositionType>::getPolygon(const size_t& polygon_idx,
                                           Polygon* polygon) const {
@@ -165,21 +218,18 @@ bool Mesh<VertexPositionType>::getPolygon(const size_t& polygon_idx,
     return false;
   };
 
-  DCHECK_EQ(vertices_mesh_.rows, vertices_mesh_normal_.rows);
-  DCHECK_EQ(vertices_mesh_.rows, vertices_mesh_color_.rows);
-  size_t idx_in_polygon_mesh = polygon_idx * (polygon_dimension_ + 1);
+  DCHECK_EQ(vertices_mesh_.size(), vertices_mesh_normal_.size());
+  DCHECK_EQ(vertices_mesh_.size(), vertices_mesh_color_.size());
+  const VertexId* vertex_ids = getPolygonVertexIds(polygon_idx);
   polygon->resize(polygon_dimension_);
   for (size_t j = 0; j < polygon_dimension_; j++) {
-    const int32_t& row_id_pt_j =
-        polygons_mesh_.at<int32_t>(idx_in_polygon_mesh + j + 1);
-    DCHECK(vertex_to_lmk_id_map_.find(row_id_pt_j) !=
-           vertex_to_lmk_id_map_.end());
-    DCHECK_LT(row_id_pt_j, vertices_mesh_.rows);
+    const VertexId& vertex_id = vertex_ids[j];
+    DCHECK(isVertexAlive(vertex_id));
     polygon->at(j) = Vertex<VertexPositionType>(
-        vertex_to_lmk_id_map_.at(row_id_pt_j),
-        vertices_mesh_.at<VertexPositionType>(row_id_pt_j),
-        vertices_mesh_normal_.at<VertexNormal>(row_id_pt_j),
-        vertices_mesh_color_.at<VertexColorRGB>(row_id_pt_j));
+        vertex_lmk_ids_[vertex_id],
+        vertices_mesh_[vertex_id],
+        vertices_mesh_normal_[vertex_id],
+        vertices_mesh_color_[vertex_id]);
   }
   return true;
 }
@@ -194,29 +244,43 @@ bool Mesh<VertexPosition>::getVertex(const LandmarkId& lmk_id,
                                      VertexId* vertex_id) const {
   CHECK(vertex != nullptr || vertex_id != nullptr)
       << "No output requested, are your sure you want to use this function?";
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map_.end();
   const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
-  if (vertex_it == lmk_id_to_vertex_map_end) {
+  if (vertex_it == lmk_id_to_vertex_map_.end()) {
     // We didn't find the lmk id!
     VLOG(100) << "Lmk id: " << lmk_id << " not found in mesh.";
     return false;
   } else {
     // Construct and Return the vertex.
     const VertexId& vtx_id = vertex_it->second;
-    DCHECK_EQ(vertices_mesh_.rows, vertices_mesh_normal_.rows);
-    DCHECK_EQ(vertices_mesh_.rows, vertices_mesh_color_.rows);
-    DCHECK_LT(vtx_id, vertices_mesh_.rows);
+    DCHECK_LT(vtx_id, vertices_mesh_.size());
     if (vertex_id != nullptr) *vertex_id = vtx_id;
     if (vertex != nullptr)
-      *vertex = Vertex<VertexPosition>(
-          vertex_to_lmk_id_map_.at(vtx_id),
-          vertices_mesh_.at<VertexPosition>(vtx_id),
-          vertices_mesh_normal_.at<VertexNormal>(vtx_id),
-          vertices_mesh_color_.at<VertexColorRGB>(vtx_id));
+      *vertex = Vertex<VertexPosition>(vertex_lmk_ids_[vtx_id],
+                                       vertices_mesh_[vtx_id],
+                                       vertices_mesh_normal_[vtx_id],
+                                       vertices_mesh_color_[vtx_id]);
     return true;  // Meaning we found the vertex.
   }
 }
 
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::getVertexNeighbors(
+    const VertexId& vertex_id,
+    std::vector<VertexId>* neighbors) const {
+  CHECK_NOTNULL(neighbors);
+  neighbors->clear();
+  for (const PolygonId& polygon_id : vertex_polygons_.at(vertex_id)) {
+    const VertexId* vertex_ids = getPolygonVertexIds(polygon_id);
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      if (vertex_ids[j] != vertex_id) neighbors->push_back(vertex_ids[j]);
+    }
+  }
+  std::sort(neighbors->begin(), neighbors->end());
+  neighbors->erase(std::unique(neighbors->begin(), neighbors->end()),
+                   neighbors->end());
+}
+
 /* -------------------------------------------------------------------------- */
 // Retrieve per vertex normals of the mesh.
 template <typename VertexPositionType>
@@ -224,22 +288,17 @@ void Mesh<VertexPositionType>::computePerVertexNormals() {
   CHECK_EQ(polygon_dimension_, 3) << "Normals are only valid for dim 3 meshes.";
   LOG_IF(ERROR, normals_computed_) << "Normals have been computed already...";
 
-  size_t n_vtx = getNumberOfUniqueVertices();
-  std::vector<int> counts(n_vtx, 0);
-
   // Set all per-vertex normals in mesh to 0, since we want to average per-face
   // normals.
   clearVertexNormals();
 
   // Walk through triangles and compute averaged vertex normals.
-  Polygon polygon;
   for (size_t i = 0; i < getNumberOfPolygons(); i++) {
-    CHECK(getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    DCHECK_EQ(polygon.size(), 3);
     // TODO(Toni): it would be better if we could do a polygon.getNormal();
-    const VertexPositionType& p1 = polygon.at(0).getVertexPosition();
-    const VertexPositionType& p2 = polygon.at(1).getVertexPosition();
-    const VertexPositionType& p3 = polygon.at(2).getVertexPosition();
+    const VertexId* vertex_ids = getPolygonVertexIds(i);
+    const VertexPositionType& p1 = vertices_mesh_[vertex_ids[0]];
+    const VertexPositionType& p2 = vertices_mesh_[vertex_ids[1]];
+    const VertexPositionType& p3 = vertices_mesh_[vertex_ids[2]];
 
     // Outward-facing normal.
     VertexPositionType v21(p2 - p1);
@@ -258,36 +317,25 @@ void Mesh<VertexPositionType>::computePerVertexNormals() {
     DCHECK_LE(std::fabs(v21.ddot(v31)), 1.0 - epsilon)
         << "Cross product of aligned vectors.";
 
-    // Compute per vertex averaged normals.
-    /// Indices of vertices
-    const VertexId& p1_idx = lmk_id_to_vertex_map_.at(polygon.at(0).getLmkId());
-    const VertexId& p2_idx = lmk_id_to_vertex_map_.at(polygon.at(1).getLmkId());
-    const VertexId& p3_idx = lmk_id_to_vertex_map_.at(polygon.at(2).getLmkId());
-    /// Sum of normals per vertex
-    vertices_mesh_normal_.at<VertexNormal>(p1_idx) += normal;
-    vertices_mesh_normal_.at<VertexNormal>(p2_idx) += normal;
-    vertices_mesh_normal_.at<VertexNormal>(p3_idx) += normal;
-    /// Increase counts of normals added per vertex
-    counts[p1_idx]++;
-    counts[p2_idx]++;
-    counts[p3_idx]++;
+    // Sum of normals per vertex.
+    vertices_mesh_normal_[vertex_ids[0]] += normal;
+    vertices_mesh_normal_[vertex_ids[1]] += normal;
+    vertices_mesh_normal_[vertex_ids[2]] += normal;
   }
 
-  DCHECK_EQ(counts.size(), vertices_mesh_normal_.rows);
-  // Average and normalize normals.
-  // clang-format off
-  // #pragma omp parallel for num_threads(params.omp_num_threads) schedule(static, params.omp_chunk_size)
-  // clang-format on
-  for (int i = 0; i < vertices_mesh_normal_.rows; i++) {
-    VertexNormal& normal = vertices_mesh_normal_.at<VertexNormal>(i);
+  // Average and normalize normals: the number of normals added per vertex is
+  // the number of polygons that use it.
+  for (size_t i = 0; i < vertices_mesh_normal_.size(); i++) {
+    if (vertex_polygons_[i].empty()) continue;
+    VertexNormal& normal = vertices_mesh_normal_[i];
     // Average
-    normal /= counts[i];
+    normal /= static_cast<float>(vertex_polygons_[i].size());
     // Normalize
     double norm = cv::norm(normal);
     DCHECK_GT(norm, 0.0);
     normal /= norm;
   }
-  return;
+  normals_computed_ = true;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -298,45 +346,62 @@ void Mesh<VertexPositionType>::computePerVertexNormals() {
 template <typename VertexPositionType>
 bool Mesh<VertexPositionType>::setVertexColor(
     const LandmarkId& lmk_id, const VertexColorRGB& vertex_color) {
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map_.end();
   const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
-  if (vertex_it == lmk_id_to_vertex_map_end) {
+  if (vertex_it == lmk_id_to_vertex_map_.end()) {
     // We didn't find the lmk id!
     VLOG(100) << "Lmk id: " << lmk_id << " not found in mesh.";
     return false;
   } else {
     // Color the vertex.
-    vertices_mesh_color_.at<VertexColorRGB>(vertex_it->second) = vertex_color;
+    vertices_mesh_color_[vertex_it->second] = vertex_color;
     return true;  // Meaning we found the vertex.
   }
 }
 
 /* -------------------------------------------------------------------------- */
+// One row per vertex id, removed vertices included (no polygon uses them).
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::convertVerticesMeshToMat(
     cv::Mat* vertices_mesh) const {
   CHECK_NOTNULL(vertices_mesh);
-  *vertices_mesh = vertices_mesh_.clone();
+  *vertices_mesh = cv::Mat(vertices_mesh_, true);
 }
 
 /* -------------------------------------------------------------------------- */
+// Raw integer list of the form: (n,id1_a,id2_a,...,idn_a,
+// n,id1_b,id2_b,...,idn_b, ..., n, ... idn_x)
+// where n is the number of points per polygon, and id is a zero-offset
+// index into the associated row in the vertices mesh.
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::convertPolygonsMeshToMat(
     cv::Mat* polygons_mesh) const {
   CHECK_NOTNULL(polygons_mesh);
-  *polygons_mesh = polygons_mesh_.clone();
+  const size_t nr_polygons = getNumberOfPolygons();
+  *polygons_mesh =
+      cv::Mat(nr_polygons * (polygon_dimension_ + 1u), 1, CV_32SC1);
+  int32_t* data = polygons_mesh->ptr<int32_t>();
+  for (size_t i = 0u; i < nr_polygons; i++) {
+    *data++ = static_cast<int32_t>(polygon_dimension_);
+    const VertexId* vertex_ids = getPolygonVertexIds(i);
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      *data++ = vertex_ids[j];
+    }
+  }
 }
 
 /* -------------------------------------------------------------------------- */
 // Reset all data structures of the mesh.
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::clearMesh() {
-  vertices_mesh_ = cv::Mat(0, 1, CV_32FC3);
-  vertices_mesh_normal_ = cv::Mat_<VertexNormal>(0, 1);
-  vertices_mesh_color_ = cv::Mat(0, 1, CV_8UC3);
-  polygons_mesh_ = cv::Mat(0, 1, CV_32SC1);
-  vertex_to_lmk_id_map_.clear();
   lmk_id_to_vertex_map_.clear();
+  vertex_lmk_ids_.clear();
+  vertices_mesh_.clear();
+  vertices_mesh_normal_.clear();
+  normals_computed_ = false;
+  vertices_mesh_color_.clear();
+  vertex_polygons_.clear();
+  free_vertex_ids_.clear();
+  polygons_mesh_.clear();
 }
 
 // explicit instantiations
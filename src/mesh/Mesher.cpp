@@ -14,6 +14,8 @@
 
 #include "kimera-vio/mesh/Mesher.h"
 
+#include <cstring>
+#include <unordered_map>
 #include <utility>  // for make_pair
 #include <vector>
 
@@ -21,8 +23,12 @@
 #include <glog/logging.h>
 #include <math.h>
 #include <algorithm>
+#include <functional>  // for greater
 #include <opencv2/imgproc.hpp>
 
+#include <boost/filesystem.hpp>  // to create folders
+
+#include "kimera-vio/mesh/TriangleFilter.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
 
@@ -33,10 +39,31 @@ DEFINE_bool(add_extra_lmks_from_stereo, false,
 DEFINE_bool(reduce_mesh_to_time_horizon, true,
             "Reduce mesh vertices to the "
             "landmarks available in current optimization's time horizon.");
+DEFINE_bool(trim_mesh_in_place, true,
+            "Trim the mesh to the time horizon in place, instead of "
+            "rebuilding it at every keyframe.");
+DEFINE_bool(incremental_delaunay_2d, true,
+            "Update the 2D triangulation of the keypoints from the previous "
+            "keyframe, instead of triangulating all keypoints again.");
 DEFINE_bool(compute_per_vertex_normals, false,
             "Compute per-vertex normals,"
             "this is for visualization in RVIZ, it is costly!");
 
+// Global mesh of the whole map.
+DEFINE_bool(global_mesh, false,
+            "Accumulate the meshes of the time horizon into a mesh of the "
+            "whole map, split in chunks.");
+DEFINE_double(global_mesh_voxel_size, 0.05,
+              "Distance under which vertices of the global mesh are merged.");
+DEFINE_double(global_mesh_chunk_size, 4.0,
+              "Side of the cube covered by a chunk of the global mesh.");
+DEFINE_int32(global_mesh_max_chunks_in_memory, 64,
+             "Chunks of the global mesh kept in memory, the least recently "
+             "used ones are evicted to disk.");
+DEFINE_string(global_mesh_chunks_path, "./global_mesh_chunks",
+              "Folder where chunks of the global mesh are evicted to. If "
+              "empty, evicted chunks are dropped.");
+
 // Mesh 2D return, for semantic segmentation.
 // TODO REMOVE THIS FLAG MAKE MESH_2D Optional!
 DEFINE_bool(return_mesh_2d, false,
@@ -143,9 +170,31 @@ DEFINE_int32(z_histogram_max_number_of_peaks_to_select, 3,
 
 namespace VIO {
 
+namespace {
+// Minimum number of polygons per block when looping over the mesh in
+// parallel, so that small meshes are not split.
+constexpr size_t kMinPolygonsPerBlock = 256u;
+
+// Number of blocks to split the polygons of the mesh in, one per thread.
+int getNumberOfPolygonBlocks(const size_t& nr_polygons) {
+  return std::max(
+      1,
+      std::min(cv::getNumThreads(),
+               static_cast<int>(nr_polygons / kMinPolygonsPerBlock)));
+}
+
+// Key to look up a pixel by its exact coordinates.
+uint64_t getPixelKey(const cv::Point2f& pixel) {
+  uint32_t x_bits, y_bits;
+  std::memcpy(&x_bits, &pixel.x, sizeof(x_bits));
+  std::memcpy(&y_bits, &pixel.y, sizeof(y_bits));
+  return (static_cast<uint64_t>(x_bits) << 32) | y_bits;
+}
+}  // namespace
+
 /* -------------------------------------------------------------------------- */
 Mesher::Mesher(const MesherParams& mesher_params)
-    : mesher_params_(mesher_params), mesh_3d_() {
+    : mesher_params_(mesher_params), mesh_3d_(), global_mesh_(nullptr) {
   // Create z histogram.
   std::vector<int> hist_size = {FLAGS_z_histogram_bins};
   // We cannot use an array of doubles here bcs the function cv::calcHist asks
@@ -171,6 +220,18 @@ Mesher::Mesher(const MesherParams& mesher_params)
   std::vector<int> channels_2d = {0, 1};
   hist_2d_ = Histogram(1, channels_2d, cv::Mat(), 2, hist_2d_size, ranges_2d,
                        true, false);
+
+  if (FLAGS_global_mesh) {
+    if (!FLAGS_global_mesh_chunks_path.empty()) {
+      boost::filesystem::create_directories(FLAGS_global_mesh_chunks_path);
+    }
+    CHECK_GT(FLAGS_global_mesh_max_chunks_in_memory, 0);
+    global_mesh_ = VIO::make_unique<GlobalMesh>(
+        FLAGS_global_mesh_voxel_size,
+        FLAGS_global_mesh_chunk_size,
+        static_cast<size_t>(FLAGS_global_mesh_max_chunks_in_memory),
+        FLAGS_global_mesh_chunks_path);
+  }
 }
 
 MesherOutput::UniquePtr Mesher::spinOnce(const MesherInput& input) {
@@ -187,6 +248,10 @@ MesherOutput::UniquePtr Mesher::spinOnce(const MesherInput& input) {
   getVerticesMesh(&(mesher_output_payload->vertices_mesh_));
   getPolygonsMesh(&(mesher_output_payload->polygons_mesh_));
   mesher_output_payload->mesh_3d_ = mesh_3d_;
+  if (global_mesh_) {
+    global_mesh_->update(mesh_3d_,
+                         &(mesher_output_payload->updated_mesh_chunks_));
+  }
   return mesher_output_payload;
 }
 
@@ -252,20 +317,25 @@ void Mesher::filterOutBadTriangles(const gtsam::Pose3& leftCameraPose,
                                    double minRatioBetweenLargestAnSmallestSide,
                                    double min_elongation_ratio,
                                    double maxTriangleSide) {
-  Mesh3D mesh_output;
-
   // Loop over each face in the mesh.
-  Mesh3D::Polygon polygon;
+  std::vector<Mesh3D::Polygon> polygons(mesh_3d_.getNumberOfPolygons());
+  for (size_t i = 0; i < polygons.size(); i++) {
+    CHECK(mesh_3d_.getPolygon(i, &polygons[i]))
+        << "Could not retrieve polygon.";
+  }
 
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), 3) << "Expecting 3 vertices in triangle";
-    // Check if triangle is good.
-    if (!isBadTriangle(polygon, leftCameraPose,
-                       minRatioBetweenLargestAnSmallestSide,
-                       min_elongation_ratio, maxTriangleSide)) {
-      mesh_output.addPolygonToMesh(polygon);
-    }
+  // Check which triangles are good.
+  std::vector<uint8_t> is_good;
+  findGoodTriangles(polygons,
+                    leftCameraPose,
+                    minRatioBetweenLargestAnSmallestSide,
+                    min_elongation_ratio,
+                    maxTriangleSide,
+                    &is_good);
+
+  Mesh3D mesh_output;
+  for (size_t i = 0; i < polygons.size(); i++) {
+    if (is_good[i]) mesh_output.addPolygonToMesh(polygons[i]);
   }
 
   mesh_3d_ = mesh_output;
@@ -273,57 +343,28 @@ void Mesher::filterOutBadTriangles(const gtsam::Pose3& leftCameraPose,
 
 /* -------------------------------------------------------------------------- */
 // Try to reject bad triangles, corresponding to outliers.
-bool Mesher::isBadTriangle(
-    const Mesh3D::Polygon& polygon,
+void Mesher::findGoodTriangles(
+    const std::vector<Mesh3D::Polygon>& polygons,
     const gtsam::Pose3& left_camera_pose,
     const double& min_ratio_between_largest_an_smallest_side,
     const double& min_elongation_ratio,
-    const double& max_triangle_side) const {
-  CHECK_EQ(polygon.size(), 3) << "Expecting 3 vertices in triangle";
-  const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-  const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-  const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-  double ratioSides_i = 0;
-  double ratioTangentialRadial_i = 0;
-  double maxTriangleSide_i = 0;
-
-  // Check geometric dimensions.
-  // Measure sides.
-  double d12 = cv::norm(p1 - p2);
-  double d23 = cv::norm(p2 - p3);
-  double d31 = cv::norm(p3 - p1);
-
-  // If threshold is disabled, avoid computation.
-  if (min_ratio_between_largest_an_smallest_side > 0.0) {
-    ratioSides_i = getRatioBetweenSmallestAndLargestSide(d12, d23, d31);
-  }
-
-  // If threshold is disabled, avoid computation.
-  if (min_elongation_ratio > 0.0) {
-    ratioTangentialRadial_i = getRatioBetweenTangentialAndRadialDisplacement(
-        p1, p2, p3, left_camera_pose);
-  }
-
-  // If threshold is disabled, avoid computation.
-  if (max_triangle_side > 0.0) {
-    std::array<double, 3> sidesLen;
-    sidesLen.at(0) = d12;
-    sidesLen.at(1) = d23;
-    sidesLen.at(2) = d31;
-    const auto& it = std::max_element(sidesLen.begin(), sidesLen.end());
-    DCHECK(it != sidesLen.end());
-    maxTriangleSide_i = *it;
-  }
-
-  // Check if triangle is not elongated.
-  if ((ratioSides_i >= min_ratio_between_largest_an_smallest_side) &&
-      (ratioTangentialRadial_i >= min_elongation_ratio) &&
-      (maxTriangleSide_i <= max_triangle_side)) {
-    return false;
-  } else {
-    return true;
+    const double& max_triangle_side,
+    std::vector<uint8_t>* is_good) const {
+  CHECK_NOTNULL(is_good);
+  TrianglesSoA triangles;
+  triangles.reserve(polygons.size());
+  for (const Mesh3D::Polygon& polygon : polygons) {
+    CHECK_EQ(polygon.size(), 3) << "Expecting 3 vertices in triangle";
+    triangles.push_back(polygon[0].getVertexPosition(),
+                        polygon[1].getVertexPosition(),
+                        polygon[2].getVertexPosition());
   }
+  TriangleFilter::filterBadTriangles(triangles,
+                                     left_camera_pose,
+                                     min_ratio_between_largest_an_smallest_side,
+                                     min_elongation_ratio,
+                                     max_triangle_side,
+                                     is_good);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -394,6 +435,21 @@ void Mesher::populate3dMesh(const std::vector<cv::Vec6f>& mesh_2d_pixels,
   Mesh3D::Polygon polygon;
   polygon.resize(3);
 
+  // Landmark id of each keypoint, instead of searching for each pixel in all
+  // keypoints, since there are many more with dense stereo. If keypoints are
+  // repeated, the first one is kept, like Frame::findLmkIdFromPixel does.
+  std::unordered_map<uint64_t, LandmarkId> pixel_to_lmk_id;
+  pixel_to_lmk_id.reserve(keypoints.size());
+  for (size_t i = 0; i < keypoints.size(); i++) {
+    pixel_to_lmk_id.emplace(getPixelKey(keypoints[i]), landmarks.at(i));
+  }
+
+  // Polygons with all vertices in points_with_id_map, and their faces.
+  std::vector<Mesh3D::Polygon> polygons;
+  std::vector<Mesh2D::Polygon> faces;
+  polygons.reserve(mesh_2d_pixels.size());
+  faces.reserve(mesh_2d_pixels.size());
+
   // Iterate over the 2d mesh triangles.
   for (size_t i = 0; i < mesh_2d_pixels.size(); i++) {
     const cv::Vec6f& triangle_2d = mesh_2d_pixels.at(i);
@@ -405,8 +461,9 @@ void Mesher::populate3dMesh(const std::vector<cv::Vec6f>& mesh_2d_pixels,
       const cv::Point2f pixel(triangle_2d[j * 2], triangle_2d[j * 2 + 1]);
 
       // Extract landmark id corresponding to this pixel.
-      const LandmarkId& lmk_id(
-          Frame::findLmkIdFromPixel(pixel, keypoints, landmarks));
+      const auto& pixel_it = pixel_to_lmk_id.find(getPixelKey(pixel));
+      CHECK(pixel_it != pixel_to_lmk_id.end());
+      const LandmarkId& lmk_id = pixel_it->second;
       CHECK_NE(lmk_id, -1);
 
       // Try to find this landmark id in points_with_id_map.
@@ -427,19 +484,10 @@ void Mesher::populate3dMesh(const std::vector<cv::Vec6f>& mesh_2d_pixels,
         static const size_t loop_end = triangle_2d.rows / 2 - 1;
         if (j == loop_end) {
           // Last iteration.
-          // Filter out bad polygons.
-          if (!isBadTriangle(polygon,
-                             left_cam_pose,
-                             min_ratio_largest_smallest_side,
-                             min_elongation_ratio,
-                             max_triangle_side)) {
-            // Save the valid triangular polygon, since it has all vertices in
-            // points_with_id_map.
-            mesh_3d_.addPolygonToMesh(polygon);
-            if (mesh_2d != nullptr) {
-              mesh_2d->addPolygonToMesh(face);
-            }
-          }
+          // Keep the triangular polygon, since it has all vertices in
+          // points_with_id_map.
+          polygons.push_back(polygon);
+          faces.push_back(face);
         }
       } else {
         // Do not save current polygon, since it has at least one vertex that
@@ -451,6 +499,23 @@ void Mesher::populate3dMesh(const std::vector<cv::Vec6f>& mesh_2d_pixels,
       }
     }
   }
+
+  // Filter out bad polygons.
+  std::vector<uint8_t> is_good;
+  findGoodTriangles(polygons,
+                    left_cam_pose,
+                    min_ratio_largest_smallest_side,
+                    min_elongation_ratio,
+                    max_triangle_side,
+                    &is_good);
+  for (size_t i = 0; i < polygons.size(); i++) {
+    if (!is_good[i]) continue;
+    // Save the valid triangular polygon.
+    mesh_3d_.addPolygonToMesh(polygons[i]);
+    if (mesh_2d != nullptr) {
+      mesh_2d->addPolygonToMesh(faces[i]);
+    }
+  }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -466,11 +531,21 @@ void Mesher::updatePolygonMeshToTimeHorizon(
   LOG_IF(WARNING, points_with_id_map.size() == 0u)
       << "Missing landmark information for the Mesher: "
          "cannot trim 3D mesh to time horizon.";
+  if (FLAGS_trim_mesh_in_place) {
+    trimPolygonMeshToTimeHorizon(points_with_id_map,
+                                 leftCameraPose,
+                                 min_ratio_largest_smallest_side,
+                                 max_triangle_side,
+                                 reduce_mesh_to_time_horizon);
+    VLOG(10) << "Finished updatePolygonMeshToTimeHorizon.";
+    return;
+  }
   const auto& end = points_with_id_map.end();
 
   // Loop over each face in the mesh.
   Mesh3D::Polygon polygon;
-  Mesh3D mesh_output;
+  std::vector<Mesh3D::Polygon> polygons;
+  polygons.reserve(mesh_3d_.getNumberOfPolygons());
   for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
     CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
     bool save_polygon = true;
@@ -498,22 +573,112 @@ void Mesher::updatePolygonMeshToTimeHorizon(
       }
     }
 
-    if (save_polygon) {
-      // Refilter polygons, as the updated vertices might make it unvalid.
-      if (!isBadTriangle(
-              polygon, leftCameraPose, min_ratio_largest_smallest_side,
-              -1.0,  // elongation test is invalid, no per-frame concept
-              max_triangle_side)) {
-        // Finally add the polygon to the mesh.
-        mesh_output.addPolygonToMesh(polygon);
-      }
-    }
+    if (save_polygon) polygons.push_back(polygon);
+  }
+
+  // Refilter polygons, as the updated vertices might make them unvalid.
+  std::vector<uint8_t> is_good;
+  findGoodTriangles(polygons,
+                    leftCameraPose,
+                    min_ratio_largest_smallest_side,
+                    -1.0,  // elongation test is invalid, no per-frame concept
+                    max_triangle_side,
+                    &is_good);
+  Mesh3D mesh_output;
+  for (size_t i = 0; i < polygons.size(); i++) {
+    // Finally add the polygon to the mesh.
+    if (is_good[i]) mesh_output.addPolygonToMesh(polygons[i]);
   }
 
   mesh_3d_ = mesh_output;
   VLOG(10) << "Finished updatePolygonMeshToTimeHorizon.";
 }
 
+/* -------------------------------------------------------------------------- */
+void Mesher::trimPolygonMeshToTimeHorizon(
+    const PointsWithIdMap& points_with_id_map,
+    const gtsam::Pose3& leftCameraPose,
+    double min_ratio_largest_smallest_side,
+    double max_triangle_side,
+    const bool& reduce_mesh_to_time_horizon) {
+  // Remove the vertices that left the time horizon, with their polygons.
+  // Their neighbors are dropped too if no polygon uses them anymore, as they
+  // would not be in a rebuilt mesh.
+  if (reduce_mesh_to_time_horizon) {
+    std::vector<Mesh3D::VertexId> neighbors;
+    for (size_t i = 0u; i < mesh_3d_.getNumberOfUniqueVertices(); i++) {
+      const Mesh3D::VertexId vertex_id = static_cast<Mesh3D::VertexId>(i);
+      if (!mesh_3d_.isVertexAlive(vertex_id) ||
+          points_with_id_map.find(mesh_3d_.getVertexLmkId(vertex_id)) !=
+              points_with_id_map.end()) {
+        continue;
+      }
+      mesh_3d_.getVertexNeighbors(vertex_id, &neighbors);
+      mesh_3d_.removeVertex(vertex_id);
+      for (const Mesh3D::VertexId& neighbor : neighbors) {
+        if (mesh_3d_.getVertexPolygons(neighbor).empty()) {
+          mesh_3d_.removeVertex(neighbor);
+        }
+      }
+    }
+  }
+
+  // Update the positions of the vertices in the time horizon, and collect
+  // the polygons that use them.
+  std::vector<Mesh3D::PolygonId> updated_polygons;
+  for (const auto& point_with_id : points_with_id_map) {
+    Mesh3D::VertexId vertex_id;
+    if (!mesh_3d_.getVertex(point_with_id.first, nullptr, &vertex_id)) {
+      continue;
+    }
+    const gtsam::Point3& point = point_with_id.second;
+    mesh_3d_.setVertexPosition(vertex_id,
+                               Vertex3D(static_cast<float>(point.x()),
+                                        static_cast<float>(point.y()),
+                                        static_cast<float>(point.z())));
+    const std::vector<Mesh3D::PolygonId>& polygons =
+        mesh_3d_.getVertexPolygons(vertex_id);
+    updated_polygons.insert(
+        updated_polygons.end(), polygons.begin(), polygons.end());
+  }
+
+  // Refilter the updated polygons, as the updated vertices might make them
+  // invalid. Removing a polygon moves the last one in its place, so go from
+  // the last polygon to the first one.
+  std::sort(updated_polygons.begin(),
+            updated_polygons.end(),
+            std::greater<Mesh3D::PolygonId>());
+  updated_polygons.erase(
+      std::unique(updated_polygons.begin(), updated_polygons.end()),
+      updated_polygons.end());
+  std::vector<Mesh3D::Polygon> polygons(updated_polygons.size());
+  for (size_t i = 0u; i < updated_polygons.size(); i++) {
+    CHECK(mesh_3d_.getPolygon(updated_polygons[i], &polygons[i]))
+        << "Could not retrieve polygon.";
+  }
+  // Removing a polygon does not change the polygons with smaller ids, so all
+  // of them can be checked at once.
+  std::vector<uint8_t> is_good;
+  findGoodTriangles(polygons,
+                    leftCameraPose,
+                    min_ratio_largest_smallest_side,
+                    -1.0,  // elongation test is invalid, no per-frame concept
+                    max_triangle_side,
+                    &is_good);
+  for (size_t i = 0u; i < updated_polygons.size(); i++) {
+    if (is_good[i]) continue;
+    mesh_3d_.removePolygon(updated_polygons[i]);
+    // Drop the vertices that are not used anymore, as a rebuilt mesh would.
+    for (const Mesh3D::VertexType& vertex : polygons[i]) {
+      Mesh3D::VertexId vertex_id;
+      CHECK(mesh_3d_.getVertex(vertex.getLmkId(), nullptr, &vertex_id));
+      if (mesh_3d_.getVertexPolygons(vertex_id).empty()) {
+        mesh_3d_.removeVertex(vertex_id);
+      }
+    }
+  }
+}
+
 /* -------------------------------------------------------------------------- */
 // Calculate normals of polygonMesh.
 // TODO(Toni): put this inside the mesh itself...
@@ -525,30 +690,35 @@ void Mesher::calculateNormals(std::vector<cv::Point3f>* normals) {
       << "Expecting 3 vertices in triangle.";
 
   // Brute force, ideally only call when a new triangle appears...
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
   normals->clear();
-  normals->resize(
-      mesh_3d_.getNumberOfPolygons());  // TODO Assumes we have triangles...
+  normals->resize(nr_polygons);  // TODO Assumes we have triangles...
 
-  // Loop over each polygon face in the mesh.
+  // Loop over each polygon face in the mesh, in parallel.
   // TODO there are far too many loops over the total number of Polygon faces...
   // Should put them all in the same loop!
-  Mesh3D::Polygon polygon;
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    DCHECK_EQ(polygon.size(), 3);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    cv::Point3f normal;
-    CHECK(calculateNormal(p1, p2, p3, &normal));
-    // Mat normal2;
-    // viz::computeNormals(mesh, normal2);
-    // https://github.com/zhoushiwei/Viz-opencv/blob/master/Viz/main.cpp
-
-    // Store normal to triangle i.
-    normals->at(i) = normal;
-  }
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(nr_polygons)),
+      [&](const cv::Range& range) {
+        Mesh3D::Polygon polygon;
+        for (int i = range.start; i < range.end; i++) {
+          CHECK(mesh_3d_.getPolygon(i, &polygon))
+              << "Could not retrieve polygon.";
+          DCHECK_EQ(polygon.size(), 3);
+          const Vertex3D& p1 = polygon.at(0).getVertexPosition();
+          const Vertex3D& p2 = polygon.at(1).getVertexPosition();
+          const Vertex3D& p3 = polygon.at(2).getVertexPosition();
+
+          cv::Point3f normal;
+          CHECK(calculateNormal(p1, p2, p3, &normal));
+          // Mat normal2;
+          // viz::computeNormals(mesh, normal2);
+          // https://github.com/zhoushiwei/Viz-opencv/blob/master/Viz/main.cpp
+
+          // Store normal to triangle i.
+          normals->at(i) = normal;
+        }
+      });
 }
 
 /* -------------------------------------------------------------------------- */
@@ -601,13 +771,19 @@ void Mesher::clusterNormalsAroundAxis(const cv::Point3f& axis,
                                       const std::vector<cv::Point3f>& normals,
                                       const double& tolerance,
                                       std::vector<int>* cluster_normals_idx) {
-  size_t idx = 0;
+  CHECK_NOTNULL(cluster_normals_idx);
   // TODO, this should be in the same loop as the one calculating
   // the normals...
-  for (const cv::Point3f& normal : normals) {
-    if (isNormalAroundAxis(axis, normal, tolerance))
-      cluster_normals_idx->push_back(idx);
-    idx++;
+  std::vector<uint8_t> is_in_cluster(normals.size(), 0u);
+  cv::parallel_for_(cv::Range(0, static_cast<int>(normals.size())),
+                    [&](const cv::Range& range) {
+                      for (int i = range.start; i < range.end; i++) {
+                        is_in_cluster[i] =
+                            isNormalAroundAxis(axis, normals[i], tolerance);
+                      }
+                    });
+  for (size_t idx = 0u; idx < normals.size(); idx++) {
+    if (is_in_cluster[idx]) cluster_normals_idx->push_back(idx);
   }
 }
 
@@ -632,14 +808,18 @@ bool Mesher::isNormalAroundAxis(const cv::Point3f& axis,
 void Mesher::clusterNormalsPerpendicularToAxis(
     const cv::Point3f& axis, const std::vector<cv::Point3f>& normals,
     const double& tolerance, std::vector<int>* cluster_normals_idx) {
-  size_t idx = 0;
-  static constexpr bool log_normals = false;
-  std::vector<cv::Point3f> cluster_normals;
-  for (const cv::Point3f& normal : normals) {
-    if (isNormalPerpendicularToAxis(axis, normal, tolerance)) {
-      cluster_normals_idx->push_back(idx);
-    }
-    idx++;
+  CHECK_NOTNULL(cluster_normals_idx);
+  std::vector<uint8_t> is_in_cluster(normals.size(), 0u);
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(normals.size())),
+      [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+          is_in_cluster[i] =
+              isNormalPerpendicularToAxis(axis, normals[i], tolerance);
+        }
+      });
+  for (size_t idx = 0u; idx < normals.size(); idx++) {
+    if (is_in_cluster[idx]) cluster_normals_idx->push_back(idx);
   }
 }
 
@@ -754,84 +934,19 @@ void Mesher::segmentPlanesInMesh(
     seed_plane.triangle_cluster_.triangle_ids_.clear();
   }
 
-  static constexpr size_t mesh_polygon_dim = 3;
-  CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), mesh_polygon_dim)
-      << "Expecting 3 vertices in triangle.";
-
-  // Cluster new lmk ids for seed planes.
+  // Cluster new lmk ids for seed planes, and collect the values of the
+  // histograms for new planes.
   // Loop over the mesh only once.
-  Mesh3D::Polygon polygon;
   cv::Mat z_components(1, 0, CV_32F);
   cv::Mat walls(0, 0, CV_32FC2);
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), mesh_polygon_dim);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    // Calculate normal of the triangle in the mesh.
-    // The normals are in the world frame of reference.
-    cv::Point3f triangle_normal;
-    if (calculateNormal(p1, p2, p3, &triangle_normal)) {
-      ////////////////////////// Update seed planes ////////////////////////////
-      // Update seed_planes lmk_ids field with ids of vertices of polygon if the
-      // polygon is on the plane.
-      bool is_polygon_on_a_plane = updatePlanesLmkIdsFromPolygon(
-          seed_planes, polygon, i, triangle_normal,
-          normal_tolerance_polygon_plane_association,
-          distance_tolerance_polygon_plane_association, points_with_id_vio,
-          FLAGS_only_associate_a_polygon_to_a_single_plane);
-
-      ////////////////// Build Histogram for new planes ////////////////////////
-      /// Values for Z Histogram.///////////////////////////////////////////////
-      // Collect z values of vertices of polygon which is not already on a plane
-      // and which has the normal aligned with the vertical direction so that we
-      // can build an histogram.
-      static const cv::Point3f vertical(0, 0, 1);
-      if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
-                                               : true) &&
-          isNormalAroundAxis(vertical, triangle_normal,
-                             normal_tolerance_horizontal_surface)) {
-        // We have a triangle with a normal aligned with gravity, which is not
-        // already clustered in a plane.
-        // Store z components to build histogram.
-        // TODO instead of storing z_components, use the accumulate flag in
-        // calcHist and add them straight.
-        z_components.push_back(p1.z);
-        z_components.push_back(p2.z);
-        z_components.push_back(p3.z);
-      } else if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
-                                                      : true) &&
-                 isNormalPerpendicularToAxis(vertical, triangle_normal,
-                                             normal_tolerance_walls)) {
-        /// Values for walls Histogram./////////////////////////////////////////
-        // WARNING if we do not normalize, we'll have two peaks for the same
-        // plane, no?
-        // Store theta.
-        double theta = getLongitude(triangle_normal, vertical);
-
-        // Store distance.
-        // Using triangle_normal.
-        double distance = p1.ddot(triangle_normal);
-        if (theta < 0) {
-          VLOG(10) << "Normalize theta: " << theta
-                   << " and distance: " << distance;
-          // Say theta is -pi/2, then normalized theta is pi/2.
-          theta = theta + M_PI;
-          // Change distance accordingly.
-          distance = -distance;
-          VLOG(10) << "New normalized theta: " << theta
-                   << " and distance: " << distance;
-        }
-        walls.push_back(cv::Point2f(theta, distance));
-        // WARNING should we instead be using projected triangle normal
-        // on equator, and taking average of three distances...
-        // NORMALIZE if a theta is positive and distance negative, it is the
-        // same as if theta is 180 deg from it and distance positive...
-      }
-    }
-  }
+  associatePolygonsToPlanes(seed_planes,
+                            normal_tolerance_polygon_plane_association,
+                            distance_tolerance_polygon_plane_association,
+                            points_with_id_vio,
+                            &z_components,
+                            &walls,
+                            normal_tolerance_horizontal_surface,
+                            normal_tolerance_walls);
 
   VLOG(10) << "Number of polygons potentially on a wall: " << walls.rows;
 
@@ -868,66 +983,167 @@ void Mesher::updatePlanesLmkIdsFromMesh(
     double distance_tolerance,
     const PointsWithIdMap& points_with_id_vio) const {
   CHECK_NOTNULL(planes);
+  associatePolygonsToPlanes(
+      planes, normal_tolerance, distance_tolerance, points_with_id_vio);
+}
+
+/* -------------------------------------------------------------------------- */
+// Loops over the mesh in parallel blocks of polygons. Each block finds the
+// planes of its polygons, and collects the histogram values of its polygons.
+// The outputs of the blocks are then merged in order, so that the result is
+// the same as a sequential loop over the mesh.
+void Mesher::associatePolygonsToPlanes(
+    std::vector<Plane>* planes,
+    double normal_tolerance,
+    double distance_tolerance,
+    const PointsWithIdMap& points_with_id_vio,
+    cv::Mat* z_components,
+    cv::Mat* walls,
+    double normal_tolerance_horizontal_surface,
+    double normal_tolerance_walls) const {
+  CHECK_NOTNULL(planes);
+  CHECK_EQ(z_components == nullptr, walls == nullptr);
   static constexpr size_t mesh_polygon_dim = 3;
   CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), mesh_polygon_dim)
       << "Expecting 3 vertices in triangle.";
-  Mesh3D::Polygon polygon;
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), mesh_polygon_dim);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    // Calculate normal of the triangle in the mesh.
-    // The normals are in the world frame of reference.
-    cv::Point3f triangle_normal;
-    if (calculateNormal(p1, p2, p3, &triangle_normal)) {
-      // Loop over newly segmented planes, and update lmk ids field if
-      // the current polygon is on the plane.
-      updatePlanesLmkIdsFromPolygon(
-          planes, polygon, i, triangle_normal, normal_tolerance,
-          distance_tolerance, points_with_id_vio,
-          FLAGS_only_associate_a_polygon_to_a_single_plane);
+
+  struct BlockOutput {
+    // (plane index, polygon id) for each polygon on a plane.
+    std::vector<std::pair<size_t, size_t>> plane_polygon_ids;
+    cv::Mat z_components = cv::Mat(1, 0, CV_32F);
+    cv::Mat walls = cv::Mat(0, 0, CV_32FC2);
+  };
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
+  const int nr_blocks = getNumberOfPolygonBlocks(nr_polygons);
+  std::vector<BlockOutput> block_outputs(nr_blocks);
+  const std::vector<Plane>& const_planes = *planes;
+  cv::parallel_for_(cv::Range(0, nr_blocks), [&](const cv::Range& blocks) {
+    Mesh3D::Polygon polygon;
+    for (int b = blocks.start; b < blocks.end; b++) {
+      BlockOutput& output = block_outputs[b];
+      for (size_t i = nr_polygons * b / nr_blocks;
+           i < nr_polygons * (b + 1) / nr_blocks;
+           i++) {
+        CHECK(mesh_3d_.getPolygon(i, &polygon))
+            << "Could not retrieve polygon.";
+        CHECK_EQ(polygon.size(), mesh_polygon_dim);
+        const Vertex3D& p1 = polygon.at(0).getVertexPosition();
+        const Vertex3D& p2 = polygon.at(1).getVertexPosition();
+        const Vertex3D& p3 = polygon.at(2).getVertexPosition();
+
+        // Calculate normal of the triangle in the mesh.
+        // The normals are in the world frame of reference.
+        cv::Point3f triangle_normal;
+        if (!calculateNormal(p1, p2, p3, &triangle_normal)) continue;
+
+        ////////////////////////// Update planes ///////////////////////////////
+        // Find the planes the polygon is on.
+        const bool is_polygon_on_a_plane = associatePolygonToPlanes(
+            const_planes, polygon, i, triangle_normal, normal_tolerance,
+            distance_tolerance,
+            FLAGS_only_associate_a_polygon_to_a_single_plane,
+            &output.plane_polygon_ids);
+
+        ////////////////// Build Histogram for new planes //////////////////////
+        if (z_components == nullptr ||
+            (FLAGS_only_use_non_clustered_points && is_polygon_on_a_plane)) {
+          continue;
+        }
+        /// Values for Z Histogram./////////////////////////////////////////////
+        // Collect z values of vertices of polygon which is not already on a
+        // plane and which has the normal aligned with the vertical direction
+        // so that we can build an histogram.
+        static const cv::Point3f vertical(0, 0, 1);
+        if (isNormalAroundAxis(vertical, triangle_normal,
+                               normal_tolerance_horizontal_surface)) {
+          // We have a triangle with a normal aligned with gravity, which is
+          // not already clustered in a plane.
+          // Store z components to build histogram.
+          output.z_components.push_back(p1.z);
+          output.z_components.push_back(p2.z);
+          output.z_components.push_back(p3.z);
+        } else if (isNormalPerpendicularToAxis(vertical, triangle_normal,
+                                               normal_tolerance_walls)) {
+          /// Values for walls Histogram.///////////////////////////////////////
+          // WARNING if we do not normalize, we'll have two peaks for the same
+          // plane, no?
+          // Store theta.
+          double theta = getLongitude(triangle_normal, vertical);
+
+          // Store distance.
+          // Using triangle_normal.
+          double distance = p1.ddot(triangle_normal);
+          if (theta < 0) {
+            // Say theta is -pi/2, then normalized theta is pi/2.
+            theta = theta + M_PI;
+            // Change distance accordingly.
+            distance = -distance;
+          }
+          output.walls.push_back(cv::Point2f(theta, distance));
+          // NORMALIZE if a theta is positive and distance negative, it is the
+          // same as if theta is 180 deg from it and distance positive...
+        }
+      }
+    }
+  });
+
+  // Merge the outputs of the blocks, in order.
+  std::vector<std::vector<size_t>> polygon_ids_per_plane(planes->size());
+  for (const BlockOutput& output : block_outputs) {
+    for (const std::pair<size_t, size_t>& ids : output.plane_polygon_ids) {
+      polygon_ids_per_plane[ids.first].push_back(ids.second);
+    }
+    if (z_components == nullptr) continue;
+    // Skip blocks without values: an empty 1x0 z_components can't be
+    // appended to the Nx1 values of the previous blocks, and vice versa.
+    if (!output.z_components.empty()) {
+      z_components->push_back(output.z_components);
     }
+    if (!output.walls.empty()) walls->push_back(output.walls);
   }
+
+  // Update lmk_ids of the planes, in parallel over the planes.
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(planes->size())),
+      [&](const cv::Range& range) {
+        Mesh3D::Polygon polygon;
+        for (int k = range.start; k < range.end; k++) {
+          Plane& plane = planes->at(k);
+          for (const size_t& polygon_id : polygon_ids_per_plane[k]) {
+            CHECK(mesh_3d_.getPolygon(polygon_id, &polygon))
+                << "Could not retrieve polygon.";
+            // Points_with_id_vio are only used for stereo.
+            appendLmkIdsOfPolygon(polygon, &plane.lmk_ids_, points_with_id_vio);
+            // TODO Remove, only used for visualization...
+            plane.triangle_cluster_.triangle_ids_.push_back(polygon_id);
+          }
+        }
+      });
 }
 
 /* -------------------------------------------------------------------------- */
-// Updates planes lmk ids field with a polygon vertices ids if this polygon
-// is part of the plane according to given tolerance.
-// points_with_id_vio is only used if we are using stereo points...
-bool Mesher::updatePlanesLmkIdsFromPolygon(
-    std::vector<Plane>* seed_planes,
+// Finds the planes a polygon is part of according to given tolerance, and
+// appends the (plane index, polygon id) pairs to plane_polygon_ids.
+bool Mesher::associatePolygonToPlanes(
+    const std::vector<Plane>& planes,
     const Mesh3D::Polygon& polygon,
     const size_t& triangle_id,
     const cv::Point3f& triangle_normal,
     double normal_tolerance,
     double distance_tolerance,
-    const PointsWithIdMap& points_with_id_vio,
-    bool only_associate_a_polygon_to_a_single_plane) const {
-  CHECK_NOTNULL(seed_planes);
+    bool only_associate_a_polygon_to_a_single_plane,
+    std::vector<std::pair<size_t, size_t>>* plane_polygon_ids) const {
+  CHECK_NOTNULL(plane_polygon_ids);
   bool is_polygon_on_a_plane = false;
-  for (Plane& seed_plane : *seed_planes) {
+  for (size_t k = 0u; k < planes.size(); k++) {
+    const Plane& plane = planes[k];
     // Only cluster if normal and distance of polygon are close to plane.
     // WARNING: same polygon is being possibly clustered in multiple planes.
     // Break loop when polygon is in a plane?
-    if (isNormalAroundAxis(seed_plane.normal_, triangle_normal,
-                           normal_tolerance) &&
-        isPolygonAtDistanceFromPlane(polygon, seed_plane.distance_,
-                                     seed_plane.normal_, distance_tolerance)) {
-      // I guess we can comment out the check below since it can happen that
-      // a poygon is segmented in two very close planes? Better we enable
-      // it again!
-      // CHECK(!is_polygon_on_a_plane) << "Polygon was already in a plane,"
-      //                                 " are we having similar planes?";
-
-      // Update lmk_ids of seed plane.
-      // Points_with_id_vio are only used for stereo.
-      appendLmkIdsOfPolygon(polygon, &seed_plane.lmk_ids_, points_with_id_vio);
-
-      // TODO Remove, only used for visualization...
-      seed_plane.triangle_cluster_.triangle_ids_.push_back(triangle_id);
+    if (isNormalAroundAxis(plane.normal_, triangle_normal, normal_tolerance) &&
+        isPolygonAtDistanceFromPlane(polygon, plane.distance_, plane.normal_,
+                                     distance_tolerance)) {
+      plane_polygon_ids->push_back(std::make_pair(k, triangle_id));
 
       // Acknowledge that the polygon is at least in one plane, to avoid
       // sending this polygon to segmentation and segment the same plane
@@ -1278,8 +1494,10 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
                           const LandmarkIds& landmarks,
                           const gtsam::Pose3& left_camera_pose,
                           Mesh2D* mesh_2d,
-                          std::vector<cv::Vec6f>* mesh_2d_for_viz) {
+                          std::vector<cv::Vec6f>* mesh_2d_for_viz,
+                          const size_t& nr_dense_keypoints) {
   VLOG(10) << "Starting updateMesh3D...";
+  CHECK_LE(nr_dense_keypoints, keypoints.size());
   LOG_IF(WARNING, points_with_id_VIO.size() == 0u)
       << "Missing landmark information to build 3D Mesh.";
   const PointsWithIdMap* points_with_id_all = &points_with_id_VIO;
@@ -1316,12 +1534,40 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
 
   // Build 2D mesh.
   std::vector<cv::Vec6f> mesh_2d_pixels;
-  createMesh2dVIO(&mesh_2d_pixels,
-                  landmarks,
-                  keypoints_status,
-                  keypoints,
-                  mesher_params_.img_size_,
-                  *points_with_id_all);
+  if (!FLAGS_incremental_delaunay_2d || nr_dense_keypoints == 0u) {
+    createMesh2dVIO(&mesh_2d_pixels,
+                    landmarks,
+                    keypoints_status,
+                    keypoints,
+                    mesher_params_.img_size_,
+                    *points_with_id_all,
+                    FLAGS_incremental_delaunay_2d ? &delaunay_2d_ : nullptr);
+  } else {
+    // The dense keypoints have new landmark ids at every keyframe: only the
+    // other keypoints are kept in the incremental triangulation, and the dense
+    // ones are inserted in a copy of it, which is dropped afterwards.
+    const size_t nr_sparse_keypoints = keypoints.size() - nr_dense_keypoints;
+    createMesh2dVIO(
+        &mesh_2d_pixels,
+        LandmarkIds(landmarks.begin(),
+                    landmarks.begin() + nr_sparse_keypoints),
+        std::vector<KeypointStatus>(
+            keypoints_status.begin(),
+            keypoints_status.begin() + nr_sparse_keypoints),
+        KeypointsCV(keypoints.begin(),
+                    keypoints.begin() + nr_sparse_keypoints),
+        mesher_params_.img_size_,
+        *points_with_id_all,
+        &delaunay_2d_);
+    IncrementalDelaunay2D dense_delaunay_2d = delaunay_2d_;
+    createMesh2dVIO(&mesh_2d_pixels,
+                    landmarks,
+                    keypoints_status,
+                    keypoints,
+                    mesher_params_.img_size_,
+                    *points_with_id_all,
+                    &dense_delaunay_2d);
+  }
   if (mesh_2d_for_viz) *mesh_2d_for_viz = mesh_2d_pixels;
   LOG_IF(WARNING, mesh_2d_pixels.size() == 0) << "2D Mesh is empty!";
 
@@ -1349,15 +1595,67 @@ void Mesher::updateMesh3D(const MesherInput& mesher_payload,
                           std::vector<cv::Vec6f>* mesh_2d_for_viz) {
   const StereoFrame& stereo_frame =
       mesher_payload.frontend_output_->stereo_frame_lkf_;
-  updateMesh3D(mesher_payload.backend_output_->landmarks_with_id_map_,
-               stereo_frame.getLeftFrame().keypoints_,
-               stereo_frame.right_keypoints_status_,
-               stereo_frame.keypoints_3d_,
-               stereo_frame.getLeftFrame().landmarks_,
-               mesher_payload.backend_output_->W_State_Blkf_.pose_.compose(
-                   mesher_params_.B_Pose_camLrect_),
+  const gtsam::Pose3 left_camera_pose =
+      mesher_payload.backend_output_->W_State_Blkf_.pose_.compose(
+          mesher_params_.B_Pose_camLrect_);
+  const DenseStereoOutput::ConstPtr& dense_stereo =
+      mesher_payload.dense_stereo_output_;
+  if (!dense_stereo || dense_stereo->landmarks_.empty()) {
+    updateMesh3D(mesher_payload.backend_output_->landmarks_with_id_map_,
+                 stereo_frame.getLeftFrame().keypoints_,
+                 stereo_frame.right_keypoints_status_,
+                 stereo_frame.keypoints_3d_,
+                 stereo_frame.getLeftFrame().landmarks_,
+                 left_camera_pose,
+                 mesh_2d,
+                 mesh_2d_for_viz);
+    return;
+  }
+
+  // Densify the mesh: the dense stereo points are used as extra keypoints,
+  // which are only in this keyframe's map of points, so their triangles are
+  // replaced at every keyframe. They are appended after the keypoints of the
+  // frame, as expected by updateMesh3D.
+  KeypointsCV keypoints = stereo_frame.getLeftFrame().keypoints_;
+  std::vector<KeypointStatus> keypoints_status =
+      stereo_frame.right_keypoints_status_;
+  std::vector<Vector3> keypoints_3d = stereo_frame.keypoints_3d_;
+  LandmarkIds landmarks = stereo_frame.getLeftFrame().landmarks_;
+  keypoints.insert(keypoints.end(),
+                   dense_stereo->keypoints_.begin(),
+                   dense_stereo->keypoints_.end());
+  keypoints_status.insert(keypoints_status.end(),
+                          dense_stereo->keypoints_.size(),
+                          KeypointStatus::VALID);
+  keypoints_3d.insert(keypoints_3d.end(),
+                      dense_stereo->keypoints_3d_.begin(),
+                      dense_stereo->keypoints_3d_.end());
+  landmarks.insert(landmarks.end(),
+                   dense_stereo->landmarks_.begin(),
+                   dense_stereo->landmarks_.end());
+
+  PointsWithIdMap points_with_id =
+      mesher_payload.backend_output_->landmarks_with_id_map_;
+  points_with_id.reserve(points_with_id.size() +
+                         dense_stereo->keypoints_.size());
+  for (size_t i = 0; i < dense_stereo->landmarks_.size(); i++) {
+    points_with_id.insert(std::make_pair(
+        dense_stereo->landmarks_[i],
+        left_camera_pose.transformFrom(
+            gtsam::Point3(dense_stereo->keypoints_3d_[i]))));
+  }
+  VLOG(10) << "Number of dense stereo points used for the mesh: "
+           << dense_stereo->landmarks_.size();
+
+  updateMesh3D(points_with_id,
+               keypoints,
+               keypoints_status,
+               keypoints_3d,
+               landmarks,
+               left_camera_pose,
                mesh_2d,
-               mesh_2d_for_viz);
+               mesh_2d_for_viz,
+               dense_stereo->keypoints_.size());
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1483,7 +1781,8 @@ void Mesher::createMesh2dVIO(
     const std::vector<KeypointStatus>& keypoints_status,
     const KeypointsCV& keypoints,
     const cv::Size& img_size,
-    const PointsWithIdMap& pointsWithIdVIO) {
+    const PointsWithIdMap& pointsWithIdVIO,
+    IncrementalDelaunay2D* delaunay_2d) {
   CHECK_NOTNULL(triangulation_2D);
 
   // Pick left frame.
@@ -1496,23 +1795,27 @@ void Mesher::createMesh2dVIO(
   // Create mesh including indices of keypoints with valid 3D.
   // (which have right px).
   std::vector<cv::Point2f> keypoints_for_mesh;
-  // TODO this double loop is quite expensive.
+  LandmarkIds lmk_ids_for_mesh;
   LOG_IF(WARNING, pointsWithIdVIO.empty())
       << "List of Keypoints with associated Landmarks is empty.";
-  for (const auto& point_with_id : pointsWithIdVIO) {
-    for (size_t j = 0; j < landmarks.size(); j++) {
-      // If we are seeing a VIO point in left and right frame, add to keypoints
-      // to generate the mesh in 2D.
-      if (landmarks.at(j) == point_with_id.first &&
-          keypoints_status.at(j) == KeypointStatus::VALID) {
-        // Add keypoints for mesh 2d.
-        keypoints_for_mesh.push_back(keypoints.at(j));
-      }
+  for (size_t j = 0; j < landmarks.size(); j++) {
+    // If we are seeing a VIO point in left and right frame, add to keypoints
+    // to generate the mesh in 2D.
+    if (keypoints_status.at(j) == KeypointStatus::VALID &&
+        pointsWithIdVIO.find(landmarks.at(j)) != pointsWithIdVIO.end()) {
+      // Add keypoints for mesh 2d.
+      keypoints_for_mesh.push_back(keypoints.at(j));
+      lmk_ids_for_mesh.push_back(landmarks.at(j));
     }
   }
 
   // Get a triangulation for all valid keypoints.
-  *triangulation_2D = createMesh2dImpl(img_size, &keypoints_for_mesh);
+  if (delaunay_2d) {
+    delaunay_2d->update(
+        img_size, lmk_ids_for_mesh, keypoints_for_mesh, triangulation_2D);
+  } else {
+    *triangulation_2D = createMesh2dImpl(img_size, &keypoints_for_mesh);
+  }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1611,7 +1914,8 @@ void Mesher::createMesh2dStereo(
     const KeypointsCV& keypoints,
     const std::vector<Vector3>& keypoints_3d,
     const cv::Size& img_size,
-    std::vector<std::pair<LandmarkId, gtsam::Point3>>* lmk_with_id_stereo) {
+    std::vector<std::pair<LandmarkId, gtsam::Point3>>* lmk_with_id_stereo,
+    IncrementalDelaunay2D* delaunay_2d) {
   // triangulation_2D is compulsory, lmk_with_id_stereo is optional.
   CHECK_NOTNULL(triangulation_2D);
 
@@ -1622,11 +1926,13 @@ void Mesher::createMesh2dStereo(
   // Create mesh including indices of keypoints with valid 3D
   // (which have right px).
   std::vector<cv::Point2f> keypoints_for_mesh;
+  LandmarkIds lmk_ids_for_mesh;
   for (int i = 0; i < landmarks.size(); i++) {
     if (keypoints_status.at(i) == KeypointStatus::VALID &&
         landmarks.at(i) != -1) {
       // Add keypoints for mesh 2d.
       keypoints_for_mesh.push_back(keypoints.at(i));
+      lmk_ids_for_mesh.push_back(landmarks.at(i));
 
       // Store corresponding landmarks.
       // These points are in stereo camera and are not in VIO, but have lmk id.
@@ -1640,7 +1946,12 @@ void Mesher::createMesh2dStereo(
   }
 
   // Get a triangulation for all valid keypoints.
-  *triangulation_2D = createMesh2dImpl(img_size, &keypoints_for_mesh);
+  if (delaunay_2d) {
+    delaunay_2d->update(
+        img_size, lmk_ids_for_mesh, keypoints_for_mesh, triangulation_2D);
+  } else {
+    *triangulation_2D = createMesh2dImpl(img_size, &keypoints_for_mesh);
+  }
 }
 
 }  // namespace VIO
@@ -16,11 +16,15 @@
 
 namespace VIO {
 
-MesherModule::MesherModule(bool parallel_run, Mesher::UniquePtr mesher)
+MesherModule::MesherModule(bool parallel_run,
+                           Mesher::UniquePtr mesher,
+                           bool use_dense_stereo)
     : MIMOPipelineModule<MesherInput, MesherOutput>("MesherModule",
                                                     parallel_run),
       frontend_payload_queue_("mesher_frontend"),
       backend_payload_queue_("mesher_backend"),
+      dense_stereo_payload_queue_("mesher_dense_stereo"),
+      use_dense_stereo_(use_dense_stereo),
       mesher_(std::move(mesher)) {}
 
 MesherModule::InputUniquePtr MesherModule::getInputPacket() {
@@ -52,8 +56,20 @@ MesherModule::InputUniquePtr MesherModule::getInputPacket() {
   CHECK(frontend_payload);
   CHECK(frontend_payload->is_keyframe_);
 
+  // The dense stereo module runs in parallel with the backend, on the same
+  // keyframes, so its payload is either ready or about to be, unless its
+  // queue has been shutdown.
+  MesherDenseStereoInput dense_stereo_payload = nullptr;
+  if (use_dense_stereo_ &&
+      !PIO::syncQueue(
+          timestamp, &dense_stereo_payload_queue_, &dense_stereo_payload)) {
+    LOG(WARNING) << "Module: " << name_id_ << " - Missing dense stereo "
+                 << "payload, meshing without dense points.";
+    dense_stereo_payload = nullptr;
+  }
+
   return VIO::make_unique<MesherInput>(
-      timestamp, frontend_payload, backend_payload);
+      timestamp, frontend_payload, backend_payload, dense_stereo_payload);
 }
 
 MesherModule::OutputUniquePtr MesherModule::spinOnce(
@@ -66,6 +82,7 @@ void MesherModule::shutdownQueues() {
   LOG(INFO) << "Shutting down queues for: " << name_id_;
   frontend_payload_queue_.shutdown();
   backend_payload_queue_.shutdown();
+  dense_stereo_payload_queue_.shutdown();
 };
 
 bool MesherModule::hasWork() const {
@@ -0,0 +1,396 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TriangleFilter.cpp
+ * @brief  Batched filters to reject bad triangles of the 2D and 3D meshes.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/TriangleFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+// Transformation from world to camera frame, p_C = R' * (p_W - t), in single
+// precision as the vertices of the mesh.
+struct WorldToCamera {
+  explicit WorldToCamera(const gtsam::Pose3& camera_pose) {
+    const gtsam::Matrix3 R = camera_pose.rotation().matrix();
+    const gtsam::Point3& t = camera_pose.translation();
+    for (size_t i = 0u; i < 3u; i++) {
+      for (size_t j = 0u; j < 3u; j++) {
+        R_t[i][j] = static_cast<float>(R(j, i));
+      }
+    }
+    translation[0] = static_cast<float>(t.x());
+    translation[1] = static_cast<float>(t.y());
+    translation[2] = static_cast<float>(t.z());
+  }
+
+  float R_t[3][3];
+  float translation[3];
+};
+
+// Thresholds of TriangleFilter::filterBadTriangles, only checked if enabled.
+struct Thresholds {
+  bool check_sides_ratio;
+  bool check_elongation_ratio;
+  bool check_max_side;
+  float min_sides_ratio;
+  float min_elongation_ratio;
+  float max_side;
+};
+
+// Scalar version of the checks, for the triangles that do not fill a SIMD
+// register. Same operations as the vectorized loop below.
+bool isGoodTriangle(const TrianglesSoA& triangles,
+                    const size_t& i,
+                    const WorldToCamera& world_T_cam,
+                    const Thresholds& thresholds,
+                    bool* is_behind_camera) {
+  float px[3], py[3], pz[3];
+  for (size_t k = 0u; k < 3u; k++) {
+    px[k] = triangles.x_[k][i];
+    py[k] = triangles.y_[k][i];
+    pz[k] = triangles.z_[k][i];
+  }
+
+  // Measure sides: d[k] is the side between vertices k and k + 1.
+  float d[3];
+  for (size_t k = 0u; k < 3u; k++) {
+    const size_t l = (k + 1u) % 3u;
+    const float dx = px[k] - px[l];
+    const float dy = py[k] - py[l];
+    const float dz = pz[k] - pz[l];
+    d[k] = std::sqrt(dx * dx + dy * dy + dz * dz);
+  }
+  const float min_side = std::min(d[0], std::min(d[1], d[2]));
+  const float max_side = std::max(d[0], std::max(d[1], d[2]));
+
+  bool keep = true;
+  if (thresholds.check_sides_ratio) {
+    keep = keep && (min_side / max_side >= thresholds.min_sides_ratio);
+  }
+  if (thresholds.check_max_side) {
+    keep = keep && (max_side <= thresholds.max_side);
+  }
+  if (thresholds.check_elongation_ratio) {
+    // Checks elongation in *camera frame*.
+    const float(&R_t)[3][3] = world_T_cam.R_t;
+    const float(&t)[3] = world_T_cam.translation;
+    float cx[3], cy[3], cz[3];
+    for (size_t k = 0u; k < 3u; k++) {
+      const float dx = px[k] - t[0];
+      const float dy = py[k] - t[1];
+      const float dz = pz[k] - t[2];
+      cx[k] = R_t[0][0] * dx + R_t[0][1] * dy + R_t[0][2] * dz;
+      cy[k] = R_t[1][0] * dx + R_t[1][1] * dy + R_t[1][2] * dz;
+      cz[k] = R_t[2][0] * dx + R_t[2][1] * dy + R_t[2][2] * dz;
+    }
+    const float min_z = std::min(cz[0], std::min(cz[1], cz[2]));
+    const float max_z = std::max(cz[0], std::max(cz[1], cz[2]));
+
+    // Project the points on a virtual image plane at distance min_z.
+    for (size_t k = 0u; k < 3u; k++) {
+      const float scale = min_z / cz[k];
+      cx[k] *= scale;
+      cy[k] *= scale;
+      cz[k] *= scale;
+    }
+    float max_t = 0.0f;
+    for (size_t k = 0u; k < 3u; k++) {
+      const size_t l = (k + 1u) % 3u;
+      const float dx = cx[k] - cx[l];
+      const float dy = cy[k] - cy[l];
+      const float dz = cz[k] - cz[l];
+      max_t = std::max(max_t, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    // Points must be in front of the camera.
+    *is_behind_camera = min_z < 0.0f;
+    const float elongation_ratio =
+        *is_behind_camera ? 0.0f : max_t / (max_z - min_z);
+    keep = keep && (elongation_ratio >= thresholds.min_elongation_ratio);
+  }
+  return keep;
+}
+
+// Returns the number of pixels with value 1 in the columns [c0, c1) of row r
+// of a binary image, given its integral image.
+inline int countInRow(const cv::Mat& integral,
+                      const int& r,
+                      const int& c0,
+                      const int& c1) {
+  const int* row = integral.ptr<int>(r);
+  const int* next_row = integral.ptr<int>(r + 1);
+  return next_row[c1] - row[c1] - next_row[c0] + row[c0];
+}
+
+// Expands [min_x, max_x] with the intersection of row r with the segment
+// between pixels (xa, ya) and (xb, yb), as FindHighIntensityInTriangle.
+inline void expandRowWithSegment(const int& r,
+                                 const int& xa,
+                                 const int& ya,
+                                 const int& xb,
+                                 const int& yb,
+                                 int* min_x,
+                                 int* max_x) {
+  // If the segment is horizontal we can skip it.
+  if (ya == yb) return;
+  const double lambda = double(r - yb) / double(ya - yb);
+  if (lambda >= 0 && lambda <= 1) {
+    // The intersection belongs to the segment.
+    const int x = std::round(lambda * double(xa) + (1 - lambda) * double(xb));
+    *min_x = std::min(*min_x, x);
+    *max_x = std::max(*max_x, x);
+  }
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+void TrianglesSoA::clear() {
+  for (size_t k = 0u; k < 3u; k++) {
+    x_[k].clear();
+    y_[k].clear();
+    z_[k].clear();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void TrianglesSoA::reserve(const size_t& nr_triangles) {
+  for (size_t k = 0u; k < 3u; k++) {
+    x_[k].reserve(nr_triangles);
+    y_[k].reserve(nr_triangles);
+    z_[k].reserve(nr_triangles);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void TrianglesSoA::push_back(const cv::Point3f& p1,
+                             const cv::Point3f& p2,
+                             const cv::Point3f& p3) {
+  const cv::Point3f* points[3] = {&p1, &p2, &p3};
+  for (size_t k = 0u; k < 3u; k++) {
+    x_[k].push_back(points[k]->x);
+    y_[k].push_back(points[k]->y);
+    z_[k].push_back(points[k]->z);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void TriangleFilter::filterBadTriangles(
+    const TrianglesSoA& triangles,
+    const gtsam::Pose3& left_camera_pose,
+    const double& min_ratio_between_largest_an_smallest_side,
+    const double& min_elongation_ratio,
+    const double& max_triangle_side,
+    std::vector<uint8_t>* keep) {
+  CHECK_NOTNULL(keep);
+  const size_t nr_triangles = triangles.size();
+  keep->resize(nr_triangles);
+  if (nr_triangles == 0u) return;
+
+  // A disabled check compares its threshold against zero: only a negative
+  // max_triangle_side fails for all triangles.
+  if (max_triangle_side < 0.0) {
+    std::fill(keep->begin(), keep->end(), 0u);
+    return;
+  }
+
+  Thresholds thresholds;
+  thresholds.check_sides_ratio = min_ratio_between_largest_an_smallest_side > 0;
+  thresholds.check_elongation_ratio = min_elongation_ratio > 0.0;
+  thresholds.check_max_side = max_triangle_side > 0.0;
+  thresholds.min_sides_ratio =
+      static_cast<float>(min_ratio_between_largest_an_smallest_side);
+  thresholds.min_elongation_ratio = static_cast<float>(min_elongation_ratio);
+  thresholds.max_side = static_cast<float>(max_triangle_side);
+  const WorldToCamera world_T_cam(left_camera_pose);
+
+  size_t nr_behind_camera = 0u;
+  size_t i = 0u;
+#if CV_SIMD128
+  const cv::v_float32x4 v_zero = cv::v_setzero_f32();
+  const cv::v_float32x4 v_min_sides_ratio =
+      cv::v_setall_f32(thresholds.min_sides_ratio);
+  const cv::v_float32x4 v_min_elongation_ratio =
+      cv::v_setall_f32(thresholds.min_elongation_ratio);
+  const cv::v_float32x4 v_max_side = cv::v_setall_f32(thresholds.max_side);
+  cv::v_float32x4 v_R_t[3][3];
+  cv::v_float32x4 v_t[3];
+  for (size_t r = 0u; r < 3u; r++) {
+    for (size_t c = 0u; c < 3u; c++) {
+      v_R_t[r][c] = cv::v_setall_f32(world_T_cam.R_t[r][c]);
+    }
+    v_t[r] = cv::v_setall_f32(world_T_cam.translation[r]);
+  }
+
+  static constexpr size_t kNrLanes = cv::v_float32x4::nlanes;
+  for (; i + kNrLanes <= nr_triangles; i += kNrLanes) {
+    cv::v_float32x4 px[3], py[3], pz[3];
+    for (size_t k = 0u; k < 3u; k++) {
+      px[k] = cv::v_load(&triangles.x_[k][i]);
+      py[k] = cv::v_load(&triangles.y_[k][i]);
+      pz[k] = cv::v_load(&triangles.z_[k][i]);
+    }
+
+    // Measure sides: d[k] is the side between vertices k and k + 1.
+    cv::v_float32x4 d[3];
+    for (size_t k = 0u; k < 3u; k++) {
+      const size_t l = (k + 1u) % 3u;
+      const cv::v_float32x4 dx = px[k] - px[l];
+      const cv::v_float32x4 dy = py[k] - py[l];
+      const cv::v_float32x4 dz = pz[k] - pz[l];
+      d[k] = cv::v_sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    const cv::v_float32x4 min_side = cv::v_min(d[0], cv::v_min(d[1], d[2]));
+    const cv::v_float32x4 max_side = cv::v_max(d[0], cv::v_max(d[1], d[2]));
+
+    // All lanes set.
+    cv::v_float32x4 v_keep = v_zero == v_zero;
+    if (thresholds.check_sides_ratio) {
+      v_keep = v_keep & (min_side / max_side >= v_min_sides_ratio);
+    }
+    if (thresholds.check_max_side) {
+      v_keep = v_keep & (max_side <= v_max_side);
+    }
+    if (thresholds.check_elongation_ratio) {
+      // Checks elongation in *camera frame*.
+      cv::v_float32x4 cx[3], cy[3], cz[3];
+      for (size_t k = 0u; k < 3u; k++) {
+        const cv::v_float32x4 dx = px[k] - v_t[0];
+        const cv::v_float32x4 dy = py[k] - v_t[1];
+        const cv::v_float32x4 dz = pz[k] - v_t[2];
+        cx[k] = v_R_t[0][0] * dx + v_R_t[0][1] * dy + v_R_t[0][2] * dz;
+        cy[k] = v_R_t[1][0] * dx + v_R_t[1][1] * dy + v_R_t[1][2] * dz;
+        cz[k] = v_R_t[2][0] * dx + v_R_t[2][1] * dy + v_R_t[2][2] * dz;
+      }
+      const cv::v_float32x4 min_z = cv::v_min(cz[0], cv::v_min(cz[1], cz[2]));
+      const cv::v_float32x4 max_z = cv::v_max(cz[0], cv::v_max(cz[1], cz[2]));
+
+      // Project the points on a virtual image plane at distance min_z.
+      for (size_t k = 0u; k < 3u; k++) {
+        const cv::v_float32x4 scale = min_z / cz[k];
+        cx[k] = cx[k] * scale;
+        cy[k] = cy[k] * scale;
+        cz[k] = cz[k] * scale;
+      }
+      cv::v_float32x4 max_t = v_zero;
+      for (size_t k = 0u; k < 3u; k++) {
+        const size_t l = (k + 1u) % 3u;
+        const cv::v_float32x4 dx = cx[k] - cx[l];
+        const cv::v_float32x4 dy = cy[k] - cy[l];
+        const cv::v_float32x4 dz = cz[k] - cz[l];
+        max_t = cv::v_max(max_t, cv::v_sqrt(dx * dx + dy * dy + dz * dz));
+      }
+
+      // Points must be in front of the camera.
+      const cv::v_float32x4 is_behind_camera = min_z < v_zero;
+      const cv::v_float32x4 elongation_ratio =
+          cv::v_select(is_behind_camera, v_zero, max_t / (max_z - min_z));
+      v_keep = v_keep & (elongation_ratio >= v_min_elongation_ratio);
+
+      const int behind_camera_bits = cv::v_signmask(is_behind_camera);
+      for (size_t k = 0u; k < kNrLanes; k++) {
+        nr_behind_camera += (behind_camera_bits >> k) & 1;
+      }
+    }
+
+    const int keep_bits = cv::v_signmask(v_keep);
+    for (size_t k = 0u; k < kNrLanes; k++) {
+      (*keep)[i + k] = static_cast<uint8_t>((keep_bits >> k) & 1);
+    }
+  }
+#endif
+
+  for (; i < nr_triangles; i++) {
+    bool is_behind_camera = false;
+    (*keep)[i] = static_cast<uint8_t>(isGoodTriangle(
+        triangles, i, world_T_cam, thresholds, &is_behind_camera));
+    if (is_behind_camera) nr_behind_camera++;
+  }
+
+  LOG_IF(ERROR, nr_behind_camera > 0u)
+      << "Negative radial components! Points of " << nr_behind_camera
+      << " triangles are behind camera.";
+}
+
+/* -------------------------------------------------------------------------- */
+void TriangleFilter::filterTrianglesWithGradients(
+    const cv::Mat& img_grads,
+    const std::vector<cv::Vec6f>& triangulation_2D,
+    const float& gradient_bound,
+    const size_t& max_keypoints_with_gradient,
+    std::vector<uint8_t>* keep) {
+  CHECK_NOTNULL(keep);
+  keep->assign(triangulation_2D.size(), 1u);
+  // Check is disabled.
+  if (gradient_bound < 0 || triangulation_2D.empty()) return;
+  CHECK_EQ(img_grads.type(), CV_8UC1);
+
+  // Count the pixels with higher gradient than gradient_bound with an
+  // integral image, instead of visiting all pixels of each triangle.
+  cv::Mat high_grads;
+  cv::threshold(
+      img_grads, high_grads, gradient_bound, 1.0, cv::THRESH_BINARY);
+  cv::Mat high_grads_integral;
+  cv::integral(high_grads, high_grads_integral, CV_32S);
+
+  static constexpr int kMargin = 4;
+  for (size_t i = 0u; i < triangulation_2D.size(); i++) {
+    const cv::Vec6f& px_vertices = triangulation_2D[i];
+    const int x0 = std::round(px_vertices[0]);
+    const int y0 = std::round(px_vertices[1]);
+    const int x1 = std::round(px_vertices[2]);
+    const int y1 = std::round(px_vertices[3]);
+    const int x2 = std::round(px_vertices[4]);
+    const int y2 = std::round(px_vertices[5]);
+
+    // Get bounding box.
+    const int top_left_x = std::min(x0, std::min(x1, x2));
+    const int top_left_y = std::max(0, std::min(y0, std::min(y1, y2)));
+    const int bot_right_x = std::max(x0, std::max(x1, x2));
+    const int bot_right_y =
+        std::min(img_grads.rows, std::max(y0, std::max(y1, y2)));
+
+    size_t nr_keypoints_with_gradient = 0u;
+    for (int r = top_left_y; r < bot_right_y; r++) {
+      // Find the columns of the triangle in this row.
+      int min_x = bot_right_x;
+      int max_x = top_left_x;
+      expandRowWithSegment(r, x0, y0, x1, y1, &min_x, &max_x);
+      expandRowWithSegment(r, x1, y1, x2, y2, &min_x, &max_x);
+      expandRowWithSegment(r, x2, y2, x0, y0, &min_x, &max_x);
+      DCHECK(min_x >= top_left_x && max_x <= bot_right_x)
+          << "filterTrianglesWithGradients: inconsistent extrema.";
+
+      const int c0 = std::max(0, min_x + kMargin);
+      const int c1 = std::min(img_grads.cols, max_x - kMargin);
+      if (c0 >= c1) continue;
+      nr_keypoints_with_gradient +=
+          countInRow(high_grads_integral, r, c0, c1);
+      if (nr_keypoints_with_gradient > max_keypoints_with_gradient) {
+        (*keep)[i] = 0u;
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace VIO
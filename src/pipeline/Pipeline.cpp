@@ -42,6 +42,18 @@ DEFINE_bool(extract_planes_from_the_scene,
 
 DEFINE_bool(visualize, true, "Enable overall visualization.");
 DEFINE_bool(visualize_lmk_type, false, "Enable landmark type visualization.");
+DEFINE_bool(headless_visualizer,
+            false,
+            "Instead of displaying the visualization, stream lightweight "
+            "visualization payloads from a worker thread.");
+DEFINE_string(headless_visualizer_output,
+              "",
+              "Where the headless visualizer sends its payloads: a file, or "
+              "unix:<path> for a consumer listening on a local socket.");
+DEFINE_double(headless_visualizer_rate_hz,
+              10.0,
+              "Maximum rate of the headless visualizer payloads [Hz], "
+              "unlimited if not positive.");
 DEFINE_int32(viz_type,
              0,
              "0: MESH2DTo3Dsparse, get a 3D mesh from a 2D triangulation of "
@@ -91,6 +103,37 @@ DEFINE_bool(use_lcd,
             false,
             "Enable LoopClosureDetector processing in pipeline.");
 
+DEFINE_bool(use_dense_stereo,
+            false,
+            "Densify the mesh with semi-dense stereo points, computed in "
+            "parallel with the backend.");
+DEFINE_double(dense_stereo_scale,
+              0.5,
+              "Scale of the images used for dense stereo matching, in (0, 1].");
+DEFINE_int32(dense_stereo_num_disparities,
+             48,
+             "Disparity range for dense stereo matching, at the matching "
+             "resolution (multiple of 16).");
+DEFINE_int32(dense_stereo_block_size,
+             5,
+             "Size of the blocks for dense stereo matching (odd).");
+DEFINE_int32(dense_stereo_grid_step,
+             8,
+             "At most one dense stereo point is sampled in each cell of a grid "
+             "with this side, in pixels at the matching resolution.");
+DEFINE_bool(dense_stereo_only_gradients,
+            true,
+            "Only sample dense stereo points on image edges (semi-dense).");
+DEFINE_int32(dense_stereo_max_nr_points,
+             1500,
+             "Maximum number of dense stereo points per keyframe.");
+DEFINE_double(dense_stereo_min_depth,
+              0.2,
+              "Minimum depth of dense stereo points [m].");
+DEFINE_double(dense_stereo_max_depth,
+              5.0,
+              "Maximum depth of dense stereo points [m].");
+
 namespace VIO {
 
 Pipeline::Pipeline(const VioParams& params)
@@ -104,10 +147,13 @@ Pipeline::Pipeline(const VioParams& params)
       backend_params_(params.backend_params_),
       frontend_params_(params.frontend_params_),
       imu_params_(params.imu_params_),
+      dense_stereo_module_(nullptr),
       mesher_module_(nullptr),
       visualizer_module_(nullptr),
+      headless_visualizer_module_(nullptr),
       frontend_thread_(nullptr),
       backend_thread_(nullptr),
+      dense_stereo_thread_(nullptr),
       mesher_thread_(nullptr),
       lcd_thread_(nullptr),
       visualizer_thread_(nullptr),
@@ -192,7 +238,8 @@ Pipeline::Pipeline(const VioParams& params)
       MesherFactory::createMesher(
           MesherType::PROJECTIVE,
           MesherParams(stereo_camera_->getLeftCamPose(),
-                       params.camera_params_.at(0).image_size_)));
+                       params.camera_params_.at(0).image_size_)),
+      FLAGS_use_dense_stereo);
   //! Register input callbacks
   vio_backend_module_->registerCallback(
       std::bind(&MesherModule::fillBackendQueue,
@@ -203,7 +250,49 @@ Pipeline::Pipeline(const VioParams& params)
                 std::ref(*CHECK_NOTNULL(mesher_module_.get())),
                 std::placeholders::_1));
 
-  if (FLAGS_visualize) {
+  if (FLAGS_use_dense_stereo) {
+    // TODO(Toni): put this into frontend params.
+    DenseStereoParams dense_stereo_params;
+    dense_stereo_params.scale_ = FLAGS_dense_stereo_scale;
+    dense_stereo_params.num_disparities_ = FLAGS_dense_stereo_num_disparities;
+    dense_stereo_params.block_size_ = FLAGS_dense_stereo_block_size;
+    dense_stereo_params.grid_step_ = FLAGS_dense_stereo_grid_step;
+    dense_stereo_params.only_gradients_ = FLAGS_dense_stereo_only_gradients;
+    dense_stereo_params.max_nr_points_ = FLAGS_dense_stereo_max_nr_points;
+    dense_stereo_params.min_depth_ = FLAGS_dense_stereo_min_depth;
+    dense_stereo_params.max_depth_ = FLAGS_dense_stereo_max_depth;
+    dense_stereo_module_ = VIO::make_unique<DenseStereoModule>(
+        parallel_run_, VIO::make_unique<DenseStereo>(dense_stereo_params));
+    //! Register input callbacks
+    vio_frontend_module_->registerCallback(
+        std::bind(&DenseStereoModule::fillFrontendQueue,
+                  std::ref(*CHECK_NOTNULL(dense_stereo_module_.get())),
+                  std::placeholders::_1));
+    dense_stereo_module_->registerCallback(
+        std::bind(&MesherModule::fillDenseStereoQueue,
+                  std::ref(*CHECK_NOTNULL(mesher_module_.get())),
+                  std::placeholders::_1));
+  }
+
+  if (FLAGS_visualize && FLAGS_headless_visualizer) {
+    // TODO(Toni): put this into VisualizerParams.
+    HeadlessVisualizerParams headless_visualizer_params;
+    headless_visualizer_params.display_rate_hz_ =
+        FLAGS_headless_visualizer_rate_hz;
+    headless_visualizer_params.output_ = FLAGS_headless_visualizer_output;
+    headless_visualizer_module_ = VIO::make_unique<HeadlessVisualizerModule>(
+        parallel_run_,
+        VIO::make_unique<HeadlessVisualizer>(headless_visualizer_params));
+    //! Register input callbacks
+    vio_backend_module_->registerCallback(
+        std::bind(&HeadlessVisualizerModule::fillBackendQueue,
+                  std::ref(*CHECK_NOTNULL(headless_visualizer_module_.get())),
+                  std::placeholders::_1));
+    mesher_module_->registerCallback(
+        std::bind(&HeadlessVisualizerModule::fillMesherQueue,
+                  std::ref(*CHECK_NOTNULL(headless_visualizer_module_.get())),
+                  std::placeholders::_1));
+  } else if (FLAGS_visualize) {
     visualizer_module_ = VIO::make_unique<VisualizerModule>(
         parallel_run_,
         VisualizerFactory::createVisualizer(
@@ -310,7 +399,8 @@ void Pipeline::spinOnce(StereoImuSyncPacket::UniquePtr stereo_imu_sync_packet) {
 }
 
 // Returns whether the visualizer_ is running or not. While in parallel mode,
-// it does not return unless shutdown.
+// it does not return unless shutdown. The headless visualizer spins in its own
+// thread instead, so this returns right away.
 bool Pipeline::spinViz() {
   if (visualizer_module_) {
     return visualizer_module_->spin();
@@ -330,11 +420,15 @@ void Pipeline::spinSequential() {
   CHECK(vio_backend_module_);
   vio_backend_module_->spin();
 
+  if (dense_stereo_module_) dense_stereo_module_->spin();
+
   if (mesher_module_) mesher_module_->spin();
 
   if (lcd_module_) lcd_module_->spin();
 
   if (visualizer_module_) visualizer_module_->spin();
+
+  if (headless_visualizer_module_) headless_visualizer_module_->spin();
 }
 
 // TODO: Adapt this function to be able to cope with new initialization
@@ -357,6 +451,7 @@ bool Pipeline::shutdownWhenFinished() {
   CHECK(vio_frontend_module_);
   CHECK(vio_backend_module_);
 
+  // The headless visualizer is not waited for: it drops payloads anyway.
   while (!shutdown_ &&         // Loop while not explicitly shutdown.
          (!is_initialized_ ||  // Loop while not initialized
                                // Or, once init, data is not yet consumed.
@@ -364,6 +459,8 @@ bool Pipeline::shutdownWhenFinished() {
             stereo_frontend_input_queue_.empty() &&
             !vio_frontend_module_->isWorking() &&
             backend_input_queue_.empty() && !vio_backend_module_->isWorking() &&
+            (dense_stereo_module_ ? !dense_stereo_module_->isWorking()
+                                  : true) &&
             (mesher_module_ ? !mesher_module_->isWorking() : true) &&
             (lcd_module_ ? !lcd_module_->isWorking() : true) &&
             (visualizer_module_ ? !visualizer_module_->isWorking() : true)))) {
@@ -381,6 +478,9 @@ bool Pipeline::shutdownWhenFinished() {
             << "Backend is working? "
             << (is_initialized_ ? vio_backend_module_->isWorking() : false);
 
+    VLOG_IF(5, dense_stereo_module_)
+        << "Dense stereo is working? " << dense_stereo_module_->isWorking();
+
     VLOG_IF(5, mesher_module_)
         << "Mesher is working? " << mesher_module_->isWorking();
 
@@ -473,9 +573,11 @@ void Pipeline::checkReInitialize(
     vio_frontend_module_->restart();
     CHECK(vio_backend_module_);
     vio_backend_module_->restart();
+    if (dense_stereo_module_) dense_stereo_module_->restart();
     mesher_module_->restart();
     if (lcd_module_) lcd_module_->restart();
-    visualizer_module_->restart();
+    if (visualizer_module_) visualizer_module_->restart();
+    if (headless_visualizer_module_) headless_visualizer_module_->restart();
     // Resume pipeline
     resume();
     initialization_frontend_output_queue_.resume();
@@ -791,6 +893,11 @@ void Pipeline::launchRemainingThreads() {
     backend_thread_ = VIO::make_unique<std::thread>(
         &VioBackEndModule::spin, CHECK_NOTNULL(vio_backend_module_.get()));
 
+    if (dense_stereo_module_) {
+      dense_stereo_thread_ = VIO::make_unique<std::thread>(
+          &DenseStereoModule::spin, CHECK_NOTNULL(dense_stereo_module_.get()));
+    }
+
     mesher_thread_ = VIO::make_unique<std::thread>(
         &MesherModule::spin, CHECK_NOTNULL(mesher_module_.get()));
 
@@ -805,6 +912,12 @@ void Pipeline::launchRemainingThreads() {
     //  visualizer_thread_ = VIO::make_unique<std::thread>(
     //      &VisualizerModule::spin, CHECK_NOTNULL(visualizer_module_.get()));
     //}
+    // The headless visualizer does not need the main thread.
+    if (headless_visualizer_module_) {
+      visualizer_thread_ = VIO::make_unique<std::thread>(
+          &HeadlessVisualizerModule::spin,
+          CHECK_NOTNULL(headless_visualizer_module_.get()));
+    }
 
     LOG(INFO) << "Backend, mesher and visualizer launched (parallel_run set to "
               << parallel_run_ << ").";
@@ -852,6 +965,9 @@ void Pipeline::stopThreads() {
   CHECK(vio_frontend_module_);
   vio_frontend_module_->shutdown();
 
+  LOG(INFO) << "Stopping dense stereo module and queues...";
+  if (dense_stereo_module_) dense_stereo_module_->shutdown();
+
   LOG(INFO) << "Stopping mesher module and queues...";
   if (mesher_module_) mesher_module_->shutdown();
 
@@ -860,6 +976,7 @@ void Pipeline::stopThreads() {
 
   LOG(INFO) << "Stopping visualizer module and queues...";
   if (visualizer_module_) visualizer_module_->shutdown();
+  if (headless_visualizer_module_) headless_visualizer_module_->shutdown();
 
   LOG(INFO) << "Sent stop flag to all module and queues...";
 }
@@ -895,6 +1012,18 @@ void Pipeline::joinThreads() {
     VLOG(1) << "No Frontend thread, not joining.";
   }
 
+  if (dense_stereo_thread_) {
+    LOG(INFO) << "Joining dense stereo thread...";
+    if (dense_stereo_thread_->joinable()) {
+      dense_stereo_thread_->join();
+      LOG(INFO) << "Joined dense stereo thread...";
+    } else {
+      LOG_IF(ERROR, parallel_run_) << "Dense stereo thread is not joinable...";
+    }
+  } else {
+    VLOG(1) << "No Dense stereo thread, not joining.";
+  }
+
   if (mesher_thread_) {
     LOG(INFO) << "Joining mesher thread...";
     if (mesher_thread_->joinable()) {
@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HammingMatcher.cpp
+ * @brief  Brute-force kNN matching of 256-bit binary descriptors (e.g. ORB).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/HammingMatcher.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+constexpr int HammingMatcher::kDescriptorBytes;
+constexpr int HammingMatcher::kTrainTile;
+constexpr int HammingMatcher::kQueryTile;
+
+/* ------------------------------------------------------------------------ */
+bool HammingMatcher::isSupported(const cv::Mat& descriptors) {
+  return descriptors.type() == CV_8U && descriptors.cols == kDescriptorBytes &&
+         descriptors.isContinuous();
+}
+
+/* ------------------------------------------------------------------------ */
+void HammingMatcher::knnMatch(const cv::Mat& query,
+                              const cv::Mat& train,
+                              std::vector<std::vector<cv::DMatch>>* matches) {
+  CHECK_NOTNULL(matches);
+  std::vector<BestTwo> best;
+  findBestTwo(query, train, &best);
+
+  const float kNoDistance = std::numeric_limits<float>::infinity();
+  matches->resize(best.size());
+  for (size_t i = 0u; i < best.size(); i++) {
+    const BestTwo& best_two = best[i];
+    std::vector<cv::DMatch>& match = (*matches)[i];
+    match.resize(2u);
+    match[0] = best_two.index_1 < 0
+                   ? cv::DMatch(i, -1, kNoDistance)
+                   : cv::DMatch(i, best_two.index_1, best_two.distance_1);
+    match[1] = best_two.index_2 < 0
+                   ? cv::DMatch(i, -1, kNoDistance)
+                   : cv::DMatch(i, best_two.index_2, best_two.distance_2);
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void HammingMatcher::ratioMatch(const cv::Mat& query,
+                                const cv::Mat& train,
+                                double lowe_ratio,
+                                std::vector<cv::DMatch>* matches) {
+  CHECK_NOTNULL(matches);
+  std::vector<BestTwo> best;
+  findBestTwo(query, train, &best);
+
+  matches->clear();
+  matches->reserve(best.size());
+  for (size_t i = 0u; i < best.size(); i++) {
+    const BestTwo& best_two = best[i];
+    if (best_two.index_1 < 0) continue;
+    // Without a second match the ratio is zero.
+    if (best_two.index_2 >= 0 &&
+        best_two.distance_1 >= lowe_ratio * best_two.distance_2) {
+      continue;
+    }
+    matches->push_back(
+        cv::DMatch(i, best_two.index_1, best_two.distance_1));
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void HammingMatcher::findBestTwo(const cv::Mat& query,
+                                 const cv::Mat& train,
+                                 std::vector<BestTwo>* best) {
+  CHECK_NOTNULL(best);
+  CHECK(query.empty() || isSupported(query));
+  CHECK(train.empty() || isSupported(train));
+  best->assign(query.rows, BestTwo());
+  if (query.empty() || train.empty()) return;
+
+  const uint8_t* query_data = query.ptr<uint8_t>();
+  const uint8_t* train_data = train.ptr<uint8_t>();
+  // Each tile of train descriptors stays in cache while all the query
+  // descriptors are compared against it.
+  for (int train_start = 0; train_start < train.rows;
+       train_start += kTrainTile) {
+    const int train_end = std::min(train.rows, train_start + kTrainTile);
+    for (int query_start = 0; query_start < query.rows;
+         query_start += kQueryTile) {
+      const int query_end = std::min(query.rows, query_start + kQueryTile);
+      for (int i = query_start; i < query_end; i++) {
+        const uint8_t* query_descriptor = query_data + i * kDescriptorBytes;
+        BestTwo& best_two = (*best)[i];
+        for (int j = train_start; j < train_end; j++) {
+          const int distance = hammingDistance256(
+              query_descriptor, train_data + j * kDescriptorBytes);
+          if (distance >= best_two.distance_2) continue;
+          if (distance < best_two.distance_1) {
+            best_two.distance_2 = best_two.distance_1;
+            best_two.index_2 = best_two.index_1;
+            best_two.distance_1 = distance;
+            best_two.index_1 = j;
+          } else {
+            best_two.distance_2 = distance;
+            best_two.index_2 = j;
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace VIO
@@ -14,10 +14,14 @@
 
 #include "kimera-vio/utils/Histogram.h"
 
+#include <algorithm>
 #include <cstddef>  // for nullptr
+#include <vector>
 
 #include <glog/logging.h>
 
+#include <opencv2/core/utility.hpp>
+
 namespace VIO {
 /* -------------------------------------------------------------------------- */
 Histogram::Histogram()
@@ -139,16 +143,39 @@ Histogram& Histogram::operator=(const Histogram& other) {
 
 /* -------------------------------------------------------------------------- */
 void Histogram::calculateHistogram(const cv::Mat& input, bool log_histogram) {
-  if (dims_ == 1) {
-    static const float* range_hist[] = {ranges_[0]};
-    cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
-                 hist_size_, range_hist, uniform_, accumulate_);
-  } else if (dims_ == 2) {
-    static const float* range_hist[] = {ranges_[0], ranges_[1]};
+  CHECK(dims_ == 1 || dims_ == 2)
+      << "The histogram is not meant for dim: " << dims_;
+  const float* range_hist[] = {ranges_[0], dims_ == 2 ? ranges_[1] : nullptr};
+
+  // Split the rows of the input in blocks, one per thread, and add the
+  // histograms of the blocks. Only possible without a mask.
+  static constexpr int kMinRowsPerBlock = 512;
+  const int nr_blocks =
+      (mask_.empty() && n_images_ == 1)
+          ? std::max(1, std::min(cv::getNumThreads(),
+                                 input.rows / kMinRowsPerBlock))
+          : 1;
+  if (nr_blocks == 1) {
     cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
                  hist_size_, range_hist, uniform_, accumulate_);
   } else {
-    LOG(FATAL) << "The histogram is not meant for dim: " << dims_;
+    std::vector<cv::Mat> block_histograms(nr_blocks);
+    cv::parallel_for_(
+        cv::Range(0, nr_blocks), [&](const cv::Range& blocks) {
+          for (int b = blocks.start; b < blocks.end; b++) {
+            const cv::Mat block =
+                input.rowRange(input.rows * b / nr_blocks,
+                               input.rows * (b + 1) / nr_blocks);
+            cv::calcHist(&block, 1, channels_, cv::Mat(), block_histograms[b],
+                         dims_, hist_size_, range_hist, uniform_, false);
+          }
+        });
+    if (!accumulate_ || histogram_.empty()) {
+      histogram_ = block_histograms[0];
+    } else {
+      histogram_ += block_histograms[0];
+    }
+    for (int b = 1; b < nr_blocks; b++) histogram_ += block_histograms[b];
   }
 
   if (log_histogram) {
@@ -0,0 +1,55 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MemoryUsage.cpp
+ * @brief  Query the resident set size (RSS) of the current process.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/MemoryUsage.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+namespace utils {
+
+size_t MemoryUsage::GetPeakRssBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    LOG(ERROR) << "Could not query peak RSS.";
+    return 0u;
+  }
+#ifdef __APPLE__
+  // Bytes on macOS.
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  // Kilobytes on Linux.
+  return static_cast<size_t>(usage.ru_maxrss) * 1024u;
+#endif
+}
+
+size_t MemoryUsage::GetCurrentRssBytes() {
+  // Second field of statm is the number of resident pages.
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0u;
+  size_t resident_pages = 0u;
+  if (!(statm >> total_pages >> resident_pages)) {
+    VLOG(1) << "Could not query current RSS.";
+    return 0u;
+  }
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+}  // namespace utils
+}  // namespace VIO
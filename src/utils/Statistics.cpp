@@ -58,6 +58,7 @@ size_t Statistics::GetHandle(std::string const& tag) {
     size_t handle = Instance().stats_collectors_.size();
     Instance().tag_map_[tag] = handle;
     Instance().stats_collectors_.push_back(StatisticsMapValue());
+    Instance().aggregates_.push_back(StatsAggregate());
     // Track the maximum tag length to help printing a table of values later.
     Instance().max_tag_length_ =
         std::max(Instance().max_tag_length_, tag.size());
@@ -226,6 +227,39 @@ double Statistics::GetVarianceDeltaTime(size_t handle) {
   return Instance().stats_collectors_[handle].LazyVarianceDeltaTime();
 }
 
+// Aggregated statistics.
+void Statistics::MergeAggregate(size_t handle,
+                                const StatsAggregate& aggregate) {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  CHECK_LT(handle, Instance().aggregates_.size());
+  Instance().aggregates_[handle].Merge(aggregate);
+}
+StatsAggregate Statistics::GetAggregate(size_t handle) {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().aggregates_[handle];
+}
+StatsAggregate Statistics::GetAggregate(std::string const& tag) {
+  return GetAggregate(GetHandle(tag));
+}
+StatsAggregate Statistics::GetMergedAggregate(size_t handle) {
+  StatsAggregate aggregate = GetAggregate(handle);
+  const size_t nr_samples = GetNumSamples(handle);
+  if (nr_samples > 0u) {
+    StatsAggregate samples;
+    samples.count_ = nr_samples;
+    samples.sum_ = GetTotal(handle);
+    const double mean = GetMean(handle);
+    samples.sum_sq_ = nr_samples * (GetVariance(handle) + mean * mean);
+    samples.min_ = GetMin(handle);
+    samples.max_ = GetMax(handle);
+    aggregate.Merge(samples);
+  }
+  return aggregate;
+}
+StatsAggregate Statistics::GetMergedAggregate(std::string const& tag) {
+  return GetMergedAggregate(GetHandle(tag));
+}
+
 std::string Statistics::SecondsToTimeString(double seconds) {
   double secs = fmod(seconds, 60);
   int minutes = (seconds / 60);
@@ -278,6 +312,17 @@ void Statistics::Print(std::ostream& out) {  // NOLINT
     out.width(7);
 
     out.setf(std::ios::right, std::ios::adjustfield);
+    // Tags fed by thread-local collectors have aggregates, and maybe samples.
+    if (GetAggregate(i).count_ > 0u) {
+      const StatsAggregate aggregate = GetMergedAggregate(i);
+      out << aggregate.count_ << "\t";
+      out << "-\t";
+      out << "(" << aggregate.Mean() << " +- ";
+      out << sqrt(aggregate.Variance()) << ")\t";
+      out << "[" << aggregate.min_ << "," << aggregate.max_ << "]";
+      out << std::endl;
+      continue;
+    }
     out << GetNumSamples(i) << "\t";
     if (GetNumSamples(i) > 0) {
       out << GetHz(i) << "\t";
@@ -343,7 +388,10 @@ void Statistics::WriteToYamlFile(const std::string &path) {
   for (const map_t::value_type& tag : tag_map) {
     const size_t index = tag.second;
 
-    if (GetNumSamples(index) > 0) {
+    // Tags fed by thread-local collectors have aggregates, and maybe samples:
+    // both are written in the same entry.
+    const bool has_aggregate = GetAggregate(index).count_ > 0u;
+    if (GetNumSamples(index) > 0 && !has_aggregate) {
       std::string label = tag.first;
 
       // We do not want colons or hashes in a label, as they might interfere
@@ -360,6 +408,18 @@ void Statistics::WriteToYamlFile(const std::string &path) {
       output_file << "  median: " << GetMedian(index) << "\n";
       output_file << "  q1: " << GetQ1(index) << "\n";
       output_file << "  q3: " << GetQ3(index) << "\n";
+    } else if (has_aggregate) {
+      const StatsAggregate aggregate = GetMergedAggregate(index);
+      std::string label = tag.first;
+      std::replace(label.begin(), label.end(), ':', '_');
+      std::replace(label.begin(), label.end(), '#', '_');
+
+      output_file << label << ":\n";
+      output_file << "  samples: " << aggregate.count_ << "\n";
+      output_file << "  mean: " << aggregate.Mean() << "\n";
+      output_file << "  stddev: " << sqrt(aggregate.Variance()) << "\n";
+      output_file << "  min: " << aggregate.min_ << "\n";
+      output_file << "  max: " << aggregate.max_ << "\n";
     }
     output_file << "\n";
   }
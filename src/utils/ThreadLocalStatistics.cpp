@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadLocalStatistics.cpp
+ * @brief  Low-overhead statistics for tight loops.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/ThreadLocalStatistics.h"
+
+namespace VIO {
+
+namespace utils {
+
+constexpr size_t ThreadLocalStatistics::kFlushEveryNSamples;
+constexpr int ThreadLocalStatistics::kFlushPeriodMs;
+
+ThreadLocalStatistics& ThreadLocalStatistics::Instance() {
+  // Destroyed (hence flushed) when the owning thread exits.
+  static thread_local ThreadLocalStatistics instance;
+  return instance;
+}
+
+ThreadLocalStatistics::ThreadLocalStatistics()
+    : aggregates_(),
+      samples_since_check_(0u),
+      last_flush_(std::chrono::steady_clock::now()) {}
+
+ThreadLocalStatistics::~ThreadLocalStatistics() { flush(); }
+
+void ThreadLocalStatistics::flush() {
+  for (size_t handle = 0u; handle < aggregates_.size(); ++handle) {
+    StatsAggregate& aggregate = aggregates_[handle];
+    if (aggregate.count_ > 0u) {
+      Statistics::MergeAggregate(handle, aggregate);
+      aggregate.Reset();
+    }
+  }
+  samples_since_check_ = 0u;
+  last_flush_ = std::chrono::steady_clock::now();
+}
+
+void ThreadLocalStatistics::flushIfPeriodElapsed() {
+  const auto now = std::chrono::steady_clock::now();
+  if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_flush_)
+          .count() >= kFlushPeriodMs) {
+    flush();
+  }
+}
+
+}  // namespace utils
+
+}  // namespace VIO
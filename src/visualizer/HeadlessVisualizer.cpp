@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HeadlessVisualizer.cpp
+ * @brief  Visualizer without display, that streams what to draw.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/HeadlessVisualizer.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+// Zero, i.e. unlimited, if the rate is not positive.
+std::chrono::steady_clock::duration getPeriod(const double& rate_hz) {
+  if (rate_hz <= 0.0) return std::chrono::steady_clock::duration::zero();
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / rate_hz));
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+HeadlessVisualizer::HeadlessVisualizer(const HeadlessVisualizerParams& params)
+    : params_(params),
+      display_period_(getPeriod(params_.display_rate_hz_)),
+      last_payload_time_(std::chrono::steady_clock::time_point::min()),
+      stream_(nullptr) {
+  if (!params_.output_.empty()) {
+    stream_ = VIO::make_unique<VisualizationStream>(params_.output_);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+VisualizationPayload::UniquePtr HeadlessVisualizer::spinOnce(
+    const HeadlessVisualizerInput& input) {
+  // Check the rate first, so that skipped payloads cost nothing.
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (last_payload_time_ != std::chrono::steady_clock::time_point::min() &&
+      now - last_payload_time_ < display_period_) {
+    VLOG(10) << "Skipping visualization payload to keep the display rate.";
+    return nullptr;
+  }
+  last_payload_time_ = now;
+
+  VisualizationPayload::UniquePtr payload = buildPayload(input);
+  if (stream_) stream_->send(*payload);
+  return payload;
+}
+
+/* -------------------------------------------------------------------------- */
+VisualizationPayload::UniquePtr HeadlessVisualizer::buildPayload(
+    const HeadlessVisualizerInput& input) {
+  CHECK(input.mesher_output_);
+  CHECK(input.backend_output_);
+  const BackendOutput& backend_output = *input.backend_output_;
+  const MesherOutput& mesher_output = *input.mesher_output_;
+  VisualizationPayload::UniquePtr payload =
+      VIO::make_unique<VisualizationPayload>(input.timestamp_);
+
+  const gtsam::Pose3& pose = backend_output.W_State_Blkf_.pose_;
+  const gtsam::Point3& position = pose.translation();
+  const gtsam::Quaternion& quaternion = pose.rotation().toQuaternion();
+  payload->W_Pose_Blkf_ = {{position.x(),
+                            position.y(),
+                            position.z(),
+                            quaternion.w(),
+                            quaternion.x(),
+                            quaternion.y(),
+                            quaternion.z()}};
+
+  const PointsWithIdMap& landmarks = backend_output.landmarks_with_id_map_;
+  const LmkIdToLmkTypeMap& lmk_types = backend_output.lmk_id_to_lmk_type_map_;
+  payload->landmark_ids_.reserve(landmarks.size());
+  payload->landmarks_.reserve(3u * landmarks.size());
+  payload->landmark_types_.reserve(landmarks.size());
+  for (const auto& id_landmark : landmarks) {
+    const LandmarkId& lmk_id = id_landmark.first;
+    const gtsam::Point3& landmark = id_landmark.second;
+    payload->landmark_ids_.push_back(lmk_id);
+    payload->landmarks_.push_back(static_cast<float>(landmark.x()));
+    payload->landmarks_.push_back(static_cast<float>(landmark.y()));
+    payload->landmarks_.push_back(static_cast<float>(landmark.z()));
+    const auto& lmk_type_it = lmk_types.find(lmk_id);
+    payload->landmark_types_.push_back(static_cast<uint8_t>(
+        lmk_type_it != lmk_types.end() ? lmk_type_it->second
+                                       : LandmarkType::SMART));
+  }
+
+  payload->mesh_.timestamp_ = input.timestamp_;
+  if (!mesher_output.vertices_mesh_.empty()) {
+    fillMeshStreamBuffer(mesher_output.vertices_mesh_,
+                         cv::Mat(),
+                         mesher_output.polygons_mesh_,
+                         input.timestamp_,
+                         &payload->mesh_);
+  }
+  return payload;
+}
+
+}  // namespace VIO
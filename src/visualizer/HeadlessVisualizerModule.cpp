@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HeadlessVisualizerModule.cpp
+ * @brief  Pipeline module for the headless visualizer.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/HeadlessVisualizerModule.h"
+
+namespace VIO {
+
+HeadlessVisualizerModule::HeadlessVisualizerModule(
+    bool parallel_run,
+    HeadlessVisualizer::UniquePtr visualizer)
+    : MIMOPipelineModule<HeadlessVisualizerInput, VisualizationPayload>(
+          "HeadlessVisualizer",
+          parallel_run),
+      backend_queue_("headless_visualizer_backend_queue"),
+      mesher_queue_("headless_visualizer_mesher_queue"),
+      visualizer_(std::move(visualizer)) {
+  CHECK(visualizer_);
+}
+
+HeadlessVisualizerModule::InputUniquePtr
+HeadlessVisualizerModule::getInputPacket() {
+  bool queue_state = false;
+  VizMesherInput mesher_payload = nullptr;
+  if (PIO::parallel_run_) {
+    queue_state = mesher_queue_.popBlocking(mesher_payload);
+  } else {
+    queue_state = mesher_queue_.pop(mesher_payload);
+  }
+
+  if (!queue_state) {
+    LOG_IF(WARNING, PIO::parallel_run_)
+        << "Module: " << name_id_ << " - Mesher queue is down";
+    VLOG_IF(1, !PIO::parallel_run_)
+        << "Module: " << name_id_ << " - Mesher queue is empty or down";
+    return nullptr;
+  }
+
+  CHECK(mesher_payload);
+  const Timestamp& timestamp = mesher_payload->timestamp_;
+
+  VizBackendInput backend_payload = nullptr;
+  PIO::syncQueue(timestamp, &backend_queue_, &backend_payload);
+  CHECK(backend_payload);
+
+  return VIO::make_unique<HeadlessVisualizerInput>(
+      timestamp, mesher_payload, backend_payload);
+}
+
+HeadlessVisualizerModule::OutputUniquePtr HeadlessVisualizerModule::spinOnce(
+    HeadlessVisualizerInput::UniquePtr input) {
+  CHECK(input);
+  return visualizer_->spinOnce(*input);
+}
+
+void HeadlessVisualizerModule::shutdownQueues() {
+  LOG(INFO) << "Shutting down queues for: " << name_id_;
+  backend_queue_.shutdown();
+  mesher_queue_.shutdown();
+}
+
+bool HeadlessVisualizerModule::hasWork() const {
+  return !mesher_queue_.empty();
+}
+
+}  // namespace VIO
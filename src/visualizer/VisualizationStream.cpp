@@ -0,0 +1,304 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VisualizationStream.cpp
+ * @brief  Sends visualization payloads to a file or a local socket.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/VisualizationStream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+constexpr char kStreamMagic[4] = {'K', 'V', 'Z', '1'};
+constexpr char kSocketPrefix[] = "unix:";
+// Sanity bound on the size of a record when reading.
+constexpr uint32_t kMaxRecordLength = 1u << 30;
+
+template <typename T>
+inline void appendBinary(std::vector<char>* buffer, const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer->insert(buffer->end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+inline void appendArray(std::vector<char>* buffer,
+                        const std::vector<T>& values) {
+  appendBinary(buffer, static_cast<uint32_t>(values.size()));
+  const char* bytes = reinterpret_cast<const char*>(values.data());
+  buffer->insert(buffer->end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+template <typename T>
+inline bool parseBinary(const std::vector<char>& buffer,
+                        size_t* offset,
+                        T* value) {
+  if (*offset + sizeof(T) > buffer.size()) return false;
+  std::copy(buffer.data() + *offset,
+            buffer.data() + *offset + sizeof(T),
+            reinterpret_cast<char*>(value));
+  *offset += sizeof(T);
+  return true;
+}
+
+template <typename T>
+inline bool parseArray(const std::vector<char>& buffer,
+                       size_t* offset,
+                       std::vector<T>* values) {
+  uint32_t size = 0u;
+  if (!parseBinary(buffer, offset, &size)) return false;
+  if (*offset + static_cast<size_t>(size) * sizeof(T) > buffer.size()) {
+    return false;
+  }
+  values->resize(size);
+  std::copy(buffer.data() + *offset,
+            buffer.data() + *offset + size * sizeof(T),
+            reinterpret_cast<char*>(values->data()));
+  *offset += size * sizeof(T);
+  return true;
+}
+
+inline bool isSocketOutput(const std::string& output) {
+  return output.compare(0, sizeof(kSocketPrefix) - 1u, kSocketPrefix) == 0;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+VisualizationStream::VisualizationStream(const std::string& output)
+    : output_(output),
+      is_socket_(isSocketOutput(output)),
+      file_(),
+      socket_fd_(-1),
+      record_(),
+      send_buffer_(),
+      send_offset_(0u),
+      nr_dropped_(0u) {
+  CHECK(!output_.empty());
+  if (!is_socket_) {
+    file_.open(output_, std::ios::out | std::ios::binary | std::ios::trunc);
+    CHECK(file_.is_open()) << "Cannot open file: " << output_;
+    file_.write(kStreamMagic, sizeof(kStreamMagic));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+VisualizationStream::~VisualizationStream() {
+  // Never wait for the consumer: what it did not take is lost.
+  closeSocket();
+  LOG_IF(WARNING, nr_dropped_ > 0u)
+      << "Visualization stream dropped " << nr_dropped_ << " payloads.";
+}
+
+/* -------------------------------------------------------------------------- */
+bool VisualizationStream::send(const VisualizationPayload& payload) {
+  if (!is_socket_) {
+    serialize(payload, &record_);
+    const uint32_t record_length = static_cast<uint32_t>(record_.size());
+    file_.write(reinterpret_cast<const char*>(&record_length),
+                sizeof(record_length));
+    file_.write(record_.data(), record_.size());
+    file_.flush();
+    if (!file_) {
+      LOG(ERROR) << "Could not write visualization payload to: " << output_;
+      nr_dropped_++;
+      return false;
+    }
+    return true;
+  }
+
+  // Finish sending the previous record first: if the consumer is still
+  // reading it, drop this one, before spending time to serialize it.
+  if ((socket_fd_ < 0 && !connectSocket()) || !flushSocket() ||
+      send_offset_ < send_buffer_.size()) {
+    nr_dropped_++;
+    return false;
+  }
+  serialize(payload, &record_);
+  send_buffer_.clear();
+  send_offset_ = 0u;
+  appendBinary(&send_buffer_, static_cast<uint32_t>(record_.size()));
+  send_buffer_.insert(send_buffer_.end(), record_.begin(), record_.end());
+  return flushSocket();
+}
+
+/* -------------------------------------------------------------------------- */
+bool VisualizationStream::connectSocket() {
+  CHECK_LT(socket_fd_, 0);
+  const std::string path = output_.substr(sizeof(kSocketPrefix) - 1u);
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  CHECK_LT(path.size(), sizeof(address.sun_path))
+      << "Socket path is too long: " << path;
+  std::copy(path.begin(), path.end(), address.sun_path);
+
+  socket_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  CHECK_GE(socket_fd_, 0) << "Cannot create socket: " << std::strerror(errno);
+  // Non blocking, also when connecting to a consumer with a full backlog.
+  ::fcntl(socket_fd_, F_SETFL, ::fcntl(socket_fd_, F_GETFL) | O_NONBLOCK);
+  if (::connect(socket_fd_,
+                reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    VLOG(5) << "No visualization consumer on: " << path << " ("
+            << std::strerror(errno) << ")";
+    closeSocket();
+    return false;
+  }
+  LOG(INFO) << "Streaming visualization payloads to: " << path;
+  // Each connection is a new stream.
+  send_buffer_.assign(kStreamMagic, kStreamMagic + sizeof(kStreamMagic));
+  send_offset_ = 0u;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+bool VisualizationStream::flushSocket() {
+  CHECK_GE(socket_fd_, 0);
+  while (send_offset_ < send_buffer_.size()) {
+    const ssize_t nr_sent = ::send(socket_fd_,
+                                   send_buffer_.data() + send_offset_,
+                                   send_buffer_.size() - send_offset_,
+                                   MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (nr_sent > 0) {
+      send_offset_ += static_cast<size_t>(nr_sent);
+    } else if (nr_sent < 0 && errno == EINTR) {
+      continue;
+    } else if (nr_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The consumer is slow, the rest is sent next time.
+      return true;
+    } else {
+      LOG(WARNING) << "Lost visualization consumer: " << std::strerror(errno);
+      closeSocket();
+      return false;
+    }
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void VisualizationStream::closeSocket() {
+  if (socket_fd_ >= 0) {
+    ::close(socket_fd_);
+    socket_fd_ = -1;
+  }
+  send_buffer_.clear();
+  send_offset_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+void VisualizationStream::serialize(const VisualizationPayload& payload,
+                                    std::vector<char>* record) {
+  CHECK_NOTNULL(record)->clear();
+  CHECK_EQ(payload.landmarks_.size(), 3u * payload.landmark_ids_.size());
+  CHECK_EQ(payload.landmark_types_.size(), payload.landmark_ids_.size());
+  const MeshStreamBuffer& mesh = payload.mesh_;
+  record->reserve(
+      sizeof(Timestamp) + sizeof(payload.W_Pose_Blkf_) +
+      6u * sizeof(uint32_t) +
+      payload.landmark_ids_.size() *
+          (sizeof(LandmarkId) + 3u * sizeof(float) + 1u) +
+      mesh.vertices_.size() * sizeof(float) + mesh.colors_.size() +
+      mesh.faces_.size() * sizeof(uint32_t));
+  appendBinary(record, payload.timestamp_);
+  for (const double& value : payload.W_Pose_Blkf_) {
+    appendBinary(record, value);
+  }
+  appendArray(record, payload.landmark_ids_);
+  appendArray(record, payload.landmarks_);
+  appendArray(record, payload.landmark_types_);
+  appendArray(record, mesh.vertices_);
+  appendArray(record, mesh.colors_);
+  appendArray(record, mesh.faces_);
+}
+
+/* -------------------------------------------------------------------------- */
+VisualizationPayload::UniquePtr VisualizationStream::deserialize(
+    const std::vector<char>& record) {
+  size_t offset = 0u;
+  Timestamp timestamp = 0;
+  if (!parseBinary(record, &offset, &timestamp)) return nullptr;
+  VisualizationPayload::UniquePtr payload =
+      VIO::make_unique<VisualizationPayload>(timestamp);
+  for (double& value : payload->W_Pose_Blkf_) {
+    if (!parseBinary(record, &offset, &value)) return nullptr;
+  }
+  MeshStreamBuffer& mesh = payload->mesh_;
+  mesh.timestamp_ = timestamp;
+  if (!parseArray(record, &offset, &payload->landmark_ids_) ||
+      !parseArray(record, &offset, &payload->landmarks_) ||
+      !parseArray(record, &offset, &payload->landmark_types_) ||
+      !parseArray(record, &offset, &mesh.vertices_) ||
+      !parseArray(record, &offset, &mesh.colors_) ||
+      !parseArray(record, &offset, &mesh.faces_) || offset != record.size()) {
+    return nullptr;
+  }
+  const size_t nr_landmarks = payload->landmark_ids_.size();
+  if (payload->landmarks_.size() != 3u * nr_landmarks ||
+      payload->landmark_types_.size() != nr_landmarks ||
+      mesh.colors_.size() != mesh.vertices_.size() ||
+      mesh.faces_.size() % 3u != 0u) {
+    return nullptr;
+  }
+  const size_t nr_vertices = mesh.getNumberOfVertices();
+  for (const uint32_t& vertex_id : mesh.faces_) {
+    if (vertex_id >= nr_vertices) return nullptr;
+  }
+  return payload;
+}
+
+/* -------------------------------------------------------------------------- */
+bool VisualizationStream::readPayloads(
+    std::istream* stream,
+    std::vector<VisualizationPayload::UniquePtr>* payloads) {
+  CHECK_NOTNULL(stream);
+  CHECK_NOTNULL(payloads)->clear();
+  char magic[sizeof(kStreamMagic)];
+  stream->read(magic, sizeof(magic));
+  if (!*stream || !std::equal(magic, magic + sizeof(magic), kStreamMagic)) {
+    LOG(ERROR) << "Not a visualization stream.";
+    return false;
+  }
+
+  std::vector<char> record;
+  uint32_t record_length = 0u;
+  while (stream->read(reinterpret_cast<char*>(&record_length),
+                      sizeof(record_length))) {
+    if (record_length > kMaxRecordLength) {
+      LOG(ERROR) << "Corrupted visualization stream.";
+      return false;
+    }
+    record.resize(record_length);
+    if (!stream->read(record.data(), record_length)) {
+      // The stream was closed in the middle of a record.
+      LOG(WARNING) << "Truncated last record in visualization stream.";
+      break;
+    }
+    VisualizationPayload::UniquePtr payload = deserialize(record);
+    if (!payload) {
+      LOG(ERROR) << "Corrupted visualization stream.";
+      return false;
+    }
+    payloads->push_back(std::move(payload));
+  }
+  return true;
+}
+
+}  // namespace VIO
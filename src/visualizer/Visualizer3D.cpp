@@ -69,7 +69,14 @@ DEFINE_bool(set_mesh_ambient,
             "mesh.");
 DEFINE_bool(set_mesh_lighting, true, "Whether to use lighting for the mesh.");
 DEFINE_bool(log_mesh, false, "Log the mesh at time horizon.");
-DEFINE_bool(log_accumulated_mesh, false, "Accumulate the mesh when logging.");
+DEFINE_bool(log_accumulated_mesh, false,
+            "Accumulate the mesh when logging, only for log_mesh_format 0.");
+DEFINE_int32(log_mesh_format, 1,
+             "Format of the logged mesh:\n 0: ascii ply every ~6s, "
+             "1: binary ply of the latest mesh, 2: stream of mesh deltas.\n"
+             "Plys are written to output_mesh.ply, deltas to "
+             "output_mesh.delta. Binary meshes are written at every update "
+             "by a background thread.");
 
 DEFINE_int32(displayed_trajectory_length, 50,
              "Set length of plotted trajectory."
@@ -96,6 +103,25 @@ Visualizer3D::Visualizer3D(const VisualizationType& viz_type,
       logger_(nullptr) {
   if (FLAGS_log_mesh) {
     logger_ = VIO::make_unique<VisualizerLogger>();
+    LOG_IF(WARNING, FLAGS_log_accumulated_mesh && FLAGS_log_mesh_format != 0)
+        << "log_accumulated_mesh is only supported by log_mesh_format 0, "
+           "only the latest mesh will be logged.";
+    switch (FLAGS_log_mesh_format) {
+      case 0: {
+        break;
+      }
+      case 1: {
+        logger_->openMeshStream(MeshStreamFormat::kBinaryPly);
+        break;
+      }
+      case 2: {
+        logger_->openMeshStream(MeshStreamFormat::kDelta);
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unknown mesh log format: " << FLAGS_log_mesh_format;
+      }
+    }
   }
 
   if (VLOG_IS_ON(2)) {
@@ -148,6 +174,14 @@ VisualizerOutput::UniquePtr Visualizer3D::spinOnce(
         }
       }
 
+      // Log the chunks of the global mesh that changed.
+      const std::vector<MeshChunk>& updated_mesh_chunks =
+          input.mesher_output_->updated_mesh_chunks_;
+      if (FLAGS_log_mesh && !updated_mesh_chunks.empty()) {
+        CHECK(logger_);
+        logger_->logMeshChunks(updated_mesh_chunks);
+      }
+
       // 3D mesh visualization
       VLOG(10) << "Starting 3D mesh visualization...";
 
@@ -715,6 +749,12 @@ void Visualizer3D::visualizeMesh3DWithColoredClusters(
   } else {
     // Visualize the mesh with same colour.
     visualizeMesh3D(map_points_3d, polygons_mesh);
+    if (FLAGS_log_mesh) {
+      const cv::Mat colors(
+          map_points_3d.rows, 1, CV_8UC3, cv::viz::Color::white());
+      logMesh(map_points_3d, colors, polygons_mesh, timestamp,
+              FLAGS_log_accumulated_mesh);
+    }
   }
 }
 
@@ -1090,6 +1130,12 @@ void Visualizer3D::logMesh(const cv::Mat& map_points_3d, const cv::Mat& colors,
                            const cv::Mat& polygons_mesh,
                            const Timestamp& timestamp,
                            bool log_accumulated_mesh) {
+  CHECK(logger_);
+  if (FLAGS_log_mesh_format != 0) {
+    // Binary logging does not block, no need to throttle it.
+    logger_->streamMesh(map_points_3d, colors, polygons_mesh, timestamp);
+    return;
+  }
   /// Log the mesh in a ply file.
   static Timestamp last_timestamp = timestamp;
   static const Timestamp first_timestamp = timestamp;
@@ -1097,7 +1143,6 @@ void Visualizer3D::logMesh(const cv::Mat& map_points_3d, const cv::Mat& colors,
       6500000000) {  // Log every 6 seconds approx. (a little bit more than
                      // time-horizon)
     LOG(WARNING) << "Logging mesh every (ns) = " << timestamp - last_timestamp;
-    CHECK(logger_);
     logger_->logMesh(
         map_points_3d, colors, polygons_mesh, timestamp, log_accumulated_mesh);
     last_timestamp = timestamp;
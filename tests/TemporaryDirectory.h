@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TemporaryDirectory.h
+ * @brief  Directory for the outputs of a test, removed after the test.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Creates a new directory in the temporary directory of the tests, and
+// removes it with all its contents when destroyed. Declare it before the
+// objects that write into it, so that they are destroyed first.
+class TemporaryDirectory {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TemporaryDirectory);
+
+  explicit TemporaryDirectory(const std::string& prefix) {
+    const std::string path_template = ::testing::TempDir() + prefix + "XXXXXX";
+    std::vector<char> path(path_template.begin(), path_template.end());
+    path.push_back('\0');
+    CHECK(mkdtemp(path.data()) != nullptr)
+        << "Could not create temporary directory: " << path_template;
+    path_ = path.data();
+  }
+
+  ~TemporaryDirectory() {
+    boost::system::error_code error;
+    boost::filesystem::remove_all(path_, error);
+    LOG_IF(WARNING, error) << "Could not remove temporary directory: "
+                           << path_ << " (" << error.message() << ")";
+  }
+
+  inline const std::string& getPath() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace VIO
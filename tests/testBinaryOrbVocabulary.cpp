@@ -0,0 +1,157 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBinaryOrbVocabulary.cpp
+ * @brief  Test conversion to and loading of the binary ORB vocabulary.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+
+#include "TemporaryDirectory.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class BinaryOrbVocabularyFixture : public ::testing::Test {
+ public:
+  BinaryOrbVocabularyFixture()
+      : output_dir_("testBinaryOrbVocabulary"),
+        text_vocabulary_path_(FLAGS_test_data_path +
+                              "/ForLoopClosureDetector/small_voc.yml.gz"),
+        // Do not write in the test data.
+        binary_vocabulary_path_(output_dir_.getPath() + "/small_voc.bin") {
+    text_vocabulary_.load(text_vocabulary_path_);
+
+    // Random ORB descriptors, always the same.
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    for (size_t i = 0u; i < 200u; i++) {
+      cv::Mat descriptor(1, 32, CV_8U);
+      for (int j = 0; j < descriptor.cols; j++) {
+        descriptor.at<uchar>(0, j) = static_cast<uchar>(byte_dist(rng));
+      }
+      descriptors_.push_back(descriptor);
+    }
+  }
+
+ protected:
+  TemporaryDirectory output_dir_;
+  std::string text_vocabulary_path_;
+  std::string binary_vocabulary_path_;
+  OrbVocabulary text_vocabulary_;
+  std::vector<cv::Mat> descriptors_;
+};
+
+TEST_F(BinaryOrbVocabularyFixture, saveAndLoadBinary) {
+  ASSERT_FALSE(text_vocabulary_.empty());
+  EXPECT_FALSE(BinaryOrbVocabulary::isBinaryFile(text_vocabulary_path_));
+  ASSERT_TRUE(BinaryOrbVocabulary::saveBinary(text_vocabulary_,
+                                              binary_vocabulary_path_));
+  EXPECT_TRUE(BinaryOrbVocabulary::isBinaryFile(binary_vocabulary_path_));
+
+  BinaryOrbVocabulary binary_vocabulary;
+  ASSERT_TRUE(binary_vocabulary.loadBinary(binary_vocabulary_path_));
+  EXPECT_EQ(binary_vocabulary.size(), text_vocabulary_.size());
+  EXPECT_EQ(binary_vocabulary.getBranchingFactor(),
+            text_vocabulary_.getBranchingFactor());
+  EXPECT_EQ(binary_vocabulary.getDepthLevels(),
+            text_vocabulary_.getDepthLevels());
+  EXPECT_EQ(binary_vocabulary.getScoringType(),
+            text_vocabulary_.getScoringType());
+  EXPECT_EQ(binary_vocabulary.getWeightingType(),
+            text_vocabulary_.getWeightingType());
+
+  // Both vocabularies give the same BoW vectors.
+  DBoW2::BowVector text_bow_vec, binary_bow_vec;
+  text_vocabulary_.transform(descriptors_, text_bow_vec);
+  binary_vocabulary.transform(descriptors_, binary_bow_vec);
+  ASSERT_EQ(binary_bow_vec.size(), text_bow_vec.size());
+  for (const auto& word : text_bow_vec) {
+    ASSERT_TRUE(binary_bow_vec.find(word.first) != binary_bow_vec.end());
+    EXPECT_DOUBLE_EQ(binary_bow_vec.at(word.first), word.second);
+  }
+}
+
+TEST_F(BinaryOrbVocabularyFixture, loadWrongFile) {
+  BinaryOrbVocabulary binary_vocabulary;
+  EXPECT_FALSE(binary_vocabulary.loadBinary(text_vocabulary_path_));
+  EXPECT_FALSE(binary_vocabulary.loadBinary(binary_vocabulary_path_ + "x"));
+}
+
+TEST_F(BinaryOrbVocabularyFixture, sharedVocabularyDatabase) {
+  ASSERT_TRUE(BinaryOrbVocabulary::saveBinary(text_vocabulary_,
+                                              binary_vocabulary_path_));
+  std::shared_ptr<const OrbVocabulary> vocabulary =
+      loadOrbVocabulary(binary_vocabulary_path_);
+  ASSERT_TRUE(vocabulary);
+
+  {
+    SharedVocabularyOrbDatabase db(vocabulary);
+    // The database uses the vocabulary, not a copy of it.
+    EXPECT_EQ(db.getVocabulary(), vocabulary.get());
+
+    DBoW2::BowVector bow_vec;
+    db.getVocabulary()->transform(descriptors_, bow_vec);
+    db.add(bow_vec);
+    DBoW2::QueryResults results;
+    db.query(bow_vec, results, 1);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].Id, 0u);
+  }
+
+  // The vocabulary survives the database.
+  EXPECT_EQ(vocabulary->size(), text_vocabulary_.size());
+}
+
+TEST_F(BinaryOrbVocabularyFixture, copyDatabase) {
+  ASSERT_TRUE(BinaryOrbVocabulary::saveBinary(text_vocabulary_,
+                                              binary_vocabulary_path_));
+  std::shared_ptr<const OrbVocabulary> vocabulary =
+      loadOrbVocabulary(binary_vocabulary_path_);
+  ASSERT_TRUE(vocabulary);
+  DBoW2::BowVector bow_vec;
+  vocabulary->transform(descriptors_, bow_vec);
+
+  std::unique_ptr<SharedVocabularyOrbDatabase> db_copy;
+  DBoW2::QueryResults expected_results;
+  {
+    SharedVocabularyOrbDatabase db(vocabulary);
+    db.add(bow_vec);
+    db.query(bow_vec, expected_results, 1);
+    ASSERT_EQ(expected_results.size(), 1u);
+    // Deep copy of the vocabulary, the binary one is unmapped below.
+    db_copy = VIO::make_unique<SharedVocabularyOrbDatabase>(
+        copyOrbVocabulary(*db.getVocabulary()), db);
+  }
+  vocabulary.reset();
+
+  // The copy still has the same words, with valid node descriptors.
+  DBoW2::BowVector copy_bow_vec;
+  db_copy->getVocabulary()->transform(descriptors_, copy_bow_vec);
+  EXPECT_EQ(copy_bow_vec, bow_vec);
+  db_copy->add(copy_bow_vec);
+  DBoW2::QueryResults results;
+  db_copy->query(copy_bow_vec, results, 1);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_DOUBLE_EQ(results[0].Score, expected_results[0].Score);
+}
+
+}  // namespace VIO
@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testDenseStereo.cpp
+ * @brief  Test the semi-dense stereo points.
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtsam/geometry/Cal3_S2.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/DenseStereo.h"
+
+namespace VIO {
+
+// Textured stereo pair of a fronto-parallel plane: every left pixel is
+// disparity pixels to the right of its match in the right image.
+void makeFrontoParallelStereoPair(const int& disparity,
+                                  cv::Mat* left_img,
+                                  cv::Mat* right_img) {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> intensity_dist(0, 255);
+  *left_img = cv::Mat(240, 320, CV_8UC1);
+  *right_img = cv::Mat(240, 320, CV_8UC1);
+  for (int r = 0; r < left_img->rows; r++) {
+    for (int c = 0; c < left_img->cols; c++) {
+      left_img->at<uint8_t>(r, c) = intensity_dist(rng);
+    }
+    for (int c = 0; c < right_img->cols; c++) {
+      const int left_c = c + disparity;
+      right_img->at<uint8_t>(r, c) = left_c < left_img->cols
+                                         ? left_img->at<uint8_t>(r, left_c)
+                                         : intensity_dist(rng);
+    }
+  }
+}
+
+TEST(testDenseStereo, computeDensePoints) {
+  static constexpr int kDisparity = 16;
+  static constexpr double kBaseline = 0.1;
+  const gtsam::Cal3_S2 left_cam_rect(400.0, 400.0, 0.0, 160.0, 120.0);
+  const double expected_depth = left_cam_rect.fx() * kBaseline / kDisparity;
+  cv::Mat left_img, right_img;
+  makeFrontoParallelStereoPair(kDisparity, &left_img, &right_img);
+
+  DenseStereoParams params;
+  params.only_gradients_ = false;
+  DenseStereo dense_stereo(params);
+  KeypointsCV keypoints;
+  std::vector<Vector3> keypoints_3d;
+  dense_stereo.computeDensePoints(left_img,
+                                  right_img,
+                                  left_cam_rect,
+                                  kBaseline,
+                                  cv::Mat(),
+                                  cv::Mat(),
+                                  &keypoints,
+                                  &keypoints_3d);
+  ASSERT_EQ(keypoints.size(), keypoints_3d.size());
+  // At most one point per grid cell, and none where the right image ends.
+  const size_t nr_cells = static_cast<size_t>(
+      (left_img.rows * params.scale_ / params.grid_step_) *
+      (left_img.cols * params.scale_ / params.grid_step_));
+  EXPECT_GT(keypoints.size(), nr_cells / 3u);
+  EXPECT_LE(keypoints.size(), nr_cells);
+  size_t nr_inliers = 0u;
+  for (size_t i = 0u; i < keypoints.size(); i++) {
+    const Vector3& point = keypoints_3d[i];
+    if (std::abs(point.z() - expected_depth) < 0.05 * expected_depth) {
+      nr_inliers++;
+    }
+    // Without rectification maps, keypoints are the rectified pixels.
+    EXPECT_NEAR(left_cam_rect.fx() * point.x() / point.z() +
+                    left_cam_rect.px(),
+                keypoints[i].x,
+                1e-3);
+    EXPECT_NEAR(left_cam_rect.fy() * point.y() / point.z() +
+                    left_cam_rect.py(),
+                keypoints[i].y,
+                1e-3);
+  }
+  EXPECT_GT(nr_inliers, 0.95 * keypoints.size());
+
+  // The number of points is bounded.
+  params.max_nr_points_ = 20;
+  DenseStereo bounded_dense_stereo(params);
+  bounded_dense_stereo.computeDensePoints(left_img,
+                                          right_img,
+                                          left_cam_rect,
+                                          kBaseline,
+                                          cv::Mat(),
+                                          cv::Mat(),
+                                          &keypoints,
+                                          &keypoints_3d);
+  EXPECT_EQ(keypoints.size(), 20u);
+  EXPECT_EQ(keypoints_3d.size(), 20u);
+
+  // Points out of the range of depths are discarded.
+  params.max_nr_points_ = 1500;
+  params.max_depth_ = 0.5 * expected_depth;
+  DenseStereo near_dense_stereo(params);
+  near_dense_stereo.computeDensePoints(left_img,
+                                       right_img,
+                                       left_cam_rect,
+                                       kBaseline,
+                                       cv::Mat(),
+                                       cv::Mat(),
+                                       &keypoints,
+                                       &keypoints_3d);
+  EXPECT_LT(keypoints.size(), 0.05 * nr_cells);
+}
+
+}  // namespace VIO
@@ -0,0 +1,237 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testGlobalMesh.cpp
+ * @brief  Test the persistent mesh of the whole map.
+ * @author Antoni Rosinol
+ */
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/mesh/GlobalMesh.h"
+#include "kimera-vio/mesh/Mesh.h"
+
+#include "TemporaryDirectory.h"
+
+namespace VIO {
+
+// Triangle of side ~1m with a corner at the given position.
+Mesh3D::Polygon makeTriangleAt(const LandmarkId& first_lmk_id,
+                               const Vertex3D& corner) {
+  Mesh3D::Polygon polygon;
+  polygon.push_back(Mesh3D::VertexType(first_lmk_id, corner));
+  polygon.push_back(
+      Mesh3D::VertexType(first_lmk_id + 1, corner + Vertex3D(1.0f, 0, 0)));
+  polygon.push_back(
+      Mesh3D::VertexType(first_lmk_id + 2, corner + Vertex3D(0, 1.0f, 0)));
+  return polygon;
+}
+
+Mesh3D makeMesh(const std::vector<Mesh3D::Polygon>& polygons) {
+  Mesh3D mesh_3d;
+  for (const Mesh3D::Polygon& polygon : polygons) {
+    mesh_3d.addPolygonToMesh(polygon);
+  }
+  return mesh_3d;
+}
+
+TEST(testGlobalMesh, mergeVerticesAndFaces) {
+  GlobalMesh global_mesh(0.1, 4.0, 10u, "");
+  std::vector<MeshChunk> updated_chunks;
+
+  // Triangles are not added while they are in the time horizon.
+  global_mesh.update(
+      makeMesh({makeTriangleAt(0, Vertex3D(0.52f, 0.52f, 0.52f))}),
+      &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+
+  // The same triangle, moved, and a neighboring triangle that shares two of
+  // its vertices.
+  Mesh3D::Polygon neighbor;
+  neighbor.push_back(Mesh3D::VertexType(1, Vertex3D(1.53f, 0.53f, 0.53f)));
+  neighbor.push_back(Mesh3D::VertexType(2, Vertex3D(0.53f, 1.53f, 0.53f)));
+  neighbor.push_back(Mesh3D::VertexType(3, Vertex3D(1.53f, 1.53f, 0.53f)));
+  global_mesh.update(
+      makeMesh({makeTriangleAt(0, Vertex3D(0.54f, 0.54f, 0.54f)), neighbor}),
+      &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+
+  // Both triangles leave the time horizon, and are added with their last
+  // positions.
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  ASSERT_EQ(updated_chunks.size(), 1u);
+  ASSERT_EQ(updated_chunks[0].vertices_.size(), 4u);
+  EXPECT_EQ(updated_chunks[0].faces_.size(), 2u);
+  // Merged vertices are averaged.
+  size_t nr_merged_vertices = 0u;
+  for (const Vertex3D& vertex : updated_chunks[0].vertices_) {
+    if (std::fabs(vertex.z - (0.54f + 0.53f) / 2.0f) < 1e-5f) {
+      nr_merged_vertices++;
+    }
+  }
+  EXPECT_EQ(nr_merged_vertices, 2u);
+}
+
+TEST(testGlobalMesh, dropReplacedTriangles) {
+  GlobalMesh global_mesh(0.1, 4.0, 10u, "");
+  std::vector<MeshChunk> updated_chunks;
+
+  // A quad of landmarks 0 to 3, triangulated along one diagonal, then along
+  // the other one: the first triangulation is dropped.
+  const Vertex3D p0(0.55f, 0.55f, 0.55f);
+  const Vertex3D p1(1.55f, 0.55f, 0.55f);
+  const Vertex3D p2(1.55f, 1.55f, 0.55f);
+  const Vertex3D p3(0.55f, 1.55f, 0.55f);
+  Mesh3D::Polygon t012, t023, t013, t123;
+  t012 = {Mesh3D::VertexType(0, p0),
+          Mesh3D::VertexType(1, p1),
+          Mesh3D::VertexType(2, p2)};
+  t023 = {Mesh3D::VertexType(0, p0),
+          Mesh3D::VertexType(2, p2),
+          Mesh3D::VertexType(3, p3)};
+  t013 = {Mesh3D::VertexType(0, p0),
+          Mesh3D::VertexType(1, p1),
+          Mesh3D::VertexType(3, p3)};
+  t123 = {Mesh3D::VertexType(1, p1),
+          Mesh3D::VertexType(2, p2),
+          Mesh3D::VertexType(3, p3)};
+  global_mesh.update(makeMesh({t012, t023}), &updated_chunks);
+  global_mesh.update(makeMesh({t013, t123}), &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  ASSERT_EQ(updated_chunks.size(), 1u);
+  EXPECT_EQ(updated_chunks[0].vertices_.size(), 4u);
+  ASSERT_EQ(updated_chunks[0].faces_.size(), 2u);
+  std::vector<std::array<Vertex3D, 3>> faces;
+  for (const MeshChunk::Face& face : updated_chunks[0].faces_) {
+    faces.push_back({updated_chunks[0].vertices_[face[0]],
+                     updated_chunks[0].vertices_[face[1]],
+                     updated_chunks[0].vertices_[face[2]]});
+  }
+  const std::vector<std::array<Vertex3D, 3>> expected_faces = {{p0, p1, p3},
+                                                               {p1, p2, p3}};
+  EXPECT_EQ(faces, expected_faces);
+}
+
+TEST(testGlobalMesh, skipCollapsedTriangles) {
+  GlobalMesh global_mesh(0.1, 4.0, 10u, "");
+  std::vector<MeshChunk> updated_chunks;
+
+  // Two vertices of the triangle fall in the same voxel.
+  Mesh3D::Polygon collapsed;
+  collapsed.push_back(Mesh3D::VertexType(0, Vertex3D(0.51f, 0.51f, 0.51f)));
+  collapsed.push_back(Mesh3D::VertexType(1, Vertex3D(0.52f, 0.52f, 0.52f)));
+  collapsed.push_back(Mesh3D::VertexType(2, Vertex3D(1.51f, 0.51f, 0.51f)));
+  global_mesh.update(makeMesh({collapsed}), &updated_chunks);
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+
+  // The chunk of the collapsed triangle has no vertex without faces.
+  global_mesh.update(
+      makeMesh({makeTriangleAt(3, Vertex3D(0.75f, 0.75f, 0.75f))}),
+      &updated_chunks);
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  ASSERT_EQ(updated_chunks.size(), 1u);
+  EXPECT_EQ(updated_chunks[0].vertices_.size(), 3u);
+  EXPECT_EQ(updated_chunks[0].faces_.size(), 1u);
+}
+
+TEST(testGlobalMesh, evictAndReloadChunks) {
+  TemporaryDirectory chunks_dir("testGlobalMesh");
+  GlobalMesh global_mesh(0.1, 4.0, 1u, chunks_dir.getPath());
+  std::vector<MeshChunk> updated_chunks;
+
+  const Vertex3D corner(0.5f, 0.5f, 0.5f);
+  global_mesh.update(makeMesh({makeTriangleAt(0, corner)}), &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+
+  // Moving to another chunk adds the first triangle.
+  global_mesh.update(
+      makeMesh({makeTriangleAt(3, Vertex3D(40.5f, 0.5f, 0.5f))}),
+      &updated_chunks);
+  EXPECT_EQ(updated_chunks.size(), 1u);
+  EXPECT_EQ(global_mesh.getNumberOfChunksInMemory(), 1u);
+  EXPECT_EQ(global_mesh.getNumberOfChunksOnDisk(), 0u);
+
+  // Coming back adds the second triangle, which evicts the first chunk.
+  global_mesh.update(makeMesh({makeTriangleAt(6, corner)}), &updated_chunks);
+  EXPECT_EQ(updated_chunks.size(), 1u);
+  EXPECT_EQ(global_mesh.getNumberOfChunksInMemory(), 1u);
+  EXPECT_EQ(global_mesh.getNumberOfChunksOnDisk(), 1u);
+
+  // The first chunk is read from disk, and it has the triangle already.
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+  EXPECT_EQ(global_mesh.getNumberOfChunksInMemory(), 1u);
+  EXPECT_EQ(global_mesh.getNumberOfChunksOnDisk(), 1u);
+
+  // Chunk files round trip.
+  MeshChunk chunk(GridIndex(1, -2, 3));
+  chunk.vertices_ = {Vertex3D(0, 0, 0), Vertex3D(1, 0, 0), Vertex3D(0, 1, 0)};
+  chunk.faces_ = {{{0u, 1u, 2u}}};
+  const std::vector<uint32_t> vertex_weights = {1u, 2u, 3u};
+  const std::vector<GridIndex> vertex_voxels = {
+      GridIndex(0, 0, 0), GridIndex(10, 0, 0), GridIndex(0, 10, -1)};
+  const std::string filename = chunks_dir.getPath() + "/round_trip.bin";
+  ASSERT_TRUE(
+      GlobalMesh::saveChunk(filename, chunk, vertex_weights, vertex_voxels));
+  MeshChunk loaded_chunk;
+  std::vector<uint32_t> loaded_vertex_weights;
+  std::vector<GridIndex> loaded_vertex_voxels;
+  ASSERT_TRUE(GlobalMesh::loadChunk(filename,
+                                    &loaded_chunk,
+                                    &loaded_vertex_weights,
+                                    &loaded_vertex_voxels));
+  EXPECT_EQ(loaded_chunk.index_, chunk.index_);
+  EXPECT_EQ(loaded_chunk.vertices_, chunk.vertices_);
+  EXPECT_EQ(loaded_chunk.faces_, chunk.faces_);
+  EXPECT_EQ(loaded_vertex_weights, vertex_weights);
+  EXPECT_EQ(loaded_vertex_voxels, vertex_voxels);
+}
+
+TEST(testGlobalMesh, reloadVertexOutsideOfItsVoxel) {
+  TemporaryDirectory chunks_dir("testGlobalMesh");
+  GlobalMesh global_mesh(0.1, 4.0, 1u, chunks_dir.getPath());
+  std::vector<MeshChunk> updated_chunks;
+
+  const Vertex3D corner(0.55f, 0.55f, 0.55f);
+  global_mesh.update(makeMesh({makeTriangleAt(0, corner)}), &updated_chunks);
+  global_mesh.update(
+      makeMesh({makeTriangleAt(3, Vertex3D(40.5f, 0.5f, 0.5f))}),
+      &updated_chunks);
+  global_mesh.update(makeMesh({makeTriangleAt(6, corner)}), &updated_chunks);
+  ASSERT_EQ(global_mesh.getNumberOfChunksOnDisk(), 1u);
+
+  // Move the first vertex of the evicted chunk across the border of its
+  // voxel, as averaging its points may do.
+  const std::string filename = chunks_dir.getPath() + "/chunk_0_0_0.bin";
+  MeshChunk chunk;
+  std::vector<uint32_t> vertex_weights;
+  std::vector<GridIndex> vertex_voxels;
+  ASSERT_TRUE(GlobalMesh::loadChunk(
+      filename, &chunk, &vertex_weights, &vertex_voxels));
+  ASSERT_EQ(chunk.vertices_.size(), 3u);
+  EXPECT_EQ(vertex_voxels[0], GridIndex(5, 5, 5));
+  chunk.vertices_[0] = Vertex3D(0.61f, 0.55f, 0.55f);
+  ASSERT_TRUE(
+      GlobalMesh::saveChunk(filename, chunk, vertex_weights, vertex_voxels));
+
+  // Coming back, the vertex still merges the points of its voxel.
+  global_mesh.update(Mesh3D(), &updated_chunks);
+  EXPECT_TRUE(updated_chunks.empty());
+}
+
+}  // namespace VIO
@@ -0,0 +1,105 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testHammingMatcher.cpp
+ * @brief  Test the Hamming kNN matcher against the OpenCV brute-force matcher.
+ * @author Antoni Rosinol
+ */
+
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/HammingMatcher.h"
+
+namespace VIO {
+
+cv::Mat randomDescriptors(int rows, std::mt19937* rng) {
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  cv::Mat descriptors(rows, HammingMatcher::kDescriptorBytes, CV_8U);
+  for (int i = 0; i < descriptors.rows; i++) {
+    for (int j = 0; j < descriptors.cols; j++) {
+      descriptors.at<uchar>(i, j) = static_cast<uchar>(byte_dist(*rng));
+    }
+  }
+  return descriptors;
+}
+
+TEST(testHammingMatcher, hammingDistance) {
+  std::mt19937 rng(0);
+  const cv::Mat descriptors = randomDescriptors(20, &rng);
+  for (int i = 0; i < descriptors.rows; i++) {
+    for (int j = 0; j < descriptors.rows; j++) {
+      EXPECT_EQ(hammingDistance256(descriptors.ptr<uint8_t>(i),
+                                   descriptors.ptr<uint8_t>(j)),
+                cv::norm(descriptors.row(i),
+                         descriptors.row(j),
+                         cv::NORM_HAMMING));
+    }
+  }
+}
+
+TEST(testHammingMatcher, sameResultsAsBFMatcher) {
+  // More train descriptors than a tile, so that several tiles are visited.
+  std::mt19937 rng(1);
+  const cv::Mat query = randomDescriptors(150, &rng);
+  const cv::Mat train = randomDescriptors(600, &rng);
+  ASSERT_TRUE(HammingMatcher::isSupported(query));
+  ASSERT_TRUE(HammingMatcher::isSupported(train));
+
+  std::vector<std::vector<cv::DMatch>> expected_matches, matches;
+  cv::BFMatcher(cv::NORM_HAMMING).knnMatch(query, train, expected_matches, 2);
+  HammingMatcher::knnMatch(query, train, &matches);
+  ASSERT_EQ(matches.size(), expected_matches.size());
+  for (size_t i = 0u; i < matches.size(); i++) {
+    ASSERT_EQ(matches[i].size(), 2u);
+    // Ties may be broken differently, distances may not.
+    EXPECT_EQ(matches[i][0].queryIdx, static_cast<int>(i));
+    EXPECT_EQ(matches[i][0].distance, expected_matches[i][0].distance);
+    EXPECT_EQ(matches[i][1].distance, expected_matches[i][1].distance);
+  }
+
+  // The ratio test keeps the same matches as on the kNN matches.
+  const double lowe_ratio = 0.9;
+  std::vector<cv::DMatch> ratio_matches;
+  HammingMatcher::ratioMatch(query, train, lowe_ratio, &ratio_matches);
+  std::vector<cv::DMatch> expected_ratio_matches;
+  for (const std::vector<cv::DMatch>& match : matches) {
+    if (match[0].distance < lowe_ratio * match[1].distance) {
+      expected_ratio_matches.push_back(match[0]);
+    }
+  }
+  ASSERT_EQ(ratio_matches.size(), expected_ratio_matches.size());
+  for (size_t i = 0u; i < ratio_matches.size(); i++) {
+    EXPECT_EQ(ratio_matches[i].queryIdx, expected_ratio_matches[i].queryIdx);
+    EXPECT_EQ(ratio_matches[i].trainIdx, expected_ratio_matches[i].trainIdx);
+  }
+}
+
+TEST(testHammingMatcher, singleTrainDescriptor) {
+  std::mt19937 rng(2);
+  const cv::Mat query = randomDescriptors(3, &rng);
+  const cv::Mat train = randomDescriptors(1, &rng);
+  std::vector<std::vector<cv::DMatch>> matches;
+  HammingMatcher::knnMatch(query, train, &matches);
+  ASSERT_EQ(matches.size(), 3u);
+  for (const std::vector<cv::DMatch>& match : matches) {
+    EXPECT_EQ(match[0].trainIdx, 0);
+    EXPECT_EQ(match[1].trainIdx, -1);
+  }
+
+  // Without a second best match, the best one always passes the ratio test.
+  std::vector<cv::DMatch> ratio_matches;
+  HammingMatcher::ratioMatch(query, train, 0.1, &ratio_matches);
+  EXPECT_EQ(ratio_matches.size(), 3u);
+}
+
+}  // namespace VIO
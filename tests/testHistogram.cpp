@@ -0,0 +1,141 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testHistogram.cpp
+ * @brief  test Histogram, in particular its parallel computation in blocks.
+ * @author Antoni Rosinol
+ */
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/utils/Histogram.h"
+
+namespace VIO {
+
+class HistogramFixture : public ::testing::Test {
+ protected:
+  // Enough rows for several blocks of 512 rows.
+  static constexpr int kNrThreads = 4;
+  static constexpr int kNrRows = 512 * kNrThreads + 100;
+
+  HistogramFixture() : nr_threads_(cv::getNumThreads()), rng_(0) {}
+
+  void SetUp() override { cv::setNumThreads(kNrThreads); }
+  void TearDown() override { cv::setNumThreads(nr_threads_); }
+
+  // Histogram computed with a single call to cv::calcHist.
+  cv::Mat calcHist(const cv::Mat& input,
+                   const std::vector<int>& channels,
+                   const std::vector<int>& hist_size,
+                   const std::vector<std::array<float, 2>>& ranges) const {
+    std::vector<const float*> range_ptrs;
+    for (const std::array<float, 2>& range : ranges) {
+      range_ptrs.push_back(range.data());
+    }
+    cv::Mat histogram;
+    cv::calcHist(&input,
+                 1,
+                 channels.data(),
+                 cv::Mat(),
+                 histogram,
+                 static_cast<int>(hist_size.size()),
+                 hist_size.data(),
+                 range_ptrs.data());
+    return histogram;
+  }
+
+ protected:
+  const int nr_threads_;
+  cv::RNG rng_;
+};
+
+TEST_F(HistogramFixture, calculateHistogram1DSameAsCalcHist) {
+  cv::Mat input(kNrRows, 1, CV_32F);
+  rng_.fill(input, cv::RNG::UNIFORM, -1.0, 4.0);
+  const std::vector<int> channels = {0};
+  const std::vector<int> hist_size = {512};
+  const std::vector<std::array<float, 2>> ranges = {{-0.75f, 3.0f}};
+
+  Histogram histogram(1, channels, cv::Mat(), 1, hist_size, ranges);
+  histogram.calculateHistogram(input);
+
+  const cv::Mat expected = calcHist(input, channels, hist_size, ranges);
+  ASSERT_EQ(histogram.getHistogram().size(), expected.size());
+  EXPECT_EQ(cv::norm(histogram.getHistogram(), expected, cv::NORM_INF), 0.0);
+}
+
+TEST_F(HistogramFixture, calculateHistogram2DSameAsCalcHist) {
+  cv::Mat input(kNrRows, 1, CV_32FC2);
+  rng_.fill(input,
+            cv::RNG::UNIFORM,
+            cv::Scalar(0.0, -6.0),
+            cv::Scalar(M_PI, 6.0));
+  const std::vector<int> channels = {0, 1};
+  const std::vector<int> hist_size = {40, 40};
+  const std::vector<std::array<float, 2>> ranges = {
+      {0.0f, static_cast<float>(M_PI)}, {-6.0f, 6.0f}};
+
+  Histogram histogram(1, channels, cv::Mat(), 2, hist_size, ranges);
+  histogram.calculateHistogram(input);
+
+  const cv::Mat expected = calcHist(input, channels, hist_size, ranges);
+  ASSERT_EQ(histogram.getHistogram().size(), expected.size());
+  EXPECT_EQ(cv::norm(histogram.getHistogram(), expected, cv::NORM_INF), 0.0);
+}
+
+TEST_F(HistogramFixture, calculateHistogramWithEmptyBlock) {
+  // The rows of the first block are all out of the range of the histogram,
+  // so its histogram is empty.
+  cv::Mat input(kNrRows, 1, CV_32F);
+  rng_.fill(input, cv::RNG::UNIFORM, 0.0, 1.0);
+  input.rowRange(0, kNrRows / kNrThreads).setTo(10.0);
+  const std::vector<int> channels = {0};
+  const std::vector<int> hist_size = {64};
+  const std::vector<std::array<float, 2>> ranges = {{0.0f, 1.0f}};
+
+  Histogram histogram(1, channels, cv::Mat(), 1, hist_size, ranges);
+  histogram.calculateHistogram(input);
+
+  const cv::Mat expected = calcHist(input, channels, hist_size, ranges);
+  ASSERT_EQ(histogram.getHistogram().size(), expected.size());
+  EXPECT_EQ(cv::norm(histogram.getHistogram(), expected, cv::NORM_INF), 0.0);
+  EXPECT_EQ(cv::sum(histogram.getHistogram())[0],
+            kNrRows - kNrRows / kNrThreads);
+}
+
+TEST_F(HistogramFixture, calculateHistogramSameAsSequential) {
+  cv::Mat input(kNrRows, 1, CV_32F);
+  rng_.fill(input, cv::RNG::NORMAL, 1.0, 1.0);
+  const std::vector<int> channels = {0};
+  const std::vector<int> hist_size = {512};
+  const std::vector<std::array<float, 2>> ranges = {{-0.75f, 3.0f}};
+
+  cv::setNumThreads(1);
+  Histogram sequential_histogram(1, channels, cv::Mat(), 1, hist_size, ranges);
+  sequential_histogram.calculateHistogram(input);
+  cv::setNumThreads(kNrThreads);
+  Histogram parallel_histogram(1, channels, cv::Mat(), 1, hist_size, ranges);
+  parallel_histogram.calculateHistogram(input);
+
+  EXPECT_EQ(cv::norm(sequential_histogram.getHistogram(),
+                     parallel_histogram.getHistogram(),
+                     cv::NORM_INF),
+            0.0);
+}
+
+}  // namespace VIO
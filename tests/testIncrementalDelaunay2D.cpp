@@ -0,0 +1,338 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalDelaunay2D.cpp
+ * @brief  Test the incremental 2D Delaunay triangulation.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/mesh/IncrementalDelaunay2D.h"
+#include "kimera-vio/mesh/Mesher.h"
+
+DECLARE_bool(incremental_delaunay_2d);
+
+namespace VIO {
+
+typedef std::array<std::pair<float, float>, 3> SortedTriangle;
+
+// Triangles with sorted vertices, to compare triangulations.
+std::set<SortedTriangle> sortTriangles(
+    const std::vector<cv::Vec6f>& triangulation_2D) {
+  std::set<SortedTriangle> triangles;
+  for (const cv::Vec6f& t : triangulation_2D) {
+    SortedTriangle triangle = {std::make_pair(t[0], t[1]),
+                               std::make_pair(t[2], t[3]),
+                               std::make_pair(t[4], t[5])};
+    std::sort(triangle.begin(), triangle.end());
+    triangles.insert(triangle);
+  }
+  return triangles;
+}
+
+// Triangles whose circumcircle is inside the image: unlike the triangles on
+// the convex hull of the keypoints, they do not depend on the vertices of the
+// triangle enclosing the image, which differ between cv::Subdiv2D and
+// IncrementalDelaunay2D.
+std::vector<cv::Vec6f> getInnerTriangles(
+    const cv::Size& img_size,
+    const std::vector<cv::Vec6f>& triangulation_2D) {
+  std::vector<cv::Vec6f> inner_triangles;
+  for (const cv::Vec6f& t : triangulation_2D) {
+    const double bx = t[2] - t[0], by = t[3] - t[1];
+    const double cx = t[4] - t[0], cy = t[5] - t[1];
+    const double d = 2.0 * (bx * cy - by * cx);
+    if (d == 0.0) continue;
+    const double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+    const double ux = (cy * b2 - by * c2) / d;
+    const double uy = (bx * c2 - cx * b2) / d;
+    const double r = std::sqrt(ux * ux + uy * uy) + 1.0;
+    const double x = t[0] + ux, y = t[1] + uy;
+    if (x - r > 0.0 && x + r < img_size.width && y - r > 0.0 &&
+        y + r < img_size.height) {
+      inner_triangles.push_back(t);
+    }
+  }
+  return inner_triangles;
+}
+
+TEST(testIncrementalDelaunay2D, sameAsFromScratch) {
+  std::mt19937 rng(0);
+  const cv::Size img_size(752, 480);
+  std::uniform_real_distribution<float> x_dist(0.0f, img_size.width);
+  std::uniform_real_distribution<float> y_dist(0.0f, img_size.height);
+  std::uniform_real_distribution<float> motion_dist(-3.0f, 3.0f);
+  std::uniform_int_distribution<int> track_dist(0, 9);
+
+  std::map<LandmarkId, cv::Point2f> keypoints;
+  LandmarkId next_lmk_id = 0;
+  for (size_t i = 0u; i < 300u; i++) {
+    keypoints[next_lmk_id++] = cv::Point2f(x_dist(rng), y_dist(rng));
+  }
+
+  IncrementalDelaunay2D delaunay;
+  for (size_t frame = 0u; frame < 20u; frame++) {
+    LandmarkIds lmk_ids;
+    std::vector<cv::Point2f> points;
+    for (const auto& keypoint : keypoints) {
+      lmk_ids.push_back(keypoint.first);
+      points.push_back(keypoint.second);
+    }
+    std::vector<cv::Vec6f> triangulation_2D;
+    delaunay.update(img_size, lmk_ids, points, &triangulation_2D);
+
+    // Points in general position have a unique Delaunay triangulation.
+    IncrementalDelaunay2D expected_delaunay;
+    std::vector<cv::Vec6f> expected_triangulation_2D;
+    expected_delaunay.update(
+        img_size, lmk_ids, points, &expected_triangulation_2D);
+    EXPECT_EQ(delaunay.getNumberOfVertices(),
+              expected_delaunay.getNumberOfVertices());
+    EXPECT_EQ(sortTriangles(triangulation_2D),
+              sortTriangles(expected_triangulation_2D));
+
+    // Lose a tenth of the keypoints, move the others, and detect new ones.
+    std::map<LandmarkId, cv::Point2f> tracked_keypoints;
+    for (const auto& keypoint : keypoints) {
+      if (track_dist(rng) == 0) continue;
+      tracked_keypoints[keypoint.first] =
+          keypoint.second + cv::Point2f(motion_dist(rng), motion_dist(rng));
+    }
+    for (size_t i = 0u; i < 30u; i++) {
+      tracked_keypoints[next_lmk_id++] = cv::Point2f(x_dist(rng), y_dist(rng));
+    }
+    keypoints = tracked_keypoints;
+  }
+}
+
+TEST(testIncrementalDelaunay2D, emptyCircumcircles) {
+  // Keypoints on a grid, with many collinear and cocircular keypoints.
+  const cv::Size img_size(100, 100);
+  LandmarkIds lmk_ids;
+  std::vector<cv::Point2f> points;
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 10; j++) {
+      lmk_ids.push_back(i * 10 + j);
+      points.push_back(cv::Point2f(i * 10.0f, j * 10.0f));
+    }
+  }
+  // Out of the image.
+  lmk_ids.push_back(100);
+  points.push_back(cv::Point2f(100.0f, 50.0f));
+
+  IncrementalDelaunay2D delaunay;
+  std::vector<cv::Vec6f> triangulation_2D;
+  delaunay.update(img_size, lmk_ids, points, &triangulation_2D);
+  EXPECT_EQ(delaunay.getNumberOfVertices(), 100u);
+  // A 10x10 grid has 2 triangles per cell.
+  EXPECT_EQ(triangulation_2D.size(), 162u);
+
+  // Shift every other column half a cell, and remove a keypoint.
+  for (int i = 1; i < 10; i += 2) {
+    for (int j = 0; j < 10; j++) points[i * 10 + j].y += 5.0f;
+  }
+  lmk_ids.erase(lmk_ids.begin() + 55);
+  points.erase(points.begin() + 55);
+  delaunay.update(img_size, lmk_ids, points, &triangulation_2D);
+  EXPECT_EQ(delaunay.getNumberOfVertices(), 99u);
+  for (const cv::Vec6f& t : triangulation_2D) {
+    for (const cv::Point2f& p : points) {
+      if (p.x >= img_size.width) continue;
+      const double adx = t[0] - p.x, ady = t[1] - p.y;
+      const double bdx = t[2] - p.x, bdy = t[3] - p.y;
+      const double cdx = t[4] - p.x, cdy = t[5] - p.y;
+      const double in_circle =
+          (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) +
+          (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy) +
+          (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+      EXPECT_LE(in_circle, 0.0);
+    }
+  }
+}
+
+TEST(testIncrementalDelaunay2D, sameAsSubdiv2D) {
+  const bool incremental_delaunay_2d = FLAGS_incremental_delaunay_2d;
+  std::mt19937 rng(1);
+  const cv::Size img_size(752, 480);
+  std::uniform_real_distribution<float> x_dist(0.0f, img_size.width);
+  std::uniform_real_distribution<float> y_dist(0.0f, img_size.height);
+  std::uniform_real_distribution<float> motion_dist(-3.0f, 3.0f);
+  std::uniform_int_distribution<int> track_dist(0, 9);
+
+  std::map<LandmarkId, cv::Point2f> keypoints;
+  LandmarkId next_lmk_id = 0;
+  for (size_t i = 0u; i < 300u; i++) {
+    keypoints[next_lmk_id++] = cv::Point2f(x_dist(rng), y_dist(rng));
+  }
+
+  const MesherParams mesher_params(gtsam::Pose3(), img_size);
+  Mesher incremental_mesher(mesher_params);
+  Mesher subdiv_mesher(mesher_params);
+  for (size_t frame = 0u; frame < 10u; frame++) {
+    PointsWithIdMap points_with_id;
+    KeypointsCV points;
+    std::vector<Vector3> points_3d;
+    LandmarkIds lmk_ids;
+    for (const auto& keypoint : keypoints) {
+      const Vector3 point_3d(keypoint.second.x, keypoint.second.y, 1.0);
+      points_with_id[keypoint.first] = gtsam::Point3(point_3d);
+      points.push_back(keypoint.second);
+      points_3d.push_back(point_3d);
+      lmk_ids.push_back(keypoint.first);
+    }
+    const std::vector<KeypointStatus> points_status(points.size(),
+                                                    KeypointStatus::VALID);
+
+    std::vector<cv::Vec6f> triangulation_2D;
+    FLAGS_incremental_delaunay_2d = true;
+    incremental_mesher.updateMesh3D(points_with_id,
+                                    points,
+                                    points_status,
+                                    points_3d,
+                                    lmk_ids,
+                                    gtsam::Pose3(),
+                                    nullptr,
+                                    &triangulation_2D);
+    std::vector<cv::Vec6f> expected_triangulation_2D;
+    FLAGS_incremental_delaunay_2d = false;
+    subdiv_mesher.updateMesh3D(points_with_id,
+                               points,
+                               points_status,
+                               points_3d,
+                               lmk_ids,
+                               gtsam::Pose3(),
+                               nullptr,
+                               &expected_triangulation_2D);
+
+    const std::vector<cv::Vec6f> inner_triangles =
+        getInnerTriangles(img_size, triangulation_2D);
+    EXPECT_GT(inner_triangles.size(), triangulation_2D.size() / 2u);
+    EXPECT_EQ(sortTriangles(inner_triangles),
+              sortTriangles(
+                  getInnerTriangles(img_size, expected_triangulation_2D)));
+
+    // Lose a tenth of the keypoints, move the others, and detect new ones.
+    std::map<LandmarkId, cv::Point2f> tracked_keypoints;
+    for (const auto& keypoint : keypoints) {
+      if (track_dist(rng) == 0) continue;
+      cv::Point2f tracked_keypoint =
+          keypoint.second + cv::Point2f(motion_dist(rng), motion_dist(rng));
+      tracked_keypoint.x =
+          std::min(std::max(tracked_keypoint.x, 0.0f), img_size.width - 1.0f);
+      tracked_keypoint.y =
+          std::min(std::max(tracked_keypoint.y, 0.0f), img_size.height - 1.0f);
+      tracked_keypoints[keypoint.first] = tracked_keypoint;
+    }
+    for (size_t i = 0u; i < 30u; i++) {
+      tracked_keypoints[next_lmk_id++] = cv::Point2f(x_dist(rng), y_dist(rng));
+    }
+    keypoints = tracked_keypoints;
+  }
+  FLAGS_incremental_delaunay_2d = incremental_delaunay_2d;
+}
+
+TEST(testIncrementalDelaunay2D, denseKeypointsNotKept) {
+  const bool incremental_delaunay_2d = FLAGS_incremental_delaunay_2d;
+  std::mt19937 rng(2);
+  const cv::Size img_size(752, 480);
+  std::uniform_real_distribution<float> x_dist(0.0f, img_size.width);
+  std::uniform_real_distribution<float> y_dist(0.0f, img_size.height);
+  std::uniform_real_distribution<float> motion_dist(-3.0f, 3.0f);
+
+  std::map<LandmarkId, cv::Point2f> keypoints;
+  LandmarkId next_lmk_id = 0;
+  for (size_t i = 0u; i < 200u; i++) {
+    keypoints[next_lmk_id++] = cv::Point2f(x_dist(rng), y_dist(rng));
+  }
+
+  static constexpr size_t kNrDenseKeypoints = 500u;
+  const MesherParams mesher_params(gtsam::Pose3(), img_size);
+  Mesher incremental_mesher(mesher_params);
+  Mesher subdiv_mesher(mesher_params);
+  for (size_t frame = 0u; frame < 5u; frame++) {
+    PointsWithIdMap points_with_id;
+    KeypointsCV points;
+    std::vector<Vector3> points_3d;
+    LandmarkIds lmk_ids;
+    for (const auto& keypoint : keypoints) {
+      const Vector3 point_3d(keypoint.second.x, keypoint.second.y, 1.0);
+      points_with_id[keypoint.first] = gtsam::Point3(point_3d);
+      points.push_back(keypoint.second);
+      points_3d.push_back(point_3d);
+      lmk_ids.push_back(keypoint.first);
+    }
+    // Dense keypoints, with new landmark ids at every keyframe, as the ones
+    // of DenseStereo.
+    for (size_t i = 0u; i < kNrDenseKeypoints; i++) {
+      const cv::Point2f point(x_dist(rng), y_dist(rng));
+      const Vector3 point_3d(point.x, point.y, 1.0);
+      points_with_id[next_lmk_id] = gtsam::Point3(point_3d);
+      points.push_back(point);
+      points_3d.push_back(point_3d);
+      lmk_ids.push_back(next_lmk_id++);
+    }
+    const std::vector<KeypointStatus> points_status(points.size(),
+                                                    KeypointStatus::VALID);
+
+    std::vector<cv::Vec6f> triangulation_2D;
+    FLAGS_incremental_delaunay_2d = true;
+    incremental_mesher.updateMesh3D(points_with_id,
+                                    points,
+                                    points_status,
+                                    points_3d,
+                                    lmk_ids,
+                                    gtsam::Pose3(),
+                                    nullptr,
+                                    &triangulation_2D,
+                                    kNrDenseKeypoints);
+    std::vector<cv::Vec6f> expected_triangulation_2D;
+    FLAGS_incremental_delaunay_2d = false;
+    subdiv_mesher.updateMesh3D(points_with_id,
+                               points,
+                               points_status,
+                               points_3d,
+                               lmk_ids,
+                               gtsam::Pose3(),
+                               nullptr,
+                               &expected_triangulation_2D);
+
+    // The dense keypoints are triangulated, but only the others are kept for
+    // the next keyframe.
+    EXPECT_EQ(sortTriangles(getInnerTriangles(img_size, triangulation_2D)),
+              sortTriangles(
+                  getInnerTriangles(img_size, expected_triangulation_2D)));
+    EXPECT_GT(triangulation_2D.size(), 2u * keypoints.size());
+    EXPECT_EQ(incremental_mesher.getDelaunay2D().getNumberOfVertices(),
+              keypoints.size());
+
+    // Move the keypoints.
+    for (auto& keypoint : keypoints) {
+      keypoint.second += cv::Point2f(motion_dist(rng), motion_dist(rng));
+      keypoint.second.x =
+          std::min(std::max(keypoint.second.x, 0.0f), img_size.width - 1.0f);
+      keypoint.second.y =
+          std::min(std::max(keypoint.second.y, 0.0f), img_size.height - 1.0f);
+    }
+  }
+  FLAGS_incremental_delaunay_2d = incremental_delaunay_2d;
+}
+
+}  // namespace VIO
@@ -12,6 +12,7 @@
  * @author Marcus Abate, Luca Carlone
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,8 +27,11 @@
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/Tracker.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
+#include "TemporaryDirectory.h"
+
 DECLARE_string(test_data_path);
 DECLARE_string(vocabulary_path);
 
@@ -282,6 +286,85 @@ TEST_F(LCDFixture, processAndAddFrame) {
             lcd_detector_->getLCDParams().nfeatures_);
 }
 
+TEST_F(LCDFixture, processAndAddFrameWithoutCopies) {
+  /* Test that the stereo frame is matched without copying it or the
+   * descriptors, with the same result as rewriting its features */
+  CHECK(lcd_detector_);
+  lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  const LCDFrame& lcd_frame = lcd_detector_->getFrameDatabasePtr()->at(0);
+
+  // Descriptors are row views of the descriptor matrix.
+  ASSERT_EQ(lcd_frame.descriptors_vec_.size(),
+            static_cast<size_t>(lcd_frame.descriptors_mat_.rows));
+  for (size_t i = 0; i < lcd_frame.descriptors_vec_.size(); i++) {
+    EXPECT_EQ(lcd_frame.descriptors_vec_[i].data,
+              lcd_frame.descriptors_mat_.ptr(i));
+  }
+
+  StereoFrame stereo_frame = *ref1_stereo_frame_;
+  lcd_detector_->rewriteStereoFrameFeatures(lcd_frame.keypoints_,
+                                            &stereo_frame);
+  ASSERT_EQ(lcd_frame.keypoints_3d_.size(),
+            stereo_frame.keypoints_3d_.size());
+  ASSERT_EQ(lcd_frame.versors_.size(),
+            stereo_frame.getLeftFrame().versors_.size());
+  for (size_t i = 0; i < lcd_frame.keypoints_3d_.size(); i++) {
+    EXPECT_TRUE(
+        lcd_frame.keypoints_3d_[i].isApprox(stereo_frame.keypoints_3d_[i]));
+    EXPECT_TRUE(lcd_frame.versors_[i].isApprox(
+        stereo_frame.getLeftFrame().versors_[i]));
+  }
+}
+
+TEST_F(LCDFixture, processAndAddFrameInTiles) {
+  /* Test ORB extraction in a grid of tiles */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams params = lcd_detector_->getLCDParams();
+  params.orb_grid_rows_ = 2;
+  params.orb_grid_cols_ = 3;
+  LoopClosureDetector lcd_detector(params, false);
+  lcd_detector.setIntrinsics(*ref1_stereo_frame_);
+
+  FrameId id_0 = lcd_detector.processAndAddFrame(*ref1_stereo_frame_);
+  const LCDFrame& lcd_frame = lcd_detector.getFrameDatabasePtr()->at(id_0);
+  EXPECT_GT(lcd_frame.keypoints_.size(), 0);
+  EXPECT_LE(lcd_frame.keypoints_.size(), params.nfeatures_);
+  EXPECT_EQ(lcd_frame.descriptors_mat_.rows, lcd_frame.keypoints_.size());
+  EXPECT_EQ(lcd_frame.descriptors_mat_.type(), CV_8U);
+  EXPECT_EQ(lcd_frame.descriptors_mat_.cols, 32);
+  EXPECT_EQ(lcd_frame.descriptors_vec_.size(), lcd_frame.keypoints_.size());
+  const cv::Mat& img = ref1_stereo_frame_->getLeftFrame().img_;
+  for (const cv::KeyPoint& keypoint : lcd_frame.keypoints_) {
+    EXPECT_GE(keypoint.pt.x, 0);
+    EXPECT_GE(keypoint.pt.y, 0);
+    EXPECT_LT(keypoint.pt.x, img.cols);
+    EXPECT_LT(keypoint.pt.y, img.rows);
+  }
+}
+
+TEST_F(LCDFixture, processAndAddFrameWithFrontendKeypoints) {
+  /* Test ORB description of the keypoints tracked by the frontend */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams params = lcd_detector_->getLCDParams();
+  params.use_frontend_keypoints_ = true;
+  LoopClosureDetector lcd_detector(params, false);
+  lcd_detector.setIntrinsics(*ref1_stereo_frame_);
+
+  FrameId id_0 = lcd_detector.processAndAddFrame(*ref1_stereo_frame_);
+  const LCDFrame& lcd_frame = lcd_detector.getFrameDatabasePtr()->at(id_0);
+  const KeypointsCV& frontend_keypoints =
+      ref1_stereo_frame_->getLeftFrame().keypoints_;
+  EXPECT_GT(lcd_frame.keypoints_.size(), 0);
+  EXPECT_LE(lcd_frame.keypoints_.size(), frontend_keypoints.size());
+  EXPECT_EQ(lcd_frame.descriptors_mat_.rows, lcd_frame.keypoints_.size());
+  for (const cv::KeyPoint& keypoint : lcd_frame.keypoints_) {
+    EXPECT_NE(std::find(frontend_keypoints.begin(),
+                        frontend_keypoints.end(),
+                        keypoint.pt),
+              frontend_keypoints.end());
+  }
+}
+
 TEST_F(LCDFixture, geometricVerificationCheck) {
   /* Test geometric verification using RANSAC Nister 5pt method */
   CHECK(lcd_detector_);
@@ -309,6 +392,41 @@ TEST_F(LCDFixture, geometricVerificationCheck) {
   EXPECT_LT(error.second, tran_tol * 2.5);
 }
 
+TEST_F(LCDFixture, geometricVerificationBoWGuidedMatching) {
+  /* Test geometric verification matching only descriptors in shared nodes */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams params = lcd_detector_->getLCDParams();
+  params.use_bow_guided_matching_ = true;
+  params.pose_recovery_option_ = PoseRecoveryOption::GIVEN_ROT;
+  LoopClosureDetector lcd_detector(params, false);
+  lcd_detector.setIntrinsics(*ref1_stereo_frame_);
+
+  FrameId frm_0 = lcd_detector.processAndAddFrame(*ref1_stereo_frame_);
+  FrameId frm_1 = lcd_detector.processAndAddFrame(*cur1_stereo_frame_);
+  const LCDFrame& lcd_frame = lcd_detector.getFrameDatabasePtr()->at(frm_1);
+  EXPECT_FALSE(lcd_frame.bow_vec_.empty());
+  ASSERT_FALSE(lcd_frame.feature_vec_.empty());
+  size_t nr_indices = 0u;
+  for (const auto& node : lcd_frame.feature_vec_) {
+    nr_indices += node.second.size();
+  }
+  EXPECT_EQ(nr_indices, lcd_frame.descriptors_vec_.size());
+
+  gtsam::Pose3 camRef1_T_camCur1_mono;
+  EXPECT_TRUE(lcd_detector.geometricVerificationCheck(
+      frm_1, frm_0, &camRef1_T_camCur1_mono));
+
+  // Pose recovery reuses the matches of the geometric verification.
+  gtsam::Pose3 bodyRef1_T_bodyCur1;
+  EXPECT_TRUE(lcd_detector.recoverPose(
+      frm_1, frm_0, camRef1_T_camCur1_mono, &bodyRef1_T_bodyCur1));
+
+  std::pair<double, double> error =
+      UtilsOpenCV::ComputeRotationAndTranslationErrors(
+          ref1_to_cur1_pose_, bodyRef1_T_bodyCur1, false);
+  EXPECT_LT(error.first, rot_tol);
+}
+
 TEST_F(LCDFixture, recoverPoseArun) {
   /* Test proper scaled pose recovery between two identical images */
   CHECK(lcd_detector_);
@@ -426,9 +544,10 @@ TEST_F(LCDFixture, detectLoop) {
   //     gtsam::Rot3::identity(), gtsam::Point3(0,0,0)), tol));
 
   /* Test the detectLoop method against two unidentical, similar images */
+  // Frames 1 and 2 are the same image, either one is a valid match.
   lcd_detector_->detectLoop(*cur1_stereo_frame_, &loop_result_3);
   EXPECT_EQ(loop_result_3.isLoop(), true);
-  EXPECT_EQ(loop_result_3.match_id_, 1);
+  EXPECT_TRUE(loop_result_3.match_id_ == 1 || loop_result_3.match_id_ == 2);
   EXPECT_EQ(loop_result_3.query_id_, 3);
 
   error = UtilsOpenCV::ComputeRotationAndTranslationErrors(
@@ -438,6 +557,56 @@ TEST_F(LCDFixture, detectLoop) {
   EXPECT_LT(error.second, tran_tol);
 }
 
+TEST_F(LCDFixture, detectLoopMatchesDescriptorsOnce) {
+  /* Test that pose recovery reuses the matches of geometric verification */
+  CHECK(lcd_detector_);
+  lcd_detector_->getLCDParamsMutable()->pose_recovery_option_ =
+      PoseRecoveryOption::GIVEN_ROT;
+
+  LoopResult loop_result_0, loop_result_1, loop_result_2, loop_result_3;
+  lcd_detector_->detectLoop(*ref2_stereo_frame_, &loop_result_0);
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result_1);
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result_2);
+
+  static const std::string kMatchingTag = "LCD Descriptor Matching Timing [ms]";
+  const size_t nr_matchings_before =
+      utils::Statistics::HasHandle(kMatchingTag)
+          ? utils::Statistics::GetNumSamples(kMatchingTag)
+          : 0u;
+  lcd_detector_->detectLoop(*cur1_stereo_frame_, &loop_result_3);
+  ASSERT_TRUE(loop_result_3.isLoop());
+  ASSERT_TRUE(utils::Statistics::HasHandle(kMatchingTag));
+  EXPECT_EQ(utils::Statistics::GetNumSamples(kMatchingTag),
+            nr_matchings_before + 1u);
+}
+
+TEST_F(LCDFixture, detectLoopParallelVerification) {
+  /* Test the detectLoop method verifying several candidates at once */
+  CHECK(lcd_detector_);
+  lcd_detector_->getLCDParamsMutable()->pose_recovery_option_ =
+      PoseRecoveryOption::GIVEN_ROT;
+  lcd_detector_->getLCDParamsMutable()->nr_candidates_to_verify_ = 3;
+
+  LoopResult loop_result_0, loop_result_1, loop_result_2, loop_result_3;
+  lcd_detector_->detectLoop(*ref2_stereo_frame_, &loop_result_0);
+  EXPECT_FALSE(loop_result_0.isLoop());
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result_1);
+  EXPECT_FALSE(loop_result_1.isLoop());
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result_2);
+
+  // Frames 1 and 2 are the same image, either one is a valid match.
+  lcd_detector_->detectLoop(*cur1_stereo_frame_, &loop_result_3);
+  EXPECT_TRUE(loop_result_3.isLoop());
+  EXPECT_EQ(loop_result_3.query_id_, 3);
+  EXPECT_TRUE(loop_result_3.match_id_ == 1 || loop_result_3.match_id_ == 2);
+
+  std::pair<double, double> error =
+      UtilsOpenCV::ComputeRotationAndTranslationErrors(
+          ref1_to_cur1_pose_, loop_result_3.relative_pose_, true);
+  EXPECT_LT(error.first, rot_tol);
+  EXPECT_LT(error.second, tran_tol);
+}
+
 TEST_F(LCDFixture, addOdometryFactorAndOptimize) {
   /* Test the addition of odometry factors to the PGO */
   CHECK(lcd_detector_);
@@ -479,6 +648,65 @@ TEST_F(LCDFixture, addLoopClosureFactorAndOptimize) {
   EXPECT_EQ(pgo_nfg.size(), 1);
 }
 
+TEST_F(LCDFixture, addOdometryFactorsInBatches) {
+  /* Test that batching the odometry gives the same PGO */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams params = lcd_detector_->getLCDParams();
+  params.pgo_odometry_batch_size_ = 3;
+  LoopClosureDetector lcd_detector_batch(params, false);
+
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Isotropic::Variance(6, 0.1);
+  const std::vector<gtsam::Pose3> poses = {
+      ref1_pose_, cur1_pose_, ref2_pose_, cur2_pose_};
+  for (LoopClosureDetector* lcd : {lcd_detector_.get(), &lcd_detector_batch}) {
+    lcd->initializePGO(VIO::OdometryFactor(1, poses[0], noise));
+    for (size_t i = 0u; i < poses.size(); i++) {
+      lcd->addOdometryFactorAndOptimize(
+          VIO::OdometryFactor(i + 1u, poses[i], noise));
+    }
+  }
+
+  // Pending odometry is part of the PGO seen from outside.
+  gtsam::Values pgo_trajectory = lcd_detector_->getPGOTrajectory();
+  gtsam::Values pgo_trajectory_batch = lcd_detector_batch.getPGOTrajectory();
+  ASSERT_EQ(pgo_trajectory_batch.size(), poses.size());
+  EXPECT_TRUE(pgo_trajectory_batch.equals(pgo_trajectory));
+  EXPECT_EQ(lcd_detector_batch.getPGOnfg().size(),
+            lcd_detector_->getPGOnfg().size());
+  EXPECT_TRUE(lcd_detector_batch.getWPoseMap().equals(
+      lcd_detector_->getWPoseMap()));
+
+  // The dead-reckoned trajectory follows the odometry.
+  PgoTrajectory::ConstPtr trajectory =
+      lcd_detector_batch.getSharedPGOTrajectory();
+  ASSERT_EQ(trajectory->size(), poses.size());
+  for (size_t i = 0u; i < poses.size(); i++) {
+    EXPECT_TRUE(trajectory->at(i).equals(poses[i], tol));
+  }
+
+  // Loop closures update the PGO with the pending odometry first. This one
+  // slightly disagrees with the odometry, to move the trajectory.
+  const gtsam::Pose3 loop_error(gtsam::Rot3(), gtsam::Point3(0.05, 0.0, 0.0));
+  lcd_detector_batch.addLoopClosureFactorAndOptimize(VIO::LoopClosureFactor(
+      0, 3, poses[0].between(poses[3]) * loop_error, noise));
+  EXPECT_EQ(lcd_detector_batch.getPGOTrajectory().size(), poses.size());
+  EXPECT_GE(lcd_detector_batch.getPGOnfg().size(), poses.size());
+
+  // Pending odometry after the loop closure follows the optimized poses,
+  // not the VIO estimates.
+  const gtsam::Pose3 B_lkf_Pose_kf(gtsam::Rot3::Ypr(0.1, 0.0, 0.0),
+                                   gtsam::Point3(1.0, 0.0, 0.0));
+  lcd_detector_batch.addOdometryFactorAndOptimize(VIO::OdometryFactor(
+      poses.size() + 1u, poses.back() * B_lkf_Pose_kf, noise));
+  const gtsam::Values values = lcd_detector_batch.getPGOTrajectory();
+  ASSERT_EQ(values.size(), poses.size() + 1u);
+  EXPECT_TRUE(values.at<gtsam::Pose3>(poses.size())
+                  .equals(values.at<gtsam::Pose3>(poses.size() - 1u) *
+                              B_lkf_Pose_kf,
+                          tol));
+}
+
 TEST_F(LCDFixture, spinOnce) {
   /* Test the full pipeline with one loop closure and full PGO optimization */
   CHECK(lcd_detector_);
@@ -521,4 +749,222 @@ TEST_F(LCDFixture, spinOnce) {
   EXPECT_EQ(output_2->states_.size(), 3);
 }
 
+TEST_F(LCDFixture, spinOnceIncrementalOutput) {
+  /* Test that the full PGO is only output on loop closures */
+  CHECK(lcd_detector_);
+  lcd_detector_->getLCDParamsMutable()->incremental_output_ = true;
+
+  CHECK(ref1_stereo_frame_);
+  LcdOutput::Ptr output_0 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref1_, FrameId(1), *ref1_stereo_frame_, gtsam::Pose3()));
+  CHECK(ref2_stereo_frame_);
+  LcdOutput::Ptr output_1 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref2_, FrameId(2), *ref2_stereo_frame_, gtsam::Pose3()));
+  CHECK(cur1_stereo_frame_);
+  LcdOutput::Ptr output_2 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_cur1_, FrameId(3), *cur1_stereo_frame_, gtsam::Pose3()));
+
+  EXPECT_EQ(output_0->is_loop_closure_, false);
+  EXPECT_EQ(output_0->states_.size(), 0);
+  EXPECT_EQ(output_0->nfg_.size(), 0);
+  ASSERT_TRUE(output_0->trajectory_);
+  EXPECT_EQ(output_0->trajectory_->size(), 1);
+  EXPECT_EQ(output_0->new_factors_.size(), 1);
+
+  EXPECT_EQ(output_1->is_loop_closure_, false);
+  EXPECT_EQ(output_1->states_.size(), 0);
+  EXPECT_EQ(output_1->nfg_.size(), 0);
+  ASSERT_TRUE(output_1->trajectory_);
+  EXPECT_EQ(output_1->trajectory_->size(), 2);
+  EXPECT_EQ(output_1->new_factors_.size(), 1);
+  // Previous outputs are not modified.
+  EXPECT_EQ(output_0->trajectory_->size(), 1);
+
+  EXPECT_EQ(output_2->is_loop_closure_, true);
+  EXPECT_EQ(output_2->states_.size(), 3);
+  ASSERT_TRUE(output_2->trajectory_);
+  EXPECT_EQ(output_2->trajectory_->size(), 3);
+  EXPECT_EQ(output_2->new_factors_.size(), 2);
+  for (size_t i = 0u; i < output_2->trajectory_->size(); i++) {
+    EXPECT_TRUE(output_2->trajectory_->at(i).equals(
+        output_2->states_.at<gtsam::Pose3>(i)));
+  }
+}
+
+TEST_F(LCDFixture, keyframeGating) {
+  /* Test that keyframes that barely moved only add odometry to the PGO */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams* params = lcd_detector_->getLCDParamsMutable();
+  params->gating_min_translation_ = 0.5;
+  params->gating_min_rotation_ = 0.1;
+  params->gating_max_queue_size_ = 2;
+
+  const gtsam::Pose3 W_Pose_B1;
+  const LcdInput input_1(
+      timestamp_ref1_, FrameId(1), *ref1_stereo_frame_, W_Pose_B1);
+  EXPECT_TRUE(lcd_detector_->shouldDetectLoop(input_1, 0u));
+  lcd_detector_->spinOnce(input_1);
+
+  // Too close to the first keyframe.
+  const gtsam::Pose3 W_Pose_B2(gtsam::Rot3::Yaw(0.05),
+                               gtsam::Point3(0.1, 0.0, 0.0));
+  const LcdInput input_2(
+      timestamp_ref2_, FrameId(2), *ref2_stereo_frame_, W_Pose_B2);
+  EXPECT_FALSE(lcd_detector_->shouldDetectLoop(input_2, 0u));
+  LcdOutput::Ptr output_2 = lcd_detector_->spinOnceWithoutDetection(input_2);
+  EXPECT_EQ(output_2->is_loop_closure_, false);
+  EXPECT_EQ(output_2->states_.size(), 2);
+
+  // The frame is kept without features, with aligned ids and timestamps.
+  const std::vector<LCDFrame>* db_frames = lcd_detector_->getFrameDatabasePtr();
+  ASSERT_EQ(db_frames->size(), 2);
+  EXPECT_FALSE(db_frames->at(1).hasFeatures());
+  EXPECT_EQ(db_frames->at(1).id_, 1u);
+  EXPECT_EQ(db_frames->at(1).timestamp_, timestamp_ref2_);
+
+  // Distances are measured from the last keyframe that was processed.
+  const LcdInput input_3(timestamp_cur1_,
+                         FrameId(3),
+                         *cur1_stereo_frame_,
+                         gtsam::Pose3(gtsam::Rot3::Yaw(0.2), gtsam::Point3()));
+  EXPECT_TRUE(lcd_detector_->shouldDetectLoop(input_3, 0u));
+  // Unless keyframes pile up.
+  EXPECT_FALSE(lcd_detector_->shouldDetectLoop(input_3, 3u));
+  LcdOutput::Ptr output_3 = lcd_detector_->spinOnce(input_3);
+  EXPECT_EQ(output_3->is_loop_closure_, true);
+  EXPECT_EQ(output_3->id_match_, 0);
+  EXPECT_EQ(output_3->states_.size(), 3);
+}
+
+TEST_F(LCDFixture, saveAndLoadSnapshot) {
+  /* Test that a new session relocalizes against a saved one */
+  CHECK(lcd_detector_);
+  lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref1_, FrameId(1), *ref1_stereo_frame_, gtsam::Pose3()));
+  lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref2_, FrameId(2), *ref2_stereo_frame_, gtsam::Pose3()));
+  TemporaryDirectory output_dir("testLCDSnapshot");
+  const std::string snapshot_path =
+      output_dir.getPath() + "/testLCDSnapshot.bin";
+  ASSERT_TRUE(lcd_detector_->saveSnapshot(snapshot_path));
+
+  LoopClosureDetector lcd_detector(lcd_detector_->getLCDParams(), false);
+  ASSERT_TRUE(lcd_detector.loadSnapshot(snapshot_path));
+
+  const std::vector<LCDFrame>& saved_frames =
+      *lcd_detector_->getFrameDatabasePtr();
+  const std::vector<LCDFrame>& loaded_frames =
+      *lcd_detector.getFrameDatabasePtr();
+  ASSERT_EQ(loaded_frames.size(), saved_frames.size());
+  for (size_t i = 0u; i < saved_frames.size(); i++) {
+    EXPECT_EQ(loaded_frames[i].timestamp_, saved_frames[i].timestamp_);
+    EXPECT_EQ(loaded_frames[i].id_kf_, saved_frames[i].id_kf_);
+    EXPECT_EQ(loaded_frames[i].keypoints_.size(),
+              saved_frames[i].keypoints_.size());
+    EXPECT_EQ(loaded_frames[i].bow_vec_, saved_frames[i].bow_vec_);
+    EXPECT_EQ(cv::norm(loaded_frames[i].descriptors_mat_,
+                       saved_frames[i].descriptors_mat_,
+                       cv::NORM_HAMMING),
+              0);
+  }
+  EXPECT_EQ(lcd_detector.getBoWDatabase()->size(),
+            lcd_detector_->getBoWDatabase()->size());
+  EXPECT_EQ(lcd_detector.getPGOTrajectory().size(), 2);
+  EXPECT_EQ(lcd_detector.getPGOnfg().size(), lcd_detector_->getPGOnfg().size());
+
+  // The first keyframe of the new session closes a loop with the old one.
+  lcd_detector.setIntrinsics(*cur1_stereo_frame_);
+  LcdOutput::Ptr output = lcd_detector.spinOnce(LcdInput(
+      timestamp_cur1_, FrameId(1), *cur1_stereo_frame_, gtsam::Pose3()));
+  EXPECT_TRUE(output->is_loop_closure_);
+  EXPECT_EQ(output->id_recent_, 2);
+  EXPECT_EQ(output->id_match_, 0);
+  EXPECT_EQ(lcd_detector.getPGOTrajectory().size(), 3);
+
+  // Saving over the loaded snapshot, which still holds the descriptors of the
+  // restored frames, as when the same site is mapped at every run.
+  ASSERT_TRUE(lcd_detector.saveSnapshot(snapshot_path));
+  LoopClosureDetector lcd_detector_reloaded(lcd_detector_->getLCDParams(),
+                                            false);
+  ASSERT_TRUE(lcd_detector_reloaded.loadSnapshot(snapshot_path));
+  ASSERT_EQ(lcd_detector_reloaded.getFrameDatabasePtr()->size(), 3u);
+  EXPECT_EQ(cv::norm(lcd_detector_reloaded.getFrameDatabasePtr()
+                         ->at(0)
+                         .descriptors_mat_,
+                     saved_frames[0].descriptors_mat_,
+                     cv::NORM_HAMMING),
+            0);
+
+  // Snapshots of another vocabulary are rejected.
+  OrbVocabulary other_vocabulary(2, 1);
+  other_vocabulary.create(std::vector<std::vector<cv::Mat>>(
+      1u, loaded_frames[0].descriptors_vec_));
+  LoopClosureDetector lcd_detector_other(lcd_detector_->getLCDParams(), false);
+  lcd_detector_other.setVocabulary(other_vocabulary);
+  EXPECT_FALSE(lcd_detector_other.loadSnapshot(snapshot_path));
+}
+
+TEST(testPgoTrajectory, appendIsCopyOnWrite) {
+  /* Test that appending to a trajectory does not modify it */
+  PgoTrajectory::ConstPtr trajectory = std::make_shared<PgoTrajectory>();
+  std::vector<PgoTrajectory::ConstPtr> trajectories;
+  const size_t nr_poses = 2u * PgoTrajectory::kChunkSize + 1u;
+  for (size_t i = 0u; i < nr_poses; i++) {
+    trajectories.push_back(trajectory);
+    trajectory =
+        trajectory->append(gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(i, 0, 0)));
+  }
+
+  ASSERT_EQ(trajectory->size(), nr_poses);
+  for (size_t i = 0u; i < nr_poses; i++) {
+    EXPECT_EQ(trajectories[i]->size(), i);
+    EXPECT_DOUBLE_EQ(trajectory->at(i).translation().x(), i);
+  }
+  EXPECT_DOUBLE_EQ(trajectory->back().translation().x(), nr_poses - 1u);
+
+  gtsam::Values values;
+  for (size_t i = 0u; i < nr_poses; i++) {
+    values.insert(gtsam::Symbol(i), trajectory->at(i));
+  }
+  PgoTrajectory trajectory_from_values(values);
+  ASSERT_EQ(trajectory_from_values.size(), nr_poses);
+  for (size_t i = 0u; i < nr_poses; i++) {
+    EXPECT_TRUE(trajectory_from_values.at(i).equals(trajectory->at(i)));
+  }
+}
+
+TEST_F(LCDFixture, spinOnceBoundedMemory) {
+  /* Test that old frames that are close to each other release their features,
+   * while spatially sparse ones are kept as loop closure candidates */
+  CHECK(lcd_detector_);
+  LoopClosureDetectorParams* params = lcd_detector_->getLCDParamsMutable();
+  params->bounded_memory_ = true;
+  params->recent_frames_with_features_ = 1;
+  params->min_dist_between_frames_with_features_ = 1.0;
+
+  CHECK(ref1_stereo_frame_);
+  lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref1_, FrameId(1), *ref1_stereo_frame_, gtsam::Pose3()));
+  CHECK(ref2_stereo_frame_);
+  lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref2_, FrameId(2), *ref2_stereo_frame_, gtsam::Pose3()));
+  CHECK(cur1_stereo_frame_);
+  LcdOutput::Ptr output = lcd_detector_->spinOnce(LcdInput(
+      timestamp_cur1_, FrameId(3), *cur1_stereo_frame_, gtsam::Pose3()));
+
+  // The loop is detected before the features of old frames are released.
+  EXPECT_EQ(output->is_loop_closure_, true);
+  EXPECT_EQ(output->id_match_, 0);
+
+  const std::vector<LCDFrame>* db_frames = lcd_detector_->getFrameDatabasePtr();
+  ASSERT_EQ(db_frames->size(), 3);
+  EXPECT_TRUE(db_frames->at(0).hasFeatures());
+  EXPECT_FALSE(db_frames->at(1).hasFeatures());
+  EXPECT_TRUE(db_frames->at(1).keypoints_.empty());
+  EXPECT_EQ(db_frames->at(1).timestamp_, timestamp_ref2_);
+  EXPECT_TRUE(db_frames->at(2).hasFeatures());
+  EXPECT_LT(db_frames->at(1).getMemoryFootprint(),
+            db_frames->at(2).getMemoryFootprint());
+}
+
 }  // namespace VIO
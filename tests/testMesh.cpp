@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMesh.cpp
+ * @brief  test Mesh implementation
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/mesh/Mesh.h"
+
+namespace VIO {
+
+Mesh3D::Polygon makeTriangle(const LandmarkId& lmk_0,
+                             const LandmarkId& lmk_1,
+                             const LandmarkId& lmk_2) {
+  Mesh3D::Polygon polygon;
+  for (const LandmarkId& lmk_id : {lmk_0, lmk_1, lmk_2}) {
+    polygon.push_back(Mesh3D::VertexType(
+        lmk_id, Vertex3D(lmk_id, lmk_id * lmk_id, 1.0f)));
+  }
+  return polygon;
+}
+
+TEST(testMesh, addPolygonToMesh) {
+  Mesh3D mesh;
+  mesh.addPolygonToMesh(makeTriangle(1, 2, 3));
+  mesh.addPolygonToMesh(makeTriangle(2, 3, 4));
+  EXPECT_EQ(mesh.getNumberOfPolygons(), 2u);
+  EXPECT_EQ(mesh.getNumberOfUniqueVertices(), 4u);
+
+  Mesh3D::Polygon polygon;
+  ASSERT_TRUE(mesh.getPolygon(1, &polygon));
+  EXPECT_EQ(polygon[0].getLmkId(), 2);
+  EXPECT_EQ(polygon[2].getLmkId(), 4);
+  EXPECT_EQ(polygon[2].getVertexPosition(), Vertex3D(4, 16, 1));
+  EXPECT_FALSE(mesh.getPolygon(2, &polygon));
+
+  // Same format as before: (3, id, id, id) per polygon.
+  cv::Mat polygons_mesh, vertices_mesh;
+  mesh.convertPolygonsMeshToMat(&polygons_mesh);
+  mesh.convertVerticesMeshToMat(&vertices_mesh);
+  ASSERT_EQ(polygons_mesh.rows, 8);
+  EXPECT_EQ(polygons_mesh.at<int32_t>(4), 3);
+  EXPECT_EQ(vertices_mesh.rows, 4);
+  Mesh3D::VertexId vertex_id;
+  ASSERT_TRUE(mesh.getVertex(4, nullptr, &vertex_id));
+  EXPECT_EQ(polygons_mesh.at<int32_t>(7), vertex_id);
+  EXPECT_EQ(vertices_mesh.at<Vertex3D>(vertex_id), Vertex3D(4, 16, 1));
+}
+
+TEST(testMesh, vertexNeighbors) {
+  Mesh3D mesh;
+  mesh.addPolygonToMesh(makeTriangle(1, 2, 3));
+  mesh.addPolygonToMesh(makeTriangle(2, 3, 4));
+  mesh.addPolygonToMesh(makeTriangle(4, 5, 6));
+
+  Mesh3D::VertexId vertex_id;
+  ASSERT_TRUE(mesh.getVertex(4, nullptr, &vertex_id));
+  EXPECT_EQ(mesh.getVertexPolygons(vertex_id).size(), 2u);
+  std::vector<Mesh3D::VertexId> neighbors;
+  mesh.getVertexNeighbors(vertex_id, &neighbors);
+  std::vector<LandmarkId> neighbor_lmk_ids;
+  for (const Mesh3D::VertexId& neighbor : neighbors) {
+    neighbor_lmk_ids.push_back(mesh.getVertexLmkId(neighbor));
+  }
+  std::sort(neighbor_lmk_ids.begin(), neighbor_lmk_ids.end());
+  EXPECT_EQ(neighbor_lmk_ids, std::vector<LandmarkId>({2, 3, 5, 6}));
+}
+
+TEST(testMesh, removePolygonAndVertex) {
+  Mesh3D mesh;
+  mesh.addPolygonToMesh(makeTriangle(1, 2, 3));
+  mesh.addPolygonToMesh(makeTriangle(2, 3, 4));
+  mesh.addPolygonToMesh(makeTriangle(4, 5, 6));
+
+  // The last polygon takes the id of the removed one.
+  mesh.removePolygon(0);
+  ASSERT_EQ(mesh.getNumberOfPolygons(), 2u);
+  Mesh3D::Polygon polygon;
+  ASSERT_TRUE(mesh.getPolygon(0, &polygon));
+  EXPECT_EQ(polygon[0].getLmkId(), 4);
+  Mesh3D::VertexId vertex_id_5;
+  ASSERT_TRUE(mesh.getVertex(5, nullptr, &vertex_id_5));
+  EXPECT_EQ(mesh.getVertexPolygons(vertex_id_5),
+            std::vector<Mesh3D::PolygonId>({0u}));
+
+  // Removing a vertex removes its polygons.
+  Mesh3D::VertexId vertex_id_4;
+  ASSERT_TRUE(mesh.getVertex(4, nullptr, &vertex_id_4));
+  mesh.removeVertex(vertex_id_4);
+  EXPECT_EQ(mesh.getNumberOfPolygons(), 0u);
+  EXPECT_FALSE(mesh.isVertexAlive(vertex_id_4));
+  EXPECT_FALSE(mesh.getVertex(4, nullptr, &vertex_id_4));
+  EXPECT_EQ(mesh.getNumberOfLiveVertices(), 5u);
+  EXPECT_TRUE(mesh.getVertexPolygons(vertex_id_5).empty());
+
+  // A new vertex reuses the removed id.
+  mesh.addPolygonToMesh(makeTriangle(7, 5, 6));
+  Mesh3D::VertexId vertex_id_7;
+  ASSERT_TRUE(mesh.getVertex(7, nullptr, &vertex_id_7));
+  EXPECT_EQ(vertex_id_7, vertex_id_4);
+  EXPECT_EQ(mesh.getNumberOfUniqueVertices(), 6u);
+  EXPECT_EQ(mesh.getNumberOfLiveVertices(), 6u);
+}
+
+}  // namespace VIO
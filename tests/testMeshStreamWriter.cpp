@@ -0,0 +1,243 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMeshStreamWriter.cpp
+ * @brief  Test the binary mesh logging.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/logging/MeshStreamWriter.h"
+
+#include "TemporaryDirectory.h"
+
+namespace VIO {
+
+// Faces starting at their smallest vertex index, sorted.
+std::vector<std::array<uint32_t, 3>> getSortedFaces(
+    const std::vector<uint32_t>& faces) {
+  std::vector<std::array<uint32_t, 3>> sorted_faces;
+  for (size_t i = 0u; i < faces.size(); i += 3u) {
+    const size_t first =
+        std::min_element(&faces[i], &faces[i] + 3) - &faces[i];
+    sorted_faces.push_back({{faces[i + first],
+                             faces[i + (first + 1u) % 3u],
+                             faces[i + (first + 2u) % 3u]}});
+  }
+  std::sort(sorted_faces.begin(), sorted_faces.end());
+  return sorted_faces;
+}
+
+void expectEqualMeshes(const std::vector<cv::Point3f>& vertices,
+                       const std::vector<cv::Vec3b>& colors,
+                       const std::vector<int32_t>& polygons,
+                       const MeshStreamBuffer& mesh) {
+  ASSERT_EQ(mesh.getNumberOfVertices(), vertices.size());
+  for (size_t i = 0u; i < vertices.size(); i++) {
+    EXPECT_EQ(mesh.vertices_[3u * i], vertices[i].x);
+    EXPECT_EQ(mesh.vertices_[3u * i + 1u], vertices[i].y);
+    EXPECT_EQ(mesh.vertices_[3u * i + 2u], vertices[i].z);
+    for (size_t j = 0u; j < 3u; j++) {
+      EXPECT_EQ(mesh.colors_[3u * i + j], colors[i][j]);
+    }
+  }
+  std::vector<uint32_t> faces;
+  for (size_t i = 0u; i < polygons.size(); i += 4u) {
+    faces.insert(faces.end(), &polygons[i + 1u], &polygons[i + 4u]);
+  }
+  EXPECT_EQ(getSortedFaces(mesh.faces_), getSortedFaces(faces));
+}
+
+TEST(testMeshStreamWriter, binaryPly) {
+  TemporaryDirectory output_dir("testMeshStreamWriter");
+  const std::string filename = output_dir.getPath() + "/mesh.ply";
+
+  std::vector<cv::Point3f> vertices = {cv::Point3f(0.0f, 0.0f, 0.0f),
+                                       cv::Point3f(1.0f, 0.0f, 0.5f),
+                                       cv::Point3f(0.0f, 1.0f, -0.5f),
+                                       cv::Point3f(1.0f, 1.0f, 2.0f)};
+  std::vector<cv::Vec3b> colors = {cv::Vec3b(255, 0, 0),
+                                   cv::Vec3b(0, 255, 0),
+                                   cv::Vec3b(0, 0, 255),
+                                   cv::Vec3b(10, 20, 30)};
+  std::vector<int32_t> polygons = {3, 0, 1, 2, 3, 1, 3, 2};
+  {
+    MeshStreamWriter writer(filename, MeshStreamFormat::kBinaryPly);
+    writer.logMesh(cv::Mat(vertices, true),
+                   cv::Mat(colors, true),
+                   cv::Mat(polygons, true),
+                   1000);
+    writer.flush();
+    EXPECT_EQ(writer.getNumberOfWrittenMeshes(), 1u);
+  }
+
+  MeshStreamBuffer mesh;
+  ASSERT_TRUE(MeshStreamWriter::readBinaryPly(filename, &mesh));
+  EXPECT_EQ(mesh.timestamp_, 1000);
+  expectEqualMeshes(vertices, colors, polygons, mesh);
+  // The mesh is written aside and renamed.
+  EXPECT_FALSE(std::ifstream(filename + ".tmp").good());
+}
+
+TEST(testMeshStreamWriter, deltaStream) {
+  TemporaryDirectory output_dir("testMeshStreamWriter");
+  const std::string filename = output_dir.getPath() + "/mesh.delta";
+
+  std::vector<cv::Point3f> vertices = {cv::Point3f(0.0f, 0.0f, 0.0f),
+                                       cv::Point3f(1.0f, 0.0f, 0.0f),
+                                       cv::Point3f(0.0f, 1.0f, 0.0f),
+                                       cv::Point3f(1.0f, 1.0f, 0.0f)};
+  std::vector<cv::Vec3b> colors(4u, cv::Vec3b(255, 255, 255));
+  std::vector<int32_t> polygons = {3, 0, 1, 2, 3, 1, 3, 2};
+
+  // One vertex moved, one added, and one face replaced by another; the kept
+  // face is given starting at another vertex.
+  std::vector<cv::Point3f> new_vertices = vertices;
+  new_vertices[3] = cv::Point3f(1.0f, 1.0f, 0.5f);
+  new_vertices.push_back(cv::Point3f(2.0f, 0.0f, 0.0f));
+  std::vector<cv::Vec3b> new_colors(5u, cv::Vec3b(255, 255, 255));
+  std::vector<int32_t> new_polygons = {3, 1, 2, 0, 3, 1, 4, 3};
+  {
+    MeshStreamWriter writer(filename, MeshStreamFormat::kDelta);
+    // Empty colors are logged as white.
+    writer.logMesh(
+        cv::Mat(vertices, true), cv::Mat(), cv::Mat(polygons, true), 1000);
+    writer.flush();
+    writer.logMesh(cv::Mat(new_vertices, true),
+                   cv::Mat(new_colors, true),
+                   cv::Mat(new_polygons, true),
+                   2000);
+    writer.flush();
+    EXPECT_EQ(writer.getNumberOfWrittenMeshes(), 2u);
+    EXPECT_EQ(writer.getNumberOfDroppedMeshes(), 0u);
+  }
+
+  std::vector<MeshStreamBuffer> meshes;
+  ASSERT_TRUE(MeshStreamWriter::readDeltaStream(filename, &meshes));
+  ASSERT_EQ(meshes.size(), 2u);
+  EXPECT_EQ(meshes[0].timestamp_, 1000);
+  expectEqualMeshes(vertices, colors, polygons, meshes[0]);
+  EXPECT_EQ(meshes[1].timestamp_, 2000);
+  expectEqualMeshes(new_vertices, new_colors, new_polygons, meshes[1]);
+}
+
+TEST(testMeshStreamWriter, duplicateFaces) {
+  TemporaryDirectory output_dir("testMeshStreamWriter");
+  const std::string ply_filename = output_dir.getPath() + "/mesh.ply";
+  const std::string delta_filename = output_dir.getPath() + "/mesh.delta";
+
+  std::vector<cv::Point3f> vertices = {cv::Point3f(0.0f, 0.0f, 0.0f),
+                                       cv::Point3f(1.0f, 0.0f, 0.0f),
+                                       cv::Point3f(0.0f, 1.0f, 0.0f),
+                                       cv::Point3f(1.0f, 1.0f, 0.0f)};
+  std::vector<cv::Vec3b> colors(4u, cv::Vec3b(255, 255, 255));
+  // The first face is repeated, once starting at another vertex. The face
+  // with the opposite orientation is a different face.
+  std::vector<int32_t> polygons = {
+      3, 0, 1, 2, 3, 1, 3, 2, 3, 0, 1, 2, 3, 2, 0, 1, 3, 0, 2, 1};
+  const std::vector<int32_t> unique_polygons = {
+      3, 0, 1, 2, 3, 1, 3, 2, 3, 0, 2, 1};
+  {
+    MeshStreamWriter ply_writer(ply_filename, MeshStreamFormat::kBinaryPly);
+    MeshStreamWriter delta_writer(delta_filename, MeshStreamFormat::kDelta);
+    for (MeshStreamWriter* writer : {&ply_writer, &delta_writer}) {
+      writer->logMesh(cv::Mat(vertices, true),
+                      cv::Mat(colors, true),
+                      cv::Mat(polygons, true),
+                      1000);
+      writer->flush();
+    }
+  }
+
+  // Both formats hold the same faces.
+  MeshStreamBuffer mesh;
+  ASSERT_TRUE(MeshStreamWriter::readBinaryPly(ply_filename, &mesh));
+  expectEqualMeshes(vertices, colors, unique_polygons, mesh);
+  std::vector<MeshStreamBuffer> meshes;
+  ASSERT_TRUE(MeshStreamWriter::readDeltaStream(delta_filename, &meshes));
+  ASSERT_EQ(meshes.size(), 1u);
+  expectEqualMeshes(vertices, colors, unique_polygons, meshes[0]);
+}
+
+TEST(testMeshStreamWriter, keepLatestMesh) {
+  TemporaryDirectory output_dir("testMeshStreamWriter");
+  const std::string filename = output_dir.getPath() + "/mesh.delta";
+
+  std::vector<cv::Point3f> vertices(3u);
+  std::vector<cv::Vec3b> colors(3u, cv::Vec3b(0, 0, 0));
+  std::vector<int32_t> polygons = {3, 0, 1, 2};
+  static constexpr size_t kNrMeshes = 100u;
+  {
+    MeshStreamWriter writer(filename, MeshStreamFormat::kDelta);
+    for (size_t i = 0u; i < kNrMeshes; i++) {
+      vertices[0].x = static_cast<float>(i);
+      writer.logMesh(cv::Mat(vertices, true),
+                     cv::Mat(colors, true),
+                     cv::Mat(polygons, true),
+                     static_cast<Timestamp>(i));
+    }
+    writer.flush();
+    // The logger never waits for the disk: meshes are either written or
+    // replaced by newer ones.
+    EXPECT_EQ(writer.getNumberOfWrittenMeshes() +
+                  writer.getNumberOfDroppedMeshes(),
+              kNrMeshes);
+  }
+
+  std::vector<MeshStreamBuffer> meshes;
+  ASSERT_TRUE(MeshStreamWriter::readDeltaStream(filename, &meshes));
+  ASSERT_FALSE(meshes.empty());
+  EXPECT_EQ(meshes.back().timestamp_, static_cast<Timestamp>(kNrMeshes - 1u));
+  expectEqualMeshes(vertices, colors, polygons, meshes.back());
+}
+
+TEST(testMeshStreamWriter, binaryPlyPerFile) {
+  TemporaryDirectory output_dir("testMeshStreamWriter");
+  const std::string filename_a = output_dir.getPath() + "/chunk_a.ply";
+  const std::string filename_b = output_dir.getPath() + "/chunk_b.ply";
+
+  MeshStreamBuffer mesh;
+  mesh.vertices_ = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+  mesh.colors_.resize(mesh.vertices_.size(), 255u);
+  mesh.faces_ = {0u, 1u, 2u, 1u, 2u, 0u};
+  MeshStreamBuffer moved_mesh = mesh;
+  moved_mesh.vertices_[0] = -1.0f;
+  {
+    // No file for logMesh: only meshes with their own file are written.
+    MeshStreamWriter writer("", MeshStreamFormat::kBinaryPly);
+    writer.logBinaryPly(filename_a, mesh);
+    writer.logBinaryPly(filename_b, mesh);
+    writer.logBinaryPly(filename_a, moved_mesh);
+    writer.flush();
+    // Only the pending mesh of the same file may have been replaced.
+    EXPECT_EQ(writer.getNumberOfWrittenMeshes() +
+                  writer.getNumberOfDroppedMeshes(),
+              3u);
+    EXPECT_LE(writer.getNumberOfDroppedMeshes(), 1u);
+  }
+
+  MeshStreamBuffer mesh_a, mesh_b;
+  ASSERT_TRUE(MeshStreamWriter::readBinaryPly(filename_a, &mesh_a));
+  ASSERT_TRUE(MeshStreamWriter::readBinaryPly(filename_b, &mesh_b));
+  EXPECT_EQ(mesh_a.vertices_, moved_mesh.vertices_);
+  EXPECT_EQ(mesh_b.vertices_, mesh.vertices_);
+  // Duplicated faces are removed, as for logMesh.
+  EXPECT_EQ(mesh_a.getNumberOfFaces(), 1u);
+  EXPECT_EQ(mesh_b.getNumberOfFaces(), 1u);
+}
+
+}  // namespace VIO
@@ -13,16 +13,23 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <random>
+#include <set>
 
 #include <gtest/gtest.h>
 
+#include <opencv2/core/utility.hpp>
+
 #include "kimera-vio/mesh/Mesher.h"
 
 DECLARE_string(test_data_path);
+DECLARE_bool(trim_mesh_in_place);
 
 namespace VIO {
 
@@ -79,6 +86,73 @@ class MesherFixture : public ::testing::Test {
   Mesher::UniquePtr mesher_;
 };
 
+// Keypoints of a keyframe, all of them stereo (VALID), with their landmarks.
+struct SyntheticKeyframe {
+  PointsWithIdMap points_with_id;
+  KeypointsCV keypoints;
+  std::vector<KeypointStatus> keypoints_status;
+  std::vector<Vector3> keypoints_3d;
+  LandmarkIds landmarks;
+};
+
+// Landmarks on a plane 4m in front of the camera, seen at the jittered nodes
+// of a triangular lattice of keypoints, so that the mesh faces are close to
+// equilateral and pass the mesh filters. Spacing is the side of the lattice
+// triangles, in pixels.
+SyntheticKeyframe createLatticeKeyframe(const int& rows,
+                                        const int& cols,
+                                        std::mt19937* rng,
+                                        const float& spacing = 60.0f) {
+  CHECK_NOTNULL(rng);
+  std::uniform_real_distribution<float> jitter(-spacing / 20.0f,
+                                               spacing / 20.0f);
+  const float row_spacing = spacing * std::sqrt(3.0f) / 2.0f;
+  SyntheticKeyframe keyframe;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      const LandmarkId lmk_id = r * cols + c;
+      const KeypointCV keypoint(60.0f + spacing * c + spacing / 2.0f * (r % 2) +
+                                    jitter(*rng),
+                                60.0f + row_spacing * r + jitter(*rng));
+      const Vector3 point((keypoint.x - 376.0) * 0.005,
+                          (keypoint.y - 240.0) * 0.005,
+                          4.0);
+      keyframe.points_with_id[lmk_id] = gtsam::Point3(point);
+      keyframe.keypoints.push_back(keypoint);
+      keyframe.keypoints_status.push_back(KeypointStatus::VALID);
+      keyframe.keypoints_3d.push_back(point);
+      keyframe.landmarks.push_back(lmk_id);
+    }
+  }
+  return keyframe;
+}
+
+void updateMesh3D(const SyntheticKeyframe& keyframe, Mesher* mesher) {
+  CHECK_NOTNULL(mesher)->updateMesh3D(keyframe.points_with_id,
+                                      keyframe.keypoints,
+                                      keyframe.keypoints_status,
+                                      keyframe.keypoints_3d,
+                                      keyframe.landmarks,
+                                      gtsam::Pose3());
+}
+
+// Polygons as sorted landmark ids, to compare meshes regardless of the order
+// of their polygons and vertices.
+std::set<std::array<LandmarkId, 3>> getSortedPolygons(const Mesh3D& mesh) {
+  CHECK_EQ(mesh.getMeshPolygonDimension(), 3u);
+  std::set<std::array<LandmarkId, 3>> polygons;
+  Mesh3D::Polygon polygon;
+  for (size_t i = 0u; i < mesh.getNumberOfPolygons(); i++) {
+    CHECK(mesh.getPolygon(i, &polygon));
+    std::array<LandmarkId, 3> lmk_ids = {polygon[0].getLmkId(),
+                                         polygon[1].getLmkId(),
+                                         polygon[2].getLmkId()};
+    std::sort(lmk_ids.begin(), lmk_ids.end());
+    polygons.insert(lmk_ids);
+  }
+  return polygons;
+}
+
 /* ************************************************************************* *
 TEST_F(MesherFixture, getRatioBetweenLargestAnSmallestSide) {
   mesher_.map_points_3d_.push_back(cv::Point3f(0.5377, 0.3188, 3.5784));   //
@@ -195,4 +269,174 @@ TEST_F(MesherFixture, createMesh2dNoKeypoints) {
   ASSERT_EQ(triangulation2D.size(), 0);
 }
 
+/* ************************************************************************* */
+TEST_F(MesherFixture, trimMeshInPlaceSameAsRebuild) {
+  const bool trim_mesh_in_place = FLAGS_trim_mesh_in_place;
+  MesherParams mesher_params(gtsam::Pose3(), cv::Size(752, 480));
+  Mesher trimmed_mesher(mesher_params);
+  Mesher rebuilt_mesher(mesher_params);
+
+  std::mt19937 rng(0);
+  static constexpr int kRows = 8;
+  static constexpr int kCols = 10;
+  const SyntheticKeyframe lattice = createLatticeKeyframe(kRows, kCols, &rng);
+  for (int i = 0; i < 3; i++) {
+    // At every keyframe, one more column of landmarks leaves the time
+    // horizon, the next one is not seen anymore (but its polygons stay in the
+    // mesh), a landmark moves out of the plane (its polygons are filtered
+    // out), and the optimization moves all the others.
+    SyntheticKeyframe keyframe;
+    for (size_t k = 0u; k < lattice.landmarks.size(); k++) {
+      const LandmarkId& lmk_id = lattice.landmarks[k];
+      const int col = lmk_id % kCols;
+      if (col < i) continue;
+      gtsam::Point3 point = lattice.points_with_id.at(lmk_id) +
+                            gtsam::Point3(0.01 * i, 0.0, 0.0);
+      if (i > 0 && lmk_id == 3 * kCols + 4 + i) {
+        point = point + gtsam::Point3(0.0, 0.0, -1.0);
+      }
+      keyframe.points_with_id[lmk_id] = point;
+      if (col < 2 * i) continue;
+      keyframe.keypoints.push_back(lattice.keypoints[k]);
+      keyframe.keypoints_status.push_back(KeypointStatus::VALID);
+      keyframe.keypoints_3d.push_back(lattice.keypoints_3d[k]);
+      keyframe.landmarks.push_back(lmk_id);
+    }
+
+    FLAGS_trim_mesh_in_place = true;
+    updateMesh3D(keyframe, &trimmed_mesher);
+    FLAGS_trim_mesh_in_place = false;
+    updateMesh3D(keyframe, &rebuilt_mesher);
+
+    const Mesh3D& trimmed_mesh = trimmed_mesher.get3DMesh();
+    const Mesh3D& rebuilt_mesh = rebuilt_mesher.get3DMesh();
+    EXPECT_GT(trimmed_mesh.getNumberOfPolygons(), 0u);
+    EXPECT_EQ(trimmed_mesh.getNumberOfPolygons(),
+              rebuilt_mesh.getNumberOfPolygons());
+    EXPECT_EQ(getSortedPolygons(trimmed_mesh),
+              getSortedPolygons(rebuilt_mesh));
+    Mesh3D::Polygon polygon;
+    for (size_t j = 0u; j < rebuilt_mesh.getNumberOfPolygons(); j++) {
+      ASSERT_TRUE(rebuilt_mesh.getPolygon(j, &polygon));
+      for (const Mesh3D::VertexType& vertex : polygon) {
+        Mesh3D::VertexType trimmed_vertex;
+        ASSERT_TRUE(trimmed_mesh.getVertex(vertex.getLmkId(), &trimmed_vertex));
+        EXPECT_EQ(vertex.getVertexPosition(),
+                  trimmed_vertex.getVertexPosition());
+      }
+    }
+  }
+  FLAGS_trim_mesh_in_place = trim_mesh_in_place;
+}
+
+// Mesh of a floor (z = 1m) seen at the top left corner of the lattice, and a
+// wall (y = 2m) seen everywhere else, with enough polygons to be split in
+// several blocks when looping over the mesh in parallel. Most blocks have no
+// polygon on the floor, hence no values for the z histogram.
+class MesherParallelFixture : public ::testing::Test {
+ protected:
+  static constexpr int kNrThreads = 4;
+  static constexpr int kRows = 24;
+  static constexpr int kCols = 32;
+
+  MesherParallelFixture()
+      : nr_threads_(cv::getNumThreads()),
+        mesher_(MesherParams(gtsam::Pose3(), cv::Size(752, 480))) {
+    std::mt19937 rng(0);
+    keyframe_ = createLatticeKeyframe(kRows, kCols, &rng, 20.0f);
+    for (size_t k = 0u; k < keyframe_.landmarks.size(); k++) {
+      const LandmarkId& lmk_id = keyframe_.landmarks[k];
+      const Vector3& point = keyframe_.keypoints_3d[k];
+      const bool is_floor = lmk_id / kCols < 6 && lmk_id % kCols < 8;
+      const Vector3 new_point = is_floor
+                                    ? Vector3(point.x(), point.y(), 1.0)
+                                    : Vector3(point.x(), 2.0, 1.0 + point.y());
+      keyframe_.keypoints_3d[k] = new_point;
+      keyframe_.points_with_id[lmk_id] = gtsam::Point3(new_point);
+    }
+    updateMesh3D(keyframe_, &mesher_);
+  }
+
+  void SetUp() override {
+    // More than 256 polygons per thread, so that each thread has a block.
+    ASSERT_GT(mesher_.get3DMesh().getNumberOfPolygons(), 256u * kNrThreads);
+  }
+
+  void TearDown() override { cv::setNumThreads(nr_threads_); }
+
+ protected:
+  const int nr_threads_;
+  SyntheticKeyframe keyframe_;
+  Mesher mesher_;
+};
+
+TEST_F(MesherParallelFixture, calculateNormalsSameAsSequential) {
+  cv::setNumThreads(1);
+  std::vector<cv::Point3f> sequential_normals;
+  mesher_.calculateNormals(&sequential_normals);
+  cv::setNumThreads(kNrThreads);
+  std::vector<cv::Point3f> parallel_normals;
+  mesher_.calculateNormals(&parallel_normals);
+
+  ASSERT_EQ(sequential_normals.size(),
+            mesher_.get3DMesh().getNumberOfPolygons());
+  EXPECT_EQ(sequential_normals, parallel_normals);
+}
+
+TEST_F(MesherParallelFixture, clusterNormalsSameAsSequential) {
+  std::vector<cv::Point3f> normals;
+  mesher_.calculateNormals(&normals);
+  static const cv::Point3f vertical(0, 0, 1);
+  static constexpr double kTolerance = 0.011;
+
+  cv::setNumThreads(1);
+  std::vector<int> sequential_floor, sequential_walls;
+  mesher_.clusterNormalsAroundAxis(
+      vertical, normals, kTolerance, &sequential_floor);
+  mesher_.clusterNormalsPerpendicularToAxis(
+      vertical, normals, kTolerance, &sequential_walls);
+  cv::setNumThreads(kNrThreads);
+  std::vector<int> parallel_floor, parallel_walls;
+  mesher_.clusterNormalsAroundAxis(
+      vertical, normals, kTolerance, &parallel_floor);
+  mesher_.clusterNormalsPerpendicularToAxis(
+      vertical, normals, kTolerance, &parallel_walls);
+
+  EXPECT_FALSE(sequential_floor.empty());
+  EXPECT_FALSE(sequential_walls.empty());
+  EXPECT_EQ(sequential_floor, parallel_floor);
+  EXPECT_EQ(sequential_walls, parallel_walls);
+}
+
+TEST_F(MesherParallelFixture, clusterPlanesSameAsSequential) {
+  // The seed floor is found by associating polygons to planes, the wall is
+  // segmented from the histogram of the polygons that are not on the floor.
+  const Plane seed_floor(gtsam::Symbol('P', 0),
+                         Plane::Normal(0.0, 0.0, 1.0),
+                         1.0,
+                         LandmarkIds(),
+                         0);
+  cv::setNumThreads(1);
+  std::vector<Plane> sequential_planes = {seed_floor};
+  mesher_.clusterPlanesFromMesh(&sequential_planes, keyframe_.points_with_id);
+  cv::setNumThreads(kNrThreads);
+  std::vector<Plane> parallel_planes = {seed_floor};
+  mesher_.clusterPlanesFromMesh(&parallel_planes, keyframe_.points_with_id);
+
+  ASSERT_FALSE(sequential_planes.empty());
+  EXPECT_FALSE(sequential_planes[0].lmk_ids_.empty());
+  ASSERT_EQ(sequential_planes.size(), parallel_planes.size());
+  for (size_t i = 0u; i < sequential_planes.size(); i++) {
+    const Plane& sequential_plane = sequential_planes[i];
+    const Plane& parallel_plane = parallel_planes[i];
+    EXPECT_EQ(sequential_plane.getPlaneSymbol(),
+              parallel_plane.getPlaneSymbol());
+    EXPECT_EQ(sequential_plane.normal_, parallel_plane.normal_);
+    EXPECT_EQ(sequential_plane.distance_, parallel_plane.distance_);
+    EXPECT_EQ(sequential_plane.lmk_ids_, parallel_plane.lmk_ids_);
+    EXPECT_EQ(sequential_plane.triangle_cluster_.triangle_ids_,
+              parallel_plane.triangle_cluster_.triangle_ids_);
+  }
+}
+
 }  // namespace VIO
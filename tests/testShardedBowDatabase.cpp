@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testShardedBowDatabase.cpp
+ * @brief  Test the sharded BoW database against the OrbDatabase.
+ * @author Antoni Rosinol
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/loopclosure/ShardedBowDatabase.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class ShardedBowDatabaseFixture : public ::testing::Test {
+ public:
+  ShardedBowDatabaseFixture() {
+    vocabulary_.load(FLAGS_test_data_path +
+                     "/ForLoopClosureDetector/small_voc.yml.gz");
+
+    // Random sets of ORB descriptors, always the same.
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    for (size_t i = 0u; i < 40u; i++) {
+      std::vector<cv::Mat> descriptors;
+      for (size_t j = 0u; j < 50u; j++) {
+        cv::Mat descriptor(1, 32, CV_8U);
+        for (int k = 0; k < descriptor.cols; k++) {
+          descriptor.at<uchar>(0, k) = static_cast<uchar>(byte_dist(rng));
+        }
+        descriptors.push_back(descriptor);
+      }
+      DBoW2::BowVector bow_vec;
+      vocabulary_.transform(descriptors, bow_vec);
+      bow_vecs_.push_back(bow_vec);
+    }
+  }
+
+ protected:
+  OrbVocabulary vocabulary_;
+  std::vector<DBoW2::BowVector> bow_vecs_;
+};
+
+TEST_F(ShardedBowDatabaseFixture, sameResultsAsOrbDatabase) {
+  ASSERT_FALSE(vocabulary_.empty());
+  OrbDatabase orb_db(vocabulary_);
+  ShardedBowDatabase sharded_db(&vocabulary_, 7u, 1.0, 1u);
+  for (const DBoW2::BowVector& bow_vec : bow_vecs_) {
+    orb_db.add(bow_vec);
+    sharded_db.add(bow_vec);
+  }
+  EXPECT_EQ(sharded_db.size(), orb_db.size());
+  EXPECT_EQ(sharded_db.nrShards(), 6u);
+
+  for (int max_id : {-1, 0, 10, 30}) {
+    DBoW2::QueryResults orb_results, sharded_results;
+    orb_db.query(bow_vecs_[5], orb_results, 10, max_id);
+    sharded_db.query(bow_vecs_[5], &sharded_results, 10, max_id);
+    ASSERT_EQ(sharded_results.size(), orb_results.size());
+    for (size_t i = 0u; i < orb_results.size(); i++) {
+      EXPECT_NEAR(sharded_results[i].Score, orb_results[i].Score, 1e-9);
+    }
+  }
+
+  // The BoW vectors can be recovered, e.g. for snapshots.
+  std::vector<DBoW2::BowVector> bow_vecs;
+  sharded_db.getBowVectors(&bow_vecs);
+  ASSERT_EQ(bow_vecs.size(), bow_vecs_.size());
+  for (size_t i = 0u; i < bow_vecs.size(); i++) {
+    EXPECT_EQ(bow_vecs[i], bow_vecs_[i]);
+  }
+}
+
+TEST_F(ShardedBowDatabaseFixture, onlyQueriesNearbyShards) {
+  // Shards of 10 entries, 100 m apart, and a global sweep every 3 queries.
+  ShardedBowDatabase sharded_db(&vocabulary_, 10u, 5.0, 3u);
+  for (size_t i = 0u; i < bow_vecs_.size(); i++) {
+    const gtsam::Point3 W_position(100.0 * (i / 10u), 0.0, 0.0);
+    sharded_db.add(bow_vecs_[i], &W_position);
+  }
+
+  // The first query is a global sweep.
+  const gtsam::Point3 W_position(0.0, 0.0, 0.0);
+  DBoW2::QueryResults results;
+  sharded_db.query(bow_vecs_[25], &results, 0, -1, &W_position);
+  ASSERT_FALSE(results.empty());
+  EXPECT_EQ(results[0].Id, 25u);
+
+  // Entry 25 is in the third shard, far from the query position.
+  sharded_db.query(bow_vecs_[25], &results, 0, -1, &W_position);
+  for (const DBoW2::Result& result : results) {
+    EXPECT_LT(result.Id, 10u);
+  }
+
+  // Once the trajectory moves the third shard to the query, it is found.
+  PgoTrajectory::ConstPtr trajectory = std::make_shared<PgoTrajectory>();
+  for (size_t i = 0u; i < bow_vecs_.size(); i++) {
+    const double x = (i >= 20u && i < 30u) ? 1.0 : 100.0;
+    trajectory =
+        trajectory->append(gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(x, 0, 0)));
+  }
+  sharded_db.updatePositions(*trajectory);
+  sharded_db.query(bow_vecs_[25], &results, 0, -1, &W_position);
+  ASSERT_FALSE(results.empty());
+  EXPECT_EQ(results[0].Id, 25u);
+  for (const DBoW2::Result& result : results) {
+    EXPECT_GE(result.Id, 20u);
+    EXPECT_LT(result.Id, 30u);
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadLocalStatistics.cpp
+ * @brief  test ThreadLocalStatistics
+ * @author Antoni Rosinol
+ */
+
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/ThreadLocalStatistics.h"
+
+namespace VIO {
+
+/* ************************************************************************** */
+TEST(testThreadLocalStatistics, aggregateSamplesSingleThread) {
+  for (size_t i = 0u; i < 10u; ++i) {
+    KIMERA_STATS_SAMPLE("testThreadLocalStatistics single", i);
+  }
+  KIMERA_STATS_FLUSH();
+  utils::StatsAggregate aggregate =
+      utils::Statistics::GetAggregate("testThreadLocalStatistics single");
+#if ENABLE_STATISTICS
+  EXPECT_EQ(aggregate.count_, 10u);
+  EXPECT_DOUBLE_EQ(aggregate.sum_, 45.0);
+  EXPECT_DOUBLE_EQ(aggregate.Mean(), 4.5);
+  EXPECT_DOUBLE_EQ(aggregate.min_, 0.0);
+  EXPECT_DOUBLE_EQ(aggregate.max_, 9.0);
+#else
+  EXPECT_EQ(aggregate.count_, 0u);
+#endif
+}
+
+/* ************************************************************************** */
+TEST(testThreadLocalStatistics, aggregateSamplesMultiThread) {
+  static constexpr size_t kNumThreads = 4u;
+  static constexpr size_t kNumSamples = 1000u;
+  std::vector<std::thread> threads;
+  for (size_t t = 0u; t < kNumThreads; ++t) {
+    threads.emplace_back([]() {
+      for (size_t i = 0u; i < kNumSamples; ++i) {
+        KIMERA_STATS_INCREMENT("testThreadLocalStatistics multi");
+      }
+      // Thread exit flushes the thread-local buffer.
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  utils::StatsAggregate aggregate =
+      utils::Statistics::GetAggregate("testThreadLocalStatistics multi");
+#if ENABLE_STATISTICS
+  EXPECT_EQ(aggregate.count_, kNumThreads * kNumSamples);
+  EXPECT_DOUBLE_EQ(aggregate.sum_, kNumThreads * kNumSamples);
+  EXPECT_DOUBLE_EQ(aggregate.Variance(), 0.0);
+#else
+  EXPECT_EQ(aggregate.count_, 0u);
+#endif
+}
+
+/* ************************************************************************** */
+TEST(testThreadLocalStatistics, mergeAggregatesWithSamples) {
+  // The same tag gets regular samples and thread-local aggregates.
+  utils::StatsCollector collector("testThreadLocalStatistics merged");
+  collector.AddSample(10.0);
+  collector.AddSample(20.0);
+  for (const double& sample : {0.0, 30.0}) {
+    KIMERA_STATS_SAMPLE("testThreadLocalStatistics merged", sample);
+  }
+  KIMERA_STATS_FLUSH();
+  utils::StatsAggregate aggregate = utils::Statistics::GetMergedAggregate(
+      "testThreadLocalStatistics merged");
+#if ENABLE_STATISTICS
+  EXPECT_EQ(aggregate.count_, 4u);
+  EXPECT_DOUBLE_EQ(aggregate.sum_, 60.0);
+  EXPECT_DOUBLE_EQ(aggregate.Mean(), 15.0);
+  EXPECT_DOUBLE_EQ(aggregate.min_, 0.0);
+  EXPECT_DOUBLE_EQ(aggregate.max_, 30.0);
+  EXPECT_GT(aggregate.Variance(), 0.0);
+#else
+  EXPECT_EQ(aggregate.count_, 0u);
+#endif
+}
+
+}  // namespace VIO
@@ -0,0 +1,154 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testTriangleFilter.cpp
+ * @brief  Test the batched filters of bad triangles.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+#include <gtsam/geometry/Point3.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/geometry/Rot3.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/mesh/TriangleFilter.h"
+#include "kimera-vio/utils/UtilsGeometry.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO {
+
+TEST(testTriangleFilter, filterBadTriangles) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> center_dist(-3.0f, 3.0f);
+  std::uniform_real_distribution<float> offset_dist(-1.0f, 1.0f);
+  const gtsam::Pose3 left_camera_pose(gtsam::Rot3::Ypr(0.3, -0.2, 0.1),
+                                      gtsam::Point3(0.1, -0.2, -4.0));
+  static constexpr double kMinRatio = 0.3;
+  static constexpr double kMinElongationRatio = 0.5;
+  static constexpr double kMaxTriangleSide = 2.0;
+
+  // Not a multiple of the SIMD width, to check the remaining triangles too.
+  TrianglesSoA triangles;
+  std::vector<std::array<cv::Point3f, 3>> vertices;
+  for (size_t i = 0u; i < 1003u; i++) {
+    const cv::Point3f center(
+        center_dist(rng), center_dist(rng), center_dist(rng));
+    std::array<cv::Point3f, 3> triangle;
+    for (cv::Point3f& vertex : triangle) {
+      vertex = center + cv::Point3f(offset_dist(rng),
+                                    offset_dist(rng),
+                                    offset_dist(rng));
+    }
+    vertices.push_back(triangle);
+    triangles.push_back(triangle[0], triangle[1], triangle[2]);
+  }
+  ASSERT_EQ(triangles.size(), vertices.size());
+
+  std::vector<uint8_t> keep;
+  TriangleFilter::filterBadTriangles(triangles,
+                                     left_camera_pose,
+                                     kMinRatio,
+                                     kMinElongationRatio,
+                                     kMaxTriangleSide,
+                                     &keep);
+  ASSERT_EQ(keep.size(), vertices.size());
+
+  size_t nr_kept = 0u;
+  for (size_t i = 0u; i < vertices.size(); i++) {
+    const std::array<cv::Point3f, 3>& triangle = vertices[i];
+    std::array<double, 3> sides;
+    std::vector<gtsam::Point3> points_C;
+    for (size_t k = 0u; k < 3u; k++) {
+      sides[k] = cv::norm(triangle[k] - triangle[(k + 1u) % 3u]);
+      points_C.push_back(left_camera_pose.transformTo(
+          gtsam::Point3(triangle[k].x, triangle[k].y, triangle[k].z)));
+    }
+    const double min_side = *std::min_element(sides.begin(), sides.end());
+    const double max_side = *std::max_element(sides.begin(), sides.end());
+    const double elongation_ratio =
+        UtilsGeometry::getRatioBetweenTangentialAndRadialDisplacement(
+            points_C);
+    const double sides_ratio = min_side / max_side;
+
+    // Single precision might not agree at the thresholds.
+    static constexpr double kTol = 1e-4;
+    if (std::abs(sides_ratio - kMinRatio) < kTol ||
+        std::abs(elongation_ratio - kMinElongationRatio) < kTol ||
+        std::abs(max_side - kMaxTriangleSide) < kTol) {
+      continue;
+    }
+    const bool is_good = sides_ratio >= kMinRatio &&
+                         elongation_ratio >= kMinElongationRatio &&
+                         max_side <= kMaxTriangleSide;
+    EXPECT_EQ(static_cast<bool>(keep[i]), is_good) << "Triangle " << i;
+    if (is_good) nr_kept++;
+  }
+  EXPECT_GT(nr_kept, 0u);
+  EXPECT_LT(nr_kept, vertices.size());
+
+  // Disabled checks keep all triangles.
+  TriangleFilter::filterBadTriangles(
+      triangles, left_camera_pose, -1.0, -1.0, 0.0, &keep);
+  EXPECT_EQ(std::count(keep.begin(), keep.end(), 1u),
+            static_cast<long>(vertices.size()));
+}
+
+TEST(testTriangleFilter, filterTrianglesWithGradients) {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> intensity_dist(0, 255);
+  cv::Mat img_grads(120, 160, CV_8UC1);
+  for (int r = 0; r < img_grads.rows; r++) {
+    for (int c = 0; c < img_grads.cols; c++) {
+      img_grads.at<uint8_t>(r, c) = intensity_dist(rng) < 250 ? 0u : 255u;
+    }
+  }
+
+  std::uniform_real_distribution<float> x_dist(0.0f, img_grads.cols - 1);
+  std::uniform_real_distribution<float> y_dist(0.0f, img_grads.rows - 1);
+  std::vector<cv::Vec6f> triangulation_2D;
+  for (size_t i = 0u; i < 500u; i++) {
+    triangulation_2D.push_back(cv::Vec6f(x_dist(rng),
+                                         y_dist(rng),
+                                         x_dist(rng),
+                                         y_dist(rng),
+                                         x_dist(rng),
+                                         y_dist(rng)));
+  }
+
+  static constexpr float kGradientBound = 50.0f;
+  for (const size_t max_keypoints_with_gradient : {0u, 3u, 20u}) {
+    std::vector<uint8_t> keep;
+    TriangleFilter::filterTrianglesWithGradients(img_grads,
+                                                 triangulation_2D,
+                                                 kGradientBound,
+                                                 max_keypoints_with_gradient,
+                                                 &keep);
+    ASSERT_EQ(keep.size(), triangulation_2D.size());
+    for (size_t i = 0u; i < triangulation_2D.size(); i++) {
+      const size_t nr_keypoints_with_gradient =
+          UtilsOpenCV::FindHighIntensityInTriangle(
+              img_grads, triangulation_2D[i], kGradientBound)
+              .size();
+      EXPECT_EQ(static_cast<bool>(keep[i]),
+                nr_keypoints_with_gradient <= max_keypoints_with_gradient)
+          << "Triangle " << i;
+    }
+  }
+}
+
+}  // namespace VIO
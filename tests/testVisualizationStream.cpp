@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testVisualizationStream.cpp
+ * @brief  Test the stream of the headless visualizer.
+ * @author Antoni Rosinol
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/visualizer/VisualizationStream.h"
+
+#include "TemporaryDirectory.h"
+
+namespace VIO {
+
+VisualizationPayload::UniquePtr makePayload(const Timestamp& timestamp) {
+  VisualizationPayload::UniquePtr payload =
+      VIO::make_unique<VisualizationPayload>(timestamp);
+  payload->W_Pose_Blkf_ = {{1.0, 2.0, 3.0, 0.5, 0.5, 0.5, 0.5}};
+  payload->landmark_ids_ = {4, 8};
+  payload->landmarks_ = {0.1f, 0.2f, 0.3f, -1.0f, -2.0f, -3.0f};
+  payload->landmark_types_ = {0u, 1u};
+  payload->mesh_.timestamp_ = timestamp;
+  payload->mesh_.vertices_ = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                              0.0f, 1.0f, 0.0f};
+  payload->mesh_.colors_ = std::vector<uint8_t>(9u, 255u);
+  payload->mesh_.faces_ = {0u, 1u, 2u};
+  return payload;
+}
+
+void expectEqualPayloads(const VisualizationPayload& expected,
+                         const VisualizationPayload& actual) {
+  EXPECT_EQ(actual.timestamp_, expected.timestamp_);
+  EXPECT_EQ(actual.W_Pose_Blkf_, expected.W_Pose_Blkf_);
+  EXPECT_EQ(actual.landmark_ids_, expected.landmark_ids_);
+  EXPECT_EQ(actual.landmarks_, expected.landmarks_);
+  EXPECT_EQ(actual.landmark_types_, expected.landmark_types_);
+  EXPECT_EQ(actual.mesh_.timestamp_, expected.mesh_.timestamp_);
+  EXPECT_EQ(actual.mesh_.vertices_, expected.mesh_.vertices_);
+  EXPECT_EQ(actual.mesh_.colors_, expected.mesh_.colors_);
+  EXPECT_EQ(actual.mesh_.faces_, expected.mesh_.faces_);
+}
+
+TEST(testVisualizationStream, serialize) {
+  VisualizationPayload::UniquePtr payload = makePayload(1000);
+  std::vector<char> record;
+  VisualizationStream::serialize(*payload, &record);
+  VisualizationPayload::UniquePtr deserialized_payload =
+      VisualizationStream::deserialize(record);
+  ASSERT_TRUE(deserialized_payload);
+  expectEqualPayloads(*payload, *deserialized_payload);
+
+  // Truncated or corrupted records are rejected.
+  record.pop_back();
+  EXPECT_FALSE(VisualizationStream::deserialize(record));
+  VisualizationStream::serialize(*payload, &record);
+  record.back() = 3;  // Vertex id out of range.
+  EXPECT_FALSE(VisualizationStream::deserialize(record));
+}
+
+TEST(testVisualizationStream, file) {
+  TemporaryDirectory output_dir("testVisualizationStream");
+  const std::string filename = output_dir.getPath() + "/viz.bin";
+
+  VisualizationPayload::UniquePtr first_payload = makePayload(1000);
+  VisualizationPayload::UniquePtr second_payload = makePayload(2000);
+  second_payload->landmark_ids_.clear();
+  second_payload->landmarks_.clear();
+  second_payload->landmark_types_.clear();
+  {
+    VisualizationStream stream(filename);
+    EXPECT_TRUE(stream.send(*first_payload));
+    EXPECT_TRUE(stream.send(*second_payload));
+  }
+
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  std::vector<VisualizationPayload::UniquePtr> payloads;
+  ASSERT_TRUE(VisualizationStream::readPayloads(&file, &payloads));
+  ASSERT_EQ(payloads.size(), 2u);
+  expectEqualPayloads(*first_payload, *payloads[0]);
+  expectEqualPayloads(*second_payload, *payloads[1]);
+}
+
+TEST(testVisualizationStream, socket) {
+  TemporaryDirectory output_dir("testVisualizationStream");
+  const std::string socket_path = output_dir.getPath() + "/viz.sock";
+  VisualizationStream stream("unix:" + socket_path);
+
+  // Nobody listens yet: the payload is dropped, without blocking.
+  VisualizationPayload::UniquePtr payload = makePayload(1000);
+  EXPECT_FALSE(stream.send(*payload));
+  EXPECT_EQ(stream.getNumberOfDroppedPayloads(), 1u);
+
+  // A consumer starts listening: the stream connects at the next payload.
+  const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(listen_fd, 0);
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(
+      address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1u);
+  ASSERT_EQ(bind(listen_fd,
+                 reinterpret_cast<const sockaddr*>(&address),
+                 sizeof(address)),
+            0);
+  ASSERT_EQ(listen(listen_fd, 1), 0);
+  EXPECT_TRUE(stream.send(*payload));
+  const int consumer_fd = accept(listen_fd, nullptr, nullptr);
+  ASSERT_GE(consumer_fd, 0);
+
+  // The payload is small enough to be all in the socket buffer already.
+  std::string received;
+  char buffer[4096];
+  ssize_t nr_received = 0;
+  while ((nr_received = recv(consumer_fd, buffer, sizeof(buffer),
+                             MSG_DONTWAIT)) > 0) {
+    received.append(buffer, nr_received);
+  }
+  std::istringstream received_stream(received);
+  std::vector<VisualizationPayload::UniquePtr> payloads;
+  ASSERT_TRUE(VisualizationStream::readPayloads(&received_stream, &payloads));
+  ASSERT_EQ(payloads.size(), 1u);
+  expectEqualPayloads(*payload, *payloads[0]);
+
+  close(consumer_fd);
+  close(listen_fd);
+}
+
+}  // namespace VIO